@@ -31,6 +31,7 @@
 #include "catcoc/comm_epilogue/block/comm_block_swizzle.hpp"
 #include "catcoc/comm_epilogue/tile/tile_remote_copy.hpp"
 #include "catcoc/detail/remote_copy_type.hpp"
+#include "catcoc/dgemm/device/device_dgemm.hpp"
 #include "catcoc/dgemm/kernel/matmul_allreduce.hpp"
 
 static uint32_t gNpuNum = 8;
@@ -39,7 +40,6 @@ static uint64_t gNpuMallocSpace = 1024UL * 1024UL * 1024;
 using namespace AscendC;
 using namespace Catcoc;
 
-constexpr uint32_t BLOCK_NUM = 20;
 constexpr int32_t BLOCK_SIZE_16 = 16;
 
 using LayoutA = Catlass::layout::RowMajor;
@@ -47,126 +47,71 @@ using LayoutB = Catlass::layout::RowMajor;
 using LayoutC = Catlass::layout::RowMajor;
 using LayoutD = Catlass::layout::RowMajor;
 
-CATLASS_GLOBAL
-void ShmemMatmulAllReduce(
-    uint64_t fftsAddr,
-    GM_ADDR a, GM_ADDR b, GM_ADDR c, GM_ADDR symmetricPtr,
-    uint32_t m, uint32_t n, uint32_t k
-)
-{
-    // Set FFTS address
-    AscendC::SetSyncBaseAddr(fftsAddr);
-
-    // Define ArchTag
-    using ArchTag = Catlass::Arch::AtlasA2;
-
-    Catlass::GemmCoord problemShape{m, n, k};
-
-    // Prepare comm address
-    uint32_t rank = shmem_my_pe();
-    uint32_t rankSize = shmem_n_pes();
-    using ElementC = half;
-
-    // Block level, Define the layout of each input matrix
-    Catlass::layout::RowMajor layoutA{m, k, k};
-    Catlass::layout::RowMajor layoutB{k, n, n};
-    Catlass::layout::RowMajor layoutC{m, n, n};
-
-    // Block level, define BlockMmad
-    constexpr bool enableUnitFlag = true;
-    using MmadDispatchPolicy = Catlass::Gemm::MmadAtlasA2Pingpong<enableUnitFlag>;
-    using L1TileShape = Catlass::GemmShape<128, 256, 256>;
-    using L0TileShape = Catlass::GemmShape<128, 256, 64>;
-    using AType = Catlass::Gemm::GemmType<half, LayoutA>;
-    using BType = Catlass::Gemm::GemmType<half, LayoutB>;
-    using CType = Catlass::Gemm::GemmType<half, LayoutC>;
-    using DType = Catlass::Gemm::GemmType<half, LayoutD>;
-    using BlockMmad = Catlass::Gemm::Block::BlockMmad<MmadDispatchPolicy, L1TileShape, L0TileShape, AType, BType, CType>;
-
-    using BlockScheduler = typename Catlass::Gemm::Block::GemmIdentityBlockSwizzle<7, 1>;
-    using CommBlockScheduler = CommEpilogue::Block::BlockCommSwizzle<0>;
-
-    using RemoteSrcType = CType;
-    using RemoteDstType = DType;
-    using CopyDirect = Catcoc::detail::CopyDirect;
-    using TileRemoteCopy = CommEpilogue::Tile::TileRemoteCopy<ArchTag, RemoteSrcType, RemoteDstType, CopyDirect::Get>;
-    using TileScheduler = Catlass::Epilogue::Tile::EpilogueIdentityTileSwizzle;
-
-    using CommBlockShape = Catlass::MatrixShape<64, 256>;
-    using CommCoreSplit = Catlass::MatrixShape<20, 1>;
-
-    constexpr uint32_t ubStages = 2;
-    constexpr bool isDynamic = false;
-    using ReduceScatterTileShape = Catlass::MatrixShape<32, 256>;
-    using ReduceScatterDispatch = CommEpilogue::EpilogueAtlasA2CommToShareMem<ubStages,
-        Catcoc::detail::CopyMode::Scatter, isDynamic>;
-    using BlockEpilogueReduceScatter = CommEpilogue::Block::CommBlockEpilogue<
-        ReduceScatterDispatch,
-        RemoteSrcType, RemoteDstType,
-        CommCoreSplit,
-        CommBlockShape,
-        ReduceScatterTileShape, TileRemoteCopy, TileScheduler,
-        BlockScheduler
-    >;
-
-    using AllGatherTileShape = Catlass::MatrixShape<32, 256>;
-    using AllGatherDispatch = CommEpilogue::EpilogueAtlasA2CommToLocalMem<ubStages, 
-        Catcoc::detail::CopyMode::Gather, isDynamic>;
-    using BlockEpilogueAllGather = CommEpilogue::Block::CommBlockEpilogue<
-        AllGatherDispatch,
-        RemoteSrcType, RemoteDstType,
-        CommCoreSplit,
-        CommBlockShape,
-        AllGatherTileShape, TileRemoteCopy, TileScheduler,
-        BlockScheduler
-    >;
-
-    constexpr uint32_t workspaceStages = 2;
-    constexpr uint32_t commInterval = 3;
-    using MatmulAllReduceKernel = DGemm::Kernel::MatmulAllReduce<
-        BlockMmad,
-        BlockEpilogueReduceScatter,
-        BlockEpilogueAllGather,
-        BlockScheduler,
-        CommBlockScheduler,
-        workspaceStages
-    >;
-    BlockScheduler matmulBlockScheduler(problemShape, Catlass::MakeCoord(L1TileShape::M, L1TileShape::N));
-
-    Catlass::layout::RowMajor layoutPeerMemStore{
-        L1TileShape::M * commInterval * BLOCK_NUM * workspaceStages, L1TileShape::N,
-        L1TileShape::N
-    };
-
-    typename BlockEpilogueAllGather::Params allGatherParams{
-        reinterpret_cast<__gm__ ElementC *>(symmetricPtr),
-        layoutPeerMemStore,
-        matmulBlockScheduler
-    };
-
-    typename BlockEpilogueReduceScatter::Params reduceScatterParams{
-        reinterpret_cast<__gm__ ElementC *>(symmetricPtr),
-        layoutPeerMemStore,
-        matmulBlockScheduler
-    };
-
-    // Prepare params
-    typename MatmulAllReduceKernel::Params params{
-        problemShape,
-        rank, rankSize,
-        a, layoutA,
-        b, layoutB,
-        symmetricPtr,
-        reduceScatterParams,
-        allGatherParams,
-        c, layoutC,
-        commInterval
-    };
-
-    // Call kernel
-    MatmulAllReduceKernel matmulCommKernel;
-    matmulCommKernel(params);
-}
+// Shared by the kernel and the host, which sizes the symmetric workspace from them
+using L1TileShape = Catlass::GemmShape<128, 256, 256>;
+constexpr uint32_t workspaceStages = 2;
+constexpr uint32_t commInterval = 3;
+
+using ArchTag = Catlass::Arch::AtlasA2;
+
+// Block level, define BlockMmad
+constexpr bool enableUnitFlag = true;
+using MmadDispatchPolicy = Catlass::Gemm::MmadAtlasA2Pingpong<enableUnitFlag>;
+using L0TileShape = Catlass::GemmShape<128, 256, 64>;
+using AType = Catlass::Gemm::GemmType<half, LayoutA>;
+using BType = Catlass::Gemm::GemmType<half, LayoutB>;
+using CType = Catlass::Gemm::GemmType<half, LayoutC>;
+using DType = Catlass::Gemm::GemmType<half, LayoutD>;
+using BlockMmad = Catlass::Gemm::Block::BlockMmad<MmadDispatchPolicy, L1TileShape, L0TileShape, AType, BType, CType>;
+
+using BlockScheduler = typename Catlass::Gemm::Block::GemmIdentityBlockSwizzle<7, 1>;
+using CommBlockScheduler = CommEpilogue::Block::BlockCommSwizzle<0>;
+
+using RemoteSrcType = CType;
+using RemoteDstType = DType;
+using CopyDirect = Catcoc::detail::CopyDirect;
+using TileRemoteCopy = CommEpilogue::Tile::TileRemoteCopy<ArchTag, RemoteSrcType, RemoteDstType, CopyDirect::Get>;
+using TileScheduler = Catlass::Epilogue::Tile::EpilogueIdentityTileSwizzle;
+
+using CommBlockShape = Catlass::MatrixShape<64, 256>;
+// Cores of the comm epilogue, the launch must provide at least that many
+using CommCoreSplit = Catlass::MatrixShape<20, 1>;
+
+constexpr uint32_t ubStages = 2;
+constexpr bool isDynamic = false;
+using ReduceScatterTileShape = Catlass::MatrixShape<32, 256>;
+using ReduceScatterDispatch = CommEpilogue::EpilogueAtlasA2CommToShareMem<ubStages,
+    Catcoc::detail::CopyMode::Scatter, isDynamic>;
+using BlockEpilogueReduceScatter = CommEpilogue::Block::CommBlockEpilogue<
+    ReduceScatterDispatch,
+    RemoteSrcType, RemoteDstType,
+    CommCoreSplit,
+    CommBlockShape,
+    ReduceScatterTileShape, TileRemoteCopy, TileScheduler,
+    BlockScheduler
+>;
+
+using AllGatherTileShape = Catlass::MatrixShape<32, 256>;
+using AllGatherDispatch = CommEpilogue::EpilogueAtlasA2CommToLocalMem<ubStages,
+    Catcoc::detail::CopyMode::Gather, isDynamic>;
+using BlockEpilogueAllGather = CommEpilogue::Block::CommBlockEpilogue<
+    AllGatherDispatch,
+    RemoteSrcType, RemoteDstType,
+    CommCoreSplit,
+    CommBlockShape,
+    AllGatherTileShape, TileRemoteCopy, TileScheduler,
+    BlockScheduler
+>;
+
+using MatmulAllReduceKernel = DGemm::Kernel::MatmulAllReduce<
+    BlockMmad,
+    BlockEpilogueReduceScatter,
+    BlockEpilogueAllGather,
+    BlockScheduler,
+    CommBlockScheduler,
+    workspaceStages
+>;
+using MatmulAllReduce = DGemm::Device::DeviceDGemm<MatmulAllReduceKernel>;
 
 struct Options {
     static constexpr auto helper = "Usage: matmul_allreduce m n k transA transB\n";
@@ -246,6 +191,13 @@ int main(int argc, char **argv)
     uint32_t fftsLen{0};
     RT_CHECK(rtGetC2cCtrlAddr(&fftsAddr, &fftsLen));
 
+    // Launch on every AI core of the device, the comm core split of the kernel has to fit in it
+    uint32_t coreNum = GetLaunchCoreNum(deviceId);
+    if (coreNum < CommCoreSplit::COUNT) {
+        ERROR_LOG("The comm core split needs %ld cores, %u can be launched.", CommCoreSplit::COUNT, coreNum);
+        return -1;
+    }
+
     size_t aSize = static_cast<size_t>(m) * k * sizeof(__fp16);
     size_t bSize = static_cast<size_t>(k) * n * sizeof(__fp16);
     size_t cSize = static_cast<size_t>(m) * n * sizeof(__fp16);
@@ -271,13 +223,27 @@ int main(int argc, char **argv)
     ReadFile("./output/c_gm.bin", cHost, cSize);
     ACL_CHECK(aclrtMemcpy(cDevice, cSize, cHost, cSize, ACL_MEMCPY_HOST_TO_DEVICE));
 
-    void *symmPtr = shmem_malloc((204 * 1024 * 1024) * sizeof(__fp16));
+    MatmulAllReduceKernel::Arguments args{
+        Catlass::GemmCoord{m, n, k},
+        static_cast<uint32_t>(rankId), static_cast<uint32_t>(rankSize), coreNum,
+        aDevice, bDevice, cDevice,
+        commInterval, workspaceStages
+    };
+    MatmulAllReduce matmulAllReduce;
+    if (MatmulAllReduce::CanImplement(args) != Catlass::Status::kSuccess) {
+        std::cerr << "[ERROR] MatmulAllReduce cannot implement m = " << m << ", n = " << n << ", k = " << k << "\n";
+        return -1;
+    }
+
+    // Reserve exactly the symmetric memory this launch touches
+    size_t workspaceSize = MatmulAllReduce::GetWorkspaceSize(args);
+    void *symmPtr = shmem_malloc(workspaceSize);
     uint8_t *symmetricPtr = (uint8_t *)symmPtr;
+    matmulAllReduce.Initialize(args, symmetricPtr);
 
     ACL_CHECK(aclrtSynchronizeStream(stream));
     for (int i = 0; i < 1; i++) {
-        ShmemMatmulAllReduce<<<BLOCK_NUM, nullptr, stream>>>(fftsAddr,
-            aDevice, bDevice, cDevice, symmetricPtr, m, n, k);
+        matmulAllReduce(stream, fftsAddr);
     }
     ACL_CHECK(aclrtSynchronizeStream(stream));
 
@@ -30,7 +30,9 @@
 #include "catcoc/comm_epilogue/block/comm_block_swizzle.hpp"
 #include "catcoc/comm_epilogue/tile/tile_remote_copy.hpp"
 #include "catcoc/detail/remote_copy_type.hpp"
+#include "catcoc/detail/rank_partition.hpp"
 #include "catcoc/dgemm/block/block_swizzle_allgather.hpp"
+#include "catcoc/dgemm/workspace_size.hpp"
 #include "catcoc/dgemm/kernel/allgather_matmul.hpp"
 
 static uint32_t gNpuNum = 8;
@@ -39,7 +41,6 @@ static uint64_t gNpuMallocSpace = 1024UL * 1024UL * 1024;
 using namespace AscendC;
 using namespace Catcoc;
 
-constexpr uint32_t BLOCK_NUM = 20;
 constexpr int32_t BLOCK_SIZE_16 = 16;
 
 using LayoutA = Catlass::layout::RowMajor;
@@ -47,6 +48,13 @@ using LayoutB = Catlass::layout::RowMajor;
 using LayoutC = Catlass::layout::RowMajor;
 using LayoutD = Catlass::layout::RowMajor;
 
+// Shared by the kernel and the host, which sizes the symmetric workspace from them
+using L1TileShape = Catlass::GemmShape<128, 256, 256>;
+// Cores of the comm epilogue, the launch must provide at least that many
+using CommCoreSplit = Catlass::MatrixShape<20, 1>;
+constexpr uint32_t workspaceStages = 2;
+constexpr uint32_t commInterval = 1;
+
 CATLASS_GLOBAL
 void ShmemAllGatherMatmul(
     uint64_t fftsAddr,
@@ -60,22 +68,24 @@ void ShmemAllGatherMatmul(
     // Define ArchTag
     using ArchTag = Catlass::Arch::AtlasA2;
 
-    Catlass::GemmCoord problemShape{m, n, k};
-
     // Prepare comm address
     uint32_t rank = shmem_my_pe();
     uint32_t rankSize = shmem_n_pes();
     using ElementC = half;
 
+    // m is the row count of the local A, the gathered problem stacks the A of every rank
+    Catlass::GemmCoord problemShape{m * rankSize, n, k};
+    Catcoc::detail::RankPartition rankPartition(problemShape.m(), rankSize);
+    uint32_t mInRank = rankPartition.GetExtent(rank);
+
     // Block level, Define the layout of each input matrix
-    Catlass::layout::RowMajor layoutA{m, k, k};
+    Catlass::layout::RowMajor layoutA{mInRank, k, k};
     Catlass::layout::RowMajor layoutB{k, n, n};
-    Catlass::layout::RowMajor layoutC{m * rankSize, n, n};
+    Catlass::layout::RowMajor layoutC{problemShape.m(), n, n};
 
     // Block level, define BlockMmad
     constexpr bool enableUnitFlag = true;
     using MmadDispatchPolicy = Catlass::Gemm::MmadAtlasA2Pingpong<enableUnitFlag>;
-    using L1TileShape = Catlass::GemmShape<128, 256, 256>;
     using L0TileShape = Catlass::GemmShape<128, 256, 64>;
     using AType = Catlass::Gemm::GemmType<half, LayoutA>;
     using BType = Catlass::Gemm::GemmType<half, LayoutB>;
@@ -97,7 +107,6 @@ void ShmemAllGatherMatmul(
 
     // In allgather, block shape = <?, >=k>
     using CommBlockShape = Catlass::MatrixShape<64, UINT_MAX / 2>;
-    using CommCoreSplit = Catlass::MatrixShape<20, 1>;
 
     constexpr uint32_t ubStages = 2;
     constexpr bool isDynamic = false;
@@ -113,8 +122,6 @@ void ShmemAllGatherMatmul(
         BlockRemapper
     >;
 
-    constexpr uint32_t workspaceStages = 2;
-    constexpr uint32_t commInterval = 1;
     using AllGatherMatmulKernel = DGemm::Kernel::AllGatherMatmul<
         BlockMmad,
         BlockEpilogueAllGather,
@@ -123,9 +130,11 @@ void ShmemAllGatherMatmul(
         workspaceStages
     >;
 
-    Catlass::GemmCoord commProblemShape{problemShape.m(), problemShape.k(), problemShape.k()};
-    BlockRemapper reMapper(commProblemShape,
-        Catlass::MakeCoord(L1TileShape::M, problemShape.k()));
+    // Remap over the tile grid of the largest share, the shape is clipped to the rows owned by this rank
+    Catlass::GemmCoord commProblemShape{mInRank, problemShape.k(), problemShape.k()};
+    Catlass::MatrixCoord commTileMN{L1TileShape::M, problemShape.k()};
+    BlockRemapper reMapper(commProblemShape, commTileMN,
+        CeilDiv(Catlass::MatrixCoord{rankPartition.GetMaxExtent(), problemShape.k()}, commTileMN));
 
     Catlass::layout::RowMajor layoutPeerMemStore{
         L1TileShape::M * commInterval * rankSize * workspaceStages,
@@ -234,6 +243,13 @@ int main(int argc, char **argv)
     uint32_t fftsLen{0};
     RT_CHECK(rtGetC2cCtrlAddr(&fftsAddr, &fftsLen));
 
+    // Launch on every AI core of the device, the comm core split of the kernel has to fit in it
+    uint32_t coreNum = GetLaunchCoreNum(deviceId);
+    if (coreNum < CommCoreSplit::COUNT) {
+        ERROR_LOG("The comm core split needs %ld cores, %u can be launched.", CommCoreSplit::COUNT, coreNum);
+        return -1;
+    }
+
     size_t aSize = static_cast<size_t>(m) * k * sizeof(__fp16);
     size_t bSize = static_cast<size_t>(k) * n * sizeof(__fp16);
     size_t cSize = static_cast<size_t>(m) * rankSize * n * sizeof(__fp16);
@@ -259,12 +275,16 @@ int main(int argc, char **argv)
     ReadFile("./output/c_gm.bin", cHost, cSize);
     ACL_CHECK(aclrtMemcpy(cDevice, cSize, cHost, cSize, ACL_MEMCPY_HOST_TO_DEVICE));
 
-    void *symmPtr = shmem_malloc((204 * 1024 * 1024) * sizeof(__fp16));
+    // Reserve exactly the symmetric memory this launch touches
+    Catcoc::DGemm::WorkspaceDesc workspaceDesc{Catlass::GemmCoord{m * rankSize, n, k}, L1TileShape::ToCoord(),
+        static_cast<uint32_t>(rankSize), coreNum, commInterval, workspaceStages, sizeof(__fp16)};
+    size_t workspaceSize = Catcoc::DGemm::GetAllGatherMatmulWorkspaceSize(workspaceDesc);
+    void *symmPtr = shmem_malloc(workspaceSize);
     uint8_t *symmetricPtr = (uint8_t *)symmPtr;
 
     ACL_CHECK(aclrtSynchronizeStream(stream));
     for (int i = 0; i < 1; i++) {
-        ShmemAllGatherMatmul<<<BLOCK_NUM, nullptr, stream>>>(fftsAddr,
+        ShmemAllGatherMatmul<<<coreNum, nullptr, stream>>>(fftsAddr,
             aDevice, bDevice, cDevice, symmetricPtr, m, n, k);
     }
     ACL_CHECK(aclrtSynchronizeStream(stream));
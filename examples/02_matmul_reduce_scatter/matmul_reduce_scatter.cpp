@@ -3,6 +3,9 @@
 #include <iostream>
 #include <vector>
 #include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
 
 // from catlass
 #include "catlass/catlass.hpp"
@@ -13,6 +16,7 @@
 #include "catlass/gemm/block/block_swizzle.hpp"
 #include "catlass/gemm/dispatch_policy.hpp"
 #include "catlass/gemm/gemm_type.hpp"
+#include "catlass/gemm/kernel/basic_matmul.hpp"
 #include "catlass/layout/layout.hpp"
 
 // shmem_host
@@ -31,6 +35,8 @@
 #include "catcoc/comm_epilogue/block/comm_block_swizzle.hpp"
 #include "catcoc/comm_epilogue/tile/tile_remote_copy.hpp"
 #include "catcoc/detail/remote_copy_type.hpp"
+#include "catcoc/detail/rank_partition.hpp"
+#include "catcoc/dgemm/workspace_size.hpp"
 #include "catcoc/dgemm/kernel/matmul_reduce_scatter.hpp"
 
 static uint32_t gNpuNum = 8;
@@ -39,7 +45,6 @@ block_swizzle.hpp
 using namespace AscendC;
 using namespace Catcoc;
 
-constexpr uint32_t BLOCK_NUM = 20;
 constexpr int32_t BLOCK_SIZE_16 = 16;
 
 using LayoutA = Catlass::layout::RowMajor;
@@ -47,6 +52,38 @@ using LayoutB = Catlass::layout::RowMajor;
 using LayoutC = Catlass::layout::RowMajor;
 using LayoutD = Catlass::layout::RowMajor;
 
+// Shared by the kernel and the host, which sizes the symmetric workspace from them
+using L1TileShape = Catlass::GemmShape<128, 256, 256>;
+// Cores of the comm epilogue, the launch must provide at least that many
+using CommCoreSplit = Catlass::MatrixShape<20, 1>;
+constexpr uint32_t workspaceStages = 2;
+constexpr uint32_t commInterval = 10;
+// Co-run benchmark: untimed launches before the measurement, and launches averaged per measurement
+constexpr uint32_t WARM_UP_TIMES = 5;
+constexpr uint32_t PERF_TEST_CYCLE_TIMES = 20;
+
+// Value of the environment variable name, defaultValue when it is not set. Returns false when it is not a number
+static bool GetEnvUint(const char *name, uint32_t defaultValue, uint32_t &value)
+{
+    const char *env = std::getenv(name);
+    value = defaultValue;
+    if (env == nullptr) {
+        return true;
+    }
+    try {
+        size_t end = 0;
+        unsigned long parsed = std::stoul(env, &end);
+        if (env[end] != '\0' || parsed > UINT32_MAX) {
+            throw std::out_of_range(name);
+        }
+        value = static_cast<uint32_t>(parsed);
+    } catch (const std::exception &) {
+        ERROR_LOG("%s=%s is not an unsigned 32 bit number.", name, env);
+        return false;
+    }
+    return true;
+}
+
 CATLASS_GLOBAL
 void ShmemMatmulReduceScatter(
     uint64_t fftsAddr,
@@ -67,15 +104,17 @@ void ShmemMatmulReduceScatter(
     uint32_t rankSize = shmem_n_pes();
     using ElementC = half;
 
+    // The first m % rankSize ranks own one extra row of the scattered output
+    Catcoc::detail::RankPartition rankPartition(m, rankSize);
+
     // Block level, Define the layout of each input matrix
     Catlass::layout::RowMajor layoutA{m, k, k};
     Catlass::layout::RowMajor layoutB{k, n, n};
-    Catlass::layout::RowMajor layoutC{m / rankSize, n, n};
+    Catlass::layout::RowMajor layoutC{rankPartition.GetExtent(rank), n, n};
 
     // Block level, define BlockMmad
     constexpr bool enableUnitFlag = true;
     using MmadDispatchPolicy = Catlass::Gemm::MmadAtlasA2Pingpong<enableUnitFlag>;
-    using L1TileShape = Catlass::GemmShape<128, 256, 256>;
     using L0TileShape = Catlass::GemmShape<128, 256, 64>;
     using AType = Catlass::Gemm::GemmType<half, LayoutA>;
     using BType = Catlass::Gemm::GemmType<half, LayoutB>;
@@ -94,7 +133,6 @@ void ShmemMatmulReduceScatter(
     using TileScheduler = Catlass::Epilogue::Tile::EpilogueIdentityTileSwizzle;
 
     using CommBlockShape = Catlass::MatrixShape<64, 256>;
-    using CommCoreSplit = Catlass::MatrixShape<20, 1>;
 
     constexpr uint32_t ubStages = 2;
     using ReduceScatterTileShape = Catlass::MatrixShape<32, 256>;
@@ -109,8 +147,6 @@ void ShmemMatmulReduceScatter(
         BlockScheduler
     >;
 
-    constexpr uint32_t workspaceStages = 2;
-    constexpr uint32_t commInterval = 10;
     using MatmulReduceScatterKernel = DGemm::Kernel::MatmulReduceScatter<
         BlockMmad,
         BlockEpilogueReduceScatter,
@@ -118,11 +154,14 @@ void ShmemMatmulReduceScatter(
         CommBlockScheduler,
         workspaceStages
     >;
-    Catlass::GemmCoord problemShapeInRank = problemShape / Catlass::MakeCoord<uint32_t>(rankSize, 1, 1);
-    BlockScheduler matmulBlockScheduler(problemShapeInRank, Catlass::MakeCoord(L1TileShape::M, L1TileShape::N));
+    // Remap over the tile grid of the largest share, the shape is clipped to the rows owned by this rank
+    Catlass::GemmCoord problemShapeInRank{rankPartition.GetExtent(rank), n, k};
+    Catlass::MatrixCoord tileMN{L1TileShape::M, L1TileShape::N};
+    Catlass::MatrixCoord loopsMN = CeilDiv(Catlass::MatrixCoord{rankPartition.GetMaxExtent(), n}, tileMN);
+    BlockScheduler matmulBlockScheduler(problemShapeInRank, tileMN, loopsMN);
 
     Catlass::layout::RowMajor layoutPeerMemStore{
-        L1TileShape::M * commInterval * BLOCK_NUM * workspaceStages, L1TileShape::N,
+        L1TileShape::M * commInterval * AscendC::GetBlockNum() * workspaceStages, L1TileShape::N,
         L1TileShape::N
     };
 
@@ -149,6 +188,35 @@ void ShmemMatmulReduceScatter(
     matmulCommKernel(params);
 }
 
+// Independent matmul co-launched with the comm kernel on the cores it leaves free, stands in for
+// unrelated work of the same layer such as attention
+CATLASS_GLOBAL
+void CoRunMatmul(GM_ADDR a, GM_ADDR b, GM_ADDR c, uint32_t m, uint32_t n, uint32_t k)
+{
+    using ArchTag = Catlass::Arch::AtlasA2;
+
+    Catlass::GemmCoord problemShape{m, n, k};
+    Catlass::layout::RowMajor layoutA{m, k, k};
+    Catlass::layout::RowMajor layoutB{k, n, n};
+    Catlass::layout::RowMajor layoutC{m, n, n};
+
+    constexpr bool enableUnitFlag = true;
+    using MmadDispatchPolicy = Catlass::Gemm::MmadAtlasA2Pingpong<enableUnitFlag>;
+    using L1TileShape = Catlass::GemmShape<128, 256, 256>;
+    using L0TileShape = Catlass::GemmShape<128, 256, 64>;
+    using AType = Catlass::Gemm::GemmType<half, LayoutA>;
+    using BType = Catlass::Gemm::GemmType<half, LayoutB>;
+    using CType = Catlass::Gemm::GemmType<half, LayoutC>;
+    using BlockMmad = Catlass::Gemm::Block::BlockMmad<MmadDispatchPolicy,
+        L1TileShape, L0TileShape, AType, BType, CType>;
+    using BlockScheduler = typename Catlass::Gemm::Block::GemmIdentityBlockSwizzle<3, 0>;
+    using MatmulKernel = Catlass::Gemm::Kernel::BasicMatmul<BlockMmad, void, BlockScheduler>;
+
+    typename MatmulKernel::Params params{problemShape, a, layoutA, b, layoutB, c, layoutC};
+    MatmulKernel matmulKernel;
+    matmulKernel(params);
+}
+
 struct Options {
     static constexpr auto helper = "Usage: matmul_allreduce m n k transA transB\n";
 
@@ -227,10 +295,31 @@ int main(int argc, char **argv)
     uint32_t fftsLen{0};
     RT_CHECK(rtGetC2cCtrlAddr(&fftsAddr, &fftsLen));
 
+    // Launch on every AI core of the device, the comm core split of the kernel has to fit in it
+    uint32_t coreNum = GetLaunchCoreNum(deviceId);
+    if (coreNum < CommCoreSplit::COUNT) {
+        ERROR_LOG("The comm core split needs %ld cores, %u can be launched.", CommCoreSplit::COUNT, coreNum);
+        return -1;
+    }
+    // Benchmark mode: an independent matmul launched on a second stream gets CORUN_CORE_NUM blocks and the comm
+    // kernel the remaining ones. Only the block counts are split, which physical cores run the blocks of the two
+    // streams is left to the runtime, the kernels take no core placement.
+    uint32_t coRunCoreNum = 0;
+    if (!GetEnvUint("CORUN_CORE_NUM", 0, coRunCoreNum)) {
+        return -1;
+    }
+    if (coRunCoreNum > coreNum - CommCoreSplit::COUNT) {
+        ERROR_LOG("CORUN_CORE_NUM %u must leave %ld cores to the comm kernel, %u cores in total.", coRunCoreNum,
+            CommCoreSplit::COUNT, coreNum);
+        coRunCoreNum = 0;
+    }
+
     size_t aSize = static_cast<size_t>(m) * k * sizeof(__fp16);
     size_t bSize = static_cast<size_t>(k) * n * sizeof(__fp16);
     size_t cSize = static_cast<size_t>(m) * n * sizeof(__fp16);
-    size_t cSizeScatter = cSize / options.rankSize;
+    Catcoc::detail::RankPartition rankPartition(m, rankSize);
+    size_t cSizeScatter = static_cast<size_t>(rankPartition.GetExtent(rankId)) * n * sizeof(__fp16);
+    size_t cOffsetScatter = static_cast<size_t>(rankPartition.GetOffset(rankId)) * n * sizeof(__fp16);
 
     uint8_t *aDevice;
     ACL_CHECK(aclrtMalloc((void **)(&aDevice), aSize, ACL_MEM_MALLOC_HUGE_FIRST));
@@ -253,22 +342,109 @@ int main(int argc, char **argv)
     ReadFile("./output/c_gm.bin", cHost, cSize);
     ACL_CHECK(aclrtMemcpy(cDevice, cSizeScatter, cHost, cSizeScatter, ACL_MEMCPY_HOST_TO_DEVICE));
 
-    void *symmPtr = shmem_malloc((204 * 1024 * 1024) * sizeof(__fp16));
+    // Reserve exactly the symmetric memory this launch touches
+    Catcoc::DGemm::WorkspaceDesc workspaceDesc{Catlass::GemmCoord{m, n, k}, L1TileShape::ToCoord(),
+        static_cast<uint32_t>(rankSize), coreNum, commInterval, workspaceStages, sizeof(__fp16)};
+    size_t workspaceSize = Catcoc::DGemm::GetMatmulReduceScatterWorkspaceSize(workspaceDesc);
+    void *symmPtr = shmem_malloc(workspaceSize);
     uint8_t *symmetricPtr = (uint8_t *)symmPtr;
 
     ACL_CHECK(aclrtSynchronizeStream(stream));
     for (int i = 0; i < 1; i++) {
-        ShmemMatmulReduceScatter<<<BLOCK_NUM, nullptr, stream>>>(fftsAddr,
+        ShmemMatmulReduceScatter<<<coreNum, nullptr, stream>>>(fftsAddr,
             aDevice, bDevice, cDevice, symmetricPtr, m, n, k);
     }
     ACL_CHECK(aclrtSynchronizeStream(stream));
 
     ACL_CHECK(aclrtMemcpy(cHost, cSizeScatter, cDevice, cSizeScatter, ACL_MEMCPY_DEVICE_TO_HOST));
-    WriteFile("./output/output.bin", cHost, cSizeScatter, options.rankId * cSizeScatter);
+    WriteFile("./output/output.bin", cHost, cSizeScatter, cOffsetScatter);
     if (rankId == 0) {
         std::printf("test finished\n");
     }
 
+    if (coRunCoreNum > 0) {
+        // The output has been saved, the timed runs below only accumulate into it
+        uint32_t commCoreNum = coreNum - coRunCoreNum;
+        uint32_t warmUpTimes = WARM_UP_TIMES;
+        uint32_t cycleTimes = PERF_TEST_CYCLE_TIMES;
+        if (!GetEnvUint("WARM_UP_TIMES", WARM_UP_TIMES, warmUpTimes) ||
+            !GetEnvUint("PERF_TEST_CYCLE_TIMES", PERF_TEST_CYCLE_TIMES, cycleTimes)) {
+            return -1;
+        }
+        cycleTimes = std::max(cycleTimes, 1U);
+        uint8_t *coRunDevice;
+        ACL_CHECK(aclrtMalloc((void **)(&coRunDevice), cSize, ACL_MEM_MALLOC_HUGE_FIRST));
+        aclrtStream coRunStream = nullptr;
+        ACL_CHECK(aclrtCreateStream(&coRunStream));
+        aclrtEvent startEvent, coRunStartEvent, commEndEvent, coRunEndEvent;
+        ACL_CHECK(aclrtCreateEvent(&startEvent));
+        ACL_CHECK(aclrtCreateEvent(&coRunStartEvent));
+        ACL_CHECK(aclrtCreateEvent(&commEndEvent));
+        ACL_CHECK(aclrtCreateEvent(&coRunEndEvent));
+
+        auto launchComm = [&]() {
+            ShmemMatmulReduceScatter<<<commCoreNum, nullptr, stream>>>(fftsAddr,
+                aDevice, bDevice, cDevice, symmetricPtr, m, n, k);
+        };
+        auto launchCoRun = [&]() {
+            CoRunMatmul<<<coRunCoreNum, nullptr, coRunStream>>>(aDevice, bDevice, coRunDevice, m, n, k);
+        };
+        // Mean time of one launch over cycleTimes launches timed between two events of the same stream
+        auto meanMs = [&](aclrtEvent start, aclrtEvent end) {
+            float ms = 0;
+            ACL_CHECK(aclrtSynchronizeEvent(end));
+            ACL_CHECK(aclrtEventElapsedTime(&ms, start, end));
+            return ms / cycleTimes;
+        };
+
+        for (uint32_t i = 0; i < warmUpTimes; ++i) {
+            launchComm();
+            launchCoRun();
+        }
+        ACL_CHECK(aclrtSynchronizeStream(stream));
+        ACL_CHECK(aclrtSynchronizeStream(coRunStream));
+
+        // Each kernel alone on its own core set
+        ACL_CHECK(aclrtRecordEvent(startEvent, stream));
+        for (uint32_t i = 0; i < cycleTimes; ++i) {
+            launchComm();
+        }
+        ACL_CHECK(aclrtRecordEvent(commEndEvent, stream));
+        float commMs = meanMs(startEvent, commEndEvent);
+
+        ACL_CHECK(aclrtRecordEvent(coRunStartEvent, coRunStream));
+        for (uint32_t i = 0; i < cycleTimes; ++i) {
+            launchCoRun();
+        }
+        ACL_CHECK(aclrtRecordEvent(coRunEndEvent, coRunStream));
+        float coRunMs = meanMs(coRunStartEvent, coRunEndEvent);
+
+        // Both kernels released together on disjoint core sets. The co-run stream starts from the event of the
+        // comm stream and the comm stream joins the end of the co-run stream, so the window is timed on one stream
+        ACL_CHECK(aclrtRecordEvent(startEvent, stream));
+        ACL_CHECK(aclrtStreamWaitEvent(coRunStream, startEvent));
+        for (uint32_t i = 0; i < cycleTimes; ++i) {
+            launchComm();
+            launchCoRun();
+        }
+        ACL_CHECK(aclrtRecordEvent(coRunEndEvent, coRunStream));
+        ACL_CHECK(aclrtStreamWaitEvent(stream, coRunEndEvent));
+        ACL_CHECK(aclrtRecordEvent(commEndEvent, stream));
+        float overlapMs = meanMs(startEvent, commEndEvent);
+
+        std::printf("[CORUN] rank %d: comm %u blocks %.3f ms, matmul %u blocks %.3f ms, "
+                    "serial %.3f ms, co-run %.3f ms, mean of %u launches, core placement left to the runtime\n",
+                    rankId, commCoreNum, commMs, coRunCoreNum, coRunMs,
+                    commMs + coRunMs, overlapMs, cycleTimes);
+
+        ACL_CHECK(aclrtDestroyEvent(startEvent));
+        ACL_CHECK(aclrtDestroyEvent(coRunStartEvent));
+        ACL_CHECK(aclrtDestroyEvent(commEndEvent));
+        ACL_CHECK(aclrtDestroyEvent(coRunEndEvent));
+        ACL_CHECK(aclrtDestroyStream(coRunStream));
+        ACL_CHECK(aclrtFree(coRunDevice));
+    }
+
     shmem_free(symmPtr);
 
     ACL_CHECK(aclrtFreeHost(aHost));
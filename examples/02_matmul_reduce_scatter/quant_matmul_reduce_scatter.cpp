@@ -35,6 +35,8 @@
 #include "catcoc/comm_epilogue/block/comm_block_swizzle.hpp"
 #include "catcoc/comm_epilogue/tile/tile_remote_copy.hpp"
 #include "catcoc/detail/remote_copy_type.hpp"
+#include "catcoc/detail/rank_partition.hpp"
+#include "catcoc/dgemm/workspace_size.hpp"
 #include "catcoc/dgemm/kernel/quant_matmul_reduce_scatter.hpp"
 
 static uint32_t gNpuNum = 8;
@@ -43,7 +45,6 @@ static uint64_t gNpuMallocSpace = 1024UL * 1024UL * 1024;
 using namespace AscendC;
 using namespace Catcoc;
 
-constexpr uint32_t BLOCK_NUM = 20;
 constexpr int32_t BLOCK_SIZE_16 = 16;
 
 using LayoutA = Catlass::layout::RowMajor;
@@ -51,6 +52,13 @@ using LayoutB = Catlass::layout::RowMajor;
 using LayoutC = Catlass::layout::RowMajor;
 using LayoutD = Catlass::layout::RowMajor;
 
+// Shared by the kernel and the host, which sizes the symmetric workspace from them
+using L1TileShape = Catlass::GemmShape<128, 256, 256>;
+// Cores of the comm epilogue, the launch must provide at least that many
+using CommCoreSplit = Catlass::MatrixShape<20, 1>;
+constexpr uint32_t workspaceStages = 2;
+constexpr uint32_t commInterval = 10;
+
 CATLASS_GLOBAL
 void ShmemQuantMatmulReduceScatter(
     uint64_t fftsAddr,
@@ -71,11 +79,15 @@ void ShmemQuantMatmulReduceScatter(
     uint32_t rank = shmem_my_pe();
     uint32_t rankSize = shmem_n_pes();
 
+    // The first m % rankSize ranks own one extra row of the scattered output
+    Catcoc::detail::RankPartition rankPartition(m, rankSize);
+    uint32_t m_per_rank = rankPartition.GetExtent(rank);
+
     // Define layouts
     Catlass::layout::RowMajor layoutA{m, k, k};
     Catlass::layout::RowMajor layoutB{k, n, n};
-    Catlass::layout::RowMajor layoutC_accum{m / rankSize, n, n};
-    Catlass::layout::RowMajor layoutD_out{m / rankSize, n, n};
+    Catlass::layout::RowMajor layoutC_accum{m_per_rank, n, n};
+    Catlass::layout::RowMajor layoutD_out{m_per_rank, n, n};
     Catlass::layout::RowMajor layout_scale_x1{m, 1, 1};
     Catlass::layout::RowMajor layout_scale_x2{n, 1, 1};
     Catlass::layout::VectorLayout layout_bias(n);
@@ -89,7 +101,6 @@ void ShmemQuantMatmulReduceScatter(
     constexpr bool enableUnitFlag = true;
     // Use the dispatch policy that supports fused bias
     using MmadDispatchPolicy = Catlass::Gemm::MmadAtlasA2PingpongBias<enableUnitFlag>;
-    using L1TileShape = Catlass::GemmShape<128, 256, 256>;
     using L0TileShape = Catlass::GemmShape<128, 256, 64>;
     using BlockMmad = Catlass::Gemm::Block::BlockMmad<MmadDispatchPolicy,
         L1TileShape, L0TileShape, AType, BType, CType, BiasType>;
@@ -99,20 +110,21 @@ void ShmemQuantMatmulReduceScatter(
     using ReduceScatterDType = CType;
 
     using BlockScheduler = typename Catlass::Gemm::Block::GemmIdentityBlockSwizzle<7, 1>;
-    using CommBlockScheduler = CommEpilogue::Block::BlockCommSwizzle<0>;
+    // Switch to true to sum the int32 partials in rank order without atomics
+    constexpr bool isDeterministic = false;
+    using CommBlockScheduler = CommEpilogue::Block::BlockCommSwizzle<0, isDeterministic>;
 
     using CopyDirect = Catcoc::detail::CopyDirect;
     using TileRemoteCopy = CommEpilogue::Tile::TileRemoteCopy<ArchTag, ReduceScatterCType, ReduceScatterDType, CopyDirect::Get>;
     using TileScheduler = Catlass::Epilogue::Tile::EpilogueIdentityTileSwizzle;
 
     using CommBlockShape = Catlass::MatrixShape<64, 256>;
-    using CommCoreSplit = Catlass::MatrixShape<20, 1>;
 
     constexpr uint32_t ubStages = 2;
     using ReduceScatterTileShape = Catlass::MatrixShape<32, 256>;
     using ReduceScatterDispatch = CommEpilogue::EpilogueAtlasA2CommToLocalMem<ubStages,
         Catcoc::detail::CopyMode::Scatter>;
-    using BlockEpilogueReduceScatter = CommEpilogue::Block::CommBlockEpilogue<
+    using BlockEpilogueReduceScatterAtomic = CommEpilogue::Block::CommBlockEpilogue<
         ReduceScatterDispatch,
         ReduceScatterCType, ReduceScatterDType,
         CommCoreSplit,
@@ -120,6 +132,17 @@ void ShmemQuantMatmulReduceScatter(
         ReduceScatterTileShape, TileRemoteCopy, TileScheduler,
         BlockScheduler
     >;
+    using ReduceScatterDeterministicDispatch = CommEpilogue::EpilogueAtlasA2CommReduceDeterministic<ubStages>;
+    using BlockEpilogueReduceScatterDeterministic = CommEpilogue::Block::CommBlockEpilogue<
+        ReduceScatterDeterministicDispatch,
+        ReduceScatterCType, ReduceScatterDType,
+        CommCoreSplit,
+        CommBlockShape,
+        ReduceScatterTileShape, TileScheduler,
+        BlockScheduler
+    >;
+    using BlockEpilogueReduceScatter = std::conditional_t<isDeterministic,
+        BlockEpilogueReduceScatterDeterministic, BlockEpilogueReduceScatterAtomic>;
 
     // Define types for PerTokenDequant Epilogue
     using namespace Catlass::Epilogue;
@@ -149,8 +172,6 @@ void ShmemQuantMatmulReduceScatter(
 
     // BiasAdd Epilogue is no longer needed, as it's fused into BlockMmad.
 
-    constexpr uint32_t workspaceStages = 2;
-    constexpr uint32_t commInterval = 10;
     using QuantMatmulReduceScatterKernel = DGemm::Kernel::QuantMatmulReduceScatter<
         BlockMmad,
         BlockEpilogueReduceScatter,
@@ -159,11 +180,14 @@ void ShmemQuantMatmulReduceScatter(
         CommBlockScheduler,
         workspaceStages
     >;
-    Catlass::GemmCoord problemShapeInRank = problemShape / Catlass::MakeCoord<uint32_t>(rankSize, 1, 1);
-    BlockScheduler matmulBlockScheduler(problemShapeInRank, Catlass::MakeCoord(L1TileShape::M, L1TileShape::N));
+    // Remap over the tile grid of the largest share, the shape is clipped to the rows owned by this rank
+    Catlass::GemmCoord problemShapeInRank{m_per_rank, n, k};
+    Catlass::MatrixCoord tileMN{L1TileShape::M, L1TileShape::N};
+    Catlass::MatrixCoord loopsMN = CeilDiv(Catlass::MatrixCoord{rankPartition.GetMaxExtent(), n}, tileMN);
+    BlockScheduler matmulBlockScheduler(problemShapeInRank, tileMN, loopsMN);
 
     Catlass::layout::RowMajor layoutPeerMemStore{
-        L1TileShape::M * commInterval * BLOCK_NUM * workspaceStages, L1TileShape::N,
+        L1TileShape::M * commInterval * AscendC::GetBlockNum() * workspaceStages, L1TileShape::N,
         L1TileShape::N
     };
 
@@ -173,8 +197,7 @@ void ShmemQuantMatmulReduceScatter(
         matmulBlockScheduler
     };
     
-    uint32_t m_per_rank = m / rankSize;
-    uint32_t scale_x1_offset = rank * m_per_rank;
+    uint32_t scale_x1_offset = rankPartition.GetOffset(rank);
     typename BlockEpilogueDequant::Params dequantParams{
         reinterpret_cast<__gm__ float *>(scale_x2), Catlass::layout::VectorLayout(n),
         reinterpret_cast<__gm__ float *>(scale_x1) + scale_x1_offset, Catlass::layout::VectorLayout(m_per_rank),
@@ -279,14 +302,23 @@ int main(int argc, char **argv)
     uint32_t fftsLen{0};
     RT_CHECK(rtGetC2cCtrlAddr(&fftsAddr, &fftsLen));
 
+    // Launch on every AI core of the device, the comm core split of the kernel has to fit in it
+    uint32_t coreNum = GetLaunchCoreNum(deviceId);
+    if (coreNum < CommCoreSplit::COUNT) {
+        ERROR_LOG("The comm core split needs %ld cores, %u can be launched.", CommCoreSplit::COUNT, coreNum);
+        return -1;
+    }
+
     // Memory sizes
     size_t x1Size = static_cast<size_t>(m) * k * sizeof(int8_t);
     size_t x2Size = static_cast<size_t>(k) * n * sizeof(int8_t);
     size_t scaleX1Size = static_cast<size_t>(m) * sizeof(float);
     size_t scaleX2Size = static_cast<size_t>(n) * sizeof(float);
     size_t biasSize = static_cast<size_t>(n) * sizeof(int32_t);
-    size_t cAccumSize = static_cast<size_t>(m) * n * sizeof(int32_t) / rankSize;
-    size_t dOutSize = static_cast<size_t>(m) * n * sizeof(bfloat16_t) / rankSize;
+    Catcoc::detail::RankPartition rankPartition(m, rankSize);
+    size_t cAccumSize = static_cast<size_t>(rankPartition.GetExtent(rankId)) * n * sizeof(int32_t);
+    size_t dOutSize = static_cast<size_t>(rankPartition.GetExtent(rankId)) * n * sizeof(bfloat16_t);
+    size_t dOutOffset = static_cast<size_t>(rankPartition.GetOffset(rankId)) * n * sizeof(bfloat16_t);
 
     // Allocate and copy x1
     uint8_t *x1Device, *x1Host;
@@ -332,19 +364,23 @@ int main(int argc, char **argv)
     ACL_CHECK(aclrtMallocHost((void **)(&dOutHost), dOutSize));
 
     // Allocate shared memory workspace
-    void *symmPtr = shmem_malloc((204 * 1024 * 1024) * sizeof(int32_t));
+    // Reserve exactly the symmetric memory this launch touches
+    Catcoc::DGemm::WorkspaceDesc workspaceDesc{Catlass::GemmCoord{m, n, k}, L1TileShape::ToCoord(),
+        static_cast<uint32_t>(rankSize), coreNum, commInterval, workspaceStages, sizeof(int32_t)};
+    size_t workspaceSize = Catcoc::DGemm::GetMatmulReduceScatterWorkspaceSize(workspaceDesc);
+    void *symmPtr = shmem_malloc(workspaceSize);
     uint8_t *symmetricPtr = (uint8_t *)symmPtr;
 
     ACL_CHECK(aclrtSynchronizeStream(stream));
     for (int i = 0; i < 1; i++) {
-        ShmemQuantMatmulReduceScatter<<<BLOCK_NUM, nullptr, stream>>>(fftsAddr,
+        ShmemQuantMatmulReduceScatter<<<coreNum, nullptr, stream>>>(fftsAddr,
             x1Device, x2Device, scaleX1Device, scaleX2Device, biasDevice,
             cAccumDevice, dOutDevice, symmetricPtr, m, n, k);
     }
     ACL_CHECK(aclrtSynchronizeStream(stream));
 
     ACL_CHECK(aclrtMemcpy(dOutHost, dOutSize, dOutDevice, dOutSize, ACL_MEMCPY_DEVICE_TO_HOST));
-    WriteFile("./output/output.bin", dOutHost, dOutSize, options.rankId * dOutSize);
+    WriteFile("./output/output.bin", dOutHost, dOutSize, dOutOffset);
     if (rankId == 0) {
         std::printf("test finished\n");
     }
@@ -1,6 +1,9 @@
 #!/bin/bash
 # eg. bash run.sh 0,1      # 在 0/1 卡上运行，rank size = 2
 # eg. bash run.sh 1,3,5,7  # 在 1/3/5/6 卡上运行，rank size = 4
+# eg. CORUN_CORE_NUM=8 bash run.sh 0,1  # 通信算子只用剩余的核, 另一条流上的独立matmul使用8个核, 输出单独/并行执行耗时
+#     只划分两个kernel的启动核数, 各自运行在哪些物理核上由runtime决定
+#     预热WARM_UP_TIMES次后取PERF_TEST_CYCLE_TIMES次的平均值, 两者均可用环境变量设置
 
 CURRENT_DIR=$(pwd)
 SCRIPT_DIR=$(cd "$(dirname "${BASH_SOURCE[0]}")" &>/dev/null && pwd)
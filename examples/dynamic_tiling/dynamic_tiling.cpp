@@ -1,6 +1,7 @@
 #include <acl/acl.h>
 #include <runtime/rt_ffts.h>
 
+#include <algorithm>
 #include <iostream>
 #include <vector>
 #include <cstring>
@@ -21,14 +22,13 @@
 #include "utils/utils.h"
 #include "tiling.h"
 #include "launch_map.h"
+#include "plan.h"
+#include "tiling_table.h"
 
-using half = __fp16;
+#include "catcoc/detail/rank_partition.hpp"
+#include "catcoc/symmetric_pool.hpp"
 
-const std::map<CocCommType, std::string> commTypeMap = {
-    { MATMUL_ALLREDUCE, "MatmulAllReduce" },
-    { ALLGATHER_MATMUL, "AllGatherMatmul" },
-    { MATMUL_REDUCE_SCATTER, "MatmulReduceScatter" }
-};
+using half = __fp16;
 
 struct Options {
     CocCommType commType;
@@ -178,6 +178,10 @@ int main(int argc, char **argv)
     int32_t deviceId = options.deviceIdList[rankId];
     std::string data_file = options.data_file;
     const std::vector<std::vector<uint32_t>> shapes = InitTestShapes(options);
+    uint32_t deterministicMode = std::getenv("DETERMINISTIC_MODE") == nullptr ? 0 : std::stoul(std::getenv("DETERMINISTIC_MODE"));
+    // plan接口执行时是否在host预计算MatmulAllReduce的通信调度表
+    uint32_t commSchedule = std::getenv("COMM_SCHEDULE") == nullptr ? 0 : std::stoul(std::getenv("COMM_SCHEDULE"));
+    SetDeterministicSearchSpace(deterministicMode);
 
     std::cout << "[TEST] input rank_size: " << rankSize << " rank_id:" << rankId << " input_ip: " << ipPort << "\n";
 
@@ -190,11 +194,32 @@ int main(int argc, char **argv)
     status = shmem_init_attr(attributes);
     status = shmem_init_status();
 
+    // 对称内存只在初始化时申请一次, 各shape依次从中取workspace, 避免在循环中调用集合通信的shmem_malloc
+    Catcoc::SymmetricPool symmetricPool;
+    if (!symmetricPool.Init(LCAL_BUFF_BYTES - FLAG_BUFF_BYTES)) {
+        ERROR_LOG("Init symmetric pool failed, capacity = %d", LCAL_BUFF_BYTES - FLAG_BUFF_BYTES);
+        return -1;
+    }
+
     // Prepare FFTS address
     uint64_t fftsAddr{0};
     uint32_t fftsLen{0};
     RT_CHECK(rtGetC2cCtrlAddr(&fftsAddr, &fftsLen));
 
+    uint32_t blockNum = GetLaunchCoreNum(deviceId);
+    if (blockNum == 0) {
+        return -1;
+    }
+    SetCoreNumSearchSpace(blockNum);
+
+    // 精度测试通过plan接口执行, 可用TILING_FILE指定get_best_res.py生成的best_result.csv, 按调优结果选择tiling
+    CocTilingTable tilingTable;
+    const char *tilingFile = std::getenv("TILING_FILE");
+    if (tilingFile != nullptr && !tilingTable.Load(tilingFile)) {
+        return -1;
+    }
+    CocPlanCache planCache(symmetricPool, &tilingTable, fftsAddr);
+
     std::string currentTime = GetCurrentTime();
     std::string opName = commTypeMap.at(commType);
     std::filesystem::path currentPath = __FILE__;
@@ -225,13 +250,18 @@ int main(int argc, char **argv)
         cocTiling.commDataSplit = 2;
         cocTiling.commBlockM = 64; // 原lenPerLoop不乘512
         cocTiling.rankSize = rankSize;
+        cocTiling.deterministic = (deterministicMode == 1) ? 1 : 0;
+        cocTiling.blockNum = blockNum;
 
         size_t aSize = static_cast<size_t>(m) * k * sizeof(half);
         size_t bSize = static_cast<size_t>(k) * n * sizeof(half);
         size_t cSize = static_cast<size_t>(m) * n * sizeof(half);
         size_t cSizePerRank;
+        size_t cOffsetPerRank = 0;
         if (commType == MATMUL_REDUCE_SCATTER) {
-            cSizePerRank = cSize / rankSize;
+            Catcoc::detail::RankPartition rankPartition(m, rankSize);
+            cSizePerRank = static_cast<size_t>(rankPartition.GetExtent(rankId)) * n * sizeof(half);
+            cOffsetPerRank = static_cast<size_t>(rankPartition.GetOffset(rankId)) * n * sizeof(half);
         } else if (commType == ALLGATHER_MATMUL) {
             cSizePerRank = cSize * rankSize;
         } else {
@@ -262,43 +292,86 @@ int main(int argc, char **argv)
             ACL_CHECK(aclrtMemcpy(bDevice, bSize, matrixB.data(), bSize, ACL_MEMCPY_HOST_TO_DEVICE));
         }
 
+        // MatmulAllReduce的输出放在对称内存中, put模式的all-gather可以直接写入各rank的C.
+        // 各rank按相同顺序取出和归还, 偏移一致; 取不到时退回普通显存, 不再尝试put模式
         uint8_t *cDevice;
-        ACL_CHECK(aclrtMalloc((void **)(&cDevice), cSizePerRank, ACL_MEM_MALLOC_HUGE_FIRST));
+        Catcoc::SymmetricWorkspace cWorkspace;
+        if (commType == MATMUL_ALLREDUCE) {
+            cWorkspace = symmetricPool.Acquire(cSizePerRank);
+        }
+        if (cWorkspace.IsValid()) {
+            cDevice = cWorkspace.ptr;
+        } else {
+            ACL_CHECK(aclrtMalloc((void **)(&cDevice), cSizePerRank, ACL_MEM_MALLOC_HUGE_FIRST));
+        }
         if (commType == MATMUL_REDUCE_SCATTER) {
             std::vector<uint8_t> matrixCInit(cSizePerRank, 0);
             ACL_CHECK(aclrtMemcpy(cDevice, cSizePerRank, matrixCInit.data(), cSizePerRank, ACL_MEMCPY_HOST_TO_DEVICE));
         }
 
-        void *symmPtr = shmem_malloc((204 * 1024 * 1024) * sizeof(half));
-        uint8_t *symmetricPtr = (uint8_t *)symmPtr;
-
         uint32_t warmUpTimes = std::getenv("WARM_UP_TIMES") == nullptr ? WARM_UP_TIMES : std::stoull(std::getenv("WARM_UP_TIMES"));
         uint32_t perfTestCycleTimes = std::getenv("PERF_TEST_CYCLE_TIMES") == nullptr ? PERF_TEST_CYCLE_TIMES : std::stoull(std::getenv("PERF_TEST_CYCLE_TIMES"));
 
         std::vector<CocTilingParams> cocTilings;
         if (warmUpTimes == 0) {
-            cocTilings.push_back(cocTiling);
+            const CocPlan *plan = planCache.Get(
+                CocPlanDesc{commType, dataType, transA, transB, cocTiling, commSchedule, cWorkspace});
+            if (plan == nullptr) {
+                return -1;
+            }
+            cocTilings.push_back(plan->GetTiling());
+
+            ACL_CHECK(aclrtSynchronizeStream(stream));
+            for (int i = 0; i < perfTestCycleTimes; i++) {
+                if (!plan->Run(stream, aDevice, bDevice, cDevice)) {
+                    return -1;
+                }
+            }
+            ACL_CHECK(aclrtSynchronizeStream(stream));
+            // 每个shape只执行一次, 用完即归还workspace
+            planCache.Clear();
         } else {
-            GetTilings(cocTilings, cocTiling, commType, rankSize);
-        }
+            // C和workspace取自同一对称内存池, 候选tiling的workspace不能超过取出C之后池中剩余的最大空闲块
+            GetTilings(cocTilings, cocTiling, commType, rankSize, symmetricPool.GetMaxAvailable());
+            if (!cWorkspace.IsValid()) {
+                cocTilings.erase(std::remove_if(cocTilings.begin(), cocTilings.end(),
+                    [](const CocTilingParams &tiling) { return tiling.pushAllGather != 0; }), cocTilings.end());
+            }
+            if (cocTilings.empty()) {
+                ERROR_LOG("No tiling fits the symmetric pool, m = %u, k = %u, n = %u", m, k, n);
+            } else {
+                // 各候选tiling在同一stream上顺序执行, 共用一块按最大需求取出的workspace
+                size_t workspaceSize = 0;
+                for (const CocTilingParams &tiling : cocTilings) {
+                    workspaceSize = std::max(workspaceSize, GetWorkspaceSize(tiling, commType, rankSize));
+                }
+                Catcoc::SymmetricWorkspace workspace = symmetricPool.Acquire(workspaceSize);
+                if (!workspace.IsValid()) {
+                    ERROR_LOG("Acquire symmetric workspace failed, size = %zu", workspaceSize);
+                    return -1;
+                }
+                uint8_t *symmetricPtr = workspace.ptr;
 
-        ACL_CHECK(aclrtSynchronizeStream(stream));
+                ACL_CHECK(aclrtSynchronizeStream(stream));
 
-        auto kernelFunc = KernelDispatcher::GetKernelFunc(commType, dataType);
+                auto kernelFunc = KernelDispatcher::GetKernelFunc(commType, dataType);
 
-        // 环境变量
-        for (int i = 0; i < warmUpTimes; i++) {
-            kernelFunc(stream, fftsAddr, aDevice, bDevice, cDevice, nullptr, nullptr, symmetricPtr, cocTilings[0], transA, transB);
-        }
+                // 环境变量
+                for (int i = 0; i < warmUpTimes; i++) {
+                    kernelFunc(stream, fftsAddr, aDevice, bDevice, cDevice, nullptr, nullptr, symmetricPtr, cocTilings[0], transA, transB);
+                }
 
-        for (CocTilingParams tiling : cocTilings) {
-            for (int i = 0; i < perfTestCycleTimes; i++) {
-                kernelFunc(stream, fftsAddr, aDevice, bDevice, cDevice, nullptr, nullptr, symmetricPtr, tiling, transA, transB);
+                for (CocTilingParams tiling : cocTilings) {
+                    for (int i = 0; i < perfTestCycleTimes; i++) {
+                        kernelFunc(stream, fftsAddr, aDevice, bDevice, cDevice, nullptr, nullptr, symmetricPtr, tiling, transA, transB);
+                    }
+                }
+
+                ACL_CHECK(aclrtSynchronizeStream(stream));
+                symmetricPool.Release(workspace);
             }
         }
 
-        ACL_CHECK(aclrtSynchronizeStream(stream));
-
         uint8_t *cHost;
         ACL_CHECK(aclrtMallocHost((void **)(&cHost), cSizePerRank));
         ACL_CHECK(aclrtMemcpy(cHost, cSizePerRank, cDevice, cSizePerRank, ACL_MEMCPY_DEVICE_TO_HOST));
@@ -313,7 +386,7 @@ int main(int argc, char **argv)
                     WriteFile(data_file + "/output.bin", cHost, cSizePerRank);
                 }
             } else if (commType == MATMUL_REDUCE_SCATTER) {
-                WriteFile(data_file + "/output.bin", cHost, cSizePerRank, rankId * cSizePerRank);
+                WriteFile(data_file + "/output.bin", cHost, cSizePerRank, cOffsetPerRank);
             }
         }
     
@@ -322,7 +395,6 @@ int main(int argc, char **argv)
             std::printf("M: %d K: %d N: %d aclrtSynchronizeStream success!\n", cocTiling.m, cocTiling.k, cocTiling.n);
         }
 
-        shmem_free(symmPtr);
 
         if (data_file != "") {
             ACL_CHECK(aclrtFreeHost(aHost));
@@ -331,10 +403,15 @@ int main(int argc, char **argv)
         ACL_CHECK(aclrtFreeHost(cHost));
         ACL_CHECK(aclrtFree(aDevice));
         ACL_CHECK(aclrtFree(bDevice));
-        ACL_CHECK(aclrtFree(cDevice));
+        if (cWorkspace.IsValid()) {
+            symmetricPool.Release(cWorkspace);
+        } else {
+            ACL_CHECK(aclrtFree(cDevice));
+        }
     }
 
     std::cout << "[TEST] begin to exit...... rankId: " << rankId << std::endl;
+    symmetricPool.Finalize();
     status = shmem_finalize();
     ACL_CHECK(aclrtDestroyStream(stream));
     ACL_CHECK(aclrtResetDevice(deviceId));
@@ -2,6 +2,9 @@
 #define ALLGATHER_MATMUL_KERNEL_H
  
 #include "info.h"
+#include "l1_tile.h"
+#include "rank_size.h"
+#include "static_comm.h"
  
 // from catlass
 #include "catlass/catlass.hpp"
@@ -20,6 +23,7 @@
 #include "catcoc/comm_epilogue/block/comm_block_swizzle.hpp"
 #include "catcoc/comm_epilogue/tile/tile_remote_copy.hpp"
 #include "catcoc/detail/remote_copy_type.hpp"
+#include "catcoc/detail/rank_partition.hpp"
 #include "catcoc/dgemm/block/block_swizzle_allgather.hpp"
 #include "catcoc/dgemm/kernel/allgather_matmul.hpp"
  
@@ -28,6 +32,9 @@ using namespace Catcoc;
  
 template <
     class ArchTag,
+    class L1TileShape,
+    int32_t STATIC_COMM,
+    uint32_t RANK_SIZE,
     class ElementA, class LayoutA,
     class ElementB, class LayoutB,
     class ElementC, class LayoutC,
@@ -36,11 +43,10 @@ template <
 CATLASS_DEVICE
 void AllGatherMatmulImpl(
     Catlass::GemmCoord& problemShape,
-    Catlass::GemmCoord& l1TileShape,
     GM_ADDR gmA, LayoutA& layoutA,
     GM_ADDR gmB, LayoutB& layoutB,
     GM_ADDR gmC, LayoutC& layoutC,
-    uint32_t commInterval,
+    uint32_t commInterval, uint32_t workspaceStages, uint32_t ubStages,
     Catlass::MatrixCoord& commCoreSplit,
     Catlass::MatrixCoord& commBlockShape,
     Catlass::MatrixCoord& commTileShape,
@@ -50,9 +56,8 @@ void AllGatherMatmulImpl(
     constexpr bool enableUnitFlag = true;
     using MmadDispatchPolicy = Catlass::Gemm::MmadAtlasA2Pingpong<enableUnitFlag>;
  
-    // TODO: 当前catlass中MmadAtlasA2Pingpong没有动态版本, 预留了l1TileShape
-    using L1TileShape = Catlass::GemmShape<M0, N0, K0>;
-    using L0TileShape = Catlass::GemmShape<M0, N0, 64>;
+    // L1TileShape由kernel入口按tiling中的m0/n0/k0从预编译的基本块中选择
+    using L0TileShape = Catlass::GemmShape<L1TileShape::M, L1TileShape::N, 64>;
  
     using AType = Catlass::Gemm::GemmType<ElementA, LayoutA>;
     using BType = Catlass::Gemm::GemmType<ElementB, LayoutB>;
@@ -60,9 +65,9 @@ void AllGatherMatmulImpl(
     using DType = Catlass::Gemm::GemmType<ElementD, LayoutD>;
  
     using BlockMmad = Catlass::Gemm::Block::BlockMmad<MmadDispatchPolicy, L1TileShape, L0TileShape, AType, BType, CType>;
-    using BlockScheduler = typename Catcoc::DGemm::Block::GemmIdentityBlockSwizzleAllGather<7, 1, 2>;
+    using BlockScheduler = typename Catcoc::DGemm::Block::GemmIdentityBlockSwizzleAllGather<7, 1, 2, RANK_SIZE>;
     using BlockRemapper = typename Catlass::Gemm::Block::GemmIdentityBlockSwizzle<7, 1>;
-    using CommBlockScheduler = CommEpilogue::Block::BlockCommSwizzle<0>;
+    using CommBlockScheduler = CommEpilogue::Block::BlockCommSwizzle<0, false, RANK_SIZE>;
  
     using RemoteSrcType = CType;
     using RemoteDstType = DType;
@@ -70,15 +75,20 @@ void AllGatherMatmulImpl(
     using TileRemoteCopy = CommEpilogue::Tile::TileRemoteCopy<ArchTag, RemoteSrcType, RemoteDstType, CopyDirect::Put>;
     using TileScheduler = Catlass::Epilogue::Tile::EpilogueIdentityTileSwizzle;
 
-    constexpr bool isDynamic = true;
-    using AllGatherDispatch = CommEpilogue::EpilogueAtlasA2CommToShareMem<UB_STAGES,
+    // 通信切分与预编译配置一致时使用编译期常量, 否则从params读取
+    using CommTilingType = CommTiling<STATIC_COMM>;
+    constexpr bool isDynamic = CommTilingType::IS_DYNAMIC;
+    using CommCoreSplit = typename CommTilingType::CoreSplit;
+    using CommBlockShape = typename CommTilingType::template BlockShape<UINT_MAX / 2>;
+    using CommTileShape = typename CommTilingType::template TileShape<L1TileShape::N>;
+    using AllGatherDispatch = CommEpilogue::EpilogueAtlasA2CommToShareMem<CommTilingType::UB_STAGES,
         Catcoc::detail::CopyMode::Gather, isDynamic>;
     using BlockEpilogueAllGather = CommEpilogue::Block::CommBlockEpilogue<
         AllGatherDispatch,
         RemoteSrcType, RemoteDstType,
-        void,
-        void,
-        void, TileRemoteCopy, TileScheduler,
+        CommCoreSplit,
+        CommBlockShape,
+        CommTileShape, TileRemoteCopy, TileScheduler,
         BlockRemapper
     >;
  
@@ -94,18 +104,17 @@ void AllGatherMatmulImpl(
     uint32_t rank = shmem_my_pe();
     uint32_t rankSize = shmem_n_pes();
  
-    Catlass::GemmCoord commProblemShape{problemShape.m(), problemShape.k(), problemShape.k()};
-    BlockRemapper remapper(commProblemShape, 
-        Catlass::MakeCoord(L1TileShape::M, problemShape.k()));
- 
-    typename BlockEpilogueAllGather::Params allGatherParams{
-        reinterpret_cast<__gm__ ElementC *>(symmetricPtr),
-        layoutD,
-        remapper,
-        commCoreSplit,
-        commBlockShape,
-        commTileShape
-    };
+    // problemShape is the gathered problem, remap over the tile grid of the largest share
+    Catcoc::detail::RankPartition rankPartition(problemShape.m(), rankSize);
+    Catlass::GemmCoord commProblemShape{rankPartition.GetExtent(rank), problemShape.k(), problemShape.k()};
+    Catlass::MatrixCoord commTileMN{L1TileShape::M, problemShape.k()};
+    BlockRemapper remapper(commProblemShape, commTileMN,
+        CeilDiv(Catlass::MatrixCoord{rankPartition.GetMaxExtent(), problemShape.k()}, commTileMN));
+ 
+    DGemm::Kernel::CommArguments commArguments{commCoreSplit, commBlockShape, commTileShape, ubStages};
+    typename BlockEpilogueAllGather::Params allGatherParams =
+        Catcoc::detail::MakeCommParams<BlockEpilogueAllGather>(
+        symmetricPtr, layoutD, remapper, commArguments);
  
     typename AllGatherMatmulKernel::Params params{
         problemShape,
@@ -115,7 +124,8 @@ void AllGatherMatmulImpl(
         symmetricPtr,
         allGatherParams,
         gmC, layoutC,
-        commInterval
+        commInterval,
+        workspaceStages
     };
  
     // Call kernel
@@ -124,37 +134,38 @@ void AllGatherMatmulImpl(
 }
  
 template <
+    class L1TileShape,
+    int32_t STATIC_COMM,
+    uint32_t RANK_SIZE,
     class ElementA, class LayoutA,
     class ElementB, class LayoutB,
     class ElementC, class LayoutC,
     class ElementD, class LayoutD
 >
-CATLASS_GLOBAL
-void AllGatherMatmul(
-    uint64_t fftsAddr, GM_ADDR gmA, GM_ADDR gmB, GM_ADDR gmC, GM_ADDR symmetricPtr, CocTilingParams cocTiling
+CATLASS_DEVICE
+void AllGatherMatmulWithTiling(
+    GM_ADDR gmA, GM_ADDR gmB, GM_ADDR gmC, GM_ADDR symmetricPtr, CocTilingParams const &cocTiling
 )
 {
- 
-    AscendC::SetSyncBaseAddr(fftsAddr);
- 
     using ArchTag = Catlass::Arch::AtlasA2;
     Catlass::Arch::Resource<ArchTag> resource;
  
     uint32_t m = cocTiling.m;
     uint32_t n = cocTiling.n;
     uint32_t k = cocTiling.k;
-    uint32_t m0 = cocTiling.m0;
-    uint32_t n0 = cocTiling.n0;
-    uint32_t k0 = cocTiling.k0;
+    uint32_t m0 = L1TileShape::M;
+    uint32_t n0 = L1TileShape::N;
     uint32_t commInterval = cocTiling.commInterval;
     uint32_t commTileM = cocTiling.commTileM;
     uint32_t commNpuSplit = cocTiling.commNpuSplit;
     uint32_t commDataSplit = cocTiling.commDataSplit;
     uint32_t commBlockM = cocTiling.commBlockM;
+    uint32_t workspaceStages = cocTiling.workspaceStages;
+    uint32_t ubStages = cocTiling.ubStages;
     uint32_t rankSize = cocTiling.rankSize;
  
-    Catlass::GemmCoord problemShape{m, n, k};
-    Catlass::GemmCoord l1TileShape{m0, n0, k0};
+    // m is the row count of the local A, the gathered problem stacks the A of every rank
+    Catlass::GemmCoord problemShape{m * rankSize, n, k};
  
     Catlass::MatrixCoord commCoreSplit{commDataSplit, commNpuSplit};
     Catlass::MatrixCoord commBlockShape{commBlockM, UINT_MAX / 2};
@@ -177,13 +188,75 @@ void AllGatherMatmul(
     LayoutA layoutA{m, k, strideA};
     LayoutB layoutB{k, n, strideB};
     LayoutC layoutC{m * rankSize, n, n};
-    LayoutD layoutD{m0 * commInterval * rankSize * WORKSPACE_STAGES, k, k};
+    LayoutD layoutD{m0 * commInterval * rankSize * workspaceStages, k, k};
  
-    AllGatherMatmulImpl<ArchTag, ElementA, LayoutA, ElementB, LayoutB, ElementC, LayoutC, ElementD, LayoutD>
-        (problemShape, l1TileShape, gmA, layoutA, gmB, layoutB, gmC, layoutC, 
-         commInterval, commCoreSplit, commBlockShape, commTileShape, symmetricPtr, layoutD
+    AllGatherMatmulImpl<ArchTag, L1TileShape, STATIC_COMM, RANK_SIZE, ElementA, LayoutA, ElementB, LayoutB, ElementC, LayoutC, ElementD, LayoutD>
+        (problemShape, gmA, layoutA, gmB, layoutB, gmC, layoutC, 
+         commInterval, workspaceStages, ubStages, commCoreSplit, commBlockShape, commTileShape, symmetricPtr, layoutD
         );
 }
- 
- 
+
+template <
+    class L1TileShape,
+    int32_t STATIC_COMM,
+    class ElementA, class LayoutA,
+    class ElementB, class LayoutB,
+    class ElementC, class LayoutC,
+    class ElementD, class LayoutD
+>
+CATLASS_DEVICE
+void AllGatherMatmulWithRankSize(
+    GM_ADDR gmA, GM_ADDR gmB, GM_ADDR gmC, GM_ADDR symmetricPtr, CocTilingParams const &cocTiling
+)
+{
+    // 常见的2/4/8卡使用编译期rank数的调度
+    uint32_t rankSize = shmem_n_pes();
+    if (rankSize == 8) {
+        AllGatherMatmulWithTiling<L1TileShape, STATIC_COMM, 8, ElementA, LayoutA, ElementB, LayoutB,
+            ElementC, LayoutC, ElementD, LayoutD>(gmA, gmB, gmC, symmetricPtr, cocTiling);
+    } else if (rankSize == 4) {
+        AllGatherMatmulWithTiling<L1TileShape, STATIC_COMM, 4, ElementA, LayoutA, ElementB, LayoutB,
+            ElementC, LayoutC, ElementD, LayoutD>(gmA, gmB, gmC, symmetricPtr, cocTiling);
+    } else if (rankSize == 2) {
+        AllGatherMatmulWithTiling<L1TileShape, STATIC_COMM, 2, ElementA, LayoutA, ElementB, LayoutB,
+            ElementC, LayoutC, ElementD, LayoutD>(gmA, gmB, gmC, symmetricPtr, cocTiling);
+    } else {
+        AllGatherMatmulWithTiling<L1TileShape, STATIC_COMM, DYNAMIC_RANK_SIZE, ElementA, LayoutA, ElementB, LayoutB,
+            ElementC, LayoutC, ElementD, LayoutD>(gmA, gmB, gmC, symmetricPtr, cocTiling);
+    }
+}
+
+template <
+    class ElementA, class LayoutA,
+    class ElementB, class LayoutB,
+    class ElementC, class LayoutC,
+    class ElementD, class LayoutD
+>
+CATLASS_GLOBAL
+void AllGatherMatmul(
+    uint64_t fftsAddr, GM_ADDR gmA, GM_ADDR gmB, GM_ADDR gmC, GM_ADDR symmetricPtr, CocTilingParams cocTiling
+)
+{
+    AscendC::SetSyncBaseAddr(fftsAddr);
+
+    // 与预编译通信切分一致的tiling使用编译期常量的kernel, 其余按tiling中的m0/n0/k0选择预编译的基本块,
+    // MmadAtlasA2Pingpong的基本块是编译期的, host保证m0/n0/k0为L1_TILES之一. 只有默认基本块再按rank数分发
+    if (IsStaticComm<0>(cocTiling)) {
+        AllGatherMatmulWithRankSize<L1Tile<0>, 0, ElementA, LayoutA, ElementB, LayoutB,
+            ElementC, LayoutC, ElementD, LayoutD>(gmA, gmB, gmC, symmetricPtr, cocTiling);
+    } else if (IsStaticComm<1>(cocTiling)) {
+        AllGatherMatmulWithRankSize<L1Tile<0>, 1, ElementA, LayoutA, ElementB, LayoutB,
+            ElementC, LayoutC, ElementD, LayoutD>(gmA, gmB, gmC, symmetricPtr, cocTiling);
+    } else if (IsL1Tile<1>(cocTiling)) {
+        AllGatherMatmulWithTiling<L1Tile<1>, DYNAMIC_COMM, DYNAMIC_RANK_SIZE, ElementA, LayoutA, ElementB, LayoutB,
+            ElementC, LayoutC, ElementD, LayoutD>(gmA, gmB, gmC, symmetricPtr, cocTiling);
+    } else if (IsL1Tile<2>(cocTiling)) {
+        AllGatherMatmulWithTiling<L1Tile<2>, DYNAMIC_COMM, DYNAMIC_RANK_SIZE, ElementA, LayoutA, ElementB, LayoutB,
+            ElementC, LayoutC, ElementD, LayoutD>(gmA, gmB, gmC, symmetricPtr, cocTiling);
+    } else {
+        AllGatherMatmulWithRankSize<L1Tile<0>, DYNAMIC_COMM, ElementA, LayoutA, ElementB, LayoutB,
+            ElementC, LayoutC, ElementD, LayoutD>(gmA, gmB, gmC, symmetricPtr, cocTiling);
+    }
+}
+
 #endif // ALLGATHER_MATMUL_KERNEL_H
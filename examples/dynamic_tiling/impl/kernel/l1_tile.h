@@ -0,0 +1,21 @@
+#ifndef L1_TILE_KERNEL_H
+#define L1_TILE_KERNEL_H
+
+#include "info.h"
+
+// from catlass
+#include "catlass/catlass.hpp"
+#include "catlass/gemm_coord.hpp"
+
+// L1_TILES中第I个基本块对应的L1TileShape
+template <uint32_t I>
+using L1Tile = Catlass::GemmShape<L1_TILES[I][0], L1_TILES[I][1], L1_TILES[I][2]>;
+
+template <uint32_t I>
+CATLASS_DEVICE
+bool IsL1Tile(CocTilingParams const &cocTiling)
+{
+    return cocTiling.m0 == L1_TILES[I][0] && cocTiling.n0 == L1_TILES[I][1] && cocTiling.k0 == L1_TILES[I][2];
+}
+
+#endif // L1_TILE_KERNEL_H
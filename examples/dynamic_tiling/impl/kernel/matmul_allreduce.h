@@ -2,6 +2,9 @@
 #define MATMUL_ALLREDUCE_KERNEL_H
 
 #include "info.h"
+#include "l1_tile.h"
+#include "rank_size.h"
+#include "static_comm.h"
 
 // from catlass
 #include "catlass/catlass.hpp"
@@ -20,6 +23,7 @@
 #include "catcoc/comm_epilogue/block/comm_block_swizzle.hpp"
 #include "catcoc/comm_epilogue/tile/tile_remote_copy.hpp"
 #include "catcoc/detail/remote_copy_type.hpp"
+#include "catcoc/dgemm/block/block_swizzle_dynamic.hpp"
 #include "catcoc/dgemm/kernel/matmul_allreduce.hpp"
 
 using namespace AscendC;
@@ -27,31 +31,35 @@ using namespace Catcoc;
 
 template <
     class ArchTag,
+    class L1TileShape,
+    int32_t STATIC_COMM,
+    uint32_t RANK_SIZE,
     class ElementA, class LayoutA,
     class ElementB, class LayoutB,
     class ElementC, class LayoutC,
-    class ElementD, class LayoutD
+    class ElementD, class LayoutD,
+    bool IS_DETERMINISTIC,
+    bool PUSH_ALL_GATHER
 >
 CATLASS_DEVICE
 void MatmulAllReduceImpl(
     Catlass::GemmCoord& problemShape,
-    Catlass::GemmCoord& l1TileShape,
     GM_ADDR gmA, LayoutA& layoutA,
     GM_ADDR gmB, LayoutB& layoutB,
     GM_ADDR gmC, LayoutC& layoutC,
-    uint32_t commInterval,
+    uint32_t commInterval, uint32_t firstCommInterval, uint32_t tailSplitK, uint32_t tileFlags, uint32_t workspaceStages, uint32_t ubStages,
     Catlass::MatrixCoord& commCoreSplit,
     Catlass::MatrixCoord& commBlockShape,
     Catlass::MatrixCoord& commTileShape,
-    GM_ADDR symmetricPtr, LayoutC& layoutD
+    Catcoc::DGemm::Block::GemmSwizzle const &swizzle,
+    GM_ADDR symmetricPtr, LayoutC& layoutD, GM_ADDR commSchedule
 )
 {
     constexpr bool enableUnitFlag = true;
     using MmadDispatchPolicy = Catlass::Gemm::MmadAtlasA2Pingpong<enableUnitFlag>;
 
-    // TODO: 当前catlass中MmadAtlasA2Pingpong没有动态版本, 预留了l1TileShape
-    using L1TileShape = Catlass::GemmShape<M0, N0, K0>;
-    using L0TileShape = Catlass::GemmShape<M0, N0, 64>;
+    // L1TileShape由kernel入口按tiling中的m0/n0/k0从预编译的基本块中选择
+    using L0TileShape = Catlass::GemmShape<L1TileShape::M, L1TileShape::N, 64>;
 
     using AType = Catlass::Gemm::GemmType<ElementA, LayoutA>;
     using BType = Catlass::Gemm::GemmType<ElementB, LayoutB>;
@@ -59,38 +67,64 @@ void MatmulAllReduceImpl(
     using DType = Catlass::Gemm::GemmType<ElementD, LayoutD>;
 
     using BlockMmad = Catlass::Gemm::Block::BlockMmad<MmadDispatchPolicy, L1TileShape, L0TileShape, AType, BType, CType>;
-    using BlockScheduler = typename Catlass::Gemm::Block::GemmIdentityBlockSwizzle<7, 1>;
+    // 静态通信切分的kernel固定使用<7, 1>的swizzle, 其余从tiling读取swizzle, 通信epilogue的remapper与之一致
+    using BlockScheduler = std::conditional_t<CommTiling<STATIC_COMM>::IS_DYNAMIC,
+        Catcoc::DGemm::Block::GemmDynamicBlockSwizzle, Catlass::Gemm::Block::GemmIdentityBlockSwizzle<7, 1>>;
 
     using RemoteSrcType = CType;
     using RemoteDstType = DType;
     using CopyDirect = Catcoc::detail::CopyDirect;
     using TileRemoteCopy = CommEpilogue::Tile::TileRemoteCopy<ArchTag, RemoteSrcType, RemoteDstType, CopyDirect::Get>;
+    // put模式下各rank将本rank归约完成的分片写入所有rank的输出, 输出需在对称内存中
+    using AllGatherRemoteCopy = CommEpilogue::Tile::TileRemoteCopy<ArchTag, RemoteSrcType, RemoteDstType,
+        PUSH_ALL_GATHER ? CopyDirect::Put : CopyDirect::Get>;
     using TileScheduler = Catlass::Epilogue::Tile::EpilogueIdentityTileSwizzle;
 
-    constexpr bool isDynamic = true;
-    using ReduceScatterDispatch = CommEpilogue::EpilogueAtlasA2CommToShareMem<UB_STAGES,
+    // 通信切分与预编译配置一致时使用编译期常量, 否则从params读取
+    using CommTilingType = CommTiling<STATIC_COMM>;
+    constexpr bool isDynamic = CommTilingType::IS_DYNAMIC;
+    using CommCoreSplit = typename CommTilingType::CoreSplit;
+    using CommBlockShape = typename CommTilingType::template BlockShape<L1TileShape::N>;
+    using CommTileShape = typename CommTilingType::template TileShape<L1TileShape::N>;
+    using ReduceScatterDispatch = CommEpilogue::EpilogueAtlasA2CommToShareMem<CommTilingType::UB_STAGES,
         Catcoc::detail::CopyMode::Scatter, isDynamic>;
-    using BlockEpilogueReduceScatter = CommEpilogue::Block::CommBlockEpilogue<
+    using BlockEpilogueReduceScatterAtomic = CommEpilogue::Block::CommBlockEpilogue<
         ReduceScatterDispatch,
         RemoteSrcType, RemoteDstType,
-        void,
-        void,
-        void, TileRemoteCopy, TileScheduler,
+        CommCoreSplit,
+        CommBlockShape,
+        CommTileShape, TileRemoteCopy, TileScheduler,
+        BlockScheduler
+    >;
+
+    // Deterministic mode reduces the slice in place in the local workspace, in rank order
+    constexpr bool remapOutput = false;
+    using ReduceScatterDeterministicDispatch = CommEpilogue::EpilogueAtlasA2CommReduceDeterministic<
+        CommTilingType::UB_STAGES, remapOutput, isDynamic>;
+    using BlockEpilogueReduceScatterDeterministic = CommEpilogue::Block::CommBlockEpilogue<
+        ReduceScatterDeterministicDispatch,
+        RemoteSrcType, RemoteSrcType,
+        CommCoreSplit,
+        CommBlockShape,
+        CommTileShape, TileScheduler,
         BlockScheduler
     >;
 
-    using AllGatherDispatch = CommEpilogue::EpilogueAtlasA2CommToLocalMem<UB_STAGES, 
+    using BlockEpilogueReduceScatter = std::conditional_t<IS_DETERMINISTIC,
+        BlockEpilogueReduceScatterDeterministic, BlockEpilogueReduceScatterAtomic>;
+
+    using AllGatherDispatch = CommEpilogue::EpilogueAtlasA2CommToLocalMem<CommTilingType::UB_STAGES, 
         Catcoc::detail::CopyMode::Gather, isDynamic>;
     using BlockEpilogueAllGather = CommEpilogue::Block::CommBlockEpilogue<
         AllGatherDispatch,
         RemoteSrcType, RemoteDstType,
-        void,
-        void,
-        void, TileRemoteCopy, TileScheduler,
+        CommCoreSplit,
+        CommBlockShape,
+        CommTileShape, AllGatherRemoteCopy, TileScheduler,
         BlockScheduler
     >;
 
-    using CommBlockScheduler = CommEpilogue::Block::BlockCommSwizzle<0>;
+    using CommBlockScheduler = CommEpilogue::Block::BlockCommSwizzle<0, IS_DETERMINISTIC, RANK_SIZE>;
 
 
     using MatmulAllReduceKernel = DGemm::Kernel::MatmulAllReduce<
@@ -106,25 +140,17 @@ void MatmulAllReduceImpl(
     uint32_t rank = shmem_my_pe();
     uint32_t rankSize = shmem_n_pes();
 
-    BlockScheduler matmulBlockScheduler(problemShape, L1TileShape::ToCoordMN());
+    auto matmulBlockScheduler = Catcoc::detail::MakeBlockScheduler<BlockScheduler>(swizzle,
+        problemShape, L1TileShape::ToCoordMN());
 
-    typename BlockEpilogueAllGather::Params allGatherParams{
-        reinterpret_cast<__gm__ ElementC *>(symmetricPtr),
-        layoutD,
-        matmulBlockScheduler,
-        commCoreSplit,
-        commBlockShape,
-        commTileShape
-    };
+    DGemm::Kernel::CommArguments commArguments{commCoreSplit, commBlockShape, commTileShape, ubStages};
+    typename BlockEpilogueAllGather::Params allGatherParams =
+        Catcoc::detail::MakeCommParams<BlockEpilogueAllGather>(
+        symmetricPtr, layoutD, matmulBlockScheduler, commArguments);
 
-    typename BlockEpilogueReduceScatter::Params reduceScatterParams{
-        reinterpret_cast<__gm__ ElementC *>(symmetricPtr),
-        layoutD,
-        matmulBlockScheduler,
-        commCoreSplit,
-        commBlockShape,
-        commTileShape
-    };
+    typename BlockEpilogueReduceScatter::Params reduceScatterParams =
+        Catcoc::detail::MakeCommParams<BlockEpilogueReduceScatter>(
+        symmetricPtr, layoutD, matmulBlockScheduler, commArguments);
 
     typename MatmulAllReduceKernel::Params params{
         problemShape,
@@ -135,7 +161,13 @@ void MatmulAllReduceImpl(
         reduceScatterParams,
         allGatherParams,
         gmC, layoutC,
-        commInterval
+        commInterval,
+        workspaceStages,
+        commSchedule,
+        swizzle,
+        firstCommInterval,
+        tailSplitK,
+        tileFlags
     };
 
     // Call kernel
@@ -144,36 +176,40 @@ void MatmulAllReduceImpl(
 }
 
 template <
+    class L1TileShape,
+    int32_t STATIC_COMM,
+    uint32_t RANK_SIZE,
     class ElementA, class LayoutA,
     class ElementB, class LayoutB,
     class ElementC, class LayoutC,
     class ElementD, class LayoutD
 >
-CATLASS_GLOBAL
-void MatmulAllReduce(
-    uint64_t fftsAddr, GM_ADDR gmA, GM_ADDR gmB, GM_ADDR gmC, GM_ADDR symmetricPtr, CocTilingParams cocTiling
+CATLASS_DEVICE
+void MatmulAllReduceWithTiling(
+    GM_ADDR gmA, GM_ADDR gmB, GM_ADDR gmC, GM_ADDR symmetricPtr, CocTilingParams const &cocTiling
 )
 {
-
-    AscendC::SetSyncBaseAddr(fftsAddr);
-
     using ArchTag = Catlass::Arch::AtlasA2;
     Catlass::Arch::Resource<ArchTag> resource;
 
     uint32_t m = cocTiling.m;
     uint32_t n = cocTiling.n;
     uint32_t k = cocTiling.k;
-    uint32_t m0 = cocTiling.m0;
-    uint32_t n0 = cocTiling.n0;
-    uint32_t k0 = cocTiling.k0;
+    uint32_t m0 = L1TileShape::M;
+    uint32_t n0 = L1TileShape::N;
     uint32_t commInterval = cocTiling.commInterval;
+    uint32_t firstCommInterval = cocTiling.firstCommInterval;
+    uint32_t tailSplitK = cocTiling.tailSplitK;
+    uint32_t tileFlags = cocTiling.tileFlags;
     uint32_t commTileM = cocTiling.commTileM;
     uint32_t commNpuSplit = cocTiling.commNpuSplit;
     uint32_t commDataSplit = cocTiling.commDataSplit;
     uint32_t commBlockM = cocTiling.commBlockM;
+    uint32_t workspaceStages = cocTiling.workspaceStages;
+    uint32_t ubStages = cocTiling.ubStages;
+    Catcoc::DGemm::Block::GemmSwizzle swizzle{cocTiling.swizzleOffset, cocTiling.swizzleDirection};
 
     Catlass::GemmCoord problemShape{m, n, k};
-    Catlass::GemmCoord l1TileShape{m0, n0, k0};
 
     Catlass::MatrixCoord commCoreSplit{commDataSplit, commNpuSplit};
     Catlass::MatrixCoord commBlockShape{commBlockM, n0};
@@ -203,13 +239,99 @@ void MatmulAllReduce(
     LayoutA layoutA{m, k, strideA};
     LayoutB layoutB{k, n, strideB};
     LayoutC layoutC{m, n, strideC};
-    LayoutD layoutD{m0 * commInterval * BLOCK_NUM * WORKSPACE_STAGES, n0, n0};
+    LayoutD layoutD{m0 * commInterval * AscendC::GetBlockNum() * workspaceStages, n0, n0};
+    // host预计算的通信调度表放在workspace之后
+    GM_ADDR commSchedule = (cocTiling.commSchedule != 0) ? symmetricPtr + cocTiling.commSchedule : nullptr;
+
+    if (cocTiling.deterministic && cocTiling.pushAllGather) {
+        MatmulAllReduceImpl<ArchTag, L1TileShape, STATIC_COMM, DYNAMIC_RANK_SIZE, ElementA, LayoutA, ElementB, LayoutB, ElementC, LayoutC, ElementD, LayoutD, true, true>
+            (problemShape, gmA, layoutA, gmB, layoutB, gmC, layoutC,
+             commInterval, firstCommInterval, tailSplitK, tileFlags, workspaceStages, ubStages, commCoreSplit, commBlockShape, commTileShape, swizzle, symmetricPtr, layoutD,
+             commSchedule
+            );
+    } else if (cocTiling.deterministic) {
+        MatmulAllReduceImpl<ArchTag, L1TileShape, STATIC_COMM, DYNAMIC_RANK_SIZE, ElementA, LayoutA, ElementB, LayoutB, ElementC, LayoutC, ElementD, LayoutD, true, false>
+            (problemShape, gmA, layoutA, gmB, layoutB, gmC, layoutC,
+             commInterval, firstCommInterval, tailSplitK, tileFlags, workspaceStages, ubStages, commCoreSplit, commBlockShape, commTileShape, swizzle, symmetricPtr, layoutD,
+             commSchedule
+            );
+    } else if (cocTiling.pushAllGather) {
+        MatmulAllReduceImpl<ArchTag, L1TileShape, STATIC_COMM, DYNAMIC_RANK_SIZE, ElementA, LayoutA, ElementB, LayoutB, ElementC, LayoutC, ElementD, LayoutD, false, true>
+            (problemShape, gmA, layoutA, gmB, layoutB, gmC, layoutC,
+             commInterval, firstCommInterval, tailSplitK, tileFlags, workspaceStages, ubStages, commCoreSplit, commBlockShape, commTileShape, swizzle, symmetricPtr, layoutD,
+             commSchedule
+            );
+    } else {
+        // 只有最常用的原子累加, 读取式all-gather变体按rank数特化调度
+        MatmulAllReduceImpl<ArchTag, L1TileShape, STATIC_COMM, RANK_SIZE, ElementA, LayoutA, ElementB, LayoutB, ElementC, LayoutC, ElementD, LayoutD, false, false>
+            (problemShape, gmA, layoutA, gmB, layoutB, gmC, layoutC,
+             commInterval, firstCommInterval, tailSplitK, tileFlags, workspaceStages, ubStages, commCoreSplit, commBlockShape, commTileShape, swizzle, symmetricPtr, layoutD,
+             commSchedule
+            );
+    }
+}
 
-    MatmulAllReduceImpl<ArchTag, ElementA, LayoutA, ElementB, LayoutB, ElementC, LayoutC, ElementD, LayoutD>
-        (problemShape, l1TileShape, gmA, layoutA, gmB, layoutB, gmC, layoutC, 
-         commInterval, commCoreSplit, commBlockShape, commTileShape, symmetricPtr, layoutD
-        );
+template <
+    class L1TileShape,
+    int32_t STATIC_COMM,
+    class ElementA, class LayoutA,
+    class ElementB, class LayoutB,
+    class ElementC, class LayoutC,
+    class ElementD, class LayoutD
+>
+CATLASS_DEVICE
+void MatmulAllReduceWithRankSize(
+    GM_ADDR gmA, GM_ADDR gmB, GM_ADDR gmC, GM_ADDR symmetricPtr, CocTilingParams const &cocTiling
+)
+{
+    // 常见的2/4/8卡使用编译期rank数的调度
+    uint32_t rankSize = shmem_n_pes();
+    if (rankSize == 8) {
+        MatmulAllReduceWithTiling<L1TileShape, STATIC_COMM, 8, ElementA, LayoutA, ElementB, LayoutB,
+            ElementC, LayoutC, ElementD, LayoutD>(gmA, gmB, gmC, symmetricPtr, cocTiling);
+    } else if (rankSize == 4) {
+        MatmulAllReduceWithTiling<L1TileShape, STATIC_COMM, 4, ElementA, LayoutA, ElementB, LayoutB,
+            ElementC, LayoutC, ElementD, LayoutD>(gmA, gmB, gmC, symmetricPtr, cocTiling);
+    } else if (rankSize == 2) {
+        MatmulAllReduceWithTiling<L1TileShape, STATIC_COMM, 2, ElementA, LayoutA, ElementB, LayoutB,
+            ElementC, LayoutC, ElementD, LayoutD>(gmA, gmB, gmC, symmetricPtr, cocTiling);
+    } else {
+        MatmulAllReduceWithTiling<L1TileShape, STATIC_COMM, DYNAMIC_RANK_SIZE, ElementA, LayoutA, ElementB, LayoutB,
+            ElementC, LayoutC, ElementD, LayoutD>(gmA, gmB, gmC, symmetricPtr, cocTiling);
+    }
 }
 
+template <
+    class ElementA, class LayoutA,
+    class ElementB, class LayoutB,
+    class ElementC, class LayoutC,
+    class ElementD, class LayoutD
+>
+CATLASS_GLOBAL
+void MatmulAllReduce(
+    uint64_t fftsAddr, GM_ADDR gmA, GM_ADDR gmB, GM_ADDR gmC, GM_ADDR symmetricPtr, CocTilingParams cocTiling
+)
+{
+    AscendC::SetSyncBaseAddr(fftsAddr);
+
+    // 与预编译通信切分一致的tiling使用编译期常量的kernel, 其余按tiling中的m0/n0/k0选择预编译的基本块,
+    // MmadAtlasA2Pingpong的基本块是编译期的, host保证m0/n0/k0为L1_TILES之一. 只有默认基本块再按rank数分发
+    if (IsStaticComm<0>(cocTiling)) {
+        MatmulAllReduceWithRankSize<L1Tile<0>, 0, ElementA, LayoutA, ElementB, LayoutB,
+            ElementC, LayoutC, ElementD, LayoutD>(gmA, gmB, gmC, symmetricPtr, cocTiling);
+    } else if (IsStaticComm<1>(cocTiling)) {
+        MatmulAllReduceWithRankSize<L1Tile<0>, 1, ElementA, LayoutA, ElementB, LayoutB,
+            ElementC, LayoutC, ElementD, LayoutD>(gmA, gmB, gmC, symmetricPtr, cocTiling);
+    } else if (IsL1Tile<1>(cocTiling)) {
+        MatmulAllReduceWithTiling<L1Tile<1>, DYNAMIC_COMM, DYNAMIC_RANK_SIZE, ElementA, LayoutA, ElementB, LayoutB,
+            ElementC, LayoutC, ElementD, LayoutD>(gmA, gmB, gmC, symmetricPtr, cocTiling);
+    } else if (IsL1Tile<2>(cocTiling)) {
+        MatmulAllReduceWithTiling<L1Tile<2>, DYNAMIC_COMM, DYNAMIC_RANK_SIZE, ElementA, LayoutA, ElementB, LayoutB,
+            ElementC, LayoutC, ElementD, LayoutD>(gmA, gmB, gmC, symmetricPtr, cocTiling);
+    } else {
+        MatmulAllReduceWithRankSize<L1Tile<0>, DYNAMIC_COMM, ElementA, LayoutA, ElementB, LayoutB,
+            ElementC, LayoutC, ElementD, LayoutD>(gmA, gmB, gmC, symmetricPtr, cocTiling);
+    }
+}
 
 #endif // MATMUL_ALLREDUCE_KERNEL_H
\ No newline at end of file
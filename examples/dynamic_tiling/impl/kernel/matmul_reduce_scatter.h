@@ -2,6 +2,9 @@
 #define MATMUL_REDUCE_SCATTER_KERNEL_H
 
 #include "info.h"
+#include "l1_tile.h"
+#include "rank_size.h"
+#include "static_comm.h"
 
 // from catlass
 #include "catlass/catlass.hpp"
@@ -20,6 +23,8 @@
 #include "catcoc/comm_epilogue/block/comm_block_swizzle.hpp"
 #include "catcoc/comm_epilogue/tile/tile_remote_copy.hpp"
 #include "catcoc/detail/remote_copy_type.hpp"
+#include "catcoc/detail/rank_partition.hpp"
+#include "catcoc/dgemm/block/block_swizzle_dynamic.hpp"
 #include "catcoc/dgemm/kernel/matmul_reduce_scatter.hpp"
 
 using namespace AscendC;
@@ -27,31 +32,35 @@ using namespace Catcoc;
 
 template <
     class ArchTag,
+    class L1TileShape,
+    int32_t STATIC_COMM,
+    uint32_t RANK_SIZE,
     class ElementA, class LayoutA,
     class ElementB, class LayoutB,
     class ElementD, class LayoutD,
-    class ElementSymmetric, class LayoutSymmetric
+    class ElementSymmetric, class LayoutSymmetric,
+    bool IS_DETERMINISTIC
 >
 CATLASS_DEVICE
 void MatmulReduceScatterImpl(
     Catlass::GemmCoord const &problemShape,
-    Catlass::GemmCoord const &l1TileShape,
     GM_ADDR gmA, LayoutA const &layoutA,
     GM_ADDR gmB, LayoutB const &layoutB,
     GM_ADDR gmD, LayoutD const &layoutD,
-    uint32_t rank, uint32_t rankSize, uint32_t commInterval,
+    uint32_t rank, uint32_t rankSize, uint32_t commInterval, uint32_t firstCommInterval, uint32_t splitK,
+    uint32_t tileFlags, uint32_t pushStore, uint32_t workspaceStages, uint32_t ubStages,
     Catlass::MatrixCoord const &commCoreSplit,
     Catlass::MatrixCoord const &commBlockShape,
     Catlass::MatrixCoord const &commTileShape,
+    Catcoc::DGemm::Block::GemmSwizzle const &swizzle,
     GM_ADDR symmetricPtr, LayoutSymmetric const &layoutSymmetric
 )
 {
     constexpr bool enableUnitFlag = true;
     using MmadDispatchPolicy = Catlass::Gemm::MmadAtlasA2Pingpong<enableUnitFlag>;
 
-    // TODO: 当前catlass中MmadAtlasA2Pingpong没有动态版本, 预留了l1TileShape
-    using L1TileShape = Catlass::GemmShape<M0, N0, K0>;
-    using L0TileShape = Catlass::GemmShape<M0, N0, 64>;
+    // L1TileShape由kernel入口按tiling中的m0/n0/k0从预编译的基本块中选择
+    using L0TileShape = Catlass::GemmShape<L1TileShape::M, L1TileShape::N, 64>;
 
     using AType = Catlass::Gemm::GemmType<ElementA, LayoutA>;
     using BType = Catlass::Gemm::GemmType<ElementB, LayoutB>;
@@ -59,7 +68,9 @@ void MatmulReduceScatterImpl(
     using DType = Catlass::Gemm::GemmType<ElementD, LayoutD>;
 
     using BlockMmad = Catlass::Gemm::Block::BlockMmad<MmadDispatchPolicy, L1TileShape, L0TileShape, AType, BType, CType>;
-    using BlockScheduler = typename Catlass::Gemm::Block::GemmIdentityBlockSwizzle<7, 1>;
+    // 静态通信切分的kernel固定使用<7, 1>的swizzle, 其余从tiling读取swizzle, 通信epilogue的remapper与之一致
+    using BlockScheduler = std::conditional_t<CommTiling<STATIC_COMM>::IS_DYNAMIC,
+        Catcoc::DGemm::Block::GemmDynamicBlockSwizzle, Catlass::Gemm::Block::GemmIdentityBlockSwizzle<7, 1>>;
 
     using RemoteSrcType = CType;
     using RemoteDstType = DType;
@@ -67,19 +78,38 @@ void MatmulReduceScatterImpl(
     using TileRemoteCopy = CommEpilogue::Tile::TileRemoteCopy<ArchTag, RemoteSrcType, RemoteDstType, CopyDirect::Get>;
     using TileScheduler = Catlass::Epilogue::Tile::EpilogueIdentityTileSwizzle;
 
-    constexpr bool isDynamic = true;
-    using ReduceScatterDispatch = CommEpilogue::EpilogueAtlasA2CommToLocalMem<UB_STAGES,
+    // 通信切分与预编译配置一致时使用编译期常量, 否则从params读取
+    using CommTilingType = CommTiling<STATIC_COMM>;
+    constexpr bool isDynamic = CommTilingType::IS_DYNAMIC;
+    using CommCoreSplit = typename CommTilingType::CoreSplit;
+    using CommBlockShape = typename CommTilingType::template BlockShape<L1TileShape::N>;
+    using CommTileShape = typename CommTilingType::template TileShape<L1TileShape::N>;
+    using ReduceScatterDispatch = CommEpilogue::EpilogueAtlasA2CommToLocalMem<CommTilingType::UB_STAGES,
         Catcoc::detail::CopyMode::Scatter, isDynamic>;
-    using BlockEpilogueReduceScatter = CommEpilogue::Block::CommBlockEpilogue<
+    using BlockEpilogueReduceScatterAtomic = CommEpilogue::Block::CommBlockEpilogue<
         ReduceScatterDispatch,
         RemoteSrcType, RemoteDstType,
-        void,
-        void,
-        void, TileRemoteCopy, TileScheduler,
+        CommCoreSplit,
+        CommBlockShape,
+        CommTileShape, TileRemoteCopy, TileScheduler,
+        BlockScheduler
+    >;
+
+    using ReduceScatterDeterministicDispatch = CommEpilogue::EpilogueAtlasA2CommReduceDeterministic<
+        CommTilingType::UB_STAGES, true, isDynamic>;
+    using BlockEpilogueReduceScatterDeterministic = CommEpilogue::Block::CommBlockEpilogue<
+        ReduceScatterDeterministicDispatch,
+        RemoteSrcType, RemoteDstType,
+        CommCoreSplit,
+        CommBlockShape,
+        CommTileShape, TileScheduler,
         BlockScheduler
     >;
 
-    using CommBlockScheduler = CommEpilogue::Block::BlockCommSwizzle<0>;
+    using BlockEpilogueReduceScatter = std::conditional_t<IS_DETERMINISTIC,
+        BlockEpilogueReduceScatterDeterministic, BlockEpilogueReduceScatterAtomic>;
+
+    using CommBlockScheduler = CommEpilogue::Block::BlockCommSwizzle<0, IS_DETERMINISTIC, RANK_SIZE>;
 
     using MatmulReduceScatterKernel = DGemm::Kernel::MatmulReduceScatter<
         BlockMmad,
@@ -89,17 +119,17 @@ void MatmulReduceScatterImpl(
         WORKSPACE_STAGES
     >;
 
-    Catlass::GemmCoord problemShapeInRank = problemShape / Catlass::MakeCoord<uint32_t>(rankSize, 1, 1);
-    BlockScheduler matmulBlockScheduler(problemShapeInRank, Catlass::MakeCoord<uint32_t>(M0, N0));
+    // Remap over the tile grid of the largest share, the shape is clipped to the rows owned by this rank
+    Catcoc::detail::RankPartition rankPartition(problemShape.m(), rankSize);
+    Catlass::GemmCoord problemShapeInRank{rankPartition.GetExtent(rank), problemShape.n(), problemShape.k()};
+    Catlass::MatrixCoord tileMN = L1TileShape::ToCoordMN();
+    auto matmulBlockScheduler = Catcoc::detail::MakeBlockScheduler<BlockScheduler>(swizzle, problemShapeInRank, tileMN,
+        CeilDiv(Catlass::MatrixCoord{rankPartition.GetMaxExtent(), problemShape.n()}, tileMN));
 
-    typename BlockEpilogueReduceScatter::Params reduceScatterParams{
-        reinterpret_cast<__gm__ ElementSymmetric *>(symmetricPtr),
-        layoutSymmetric,
-        matmulBlockScheduler,
-        commCoreSplit,
-        commBlockShape,
-        commTileShape
-    };
+    DGemm::Kernel::CommArguments commArguments{commCoreSplit, commBlockShape, commTileShape, ubStages};
+    typename BlockEpilogueReduceScatter::Params reduceScatterParams =
+        Catcoc::detail::MakeCommParams<BlockEpilogueReduceScatter>(
+        symmetricPtr, layoutSymmetric, matmulBlockScheduler, commArguments);
 
     typename MatmulReduceScatterKernel::Params params{
         problemShape,
@@ -109,7 +139,13 @@ void MatmulReduceScatterImpl(
         symmetricPtr,
         reduceScatterParams,
         gmD, layoutD,
-        commInterval
+        commInterval,
+        workspaceStages,
+        swizzle,
+        firstCommInterval,
+        splitK,
+        tileFlags,
+        pushStore
     };
 
     // Call kernel
@@ -118,35 +154,41 @@ void MatmulReduceScatterImpl(
 }
 
 template <
+    class L1TileShape,
+    int32_t STATIC_COMM,
+    uint32_t RANK_SIZE,
     class ElementA, class LayoutA,
     class ElementB, class LayoutB,
     class ElementD, class LayoutD,
     class ElementSymmetric, class LayoutSymmetric
 >
-CATLASS_GLOBAL
-void MatmulReduceScatter(
-    uint64_t fftsAddr, GM_ADDR gmA, GM_ADDR gmB, GM_ADDR gmD, GM_ADDR symmetricPtr, CocTilingParams cocTiling
+CATLASS_DEVICE
+void MatmulReduceScatterWithTiling(
+    GM_ADDR gmA, GM_ADDR gmB, GM_ADDR gmD, GM_ADDR symmetricPtr, CocTilingParams const &cocTiling
 )
 {
-    AscendC::SetSyncBaseAddr(fftsAddr);
-
     using ArchTag = Catlass::Arch::AtlasA2;
     Catlass::Arch::Resource<ArchTag> resource;
 
     uint32_t m = cocTiling.m;
     uint32_t n = cocTiling.n;
     uint32_t k = cocTiling.k;
-    uint32_t m0 = cocTiling.m0;
-    uint32_t n0 = cocTiling.n0;
-    uint32_t k0 = cocTiling.k0;
+    uint32_t m0 = L1TileShape::M;
+    uint32_t n0 = L1TileShape::N;
     uint32_t commInterval = cocTiling.commInterval;
+    uint32_t firstCommInterval = cocTiling.firstCommInterval;
+    uint32_t splitK = cocTiling.splitK;
+    uint32_t tileFlags = cocTiling.tileFlags;
+    uint32_t pushStore = cocTiling.pushStore;
     uint32_t commTileM = cocTiling.commTileM;
     uint32_t commNpuSplit = cocTiling.commNpuSplit;
     uint32_t commDataSplit = cocTiling.commDataSplit;
     uint32_t commBlockM = cocTiling.commBlockM;
+    uint32_t workspaceStages = cocTiling.workspaceStages;
+    uint32_t ubStages = cocTiling.ubStages;
+    Catcoc::DGemm::Block::GemmSwizzle swizzle{cocTiling.swizzleOffset, cocTiling.swizzleDirection};
 
     Catlass::GemmCoord problemShape{m, n, k};
-    Catlass::GemmCoord l1TileShape{m0, n0, k0};
 
     Catlass::MatrixCoord commCoreSplit{commDataSplit, commNpuSplit};
     Catlass::MatrixCoord commBlockShape{commBlockM, n0};
@@ -157,16 +199,92 @@ void MatmulReduceScatter(
 
     LayoutA layoutA{m, k};
     LayoutB layoutB{k, n};
-    LayoutD layoutD{m / rankSize, n};
-    LayoutSymmetric layoutSymmetric{m0 * commInterval * BLOCK_NUM * WORKSPACE_STAGES, n0, n0};
-
-    MatmulReduceScatterImpl<ArchTag, ElementA, LayoutA, ElementB, LayoutB, ElementD, LayoutD, ElementSymmetric, LayoutSymmetric>(
-        problemShape, l1TileShape,
-        gmA, layoutA, gmB, layoutB, gmD, layoutD,
-        rank, rankSize, commInterval,
-        commCoreSplit, commBlockShape, commTileShape,
-        symmetricPtr, layoutSymmetric
-    );
+    LayoutD layoutD{Catcoc::detail::RankPartition(m, rankSize).GetExtent(rank), n};
+    LayoutSymmetric layoutSymmetric{m0 * commInterval * AscendC::GetBlockNum() * workspaceStages, n0, n0};
+
+    if (cocTiling.deterministic) {
+        MatmulReduceScatterImpl<ArchTag, L1TileShape, STATIC_COMM, DYNAMIC_RANK_SIZE, ElementA, LayoutA,
+            ElementB, LayoutB, ElementD, LayoutD, ElementSymmetric, LayoutSymmetric, true>(
+            problemShape,
+            gmA, layoutA, gmB, layoutB, gmD, layoutD,
+            rank, rankSize, commInterval, firstCommInterval, splitK, tileFlags, pushStore, workspaceStages, ubStages,
+            commCoreSplit, commBlockShape, commTileShape, swizzle,
+            symmetricPtr, layoutSymmetric
+        );
+    } else {
+        // 只有原子累加的变体按rank数特化调度
+        MatmulReduceScatterImpl<ArchTag, L1TileShape, STATIC_COMM, RANK_SIZE, ElementA, LayoutA, ElementB, LayoutB,
+            ElementD, LayoutD, ElementSymmetric, LayoutSymmetric, false>(
+            problemShape,
+            gmA, layoutA, gmB, layoutB, gmD, layoutD,
+            rank, rankSize, commInterval, firstCommInterval, splitK, tileFlags, pushStore, workspaceStages, ubStages,
+            commCoreSplit, commBlockShape, commTileShape, swizzle,
+            symmetricPtr, layoutSymmetric
+        );
+    }
+}
+
+template <
+    class L1TileShape,
+    int32_t STATIC_COMM,
+    class ElementA, class LayoutA,
+    class ElementB, class LayoutB,
+    class ElementD, class LayoutD,
+    class ElementSymmetric, class LayoutSymmetric
+>
+CATLASS_DEVICE
+void MatmulReduceScatterWithRankSize(
+    GM_ADDR gmA, GM_ADDR gmB, GM_ADDR gmD, GM_ADDR symmetricPtr, CocTilingParams const &cocTiling
+)
+{
+    // 常见的2/4/8卡使用编译期rank数的调度
+    uint32_t rankSize = shmem_n_pes();
+    if (rankSize == 8) {
+        MatmulReduceScatterWithTiling<L1TileShape, STATIC_COMM, 8, ElementA, LayoutA, ElementB, LayoutB,
+            ElementD, LayoutD, ElementSymmetric, LayoutSymmetric>(gmA, gmB, gmD, symmetricPtr, cocTiling);
+    } else if (rankSize == 4) {
+        MatmulReduceScatterWithTiling<L1TileShape, STATIC_COMM, 4, ElementA, LayoutA, ElementB, LayoutB,
+            ElementD, LayoutD, ElementSymmetric, LayoutSymmetric>(gmA, gmB, gmD, symmetricPtr, cocTiling);
+    } else if (rankSize == 2) {
+        MatmulReduceScatterWithTiling<L1TileShape, STATIC_COMM, 2, ElementA, LayoutA, ElementB, LayoutB,
+            ElementD, LayoutD, ElementSymmetric, LayoutSymmetric>(gmA, gmB, gmD, symmetricPtr, cocTiling);
+    } else {
+        MatmulReduceScatterWithTiling<L1TileShape, STATIC_COMM, DYNAMIC_RANK_SIZE, ElementA, LayoutA, ElementB, LayoutB,
+            ElementD, LayoutD, ElementSymmetric, LayoutSymmetric>(gmA, gmB, gmD, symmetricPtr, cocTiling);
+    }
+}
+
+template <
+    class ElementA, class LayoutA,
+    class ElementB, class LayoutB,
+    class ElementD, class LayoutD,
+    class ElementSymmetric, class LayoutSymmetric
+>
+CATLASS_GLOBAL
+void MatmulReduceScatter(
+    uint64_t fftsAddr, GM_ADDR gmA, GM_ADDR gmB, GM_ADDR gmD, GM_ADDR symmetricPtr, CocTilingParams cocTiling
+)
+{
+    AscendC::SetSyncBaseAddr(fftsAddr);
+
+    // 与预编译通信切分一致的tiling使用编译期常量的kernel, 其余按tiling中的m0/n0/k0选择预编译的基本块,
+    // MmadAtlasA2Pingpong的基本块是编译期的, host保证m0/n0/k0为L1_TILES之一. 只有默认基本块再按rank数分发
+    if (IsStaticComm<0>(cocTiling)) {
+        MatmulReduceScatterWithRankSize<L1Tile<0>, 0, ElementA, LayoutA, ElementB, LayoutB,
+            ElementD, LayoutD, ElementSymmetric, LayoutSymmetric>(gmA, gmB, gmD, symmetricPtr, cocTiling);
+    } else if (IsStaticComm<1>(cocTiling)) {
+        MatmulReduceScatterWithRankSize<L1Tile<0>, 1, ElementA, LayoutA, ElementB, LayoutB,
+            ElementD, LayoutD, ElementSymmetric, LayoutSymmetric>(gmA, gmB, gmD, symmetricPtr, cocTiling);
+    } else if (IsL1Tile<1>(cocTiling)) {
+        MatmulReduceScatterWithTiling<L1Tile<1>, DYNAMIC_COMM, DYNAMIC_RANK_SIZE, ElementA, LayoutA, ElementB, LayoutB,
+            ElementD, LayoutD, ElementSymmetric, LayoutSymmetric>(gmA, gmB, gmD, symmetricPtr, cocTiling);
+    } else if (IsL1Tile<2>(cocTiling)) {
+        MatmulReduceScatterWithTiling<L1Tile<2>, DYNAMIC_COMM, DYNAMIC_RANK_SIZE, ElementA, LayoutA, ElementB, LayoutB,
+            ElementD, LayoutD, ElementSymmetric, LayoutSymmetric>(gmA, gmB, gmD, symmetricPtr, cocTiling);
+    } else {
+        MatmulReduceScatterWithRankSize<L1Tile<0>, DYNAMIC_COMM, ElementA, LayoutA, ElementB, LayoutB,
+            ElementD, LayoutD, ElementSymmetric, LayoutSymmetric>(gmA, gmB, gmD, symmetricPtr, cocTiling);
+    }
 }
 
 #endif // MATMUL_REDUCE_SCATTER_KERNEL_H
\ No newline at end of file
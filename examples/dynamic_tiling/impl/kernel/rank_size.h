@@ -0,0 +1,10 @@
+#ifndef RANK_SIZE_KERNEL_H
+#define RANK_SIZE_KERNEL_H
+
+#include <cstdint>
+
+// 调度中按rank数的除法和取模: RANK_SIZE为2/4/8时是编译期常量, 折叠为移位和掩码;
+// 为DYNAMIC_RANK_SIZE时在运行时计算. 为控制实例化数量, 只有默认基本块上的原子累加变体按rank数特化
+constexpr uint32_t DYNAMIC_RANK_SIZE = 0;
+
+#endif // RANK_SIZE_KERNEL_H
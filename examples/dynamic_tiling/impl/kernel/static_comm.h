@@ -0,0 +1,43 @@
+#ifndef STATIC_COMM_KERNEL_H
+#define STATIC_COMM_KERNEL_H
+
+#include "info.h"
+
+// from catlass
+#include "catlass/catlass.hpp"
+#include "catlass/matrix_coord.hpp"
+
+// 通信切分: STATIC_COMM为STATIC_COMMS的下标时使用编译期常量, 为DYNAMIC_COMM时由params在运行时传入
+constexpr int32_t DYNAMIC_COMM = -1;
+
+template <int32_t STATIC_COMM>
+struct CommTiling {
+    static constexpr CocStaticComm COMM = STATIC_COMMS[STATIC_COMM];
+    static constexpr bool IS_DYNAMIC = false;
+    static constexpr uint32_t UB_STAGES = COMM.ubStages;
+    using CoreSplit = Catlass::MatrixShape<COMM.commDataSplit, COMM.commNpuSplit>;
+    template <uint32_t BLOCK_COLUMN>
+    using BlockShape = Catlass::MatrixShape<COMM.commBlockM, BLOCK_COLUMN>;
+    template <uint32_t TILE_COLUMN>
+    using TileShape = Catlass::MatrixShape<COMM.commTileM / 2, TILE_COLUMN>;
+};
+
+template <>
+struct CommTiling<DYNAMIC_COMM> {
+    static constexpr bool IS_DYNAMIC = true;
+    static constexpr uint32_t UB_STAGES = ::UB_STAGES;
+    using CoreSplit = void;
+    template <uint32_t BLOCK_COLUMN>
+    using BlockShape = void;
+    template <uint32_t TILE_COLUMN>
+    using TileShape = void;
+};
+
+template <int32_t STATIC_COMM>
+CATLASS_DEVICE
+bool IsStaticComm(CocTilingParams const &cocTiling)
+{
+    return cocTiling.commStatic == static_cast<uint32_t>(STATIC_COMM) + 1;
+}
+
+#endif // STATIC_COMM_KERNEL_H
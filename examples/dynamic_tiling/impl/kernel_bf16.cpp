@@ -30,16 +30,16 @@ void LaunchMatmulAllReduceBF16(
     (void)bW;
     if (!transA && !transB) {
         MatmulAllReduce<ElementA, LayoutA0, ElementB, LayoutB0, ElementC, LayoutC, ElementD, LayoutD>
-            <<<BLOCK_NUM, nullptr, stream>>>(fftsAddr, a, b, c, symmetricPtr, cocTiling);
+            <<<cocTiling.blockNum, nullptr, stream>>>(fftsAddr, a, b, c, symmetricPtr, cocTiling);
     } else if (!transA && transB) {
         MatmulAllReduce<ElementA, LayoutA0, ElementB, LayoutB1, ElementC, LayoutC, ElementD, LayoutD>
-            <<<BLOCK_NUM, nullptr, stream>>>(fftsAddr, a, b, c, symmetricPtr, cocTiling);
+            <<<cocTiling.blockNum, nullptr, stream>>>(fftsAddr, a, b, c, symmetricPtr, cocTiling);
     } else if (transA && !transB) {
         MatmulAllReduce<ElementA, LayoutA1, ElementB, LayoutB0, ElementC, LayoutC, ElementD, LayoutD>
-            <<<BLOCK_NUM, nullptr, stream>>>(fftsAddr, a, b, c, symmetricPtr, cocTiling);
+            <<<cocTiling.blockNum, nullptr, stream>>>(fftsAddr, a, b, c, symmetricPtr, cocTiling);
     } else {
         MatmulAllReduce<ElementA, LayoutA1, ElementB, LayoutB1, ElementC, LayoutC, ElementD, LayoutD>
-            <<<BLOCK_NUM, nullptr, stream>>>(fftsAddr, a, b, c, symmetricPtr, cocTiling);
+            <<<cocTiling.blockNum, nullptr, stream>>>(fftsAddr, a, b, c, symmetricPtr, cocTiling);
     }
 }
 
@@ -54,10 +54,10 @@ void LaunchAllGatherMatmulBF16(
     (void)bW;
     if (!transA && !transB) {
         AllGatherMatmul<ElementA, LayoutA0, ElementB, LayoutB0, ElementC, LayoutC, ElementD, LayoutD>
-            <<<BLOCK_NUM, nullptr, stream>>>(fftsAddr, a, b, c, symmetricPtr, cocTiling);
+            <<<cocTiling.blockNum, nullptr, stream>>>(fftsAddr, a, b, c, symmetricPtr, cocTiling);
     } else if (!transA && transB) {
         AllGatherMatmul<ElementA, LayoutA0, ElementB, LayoutB1, ElementC, LayoutC, ElementD, LayoutD>
-            <<<BLOCK_NUM, nullptr, stream>>>(fftsAddr, a, b, c, symmetricPtr, cocTiling);
+            <<<cocTiling.blockNum, nullptr, stream>>>(fftsAddr, a, b, c, symmetricPtr, cocTiling);
     }
 }
 
@@ -72,15 +72,15 @@ void LaunchMatmulReduceScatterBF16(
     (void)bW;
     if (!transA && !transB) {
         MatmulReduceScatter<ElementA, LayoutA0, ElementB, LayoutB0, ElementC, LayoutC, ElementD, LayoutD>
-            <<<BLOCK_NUM, nullptr, stream>>>(fftsAddr, a, b, c, symmetricPtr, cocTiling);
+            <<<cocTiling.blockNum, nullptr, stream>>>(fftsAddr, a, b, c, symmetricPtr, cocTiling);
     } else if (!transA && transB) {
         MatmulReduceScatter<ElementA, LayoutA0, ElementB, LayoutB1, ElementC, LayoutC, ElementD, LayoutD>
-            <<<BLOCK_NUM, nullptr, stream>>>(fftsAddr, a, b, c, symmetricPtr, cocTiling);
+            <<<cocTiling.blockNum, nullptr, stream>>>(fftsAddr, a, b, c, symmetricPtr, cocTiling);
     } else if (transA && !transB) {
         MatmulReduceScatter<ElementA, LayoutA1, ElementB, LayoutB0, ElementC, LayoutC, ElementD, LayoutD>
-            <<<BLOCK_NUM, nullptr, stream>>>(fftsAddr, a, b, c, symmetricPtr, cocTiling);
+            <<<cocTiling.blockNum, nullptr, stream>>>(fftsAddr, a, b, c, symmetricPtr, cocTiling);
     } else {
         MatmulReduceScatter<ElementA, LayoutA1, ElementB, LayoutB1, ElementC, LayoutC, ElementD, LayoutD>
-            <<<BLOCK_NUM, nullptr, stream>>>(fftsAddr, a, b, c, symmetricPtr, cocTiling);
+            <<<cocTiling.blockNum, nullptr, stream>>>(fftsAddr, a, b, c, symmetricPtr, cocTiling);
     }
 }
@@ -16,12 +16,21 @@ static uint64_t SHMEM_MALLOC_MAX_SIZE = 1024UL * 1024UL * 1024;
 constexpr uint32_t M0 = 128;
 constexpr int32_t N0 = 256;
 constexpr int32_t K0 = 256;
-constexpr uint32_t WORKSPACE_STAGES = 2;
-constexpr uint32_t UB_STAGES = 2;
-constexpr uint32_t BLOCK_NUM = 20;
+// kernel预编译的L1基本块{m0, n0, k0}, 第0个是默认基本块. L0切分为{m0, n0, 64}, 均满足L1/L0A/L0B/L0C的容量
+constexpr uint32_t L1_TILE_NUM = 3;
+constexpr uint32_t L1_TILES[L1_TILE_NUM][3] = {
+    {M0, N0, K0},
+    {64, 256, 256},  // 每个rank的M较小时(decode), 减少M方向的无效计算
+    {256, 128, 256}, // M较大而N较小时, 减少N方向的无效计算并复用更多A
+};
+// kernel编译的最大流水深度, 实际使用的深度由tiling中的workspaceStages/ubStages决定
+constexpr uint32_t WORKSPACE_STAGES = 4;
+constexpr uint32_t UB_STAGES = 4;
+// 默认的matmul swizzle, 与GemmIdentityBlockSwizzle<7, 1>一致, 静态通信切分的kernel固定使用它
+constexpr uint32_t SWIZZLE_OFFSET = 7;
+constexpr uint32_t SWIZZLE_DIRECTION = 1;
 constexpr uint32_t WARM_UP_TIMES = 10;
 constexpr uint32_t PERF_TEST_CYCLE_TIMES = 3;
-constexpr int32_t MAX_BLOCK_COUNT = 2;
 constexpr int LCAL_BUFF_BYTES = 204 * 1024 * 1024;
 constexpr int32_t FLAG_BUFF_BYTES = 5 * 512 * 1024;  // 2.5MB
 constexpr int32_t INPUT_DTYPE = 2;
@@ -35,10 +44,76 @@ struct CocTilingParams {
     uint32_t n0 = 0;
     uint32_t commTileM = 0;
     uint32_t commInterval = 0;
+    uint32_t firstCommInterval = 0; // 首个chunk的commInterval, 之后逐个翻倍直到commInterval, 0表示所有chunk相同
+    uint32_t tailSplitK = 0; // 最后一个chunk沿K切分到空闲核的最大份数, 0表示不切分, 仅matmul allreduce支持
+    uint32_t splitK = 0; // 每个基本块沿K切分的份数, 各份由reduce scatter一并累加, 0表示不切分, 仅matmul reduce scatter支持
+    uint32_t tileFlags = 0; // 非0时AIC每写完一个基本块置一次GM标志, 通信任务只等待其读取的基本块, 仅matmul allreduce和matmul reduce scatter支持
+    uint32_t pushStore = 0; // 非0时AIC直接将部分和写入目标rank的workspace, reduce scatter只读本地内存, 仅matmul reduce scatter支持
+    uint32_t pushAllGather = 0; // 非0时各rank将归约完成的分片写入所有rank的输出, 输出需从对称内存池中申请, 仅matmul allreduce支持
     uint32_t commNpuSplit = 0;
     uint32_t commDataSplit = 0;
     uint32_t commBlockM = 0;
     uint32_t rankSize = 0;
+    uint32_t deterministic = 0;
+    uint32_t blockNum = 0; // 启动的AI core数, 运行时从设备查询
+    uint32_t workspaceStages = 2; // workspace流水级数, 不超过WORKSPACE_STAGES
+    uint32_t ubStages = 2; // 通信UB多缓冲级数, 不超过UB_STAGES
+    uint32_t swizzleOffset = SWIZZLE_OFFSET; // matmul基本块swizzle的步长, 通信epilogue按相同的顺序取数据
+    uint32_t swizzleDirection = SWIZZLE_DIRECTION; // 0: 沿M方向swizzle(Zn), 1: 沿N方向swizzle(Nz)
+    uint32_t commStatic = 0; // 非0时为STATIC_COMMS中下标加1, 由host在tiling与之完全一致时设置
+    uint32_t commSchedule = 0; // 非0时为host预计算的通信调度表相对symmetricPtr的字节偏移, 仅MatmulAllReduce使用
+};
+
+// 常用的调优结果对应的通信切分. 使用默认基本块且与之完全一致的tiling走编译期常量的kernel,
+// 省去每个通信块上读取params和计算MatrixCoord的标量开销
+struct CocStaticComm {
+    uint32_t commTileM;
+    uint32_t commBlockM;
+    uint32_t commNpuSplit;
+    uint32_t commDataSplit;
+    uint32_t ubStages;
+};
+constexpr uint32_t STATIC_COMM_NUM = 2;
+constexpr CocStaticComm STATIC_COMMS[STATIC_COMM_NUM] = {
+    {64, 64, 1, 20, 2}, // 20核时的默认tiling
+    {64, 64, 1, 24, 2}, // 24核时的默认tiling
 };
 
+// tiling中的基本块必须是kernel预编译的基本块之一
+inline bool IsSupportedL1Tile(uint32_t m0, uint32_t n0, uint32_t k0)
+{
+    for (uint32_t i = 0; i < L1_TILE_NUM; ++i) {
+        if (m0 == L1_TILES[i][0] && n0 == L1_TILES[i][1] && k0 == L1_TILES[i][2]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// swizzle步长为0时无法划分基本块, 方向只有Zn/Nz两种
+inline bool IsSupportedSwizzle(uint32_t swizzleOffset, uint32_t swizzleDirection)
+{
+    return swizzleOffset > 0 && swizzleDirection <= 1;
+}
+
+// 返回与tiling完全一致的预编译通信切分的commStatic, 没有时返回0
+inline uint32_t GetStaticComm(const CocTilingParams &tiling)
+{
+    if (tiling.m0 != M0 || tiling.n0 != N0 || tiling.k0 != K0) {
+        return 0;
+    }
+    if (tiling.swizzleOffset != SWIZZLE_OFFSET || tiling.swizzleDirection != SWIZZLE_DIRECTION) {
+        return 0;
+    }
+    for (uint32_t i = 0; i < STATIC_COMM_NUM; ++i) {
+        const CocStaticComm &comm = STATIC_COMMS[i];
+        if (tiling.commTileM == comm.commTileM && tiling.commBlockM == comm.commBlockM &&
+            tiling.commNpuSplit == comm.commNpuSplit && tiling.commDataSplit == comm.commDataSplit &&
+            tiling.ubStages == comm.ubStages) {
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
 #endif // INFO_H
\ No newline at end of file
@@ -1,6 +1,8 @@
 #ifndef LAUNCH_MAP_H
 #define LAUNCH_MAP_H
 
+#include <map>
+#include <string>
 #include <unordered_map>
 
 enum CocCommType {
@@ -10,6 +12,13 @@ enum CocCommType {
     TYPE_NUM
 };
 
+// 与tiling文件中Op列的名字一致
+inline const std::map<CocCommType, std::string> commTypeMap = {
+    { MATMUL_ALLREDUCE, "MatmulAllReduce" },
+    { ALLGATHER_MATMUL, "AllGatherMatmul" },
+    { MATMUL_REDUCE_SCATTER, "MatmulReduceScatter" }
+};
+
 enum CocDataType {
     FP16 = 1,
     BF16 = 27
@@ -0,0 +1,276 @@
+/*
+ * Copyright (c) 2025 Huawei Technologies Co., Ltd.
+ * This file is a part of the CANN Open Software.
+ * Licensed under CANN Open Software License Agreement Version 1.0 (the "License").
+ * Please refer to the License for details. You may not use this file except in compliance with the License.
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE.
+ * See LICENSE in the root of the software repository for the full text of the License.
+ */
+#ifndef PLAN_H
+#define PLAN_H
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include <acl/acl.h>
+
+#include "host/shmem_host_team.h"
+
+#include "info.h"
+#include "launch_map.h"
+#include "tiling_check.h"
+#include "tiling_table.h"
+#include "catcoc/symmetric_pool.hpp"
+#include "catcoc/comm_epilogue/block/comm_block_swizzle.hpp"
+#include "catcoc/detail/remote_copy_type.hpp"
+#include "catcoc/dgemm/comm_schedule.hpp"
+#include "catcoc/dgemm/workspace_size.hpp"
+
+// 一次plan对应的算子描述. tiling中的shape(m/k/n), rankSize, blockNum和deterministic必须填写,
+// 其余字段(包括基本块m0/n0/k0)作为调优表中没有该shape时的默认tiling
+struct CocPlanDesc {
+    CocCommType commType;
+    CocDataType dataType;
+    uint32_t transA;
+    uint32_t transB;
+    CocTilingParams tiling;
+    // 非0时在创建plan时预计算MatmulAllReduce的通信调度表, kernel按表执行通信而不在每个通信块上计算下标
+    uint32_t commSchedule = 0;
+    // 从同一对称内存池中取出的输出D, 仅MatmulAllReduce使用. 有效时创建plan时按调优结果决定是否使用put模式的
+    // all-gather, 之后Run传入的d必须是它; 无效时只使用各rank读取的all-gather
+    Catcoc::SymmetricWorkspace d;
+};
+
+// dynamic_tiling的MatmulAllReduce kernel使用的通信调度, reduce-scatter从各rank读取, all-gather从各rank读取或写入各rank
+template <bool IS_DETERMINISTIC, Catcoc::detail::CopyDirect ALL_GATHER_DIRECT>
+using AllReduceCommSchedule = Catcoc::DGemm::MatmulAllReduceCommSchedule<
+    Catcoc::CommEpilogue::Block::BlockCommSwizzle<0, IS_DETERMINISTIC>,
+    Catcoc::detail::CopyMode::Scatter, Catcoc::detail::CopyDirect::Get,
+    Catcoc::detail::CopyMode::Gather, ALL_GATHER_DIRECT>;
+
+// 按tiling在host上生成本rank的通信调度表, 与kernel的启动核数和通信切分一一对应
+template <bool IS_DETERMINISTIC, Catcoc::detail::CopyDirect ALL_GATHER_DIRECT>
+inline void BuildAllReduceCommSchedule(const CocTilingParams &tiling, uint32_t rankIdx, std::vector<uint32_t> &words)
+{
+    Catcoc::DGemm::WorkspaceDesc desc{Catlass::GemmCoord{tiling.m, tiling.n, tiling.k},
+        Catlass::GemmCoord{tiling.m0, tiling.n0, tiling.k0}, tiling.rankSize, tiling.blockNum, tiling.commInterval,
+        tiling.workspaceStages, INPUT_DTYPE, tiling.firstCommInterval, tiling.tailSplitK};
+    AllReduceCommSchedule<IS_DETERMINISTIC, ALL_GATHER_DIRECT> schedule(desc, rankIdx,
+        Catlass::MatrixCoord{tiling.commDataSplit, tiling.commNpuSplit},
+        Catlass::MatrixCoord{tiling.commBlockM, tiling.n0});
+    words.resize(schedule.GetLayout().GetWords());
+    schedule.Build(words.data());
+}
+
+// 创建时一次性确定tiling, workspace和kernel入口, Run只做kernel launch. Run不修改plan, 可多线程同时调用
+class CocPlan {
+public:
+    bool Init(const CocPlanDesc &desc, const CocTilingTable *table, Catcoc::SymmetricPool &pool, uint64_t fftsAddr)
+    {
+        commType = desc.commType;
+        transA = desc.transA;
+        transB = desc.transB;
+        this->fftsAddr = fftsAddr;
+        this->pool = &pool;
+        // D需是本池中仍持有的workspace, allreduce的D为完整C
+        size_t dBytes = static_cast<size_t>(desc.tiling.m) * desc.tiling.n * INPUT_DTYPE;
+        if (desc.d.IsValid() && (!pool.Owns(desc.d) || (commType == MATMUL_ALLREDUCE && desc.d.size < dBytes))) {
+            ERROR_LOG("Output is not a symmetric workspace of the pool, offset = %zu, size = %zu", desc.d.offset,
+                desc.d.size);
+            return false;
+        }
+        d = desc.d;
+        tiling = desc.tiling;
+        CocTilingParams tuned;
+        if (table != nullptr && table->Lookup(commTypeMap.at(commType), desc.tiling, transA, transB, tuned)) {
+            MergeTunedTiling(tiling, tuned);
+            // 调优结果来自同一分桶中的其他M, 对本shape不满足约束时退回默认tiling
+            if (!IsValid(tiling)) {
+                tiling = desc.tiling;
+            }
+        }
+        if (!IsValid(tiling)) {
+            ERROR_LOG("Invalid tiling for %s, m = %u, k = %u, n = %u", commTypeMap.at(commType).c_str(),
+                tiling.m, tiling.k, tiling.n);
+            return false;
+        }
+        // put模式的all-gather由各rank写入所有rank的D, 只有D在各rank上偏移一致时可用, 在此一次确定
+        if (!d.IsValid()) {
+            tiling.pushAllGather = 0;
+        }
+        tiling.commStatic = GetStaticComm(tiling);
+        kernelFunc = KernelDispatcher::GetKernelFunc(commType, desc.dataType);
+        if (kernelFunc == nullptr) {
+            ERROR_LOG("No kernel registered for comm type %d, data type %d", commType, desc.dataType);
+            return false;
+        }
+        size_t workspaceSize = GetWorkspaceSize(tiling, commType, tiling.rankSize);
+        // 通信调度表只在本rank读取, 放在workspace之后
+        std::vector<uint32_t> commSchedule;
+        size_t commScheduleOffset = (workspaceSize + COMM_SCHEDULE_ALIGN - 1) / COMM_SCHEDULE_ALIGN *
+            COMM_SCHEDULE_ALIGN;
+        if (desc.commSchedule != 0 && commType == MATMUL_ALLREDUCE && commScheduleOffset != 0 &&
+            commScheduleOffset <= UINT32_MAX) {
+            using Catcoc::detail::CopyDirect;
+            if (tiling.deterministic && tiling.pushAllGather) {
+                BuildAllReduceCommSchedule<true, CopyDirect::Put>(tiling, shmem_my_pe(), commSchedule);
+            } else if (tiling.deterministic) {
+                BuildAllReduceCommSchedule<true, CopyDirect::Get>(tiling, shmem_my_pe(), commSchedule);
+            } else if (tiling.pushAllGather) {
+                BuildAllReduceCommSchedule<false, CopyDirect::Put>(tiling, shmem_my_pe(), commSchedule);
+            } else {
+                BuildAllReduceCommSchedule<false, CopyDirect::Get>(tiling, shmem_my_pe(), commSchedule);
+            }
+        }
+        size_t commScheduleSize = commSchedule.size() * sizeof(uint32_t);
+        workspace = pool.Acquire(commSchedule.empty() ? workspaceSize : commScheduleOffset + commScheduleSize);
+        if (!workspace.IsValid()) {
+            ERROR_LOG("Acquire symmetric workspace failed, size = %zu", workspaceSize);
+            return false;
+        }
+        if (!commSchedule.empty()) {
+            aclError ret = aclrtMemcpy(workspace.ptr + commScheduleOffset, commScheduleSize, commSchedule.data(),
+                commScheduleSize, ACL_MEMCPY_HOST_TO_DEVICE);
+            if (ret != ACL_SUCCESS) {
+                ERROR_LOG("Copy comm schedule failed, size = %zu, error = %d", commScheduleSize, ret);
+                pool.Release(workspace);
+                return false;
+            }
+            tiling.commSchedule = static_cast<uint32_t>(commScheduleOffset);
+        }
+        return true;
+    }
+
+    void Release(Catcoc::SymmetricPool &pool)
+    {
+        pool.Release(workspace);
+        kernelFunc = nullptr;
+    }
+
+    // d是输出, 三种算子分别为allreduce后的完整C, gather后的完整C和本rank的C分片.
+    // plan使用put模式的all-gather时d必须是创建时绑定的D, 否则不launch并返回false
+    bool Run(void *stream, uint8_t *a, uint8_t *b, uint8_t *d) const
+    {
+        if (tiling.pushAllGather != 0 && d != this->d.ptr) {
+            ERROR_LOG("Output does not match the symmetric workspace bound at offset %zu", this->d.offset);
+            return false;
+        }
+        CocTilingParams launchTiling = tiling;
+        kernelFunc(stream, fftsAddr, a, b, d, nullptr, nullptr, workspace.ptr, launchTiling, transA, transB);
+        return true;
+    }
+
+    const CocTilingParams &GetTiling() const
+    {
+        return tiling;
+    }
+
+private:
+    // workspace从池中当前最大的空闲块取出, 放不下的调优结果同样退回默认tiling
+    bool IsValid(const CocTilingParams &t) const
+    {
+        return IsValidTiling(t, commType, pool->GetMaxAvailable());
+    }
+
+    static constexpr size_t COMM_SCHEDULE_ALIGN = 512;
+
+    CocCommType commType{MATMUL_ALLREDUCE};
+    uint32_t transA{0};
+    uint32_t transB{0};
+    uint64_t fftsAddr{0};
+    const Catcoc::SymmetricPool *pool{nullptr};
+    CocTilingParams tiling;
+    KernelFuncPtr kernelFunc{nullptr};
+    Catcoc::SymmetricWorkspace workspace;
+    Catcoc::SymmetricWorkspace d;
+};
+
+// 按(算子, 数据类型, 转置, shape, 确定性, 启动核数, rankSize, 是否预计算通信调度, 绑定的D)缓存plan, Get可多线程调用, 命中时只持有读锁.
+// plan的workspace从对称内存池中取出, 各rank需按相同顺序首次创建plan, 保证workspace在各rank上偏移一致.
+// 多个线程同时首次创建时顺序在各rank上不确定, 因此只有构造cache的线程可以创建plan: 服务线程启动前由该线程
+// 调用Prepare按固定顺序创建所有plan, 其他线程的Get未命中时返回nullptr
+class CocPlanCache {
+public:
+    CocPlanCache(Catcoc::SymmetricPool &pool, const CocTilingTable *table, uint64_t fftsAddr)
+        : pool(pool), table(table), fftsAddr(fftsAddr), ownerThread(std::this_thread::get_id()) {}
+
+    CocPlanCache(const CocPlanCache &) = delete;
+    CocPlanCache &operator=(const CocPlanCache &) = delete;
+
+    ~CocPlanCache()
+    {
+        Clear();
+    }
+
+    // 按descs的顺序创建plan, 各rank需传入相同的descs. 只能在构造cache的线程调用
+    bool Prepare(const std::vector<CocPlanDesc> &descs)
+    {
+        for (const auto &desc : descs) {
+            if (Get(desc) == nullptr) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // 返回的plan在Clear之前一直有效, 创建失败或在其他线程上未命中时返回nullptr
+    const CocPlan *Get(const CocPlanDesc &desc)
+    {
+        Key key{desc.commType, desc.dataType, desc.transA, desc.transB, desc.tiling.m, desc.tiling.k,
+            desc.tiling.n, desc.tiling.deterministic, desc.tiling.blockNum, desc.tiling.rankSize, desc.commSchedule,
+            desc.d.IsValid() ? desc.d.offset : SIZE_MAX};
+        {
+            std::shared_lock<std::shared_mutex> lock(mutex);
+            auto it = plans.find(key);
+            if (it != plans.end()) {
+                return it->second.get();
+            }
+        }
+        if (std::this_thread::get_id() != ownerThread) {
+            ERROR_LOG("Plan for %s, m = %u, k = %u, n = %u was not prepared, plans can only be created on the "
+                "thread that constructed the cache", commTypeMap.at(desc.commType).c_str(), desc.tiling.m,
+                desc.tiling.k, desc.tiling.n);
+            return nullptr;
+        }
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        auto it = plans.find(key);
+        if (it != plans.end()) {
+            return it->second.get();
+        }
+        auto plan = std::make_unique<CocPlan>();
+        if (!plan->Init(desc, table, pool, fftsAddr)) {
+            return nullptr;
+        }
+        return plans.emplace(key, std::move(plan)).first->second.get();
+    }
+
+    // 调用前需保证这些plan的launch都已完成
+    void Clear()
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        for (auto &plan : plans) {
+            plan.second->Release(pool);
+        }
+        plans.clear();
+    }
+
+private:
+    using Key = std::tuple<CocCommType, CocDataType, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t,
+        uint32_t, uint32_t, uint32_t, size_t>;
+
+    Catcoc::SymmetricPool &pool;
+    const CocTilingTable *table;
+    uint64_t fftsAddr;
+    std::thread::id ownerThread;
+    std::shared_mutex mutex;
+    std::map<Key, std::unique_ptr<CocPlan>> plans;
+};
+
+#endif // PLAN_H
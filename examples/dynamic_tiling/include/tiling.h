@@ -12,14 +12,65 @@
 
 #include "info.h"
 #include "launch_map.h"
+#include "tiling_check.h"
+#include "catcoc/dgemm/workspace_size.hpp"
 #include <sstream>
 #include <vector>
 
 // tiling 搜索空间
+// 基础网格: 通信切分与commInterval对所有shape都需要搜索, 彼此做笛卡尔积
 std::vector<uint32_t> vCommInterval = {4, 6, 8, 12, 14};
 std::vector<uint32_t> vCommTileM = {4, 8, 16, 32, 64};
+// 由SetCoreNumSearchSpace按启动核数重新生成, 默认值对应20核
 std::vector<std::pair<uint32_t, uint32_t>> vCommSplitNpuDataPair = {{1, 16}, {1, 20}};
-std::vector<std::vector<uint32_t>> allParams = {vCommInterval, vCommTileM};
+// 0: 原子累加, 1: 按rank顺序确定性累加
+std::vector<uint32_t> vDeterministic = {0};
+
+// 调度参数: 基础网格的每个点上只改变其中一组, 其余保持默认值, 各组之间不做笛卡尔积.
+// 只对部分算子或shape生效的组仅在生效时展开, 见AppendScheduleVariants
+// 长K场景下更深的流水可以掩盖通信抖动, workspace和UB的级数一起搜索
+std::vector<uint32_t> vWorkspaceStages = {2, 3, 4};
+std::vector<uint32_t> vUbStages = {2, 3, 4};
+// 预编译基本块在L1_TILES中的下标, 小M的decode shape和窄N的shape需要不同于128x256的基本块
+std::vector<uint32_t> vL1Tile = {0, 1, 2};
+// matmul的swizzle步长和方向, 瘦高和宽扁的shape换用其他顺序时B/A在L2中的复用更好
+std::vector<uint32_t> vSwizzleOffset = {1, 3, 7};
+std::vector<uint32_t> vSwizzleDirection = {0, 1};
+// 首个chunk的commInterval, 0为均匀切分. 较小的首个chunk让通信更早开始, 之后的chunk翻倍到commInterval
+std::vector<uint32_t> vFirstCommInterval = {0, 1, 2};
+// 最后一个chunk沿K切分的最大份数, 0为不切分. 最后一个chunk的基本块较少时, 切分后由空闲核分担
+std::vector<uint32_t> vTailSplitK = {0, 2, 4};
+// matmul reduce scatter每个基本块沿K切分的份数, 0为不切分. 每个rank的M较小, 基本块不足以占满所有核时使用
+std::vector<uint32_t> vSplitK = {0, 2, 4};
+// 1: 通信任务等待AIC逐块置位的GM标志, 0: 等待整个chunk完成后再做一次全rank同步
+std::vector<uint32_t> vTileFlags = {0, 1};
+// matmul reduce scatter, 1: AIC将部分和直接写入目标rank的workspace, 0: 写入本地workspace, 由目标rank远端读取
+std::vector<uint32_t> vPushStore = {0, 1};
+// matmul allreduce, 1: 归约完成的分片由本rank写入各rank的输出, 0: 全rank同步后各rank读取其他rank的分片
+std::vector<uint32_t> vPushAllGather = {0, 1};
+
+// mode 0: 仅原子累加, mode 1: 仅确定性累加, mode 2: 两者都搜索, 用于评估确定性模式的性能开销
+void SetDeterministicSearchSpace(uint32_t mode)
+{
+    if (mode == 0) {
+        vDeterministic = {0};
+    } else if (mode == 1) {
+        vDeterministic = {1};
+    } else {
+        vDeterministic = {0, 1};
+    }
+}
+
+// 通信核切分随启动核数变化: 分别使用4/5的核和全部核做通信
+void SetCoreNumSearchSpace(uint32_t blockNum)
+{
+    uint32_t partialNum = blockNum * 4 / 5;
+    vCommSplitNpuDataPair.clear();
+    if (partialNum > 0 && partialNum != blockNum) {
+        vCommSplitNpuDataPair.push_back({1, partialNum});
+    }
+    vCommSplitNpuDataPair.push_back({1, blockNum});
+}
 
 int32_t CeilDev(int32_t num, int32_t div)
 {
@@ -29,78 +80,164 @@ int32_t CeilDev(int32_t num, int32_t div)
     return (num + div - 1) / div;
 }
 
-bool CheckCommIntervalReduceScatter(const CocTilingParams &tiling, int rankSize)
+// 与matmul allreduce kernel的切分判断一致, 实际不切分时与tailSplitK为0相同
+bool IsTailSplit(const CocTilingParams &tiling)
 {
-    constexpr int32_t blockNum= BLOCK_NUM;   
-    int64_t product = static_cast<int64_t>(blockNum) * tiling.commInterval;
-
-    if (product % rankSize != 0) {
-        return false;
-    }
-    return true;
+    uint32_t coreLoops = CeilDev(tiling.m, tiling.m0) * CeilDev(tiling.n, tiling.n0);
+    Catcoc::detail::ChunkRamp chunkRamp(tiling.blockNum * tiling.commInterval,
+        tiling.blockNum * tiling.firstCommInterval);
+    uint32_t commLoops = chunkRamp.GetChunkCount(coreLoops);
+    Catcoc::detail::TailSplit tailSplit(chunkRamp.GetActualSize(commLoops - 1, coreLoops), tiling.blockNum,
+        CeilDev(tiling.k, tiling.k0), tiling.tailSplitK);
+    return tailSplit.IsSplit();
 }
- 
-bool CheckCommIntervalAllReduce(const CocTilingParams &tiling, int rankSize)
+
+// 所有rank的基本块加起来仍少于启动核数时才切分K, 切分份数不超过K方向的基本块数
+bool IsSplitKUseful(const CocTilingParams &tiling, int rankSize)
 {
-    auto blockCount = MAX_BLOCK_COUNT;
-    int32_t maxPeerMemPerRank = (LCAL_BUFF_BYTES - FLAG_BUFF_BYTES) / INPUT_DTYPE / rankSize / blockCount;
-    if (tiling.commInterval * tiling.m0 * tiling.n0 * BLOCK_NUM >= maxPeerMemPerRank) {
-        return false;
-    }
-    return true;
+    uint32_t mInRank = Catcoc::detail::RankPartition(tiling.m, rankSize).GetMaxExtent();
+    uint32_t coreLoops = CeilDev(mInRank, tiling.m0) * CeilDev(tiling.n, tiling.n0) * rankSize;
+    return coreLoops < tiling.blockNum && tiling.splitK <= static_cast<uint32_t>(CeilDev(tiling.k, tiling.k0));
 }
 
-bool CheckCommIntervalAllGather(const CocTilingParams &tiling, int rankSize)
+// 在基础网格的一个点base上, 依次只改变一组调度参数生成候选, base本身为第一个
+void AppendScheduleVariants(const CocTilingParams &base, CocCommType commType, int rankSize,
+    std::vector<CocTilingParams> &variants)
 {
-    auto blockCount = MAX_BLOCK_COUNT;
-    uint32_t kLoop = CeilDev(tiling.k, tiling.k0);
-    int32_t maxPeerMemPerRank = (LCAL_BUFF_BYTES - FLAG_BUFF_BYTES) / INPUT_DTYPE / rankSize / blockCount;
-    if (tiling.commInterval * tiling.m0 * tiling.k0 * kLoop >= maxPeerMemPerRank) {
-        return false;
+    variants.push_back(base);
+    auto vary = [&](auto &&apply) {
+        CocTilingParams t = base;
+        apply(t);
+        variants.push_back(t);
+    };
+    for (uint32_t workspaceStages : vWorkspaceStages) {
+        for (uint32_t ubStages : vUbStages) {
+            if (workspaceStages != base.workspaceStages || ubStages != base.ubStages) {
+                vary([&](CocTilingParams &t) {
+                    t.workspaceStages = workspaceStages;
+                    t.ubStages = ubStages;
+                });
+            }
+        }
     }
-    return true;
-}
-
-void GetParamFromSearchSpace(std::vector<uint32_t>& curParams, 
-                             std::vector<std::vector<uint32_t>> &results, 
-                             int pos) {
-    if (pos == allParams.size()) {
-        for (int i = 0; i < vCommSplitNpuDataPair.size(); i++) {
-            std::vector<uint32_t> tmpParams(curParams.begin(), curParams.end());
-            tmpParams.push_back(vCommSplitNpuDataPair[i].first);
-            tmpParams.push_back(vCommSplitNpuDataPair[i].second);
-            results.push_back(tmpParams);
+    for (uint32_t l1Tile : vL1Tile) {
+        if (L1_TILES[l1Tile][0] != base.m0 || L1_TILES[l1Tile][1] != base.n0 || L1_TILES[l1Tile][2] != base.k0) {
+            vary([&](CocTilingParams &t) {
+                t.m0 = L1_TILES[l1Tile][0];
+                t.n0 = L1_TILES[l1Tile][1];
+                t.k0 = L1_TILES[l1Tile][2];
+            });
+        }
+    }
+    // allgather matmul的调度器按通信块排布基本块, 不使用swizzle参数, 各chunk也固定为commInterval,
+    // 其通信在matmul之前, 没有逐块就绪的标志
+    if (commType == ALLGATHER_MATMUL) {
+        return;
+    }
+    // swizzle与基本块分开搜索, 只在默认基本块上展开
+    for (uint32_t swizzleOffset : vSwizzleOffset) {
+        for (uint32_t swizzleDirection : vSwizzleDirection) {
+            if (swizzleOffset != base.swizzleOffset || swizzleDirection != base.swizzleDirection) {
+                vary([&](CocTilingParams &t) {
+                    t.swizzleOffset = swizzleOffset;
+                    t.swizzleDirection = swizzleDirection;
+                });
+            }
+        }
+    }
+    // 首个chunk不小于commInterval时与均匀切分相同
+    for (uint32_t firstCommInterval : vFirstCommInterval) {
+        if (firstCommInterval != 0 && firstCommInterval < base.commInterval) {
+            vary([&](CocTilingParams &t) { t.firstCommInterval = firstCommInterval; });
         }
     }
-    else {
-        for (int i = 0; i < allParams[pos].size(); i++) {
-            curParams[pos] = allParams[pos][i];
-            GetParamFromSearchSpace(curParams, results, pos + 1);
+    // 只有matmul allreduce支持最后一个chunk的K切分, 实际不切分时与tailSplitK为0相同
+    for (uint32_t tailSplitK : vTailSplitK) {
+        CocTilingParams t = base;
+        t.tailSplitK = tailSplitK;
+        if (tailSplitK != 0 && commType == MATMUL_ALLREDUCE && IsTailSplit(t)) {
+            variants.push_back(t);
+        }
+    }
+    // 只有matmul reduce scatter支持基本块的K切分
+    for (uint32_t splitK : vSplitK) {
+        CocTilingParams t = base;
+        t.splitK = splitK;
+        if (splitK != 0 && commType == MATMUL_REDUCE_SCATTER && IsSplitKUseful(t, rankSize)) {
+            variants.push_back(t);
+        }
+    }
+    // 逐块就绪的标志和两种写入远端的方式都作用于通信阶段的同步, 一起搜索. 只有matmul reduce scatter的部分和
+    // 按基本块归属于一个rank, 只有matmul allreduce有all-gather阶段
+    for (uint32_t tileFlags : vTileFlags) {
+        for (uint32_t push : (commType == MATMUL_REDUCE_SCATTER) ? vPushStore : vPushAllGather) {
+            if (tileFlags != base.tileFlags || push != 0) {
+                vary([&](CocTilingParams &t) {
+                    t.tileFlags = tileFlags;
+                    t.pushStore = (commType == MATMUL_REDUCE_SCATTER) ? push : 0;
+                    t.pushAllGather = (commType == MATMUL_ALLREDUCE) ? push : 0;
+                });
+            }
         }
     }
 }
 
+// capacity为可用于workspace的对称内存字节数, 只保留workspace不超过它的tiling
 void GetTilings(std::vector<CocTilingParams> &tilings, CocTilingParams &t,
-    CocCommType commType, int rankSize) {
-    std::vector<uint32_t> curParams(allParams.size(), 0);
-    std::vector<std::vector<uint32_t>> allTilings;
-    GetParamFromSearchSpace(curParams, allTilings, 0);
-    for (const auto &tiling : allTilings) {
-        uint32_t idx = 0;
-        t.commInterval = tiling[idx++];
-        t.commTileM = tiling[idx++];
-        t.commBlockM = t.commTileM;
-        t.commNpuSplit = tiling[idx++];
-        t.commDataSplit = tiling[idx++];
+    CocCommType commType, int rankSize, size_t capacity = LCAL_BUFF_BYTES - FLAG_BUFF_BYTES) {
+    // 基础网格上的其余参数取默认值, 与info.h中CocTilingParams的默认值一致
+    CocTilingParams base = t;
+    base.rankSize = rankSize;
+    base.m0 = L1_TILES[0][0];
+    base.n0 = L1_TILES[0][1];
+    base.k0 = L1_TILES[0][2];
+    base.workspaceStages = CocTilingParams{}.workspaceStages;
+    base.ubStages = CocTilingParams{}.ubStages;
+    base.swizzleOffset = SWIZZLE_OFFSET;
+    base.swizzleDirection = SWIZZLE_DIRECTION;
+    base.firstCommInterval = 0;
+    base.tailSplitK = 0;
+    base.splitK = 0;
+    base.tileFlags = 0;
+    base.pushStore = 0;
+    base.pushAllGather = 0;
 
-        if (commType == ALLGATHER_MATMUL && !CheckCommIntervalAllGather(t, rankSize)) 
-            continue;
-        if (commType == MATMUL_REDUCE_SCATTER && !CheckCommIntervalReduceScatter(t, rankSize))
+    std::vector<CocTilingParams> variants;
+    for (uint32_t deterministic : vDeterministic) {
+        // allgather matmul没有规约, 不区分确定性模式
+        if (commType == ALLGATHER_MATMUL && deterministic) {
             continue;
-        if (commType == MATMUL_ALLREDUCE && !CheckCommIntervalAllReduce(t, rankSize))
-            continue;
-
-        tilings.push_back(t);
+        }
+        for (uint32_t commInterval : vCommInterval) {
+            for (uint32_t commTileM : vCommTileM) {
+                for (const auto &commSplit : vCommSplitNpuDataPair) {
+                    base.deterministic = deterministic;
+                    base.commInterval = commInterval;
+                    base.commTileM = commTileM;
+                    base.commBlockM = commTileM;
+                    base.commNpuSplit = commSplit.first;
+                    base.commDataSplit = commSplit.second;
+                    // 通信核不能超过实际启动的核数
+                    if (base.commNpuSplit * base.commDataSplit > base.blockNum) {
+                        continue;
+                    }
+                    variants.clear();
+                    AppendScheduleVariants(base, commType, rankSize, variants);
+                    for (CocTilingParams &variant : variants) {
+                        if (!IsValidTiling(variant, commType, capacity)) {
+                            continue;
+                        }
+                        variant.commStatic = 0;
+                        tilings.push_back(variant);
+                        // 命中预编译通信切分的tiling再以编译期常量的kernel测一次, 用于对比两者的耗时
+                        variant.commStatic = GetStaticComm(variant);
+                        if (variant.commStatic != 0) {
+                            tilings.push_back(variant);
+                        }
+                    }
+                }
+            }
+        }
     }
 }
 
@@ -111,7 +248,7 @@ bool CreateTilingFile(const std::string filename)
         std::cerr << "Open file failed." << std::endl;
         return false;
     }
-    outFile << "Op,M,K,N,Transpose A,Transpose B,commInterval,commTileM,commBlockM,commNpuSplit,commDataSplit,Time(us)\n";
+    outFile << "Op,M,K,N,Transpose A,Transpose B,commInterval,commTileM,commBlockM,commNpuSplit,commDataSplit,deterministic,blockNum,workspaceStages,ubStages,m0,n0,k0,swizzleOffset,swizzleDirection,firstCommInterval,tailSplitK,splitK,tileFlags,pushStore,pushAllGather,commStatic,Time(us)\n";
     outFile.close();
     return true;
 }
@@ -136,6 +273,22 @@ bool WriteTilingInfos(std::string opName, std::vector<CocTilingParams> &cocTilin
                   << "," << cocTiling.commBlockM
                   << "," << cocTiling.commNpuSplit
                   << "," << cocTiling.commDataSplit
+                  << "," << cocTiling.deterministic
+                  << "," << cocTiling.blockNum
+                  << "," << cocTiling.workspaceStages
+                  << "," << cocTiling.ubStages
+                  << "," << cocTiling.m0
+                  << "," << cocTiling.n0
+                  << "," << cocTiling.k0
+                  << "," << cocTiling.swizzleOffset
+                  << "," << cocTiling.swizzleDirection
+                  << "," << cocTiling.firstCommInterval
+                  << "," << cocTiling.tailSplitK
+                  << "," << cocTiling.splitK
+                  << "," << cocTiling.tileFlags
+                  << "," << cocTiling.pushStore
+                  << "," << cocTiling.pushAllGather
+                  << "," << cocTiling.commStatic
                   << "," << "\n";
     }
 
@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2025 Huawei Technologies Co., Ltd.
+ * This file is a part of the CANN Open Software.
+ * Licensed under CANN Open Software License Agreement Version 1.0 (the "License").
+ * Please refer to the License for details. You may not use this file except in compliance with the License.
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE.
+ * See LICENSE in the root of the software repository for the full text of the License.
+ */
+#ifndef TILING_CHECK_H
+#define TILING_CHECK_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "info.h"
+#include "launch_map.h"
+#include "catcoc/detail/pipeline_stages.hpp"
+#include "catcoc/dgemm/workspace_size.hpp"
+
+// tiling的合法性检查和workspace大小, 由调优, plan和libcatcoc共用.
+// elementBytes为workspace中元素的字节数, 量化算子在int32的累加结果上通信, 其余算子与输入类型一致
+
+// 与kernel的GetWorkspaceSize使用同一公式, 返回该tiling一次启动在每个rank上占用的对称内存字节数
+inline size_t GetWorkspaceSize(const CocTilingParams &tiling, CocCommType commType, int rankSize,
+    uint32_t elementBytes = INPUT_DTYPE)
+{
+    Catcoc::DGemm::WorkspaceDesc desc;
+    desc.problemShape = Catlass::GemmCoord{tiling.m, tiling.n, tiling.k};
+    desc.l1TileShape = Catlass::GemmCoord{tiling.m0, tiling.n0, tiling.k0};
+    desc.rankSize = rankSize;
+    desc.coreNum = tiling.blockNum;
+    desc.commInterval = tiling.commInterval;
+    desc.firstCommInterval = tiling.firstCommInterval;
+    desc.tailSplitK = tiling.tailSplitK;
+    desc.splitK = tiling.splitK;
+    desc.tileFlags = tiling.tileFlags;
+    desc.workspaceStages = tiling.workspaceStages;
+    desc.elementBytes = elementBytes;
+    if (commType == ALLGATHER_MATMUL) {
+        // allgather matmul的problemShape是gather之后的形状
+        desc.problemShape = Catlass::GemmCoord{tiling.m * rankSize, tiling.n, tiling.k};
+        return Catcoc::DGemm::GetAllGatherMatmulWorkspaceSize(desc);
+    }
+    if (commType == MATMUL_REDUCE_SCATTER) {
+        return Catcoc::DGemm::GetMatmulReduceScatterWorkspaceSize(desc);
+    }
+    return Catcoc::DGemm::GetMatmulAllReduceWorkspaceSize(desc);
+}
+
+// 流水级数不能超过kernel编译的深度, 每级workspace占用一个核间同步flag, 每级UB buffer占用一个event id且总量不超过UB容量
+inline bool CheckPipelineStages(const CocTilingParams &tiling, uint32_t elementBytes = INPUT_DTYPE)
+{
+    if (tiling.workspaceStages > WORKSPACE_STAGES || !Catcoc::detail::IsValidWorkspaceStages(tiling.workspaceStages)) {
+        return false;
+    }
+    uint32_t tileElems = tiling.commTileM / 2 * tiling.n0;
+    uint32_t stageBytes = tileElems * elementBytes;
+    // 确定性累加额外占用fp32的累加buffer, 类型转换buffer和输出buffer
+    uint32_t fixedBytes = tiling.deterministic ? tileElems * (sizeof(float) * 2 + elementBytes) : 0;
+    if (tiling.ubStages > UB_STAGES || !Catcoc::detail::IsValidUbStages(tiling.ubStages, stageBytes, fixedBytes)) {
+        return false;
+    }
+    return true;
+}
+
+// 各调度参数只在部分算子中实现, 其余算子上必须保持为0
+inline bool CheckOpSupport(const CocTilingParams &tiling, CocCommType commType)
+{
+    // allgather matmul的chunk固定为commInterval
+    if (commType == ALLGATHER_MATMUL && tiling.firstCommInterval != 0) {
+        return false;
+    }
+    // 最后一个chunk的K切分只在matmul allreduce中实现
+    if (commType != MATMUL_ALLREDUCE && tiling.tailSplitK != 0) {
+        return false;
+    }
+    // 基本块的K切分只在matmul reduce scatter中实现
+    if (commType != MATMUL_REDUCE_SCATTER && tiling.splitK != 0) {
+        return false;
+    }
+    // 逐块就绪标志只在matmul allreduce和matmul reduce scatter中实现
+    if (commType == ALLGATHER_MATMUL && tiling.tileFlags != 0) {
+        return false;
+    }
+    // AIC直接写入目标rank的workspace只在matmul reduce scatter中实现
+    if (commType != MATMUL_REDUCE_SCATTER && tiling.pushStore != 0) {
+        return false;
+    }
+    // put模式的all-gather只在matmul allreduce中实现
+    return commType == MATMUL_ALLREDUCE || tiling.pushAllGather == 0;
+}
+
+// 完整的tiling约束, capacity为可用于workspace的对称内存字节数
+inline bool IsValidTiling(const CocTilingParams &tiling, CocCommType commType, size_t capacity,
+    uint32_t elementBytes = INPUT_DTYPE)
+{
+    // 通信切分需落在启动的核内, kernel不会在device上改写它; 非确定性模式下npu切分还需整除rankSize
+    uint32_t commCoreNum = tiling.commNpuSplit * tiling.commDataSplit;
+    if (commCoreNum == 0 || commCoreNum > tiling.blockNum || tiling.commInterval == 0) {
+        return false;
+    }
+    if (!tiling.deterministic && tiling.rankSize % tiling.commNpuSplit != 0) {
+        return false;
+    }
+    if (!IsSupportedL1Tile(tiling.m0, tiling.n0, tiling.k0) ||
+        !IsSupportedSwizzle(tiling.swizzleOffset, tiling.swizzleDirection)) {
+        return false;
+    }
+    if (!CheckOpSupport(tiling, commType) || !CheckPipelineStages(tiling, elementBytes)) {
+        return false;
+    }
+    return GetWorkspaceSize(tiling, commType, tiling.rankSize, elementBytes) <= capacity;
+}
+
+// 将调优表中的结果合并到tiling, shape, rankSize, blockNum和确定性模式保持调用方的取值
+inline void MergeTunedTiling(CocTilingParams &tiling, const CocTilingParams &tuned)
+{
+    tiling.commInterval = tuned.commInterval;
+    tiling.firstCommInterval = tuned.firstCommInterval;
+    tiling.tailSplitK = tuned.tailSplitK;
+    tiling.splitK = tuned.splitK;
+    tiling.tileFlags = tuned.tileFlags;
+    tiling.pushStore = tuned.pushStore;
+    tiling.pushAllGather = tuned.pushAllGather;
+    tiling.commTileM = tuned.commTileM;
+    tiling.commBlockM = tuned.commBlockM;
+    tiling.commNpuSplit = tuned.commNpuSplit;
+    tiling.commDataSplit = tuned.commDataSplit;
+    tiling.workspaceStages = tuned.workspaceStages;
+    tiling.ubStages = tuned.ubStages;
+    tiling.m0 = tuned.m0;
+    tiling.n0 = tuned.n0;
+    tiling.k0 = tuned.k0;
+    tiling.swizzleOffset = tuned.swizzleOffset;
+    tiling.swizzleDirection = tuned.swizzleDirection;
+}
+
+#endif // TILING_CHECK_H
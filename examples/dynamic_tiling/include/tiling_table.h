@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2025 Huawei Technologies Co., Ltd.
+ * This file is a part of the CANN Open Software.
+ * Licensed under CANN Open Software License Agreement Version 1.0 (the "License").
+ * Please refer to the License for details. You may not use this file except in compliance with the License.
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE.
+ * See LICENSE in the root of the software repository for the full text of the License.
+ */
+#ifndef TILING_TABLE_H
+#define TILING_TABLE_H
+
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "info.h"
+
+// get_best_res.py输出的best_result.csv, 每行是一个(Op, M, K, N, deterministic, blockNum)下耗时最小的tiling
+class CocTilingTable {
+public:
+    bool Load(const std::string &fileName)
+    {
+        std::ifstream file(fileName);
+        if (!file.is_open()) {
+            std::cerr << "Unable to open file: " << fileName << std::endl;
+            return false;
+        }
+        std::string line;
+        if (!getline(file, line)) {
+            std::cerr << "The file is empty or the header line fails to be read." << std::endl;
+            return false;
+        }
+        std::map<std::string, size_t> columns;
+        std::vector<std::string> cells = Split(line);
+        for (size_t i = 0; i < cells.size(); ++i) {
+            columns[cells[i]] = i;
+        }
+        for (const char *name : REQUIRED_COLUMNS) {
+            if (columns.find(name) == columns.end()) {
+                std::cerr << fileName << " required column missing: " << name << std::endl;
+                return false;
+            }
+        }
+
+        while (getline(file, line)) {
+            if (line.empty()) {
+                continue;
+            }
+            cells = Split(line);
+            if (cells.size() < columns.size()) {
+                std::cerr << "The number of data columns does not match the header: " << line << std::endl;
+                continue;
+            }
+            auto get = [&](const char *name) {
+                return static_cast<uint32_t>(std::stoul(cells[columns.at(name)]));
+            };
+            CocTilingParams tiling;
+            tiling.m = get("M");
+            tiling.k = get("K");
+            tiling.n = get("N");
+            tiling.commInterval = get("commInterval");
+            tiling.commTileM = get("commTileM");
+            tiling.commBlockM = get("commBlockM");
+            tiling.commNpuSplit = get("commNpuSplit");
+            tiling.commDataSplit = get("commDataSplit");
+            tiling.deterministic = get("deterministic");
+            tiling.blockNum = get("blockNum");
+            tiling.workspaceStages = get("workspaceStages");
+            tiling.ubStages = get("ubStages");
+            // 早期的调优结果没有基本块, swizzle, firstCommInterval, tailSplitK, splitK, tileFlags, pushStore和pushAllGather列, 使用默认值
+            auto getOr = [&](const char *name, uint32_t value) {
+                return columns.count(name) ? get(name) : value;
+            };
+            tiling.m0 = getOr("m0", M0);
+            tiling.n0 = getOr("n0", N0);
+            tiling.k0 = getOr("k0", K0);
+            tiling.swizzleOffset = getOr("swizzleOffset", SWIZZLE_OFFSET);
+            tiling.swizzleDirection = getOr("swizzleDirection", SWIZZLE_DIRECTION);
+            tiling.firstCommInterval = getOr("firstCommInterval", 0);
+            tiling.tailSplitK = getOr("tailSplitK", 0);
+            tiling.splitK = getOr("splitK", 0);
+            tiling.tileFlags = getOr("tileFlags", 0);
+            tiling.pushStore = getOr("pushStore", 0);
+            tiling.pushAllGather = getOr("pushAllGather", 0);
+            Key key{cells[columns.at("Op")], tiling.k, tiling.n, get("Transpose A"), get("Transpose B"),
+                tiling.deterministic, tiling.blockNum};
+            records[key][tiling.m] = tiling;
+        }
+        return true;
+    }
+
+    // M按已调优的shape分桶: 同一(Op, K, N, 转置, 确定性, 启动核数)下取M不小于m的最小shape, m超出范围时取M最大的shape
+    bool Lookup(const std::string &op, const CocTilingParams &shape, uint32_t transA, uint32_t transB,
+        CocTilingParams &tiling) const
+    {
+        Key key{op, shape.k, shape.n, transA, transB, shape.deterministic, shape.blockNum};
+        auto it = records.find(key);
+        if (it == records.end() || it->second.empty()) {
+            return false;
+        }
+        auto bucket = it->second.lower_bound(shape.m);
+        if (bucket == it->second.end()) {
+            bucket = std::prev(bucket);
+        }
+        tiling = bucket->second;
+        return true;
+    }
+
+    bool Empty() const
+    {
+        return records.empty();
+    }
+
+private:
+    using Key = std::tuple<std::string, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t>;
+
+    static constexpr const char *REQUIRED_COLUMNS[] = {
+        "Op", "M", "K", "N", "Transpose A", "Transpose B", "commInterval", "commTileM", "commBlockM",
+        "commNpuSplit", "commDataSplit", "deterministic", "blockNum", "workspaceStages", "ubStages"
+    };
+
+    static std::vector<std::string> Split(const std::string &line)
+    {
+        std::vector<std::string> cells;
+        std::stringstream ss(line);
+        std::string cell;
+        while (getline(ss, cell, ',')) {
+            cells.push_back(cell);
+        }
+        return cells;
+    }
+
+    std::map<Key, std::map<uint32_t, CocTilingParams>> records;
+};
+
+#endif // TILING_TABLE_H
@@ -15,6 +15,14 @@ UTILS_PATH=${PROJECT_ROOT}/examples/utils
 # eg. 性能测试WARM_UP_TIMES设置成10, PERF_TEST_CYCLE_TIMES成3
 export WARM_UP_TIMES=10
 export PERF_TEST_CYCLE_TIMES=3
+# 规约累加模式: 0 原子累加, 1 按rank顺序确定性累加, 2 两种模式都参与搜索, 并输出性能对比 deterministic_cost.csv
+export DETERMINISTIC_MODE=${DETERMINISTIC_MODE:-0}
+# 启动核数默认为设备全部AI core, 设置CORE_NUM可减少启动核数, 为同时运行的其他任务预留核
+# export CORE_NUM=16
+# 精度测试时设置TILING_FILE, 按get_best_res.py生成的best_result.csv选择tiling, 未命中的shape使用默认tiling
+# export TILING_FILE=${PROJECT_ROOT}/examples/dynamic_tiling/best_result.csv
+# 精度测试时设置COMM_SCHEDULE=1, MatmulAllReduce在创建plan时预计算通信调度表, kernel按表执行通信
+# export COMM_SCHEDULE=1
 
 CSV_FILE="${SCRIPT_DIR}/test_shapes.csv"
 
@@ -53,7 +53,7 @@ def process_csv_files(folder_path):
         return
     
     df_list = []
-    required_columns = ["Op", "M", "K", "N", "Transpose A", "Transpose B", "commInterval", "commTileM", "commBlockM", "commNpuSplit", "commDataSplit", "Time(us)"]
+    required_columns = ["Op", "M", "K", "N", "Transpose A", "Transpose B", "commInterval", "commTileM", "commBlockM", "commNpuSplit", "commDataSplit", "deterministic", "blockNum", "workspaceStages", "ubStages", "Time(us)"]
     
     # 对每个文件检查所需要的列是否齐全
     for file in result_csv_files:
@@ -76,11 +76,53 @@ def process_csv_files(folder_path):
     # 转换 Time(us) 为数值型（若有非数字数据则转为 NaN）
     all_data["Time(us)"] = pd.to_numeric(all_data["Time(us)"], errors="coerce")
     
-    # 根据 Op, M, K, N 分组，使用 idxmin() 找出每组 Time(us) 最小的那一行数据
-    idx = all_data.groupby(["Op", "M", "K", "N"])["Time(us)"].idxmin()
+    # 根据 Op, M, K, N, deterministic, blockNum 分组，使用 idxmin() 找出每组 Time(us) 最小的那一行数据
+    idx = all_data.groupby(["Op", "M", "K", "N", "deterministic", "blockNum"])["Time(us)"].idxmin()
     ans = all_data.loc[idx].reset_index(drop=True)
     
     ans.to_csv("best_result.csv", index=False)
+    report_deterministic_cost(ans)
+    report_static_comm_gain(all_data)
+
+
+def report_deterministic_cost(best_df, output_file="deterministic_cost.csv"):
+    # 同一shape下同时搜索了两种模式时, 对比各自最优tiling的耗时, 得到确定性累加的性能开销
+    pivot = best_df.pivot_table(index=["Op", "M", "K", "N", "blockNum"], columns="deterministic", values="Time(us)")
+    if 0 not in pivot.columns or 1 not in pivot.columns:
+        return
+    pivot = pivot.dropna(subset=[0, 1])
+    if pivot.empty:
+        return
+    report = pd.DataFrame({
+        "Atomic Time(us)": pivot[0],
+        "Deterministic Time(us)": pivot[1],
+        "Overhead(%)": (pivot[1] - pivot[0]) / pivot[0] * 100,
+    }).reset_index()
+    report.to_csv(output_file, index=False)
+    print(report.to_string(index=False))
+    print(f"deterministic mode mean overhead: {report['Overhead(%)'].mean():.2f}%")
+
+def report_static_comm_gain(all_data, output_file="static_comm_gain.csv"):
+    # 命中预编译通信切分的tiling分别以动态和编译期常量的kernel各测一次, 对比同一tiling的耗时
+    if "commStatic" not in all_data.columns:
+        return
+    data = all_data.assign(static=all_data["commStatic"] > 0).drop(columns=["commStatic"])
+    keys = [col for col in data.columns if col not in ("Time(us)", "static")]
+    pivot = data.pivot_table(index=keys, columns="static", values="Time(us)")
+    if True not in pivot.columns or False not in pivot.columns:
+        return
+    pivot = pivot.dropna(subset=[False, True])
+    if pivot.empty:
+        return
+    report = pd.DataFrame({
+        "Dynamic Time(us)": pivot[False],
+        "Static Time(us)": pivot[True],
+        "Gain(%)": (pivot[False] - pivot[True]) / pivot[False] * 100,
+    }).reset_index()
+    report.to_csv(output_file, index=False)
+    print(report.to_string(index=False))
+    print(f"static comm tiling mean gain: {report['Gain(%)'].mean():.2f}%")
+
 
 if __name__ == "__main__":
     cur_file = os.path.abspath(__file__)
@@ -0,0 +1,33 @@
+/*
+ * Copyright (c) 2025 Huawei Technologies Co., Ltd.
+ * This file is a part of the CANN Open Software.
+ * Licensed under CANN Open Software License Agreement Version 1.0 (the "License").
+ * Please refer to the License for details. You may not use this file except in compliance with the License.
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE.
+ * See LICENSE in the root of the software repository for the full text of the License.
+ */
+
+#include <pybind11/pybind11.h>
+#include <torch/extension.h>
+#include <torch_npu/csrc/core/npu/NPUStream.h>
+
+#include "catcoc_kernel.h"
+#include "wrapper/catcoc_kernel_wrapper.h"
+
+namespace py = pybind11;
+using namespace CatcocKernelWrapper;
+
+PYBIND11_MODULE(_C, m) {
+    m.doc() = "Python bindings for CatcocKernel";
+    m.def("init", &Init, "", py::arg("rank_id"), py::arg("rank_size"), py::arg("ip_port"),
+        py::arg("workspace_capacity") = 0, py::arg("tiling_file") = "")
+    .def("finalize", &Finalize, "")
+    .def("matmul_all_reduce", &RunMatmulAllReduce, "", py::arg("mat1"), py::arg("mat2"),
+        py::arg("deterministic") = false)
+    .def("all_gather_matmul", &RunAllGatherMatmul, "", py::arg("mat1"), py::arg("mat2"))
+    .def("matmul_reduce_scatter", &RunMatmulReduceScatter, "", py::arg("mat1"), py::arg("mat2"),
+        py::arg("deterministic") = false)
+    .def("quant_matmul_reduce_scatter", &RunQuantMatmulReduceScatter, "", py::arg("mat1"), py::arg("mat2"),
+        py::arg("scale"), py::arg("per_token_scale"), py::arg("bias"), py::arg("deterministic") = false);
+}
@@ -0,0 +1,36 @@
+/*
+ * Copyright (c) 2025 Huawei Technologies Co., Ltd.
+ * This file is a part of the CANN Open Software.
+ * Licensed under CANN Open Software License Agreement Version 1.0 (the "License").
+ * Please refer to the License for details. You may not use this file except in compliance with the License.
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE.
+ * See LICENSE in the root of the software repository for the full text of the License.
+ */
+
+#include <torch/extension.h>
+
+#include "wrapper/catcoc_kernel_wrapper.h"
+
+#define NPU PrivateUse1
+
+using namespace CatcocKernelWrapper;
+TORCH_LIBRARY(CatcocTorch, m)
+{
+    // init/finalize不涉及tensor, 不区分设备
+    m.def("init(int rank_id, int rank_size, str ip_port, int workspace_capacity=0, str tiling_file='') -> ()", &Init);
+    m.def("finalize() -> ()", &Finalize);
+    m.def("matmul_all_reduce(Tensor mat1, Tensor mat2, bool deterministic=False) -> Tensor");
+    m.def("all_gather_matmul(Tensor mat1, Tensor mat2) -> Tensor");
+    m.def("matmul_reduce_scatter(Tensor mat1, Tensor mat2, bool deterministic=False) -> Tensor");
+    m.def("quant_matmul_reduce_scatter(Tensor mat1, Tensor mat2, Tensor scale, Tensor per_token_scale, "
+          "Tensor bias, bool deterministic=False) -> Tensor");
+}
+
+TORCH_LIBRARY_IMPL(CatcocTorch, NPU, m)
+{
+    m.impl("matmul_all_reduce", &RunMatmulAllReduce);
+    m.impl("all_gather_matmul", &RunAllGatherMatmul);
+    m.impl("matmul_reduce_scatter", &RunMatmulReduceScatter);
+    m.impl("quant_matmul_reduce_scatter", &RunQuantMatmulReduceScatter);
+}
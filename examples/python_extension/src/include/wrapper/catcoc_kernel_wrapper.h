@@ -0,0 +1,34 @@
+/*
+ * Copyright (c) 2025 Huawei Technologies Co., Ltd.
+ * This file is a part of the CANN Open Software.
+ * Licensed under CANN Open Software License Agreement Version 1.0 (the "License").
+ * Please refer to the License for details. You may not use this file except in compliance with the License.
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE.
+ * See LICENSE in the root of the software repository for the full text of the License.
+ */
+
+#ifndef PY_EXT_CATCOC_KERNEL_WRAPPER_H
+#define PY_EXT_CATCOC_KERNEL_WRAPPER_H
+
+#include <pybind11/stl.h>
+#include <torch/extension.h>
+
+#include "catcoc_kernel.h"
+
+namespace CatcocKernelWrapper {
+// 初始化shmem和libcatcoc.so, 集合调用, 需在设置好当前NPU设备之后调用
+void Init(int64_t rankId, int64_t rankSize, const std::string &ipPort, int64_t workspaceCapacity,
+    const std::string &tilingFile);
+// 销毁缓存的plan并释放对称内存, 集合调用
+void Finalize();
+
+at::Tensor RunMatmulAllReduce(const at::Tensor &mat1, const at::Tensor &mat2, bool deterministic);
+at::Tensor RunAllGatherMatmul(const at::Tensor &mat1, const at::Tensor &mat2);
+at::Tensor RunMatmulReduceScatter(const at::Tensor &mat1, const at::Tensor &mat2, bool deterministic);
+at::Tensor RunQuantMatmulReduceScatter(const at::Tensor &mat1, const at::Tensor &mat2, const at::Tensor &scale,
+    const at::Tensor &perTokenScale, const at::Tensor &bias, bool deterministic);
+
+} // namespace CatcocKernelWrapper
+
+#endif // PY_EXT_CATCOC_KERNEL_WRAPPER_H
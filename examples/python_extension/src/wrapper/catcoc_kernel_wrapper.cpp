@@ -0,0 +1,333 @@
+/*
+ * Copyright (c) 2025 Huawei Technologies Co., Ltd.
+ * This file is a part of the CANN Open Software.
+ * Licensed under CANN Open Software License Agreement Version 1.0 (the "License").
+ * Please refer to the License for details. You may not use this file except in compliance with the License.
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE.
+ * See LICENSE in the root of the software repository for the full text of the License.
+ */
+
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <tuple>
+#include <unordered_map>
+
+#include <torch/torch.h>
+#include <torch_npu/csrc/core/npu/DeviceUtils.h>
+#include <torch_npu/csrc/core/npu/NPUFormat.h>
+#include <torch_npu/csrc/core/npu/NPUFunctions.h>
+#include <torch_npu/csrc/core/npu/NPUStream.h>
+
+// shmem_host
+#include "host/shmem_host_def.h"
+#include "host/shmem_host_init.h"
+#include "host/shmem_host_team.h"
+
+#include "catcoc/detail/rank_partition.hpp"
+
+#include "catcoc_kernel.h"
+#include "wrapper/catcoc_kernel_wrapper.h"
+
+namespace py = pybind11;
+
+namespace CatcocKernelWrapper {
+namespace {
+// shmem初始化时申请的对称内存上限, 与dynamic_tiling保持一致
+constexpr uint64_t SHMEM_MALLOC_MAX_SIZE = 1024UL * 1024UL * 1024;
+
+// (stream, op, dataType, m, n, k, transA, transB, deterministic)
+using PlanKey = std::tuple<aclrtStream, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t,
+    uint32_t>;
+
+struct Context {
+    std::mutex mutex;
+    bool initialized{false};
+    uint32_t rankId{0};
+    uint32_t rankSize{1};
+    // 按stream和shape缓存plan, 首次遇到某个shape时才创建, 之后每次调用只做kernel launch.
+    // 同一stream上的plan顺序执行, 共用该stream的workspace, 对称内存只随最大的shape增长而不随shape的个数增长.
+    // plan的创建顺序决定workspace的偏移, 要求各rank以相同顺序调用各算子
+    std::map<PlanKey, CatcocPlanHandle> plans;
+    std::map<aclrtStream, CatcocWorkspaceHandle> workspaces;
+};
+
+Context &GetContext()
+{
+    static Context context;
+    return context;
+}
+
+const char *StatusToStr(CatcocStatus status)
+{
+    switch (status) {
+        case CATCOC_SUCCESS:
+            return "success";
+        case CATCOC_ERROR_INVALID_PARAM:
+            return "invalid param";
+        case CATCOC_ERROR_NOT_INITIALIZED:
+            return "not initialized, call torch_catcoc.init first";
+        case CATCOC_ERROR_UNSUPPORTED:
+            return "unsupported";
+        case CATCOC_ERROR_LOAD_KERNEL:
+            return "load kernel library failed";
+        case CATCOC_ERROR_OUT_OF_MEMORY:
+            return "symmetric workspace exhausted";
+        default:
+            return "runtime error";
+    }
+}
+
+void CheckStatus(CatcocStatus status, const char *what)
+{
+    if (status != CATCOC_SUCCESS) {
+        std::stringstream ss;
+        ss << what << " failed: " << StatusToStr(status);
+        throw std::runtime_error(ss.str());
+    }
+}
+
+torch::Tensor GetOutputTensor(const std::vector<int64_t> &shape, const torch::Dtype dtype)
+{
+    at::TensorOptions options = at::TensorOptions();
+    options = options.dtype(dtype).layout(at::kStrided).requires_grad(false).device(
+        torch_npu::utils::get_npu_device_type());
+    return at_npu::native::empty_with_format(shape, options, ACL_FORMAT_ND);
+}
+
+CatcocDataType TorchDtypeToCatcocDtype(torch::Dtype torchDtype)
+{
+    static const std::unordered_map<torch::Dtype, CatcocDataType> mapper = {{torch::kFloat16, CATCOC_DTYPE_FP16},
+                                                                            {torch::kBFloat16, CATCOC_DTYPE_BF16},
+                                                                            {torch::kInt8, CATCOC_DTYPE_INT8}};
+    auto iter = mapper.find(torchDtype);
+    if (iter == mapper.end()) {
+        throw std::runtime_error("unsupported input dtype, expect float16, bfloat16 or int8");
+    }
+    return iter->second;
+}
+
+enum class TransposeStatus : uint32_t {
+    NO_TRANSPOSE = 0,
+    TRANSPOSE = 1,
+    NON_CONTINUOUS = 2
+};
+
+TransposeStatus GetTransposeStatus(const at::Tensor &mat)
+{
+    if (mat.is_contiguous()) {
+        return TransposeStatus::NO_TRANSPOSE;
+    }
+    std::vector<int64_t> strides = mat.strides().vec();
+    std::vector<int64_t> shape = mat.sizes().vec();
+    int64_t dimA = shape.at(shape.size() - 2);
+    int64_t strideA = strides.at(strides.size() - 2);
+    int64_t strideB = strides.at(strides.size() - 1);
+    if (strideB == dimA && strideA == 1) {
+        return TransposeStatus::TRANSPOSE;
+    }
+    return TransposeStatus::NON_CONTINUOUS;
+}
+
+CatcocPlanDesc GetPlanDesc(CatcocOpType op, const at::Tensor &mat1, const at::Tensor &mat2, bool deterministic)
+{
+    if (mat1.dim() != 2 || mat2.dim() != 2) {
+        throw std::runtime_error("mat1 and mat2 must be 2-D");
+    }
+    if (mat1.scalar_type() != mat2.scalar_type()) {
+        throw std::runtime_error("mat1 and mat2 must have the same dtype");
+    }
+    int64_t m = mat1.sizes().at(0);
+    int64_t k1 = mat1.sizes().at(1);
+    int64_t k2 = mat2.sizes().at(0);
+    int64_t n = mat2.sizes().at(1);
+    if (k1 != k2) {
+        std::stringstream ss;
+        ss << "mat1 and mat2 shapes cannot be multiplied";
+        ss << "(" << m << "x" << k1 << " and " << k2 << "x" << n << ")";
+        throw std::runtime_error(ss.str());
+    }
+    TransposeStatus transposeStatus1 = GetTransposeStatus(mat1);
+    TransposeStatus transposeStatus2 = GetTransposeStatus(mat2);
+    if (transposeStatus1 == TransposeStatus::NON_CONTINUOUS) {
+        throw std::runtime_error("mat1 is not contiguous");
+    }
+    if (transposeStatus2 == TransposeStatus::NON_CONTINUOUS) {
+        throw std::runtime_error("mat2 is not contiguous");
+    }
+
+    CatcocPlanDesc desc;
+    desc.op = op;
+    desc.dataType = TorchDtypeToCatcocDtype(mat1.scalar_type());
+    desc.m = static_cast<uint32_t>(m);
+    desc.n = static_cast<uint32_t>(n);
+    desc.k = static_cast<uint32_t>(k1);
+    desc.transA = static_cast<uint32_t>(transposeStatus1);
+    desc.transB = static_cast<uint32_t>(transposeStatus2);
+    desc.deterministic = deterministic ? 1 : 0;
+    return desc;
+}
+
+CatcocPlanHandle GetPlan(Context &context, const CatcocPlanDesc &desc, aclrtStream stream)
+{
+    PlanKey key{stream, desc.op, desc.dataType, desc.m, desc.n, desc.k, desc.transA, desc.transB,
+        desc.deterministic};
+    auto iter = context.plans.find(key);
+    if (iter != context.plans.end()) {
+        return iter->second;
+    }
+    auto workspace = context.workspaces.find(stream);
+    if (workspace == context.workspaces.end()) {
+        CatcocWorkspaceHandle handle;
+        CheckStatus(CatcocWorkspaceCreate(&handle), "CatcocWorkspaceCreate");
+        workspace = context.workspaces.emplace(stream, handle).first;
+    }
+    // 新plan可能扩大并移动该stream的workspace, 先等之前的launch完成
+    if (aclrtSynchronizeStream(stream) != ACL_SUCCESS) {
+        CheckStatus(CATCOC_ERROR_RUNTIME, "aclrtSynchronizeStream");
+    }
+    CatcocPlanHandle plan;
+    CheckStatus(CatcocPlanCreateWithWorkspace(&desc, workspace->second, &plan), "CatcocPlanCreateWithWorkspace");
+    context.plans.emplace(key, plan);
+    return plan;
+}
+
+void *GetDataPtr(const at::Tensor &tensor)
+{
+    return const_cast<void *>(tensor.data_ptr());
+}
+
+at::Tensor RunPlan(CatcocOpType op, const at::Tensor &mat1, const at::Tensor &mat2, bool deterministic)
+{
+    Context &context = GetContext();
+    CatcocPlanDesc desc = GetPlanDesc(op, mat1, mat2, deterministic);
+    if (desc.dataType == CATCOC_DTYPE_INT8) {
+        throw std::runtime_error("int8 input is only supported by quant_matmul_reduce_scatter");
+    }
+
+    CatcocPlanHandle plan;
+    int64_t outM = desc.m;
+    aclrtStream stream = c10_npu::getCurrentNPUStream().stream(false);
+    {
+        std::lock_guard<std::mutex> lock(context.mutex);
+        if (!context.initialized) {
+            CheckStatus(CATCOC_ERROR_NOT_INITIALIZED, "GetPlan");
+        }
+        plan = GetPlan(context, desc, stream);
+        if (op == CATCOC_OP_ALLGATHER_MATMUL) {
+            outM = static_cast<int64_t>(desc.m) * context.rankSize;
+        } else if (op == CATCOC_OP_MATMUL_REDUCE_SCATTER) {
+            Catcoc::detail::RankPartition rankPartition(desc.m, context.rankSize);
+            outM = rankPartition.GetExtent(context.rankId);
+        }
+    }
+
+    torch::Tensor result = GetOutputTensor({outM, static_cast<int64_t>(desc.n)}, mat1.scalar_type());
+    CheckStatus(CatcocPlanRun(plan, stream, GetDataPtr(mat1), GetDataPtr(mat2), GetDataPtr(result)),
+        "CatcocPlanRun");
+    return result;
+}
+} // namespace
+
+void Init(int64_t rankId, int64_t rankSize, const std::string &ipPort, int64_t workspaceCapacity,
+    const std::string &tilingFile)
+{
+    Context &context = GetContext();
+    std::lock_guard<std::mutex> lock(context.mutex);
+    if (context.initialized) {
+        return;
+    }
+    shmem_init_attr_t *attributes;
+    if (shmem_set_attr(static_cast<int>(rankId), static_cast<int>(rankSize), SHMEM_MALLOC_MAX_SIZE, ipPort.c_str(),
+        &attributes) != SHMEM_SUCCESS || shmem_init_attr(attributes) != SHMEM_SUCCESS) {
+        throw std::runtime_error("shmem init failed");
+    }
+    int32_t deviceId = static_cast<int32_t>(c10_npu::current_device());
+    CheckStatus(CatcocInit(deviceId, static_cast<size_t>(workspaceCapacity),
+        tilingFile.empty() ? nullptr : tilingFile.c_str()), "CatcocInit");
+    context.rankId = static_cast<uint32_t>(rankId);
+    context.rankSize = static_cast<uint32_t>(rankSize);
+    context.initialized = true;
+}
+
+void Finalize()
+{
+    Context &context = GetContext();
+    std::lock_guard<std::mutex> lock(context.mutex);
+    if (!context.initialized) {
+        return;
+    }
+    // workspace可能仍被未完成的kernel使用
+    for (auto &workspace : context.workspaces) {
+        aclrtSynchronizeStream(workspace.first);
+    }
+    for (auto &plan : context.plans) {
+        CatcocPlanDestroy(plan.second);
+    }
+    context.plans.clear();
+    for (auto &workspace : context.workspaces) {
+        CatcocWorkspaceDestroy(workspace.second);
+    }
+    context.workspaces.clear();
+    CheckStatus(CatcocFinalize(), "CatcocFinalize");
+    shmem_finalize();
+    context.initialized = false;
+}
+
+at::Tensor RunMatmulAllReduce(const at::Tensor &mat1, const at::Tensor &mat2, bool deterministic)
+{
+    return RunPlan(CATCOC_OP_MATMUL_ALLREDUCE, mat1, mat2, deterministic);
+}
+
+at::Tensor RunAllGatherMatmul(const at::Tensor &mat1, const at::Tensor &mat2)
+{
+    return RunPlan(CATCOC_OP_ALLGATHER_MATMUL, mat1, mat2, false);
+}
+
+at::Tensor RunMatmulReduceScatter(const at::Tensor &mat1, const at::Tensor &mat2, bool deterministic)
+{
+    return RunPlan(CATCOC_OP_MATMUL_REDUCE_SCATTER, mat1, mat2, deterministic);
+}
+
+at::Tensor RunQuantMatmulReduceScatter(const at::Tensor &mat1, const at::Tensor &mat2, const at::Tensor &scale,
+    const at::Tensor &perTokenScale, const at::Tensor &bias, bool deterministic)
+{
+    Context &context = GetContext();
+    CatcocPlanDesc desc = GetPlanDesc(CATCOC_OP_QUANT_MATMUL_REDUCE_SCATTER, mat1, mat2, deterministic);
+    if (desc.dataType != CATCOC_DTYPE_INT8) {
+        throw std::runtime_error("quant_matmul_reduce_scatter expects int8 mat1 and mat2");
+    }
+    if (scale.scalar_type() != torch::kFloat32 || scale.numel() != desc.n) {
+        throw std::runtime_error("scale must be a float32 tensor of n elements");
+    }
+    if (perTokenScale.scalar_type() != torch::kFloat32 || perTokenScale.numel() != desc.m) {
+        throw std::runtime_error("per_token_scale must be a float32 tensor of m elements");
+    }
+    if (bias.scalar_type() != torch::kInt32 || bias.numel() != desc.n) {
+        throw std::runtime_error("bias must be an int32 tensor of n elements");
+    }
+
+    CatcocPlanHandle plan;
+    int64_t outM;
+    aclrtStream stream = c10_npu::getCurrentNPUStream().stream(false);
+    {
+        std::lock_guard<std::mutex> lock(context.mutex);
+        if (!context.initialized) {
+            CheckStatus(CATCOC_ERROR_NOT_INITIALIZED, "GetPlan");
+        }
+        plan = GetPlan(context, desc, stream);
+        Catcoc::detail::RankPartition rankPartition(desc.m, context.rankSize);
+        outM = rankPartition.GetExtent(context.rankId);
+    }
+
+    int64_t accumSize = static_cast<int64_t>(CatcocPlanGetAccumSize(plan));
+    torch::Tensor accum = GetOutputTensor({accumSize / static_cast<int64_t>(sizeof(int32_t))}, torch::kInt32);
+    torch::Tensor result = GetOutputTensor({outM, static_cast<int64_t>(desc.n)}, torch::kFloat16);
+    CatcocQuantArgs quantArgs{GetDataPtr(scale), GetDataPtr(perTokenScale), GetDataPtr(bias), GetDataPtr(accum)};
+    CheckStatus(CatcocPlanRunQuant(plan, stream, GetDataPtr(mat1), GetDataPtr(mat2), GetDataPtr(result), &quantArgs),
+        "CatcocPlanRunQuant");
+    return result;
+}
+} // namespace CatcocKernelWrapper
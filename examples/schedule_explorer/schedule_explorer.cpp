@@ -0,0 +1,555 @@
+/*
+ * Copyright (c) 2025 Huawei Technologies Co., Ltd.
+ * This file is a part of the CANN Open Software.
+ * Licensed under CANN Open Software License Agreement Version 1.0 (the "License").
+ * Please refer to the License for details. You may not use this file except in compliance with the License.
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE.
+ * See LICENSE in the root of the software repository for the full text of the License.
+ */
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <vector>
+
+// from catlass
+#include "catlass/catlass.hpp"
+
+#include "catcoc/comm_epilogue/block/comm_block_swizzle.hpp"
+#include "catcoc/dgemm/block/block_swizzle_dynamic.hpp"
+#include "catcoc/detail/chunk_partition.hpp"
+#include "catcoc/detail/k_slices.hpp"
+#include "catcoc/detail/rank_partition.hpp"
+#include "catcoc/detail/remote_copy_type.hpp"
+#include "catcoc/detail/tail_split.hpp"
+
+#include "info.h"
+
+using Catlass::GemmCoord;
+using Catlass::MatrixCoord;
+using Catcoc::detail::CopyDirect;
+using Catcoc::detail::CopyMode;
+
+// 与examples/dynamic_tiling/impl/kernel中的调度器保持一致
+// 默认swizzle时与静态通信切分kernel的GemmIdentityBlockSwizzle<7, 1>顺序一致
+using BlockScheduler = Catcoc::DGemm::Block::GemmDynamicBlockSwizzle;
+template <bool IS_DETERMINISTIC>
+using CommScheduler = Catcoc::CommEpilogue::Block::BlockCommSwizzle<0, IS_DETERMINISTIC>;
+
+struct Options {
+    std::string opName;
+    uint32_t rankId{0};
+    CocTilingParams tiling;
+
+    int Parse(int argc, char **argv)
+    {
+        enum ArgsIndex {
+            OP_NAME_INDEX = 1,
+            RANK_SIZE_INDEX,
+            M_INDEX,
+            N_INDEX,
+            K_INDEX,
+            TILING_INDEX
+        };
+
+        if (argc < TILING_INDEX) {
+            return -1;
+        }
+        // 算子名与best_result.csv的Op列一致
+        opName = argv[OP_NAME_INDEX];
+        if (opName != "MatmulAllReduce" && opName != "MatmulReduceScatter") {
+            return -1;
+        }
+
+        // 默认tiling与dynamic_tiling未命中调优表时一致
+        tiling.rankSize = std::atoi(argv[RANK_SIZE_INDEX]);
+        tiling.m = std::atoi(argv[M_INDEX]);
+        tiling.n = std::atoi(argv[N_INDEX]);
+        tiling.k = std::atoi(argv[K_INDEX]);
+        tiling.m0 = M0;
+        tiling.k0 = K0;
+        tiling.n0 = N0;
+        tiling.commTileM = 64;
+        tiling.commInterval = 20;
+        tiling.commNpuSplit = 1;
+        tiling.commDataSplit = 2;
+        tiling.commBlockM = 64;
+        tiling.blockNum = 20;
+
+        // 其余参数以name=value给出, 名字与best_result.csv的列名一致
+        std::map<std::string, uint32_t *> fields = {
+            {"m0", &tiling.m0}, {"n0", &tiling.n0}, {"k0", &tiling.k0}, {"commInterval", &tiling.commInterval},
+            {"firstCommInterval", &tiling.firstCommInterval}, {"tailSplitK", &tiling.tailSplitK},
+            {"splitK", &tiling.splitK}, {"commBlockM", &tiling.commBlockM},
+            {"commNpuSplit", &tiling.commNpuSplit}, {"commDataSplit", &tiling.commDataSplit},
+            {"deterministic", &tiling.deterministic}, {"blockNum", &tiling.blockNum}, {"rankId", &rankId},
+            {"swizzleOffset", &tiling.swizzleOffset}, {"swizzleDirection", &tiling.swizzleDirection}
+        };
+        for (int i = TILING_INDEX; i < argc; ++i) {
+            std::string arg = argv[i];
+            size_t pos = arg.find('=');
+            auto it = (pos == std::string::npos) ? fields.end() : fields.find(arg.substr(0, pos));
+            if (it == fields.end()) {
+                std::fprintf(stderr, "Unknown argument: %s\n", argv[i]);
+                return -1;
+            }
+            *it->second = std::atoi(arg.c_str() + pos + 1);
+        }
+
+        if (tiling.rankSize == 0 || rankId >= tiling.rankSize || tiling.m == 0 || tiling.n == 0 ||
+            tiling.m0 == 0 || tiling.n0 == 0 || tiling.k0 == 0 || tiling.commInterval == 0 || tiling.commBlockM == 0 ||
+            tiling.commNpuSplit == 0 || tiling.commDataSplit == 0 || tiling.blockNum == 0 ||
+            tiling.commNpuSplit * tiling.commDataSplit > tiling.blockNum ||
+            !IsSupportedSwizzle(tiling.swizzleOffset, tiling.swizzleDirection)) {
+            return -1;
+        }
+        return 0;
+    }
+};
+
+// 一个阶段内各核的任务数和工作量, 核按轮次并行执行任务, 第t轮是每个核实际搬运的第t个任务
+struct CoreLoad {
+    std::vector<uint32_t> tasks;
+    std::vector<uint64_t> work;
+
+    explicit CoreLoad(uint32_t coreNum) : tasks(coreNum, 0), work(coreNum, 0) {}
+
+    void Add(uint32_t coreIdx, uint64_t taskWork)
+    {
+        tasks[coreIdx] += 1;
+        work[coreIdx] += taskWork;
+    }
+
+    uint32_t GetRounds() const
+    {
+        return *std::max_element(tasks.begin(), tasks.end());
+    }
+
+    // 最重的核相对平均值的倍数, 1.0表示完全均衡
+    double GetImbalance() const
+    {
+        uint64_t total = 0;
+        for (uint64_t w : work) {
+            total += w;
+        }
+        uint64_t maxWork = *std::max_element(work.begin(), work.end());
+        return (total == 0) ? 1.0 : static_cast<double>(maxWork) * work.size() / total;
+    }
+
+    // 所有轮次中有任务的核的比例
+    double GetUtilization() const
+    {
+        uint64_t total = 0;
+        for (uint32_t t : tasks) {
+            total += t;
+        }
+        uint32_t rounds = GetRounds();
+        return (rounds == 0) ? 1.0 : static_cast<double>(total) / (static_cast<uint64_t>(rounds) * tasks.size());
+    }
+
+    // 最后一轮有任务的核的比例
+    double GetTailUtilization() const
+    {
+        uint32_t rounds = GetRounds();
+        uint32_t active = 0;
+        for (uint32_t t : tasks) {
+            active += (t == rounds) ? 1 : 0;
+        }
+        return (rounds == 0) ? 1.0 : static_cast<double>(active) / tasks.size();
+    }
+};
+
+// 通信阶段的一个任务, 即kernel中一次commLoopIdx循环
+struct CommTaskInfo {
+    uint32_t coreIdx;
+    MatrixCoord blockCoord; // {dataIdx, rank}
+    MatrixCoord blockShape;
+    bool skipped; // kernel中continue掉的任务, 不产生搬运
+};
+
+bool printTasks = false;
+
+void PrintLoad(const char *phase, const CoreLoad &load, uint32_t taskNum, uint32_t idleCores)
+{
+    std::printf("  %-15s tasks %5u  rounds %3u  imbalance %.3f  utilization %.3f  tail %.3f  idle cores %u\n",
+        phase, taskNum, load.GetRounds(), load.GetImbalance(), load.GetUtilization(), load.GetTailUtilization(),
+        idleCores);
+}
+
+// 统计通信阶段各核的负载和每轮从各peer搬运的字节数, fullGrid为false时只有本rank一列参与映射
+bool ReportCommPhase(const char *phase, const std::vector<CommTaskInfo> &tasks, const CocTilingParams &tiling,
+    uint32_t rankId, uint32_t commAicoreNum, uint32_t dataLoopsInRank, bool fullGrid, bool readAllRanks)
+{
+    uint32_t rankSize = tiling.rankSize;
+    CoreLoad load(commAicoreNum);
+    std::vector<std::vector<uint64_t>> peerBytes;
+    std::vector<uint32_t> roundTasks;
+    std::vector<uint32_t> hits(static_cast<size_t>(dataLoopsInRank) * rankSize, 0);
+    bool bijective = true;
+    uint32_t taskNum = 0;
+    uint32_t emptyNum = 0;
+    for (const CommTaskInfo &task : tasks) {
+        uint32_t dataIdx = task.blockCoord.row();
+        uint32_t rankIdx = task.blockCoord.column();
+        if (dataIdx >= dataLoopsInRank || rankIdx >= rankSize) {
+            bijective = false;
+        } else {
+            hits[static_cast<size_t>(dataIdx) * rankSize + rankIdx] += 1;
+        }
+        if (task.skipped) {
+            continue;
+        }
+        uint64_t bytes = static_cast<uint64_t>(task.blockShape.row()) * task.blockShape.column() * INPUT_DTYPE;
+        emptyNum += (bytes == 0) ? 1 : 0;
+        // 确定性规约的一个任务按固定顺序读取所有rank的同一数据块
+        load.Add(task.coreIdx, readAllRanks ? bytes * rankSize : bytes);
+        taskNum += 1;
+        // 跳过的任务几乎不占时间, 轮次按各核实际搬运的任务计数
+        uint32_t round = load.tasks[task.coreIdx] - 1;
+        if (peerBytes.size() <= round) {
+            peerBytes.resize(round + 1, std::vector<uint64_t>(rankSize, 0));
+            roundTasks.resize(round + 1, 0);
+        }
+        roundTasks[round] += 1;
+        for (uint32_t peerIdx = 0; peerIdx < rankSize; ++peerIdx) {
+            if (readAllRanks || peerIdx == rankIdx) {
+                peerBytes[round][peerIdx] += bytes;
+            }
+        }
+    }
+    for (uint32_t dataIdx = 0; dataIdx < dataLoopsInRank; ++dataIdx) {
+        for (uint32_t rankIdx = 0; rankIdx < rankSize; ++rankIdx) {
+            uint32_t expected = (fullGrid || rankIdx == rankId) ? 1 : 0;
+            bijective = bijective && (hits[static_cast<size_t>(dataIdx) * rankSize + rankIdx] == expected);
+        }
+    }
+
+    PrintLoad(phase, load, taskNum, tiling.blockNum - commAicoreNum);
+    // 同一轮的搬运集中在少数peer时链路争用最严重. 以最重peer相对理想分布的倍数衡量,
+    // 理想情况下一轮的各任务落在不同的远端peer上
+    double worstSkew = 1.0;
+    std::vector<uint64_t> totalBytes(rankSize, 0);
+    for (size_t round = 0; round < peerBytes.size(); ++round) {
+        uint64_t remoteTotal = 0;
+        uint64_t remoteMax = 0;
+        for (uint32_t peerIdx = 0; peerIdx < rankSize; ++peerIdx) {
+            totalBytes[peerIdx] += peerBytes[round][peerIdx];
+            if (peerIdx != rankId) {
+                remoteTotal += peerBytes[round][peerIdx];
+                remoteMax = std::max(remoteMax, peerBytes[round][peerIdx]);
+            }
+        }
+        uint32_t idealPeers = readAllRanks ? rankSize - 1 : std::min(roundTasks[round], rankSize - 1);
+        if (remoteTotal != 0) {
+            worstSkew = std::max(worstSkew, static_cast<double>(remoteMax) * idealPeers / remoteTotal);
+        }
+    }
+    std::printf("  %-15s empty tasks %u  worst peer skew %.3f  mapping over (dataIdx, rank) %s\n", "",
+        emptyNum, worstSkew, bijective ? "bijective" : "NOT BIJECTIVE");
+    std::printf("  %-15s bytes per peer:", "");
+    for (uint32_t peerIdx = 0; peerIdx < rankSize; ++peerIdx) {
+        std::printf(" %s%llu", (peerIdx == rankId) ? "*" : "", static_cast<unsigned long long>(totalBytes[peerIdx]));
+    }
+    std::printf("\n");
+
+    if (printTasks) {
+        for (size_t round = 0; round < peerBytes.size(); ++round) {
+            std::printf("    round %3zu bytes per peer:", round);
+            for (uint32_t peerIdx = 0; peerIdx < rankSize; ++peerIdx) {
+                std::printf(" %llu", static_cast<unsigned long long>(peerBytes[round][peerIdx]));
+            }
+            std::printf("\n");
+        }
+        for (uint32_t coreIdx = 0; coreIdx < commAicoreNum; ++coreIdx) {
+            std::printf("    core %3u:", coreIdx);
+            for (const CommTaskInfo &task : tasks) {
+                if (task.coreIdx == coreIdx) {
+                    std::printf(" (%u,%u)%s", task.blockCoord.row(), task.blockCoord.column(),
+                        task.skipped ? "-" : "");
+                }
+            }
+            std::printf("\n");
+        }
+    }
+    return bijective;
+}
+
+// 与通信epilogue一致: 通信块按输出所在的matmul基本块的实际大小裁剪, 矩阵边缘的基本块不足m0 x n0,
+// 超出其行数的通信块不产生搬运
+MatrixCoord ClipToGemmBlock(const BlockScheduler &reMapper, MatrixCoord blockShapeMN, MatrixCoord commBlockShape,
+    MatrixCoord outputOffset)
+{
+    GemmCoord blockCoord = reMapper.GetBlockCoord(outputOffset.row() / blockShapeMN.row());
+    MatrixCoord actualGemmBlockShape = reMapper.GetActualBlockShape(blockCoord).GetCoordMN();
+    MatrixCoord blockInnerOffset = outputOffset % blockShapeMN;
+    if (blockInnerOffset.row() >= actualGemmBlockShape.row()) {
+        return MatrixCoord{};
+    }
+    return MatrixCoord::Min(actualGemmBlockShape - blockInnerOffset, commBlockShape);
+}
+
+void PrintMatmulTasks(const std::vector<std::vector<GemmCoord>> &coreTiles)
+{
+    for (size_t coreIdx = 0; coreIdx < coreTiles.size(); ++coreIdx) {
+        std::printf("    core %3zu:", coreIdx);
+        for (const GemmCoord &tile : coreTiles[coreIdx]) {
+            std::printf(" (%u,%u)", tile.m(), tile.n());
+        }
+        std::printf("\n");
+    }
+}
+
+// 与MatmulAllReduce kernel的AIC/AIV循环一一对应
+template <bool IS_DETERMINISTIC>
+bool ExploreMatmulAllReduce(const CocTilingParams &tiling, uint32_t rankId)
+{
+    uint32_t coreNum = tiling.blockNum;
+    MatrixCoord blockShapeMN{tiling.m0, tiling.n0};
+    BlockScheduler matmulBlockScheduler(GemmCoord{tiling.m, tiling.n, tiling.k}, blockShapeMN,
+        Catcoc::DGemm::Block::GemmSwizzle{tiling.swizzleOffset, tiling.swizzleDirection});
+    uint32_t coreLoops = matmulBlockScheduler.GetCoreLoops();
+    Catcoc::detail::ChunkRamp chunkRamp(coreNum * tiling.commInterval, coreNum * tiling.firstCommInterval);
+    uint32_t commLoops = chunkRamp.GetChunkCount(coreLoops);
+    Catcoc::detail::TailSplit tailSplit(chunkRamp.GetActualSize(commLoops - 1, coreLoops), coreNum,
+        CeilDiv(tiling.k, tiling.k0), tiling.tailSplitK);
+    std::vector<uint32_t> tileHits(coreLoops, 0);
+
+    MatrixCoord commBlockShape{tiling.commBlockM, tiling.n0};
+    CommScheduler<IS_DETERMINISTIC> commScheduler(rankId, tiling.rankSize,
+        MatrixCoord{tiling.commDataSplit, tiling.commNpuSplit}, coreNum);
+    bool bijective = true;
+
+    for (uint32_t commIdx = 0; commIdx < commLoops; ++commIdx) {
+        uint32_t commBlockOffset = chunkRamp.GetBegin(commIdx);
+        uint32_t actualBlockInComm = chunkRamp.GetActualSize(commIdx, coreLoops);
+        // 最后一个chunk沿K切分时, 任务为基本块的一个K分片, 只统计分片0的覆盖次数
+        bool splitTail = (commIdx == commLoops - 1) && tailSplit.IsSplit();
+        uint32_t taskCount = splitTail ? tailSplit.GetTaskCount() : actualBlockInComm;
+        if (splitTail) {
+            std::printf("chunk %u: %u matmul blocks, split into %u K slices\n", commIdx, actualBlockInComm,
+                tailSplit.splitK);
+        } else {
+            std::printf("chunk %u: %u matmul blocks\n", commIdx, actualBlockInComm);
+        }
+
+        CoreLoad matmulLoad(coreNum);
+        std::vector<std::vector<GemmCoord>> coreTiles(coreNum);
+        for (uint32_t taskIdx = 0; taskIdx < taskCount; ++taskIdx) {
+            uint32_t blockIdxInComm = splitTail ? tailSplit.GetTileIdx(taskIdx) : taskIdx;
+            GemmCoord blockCoord = matmulBlockScheduler.GetBlockCoord(commBlockOffset + blockIdxInComm);
+            GemmCoord actualBlockShape = matmulBlockScheduler.GetActualBlockShape(blockCoord);
+            uint32_t kOffset = 0;
+            uint32_t kSize = tiling.k;
+            if (splitTail) {
+                tailSplit.GetSliceK(tailSplit.GetSliceIdx(taskIdx), tiling.k0, tiling.k, kOffset, kSize);
+            }
+            uint32_t coreIdx = taskIdx % coreNum;
+            matmulLoad.Add(coreIdx, static_cast<uint64_t>(actualBlockShape.m()) * actualBlockShape.n() * kSize);
+            coreTiles[coreIdx].push_back(blockCoord);
+            if (kOffset == 0) {
+                tileHits[blockCoord.m() * matmulBlockScheduler.loopsMN.column() + blockCoord.n()] += 1;
+            }
+        }
+        PrintLoad("matmul", matmulLoad, taskCount, 0);
+        if (printTasks) {
+            PrintMatmulTasks(coreTiles);
+        }
+
+        MatrixCoord commShape = MatrixCoord{actualBlockInComm, 1} * blockShapeMN;
+        MatrixCoord commOffset = MatrixCoord{commBlockOffset, 0} * blockShapeMN;
+        MatrixCoord dataLoopsMx = CeilDiv(commShape, commBlockShape);
+        uint32_t dLoopsInRank = CeilDiv(dataLoopsMx.row() * dataLoopsMx.column(), tiling.rankSize);
+        commScheduler.Update(commShape, commBlockShape, dLoopsInRank);
+        auto layoutComm = Catcoc::layout::AffineRankN<3>::Packed(
+            Catlass::MakeCoord<int>(1, dLoopsInRank, commBlockShape.row()));
+        uint32_t commAicoreNum = commScheduler.GetRealCore();
+        uint32_t commCoreLoops = commScheduler.GetCoreLoop();
+
+        std::vector<CommTaskInfo> reduceScatterTasks;
+        for (uint32_t commLoopIdx = 0; commLoopIdx < commCoreLoops; ++commLoopIdx) {
+            MatrixCoord blockCoord = commScheduler.GetBlockIdx(commLoopIdx);
+            MatrixCoord blockOffset = commScheduler.template GetBlockOffset<CopyMode::Scatter, CopyDirect::Get>(
+                blockCoord, layoutComm);
+            MatrixCoord blockShape = ClipToGemmBlock(matmulBlockScheduler, blockShapeMN,
+                commScheduler.template GetActualBlockShape<CopyMode::Scatter, CopyDirect::Get>(blockCoord, layoutComm),
+                commOffset + blockOffset);
+            bool skipped = !IS_DETERMINISTIC && blockCoord.column() == rankId;
+            reduceScatterTasks.push_back(CommTaskInfo{commLoopIdx % commAicoreNum, blockCoord, blockShape, skipped});
+        }
+        bijective &= ReportCommPhase("reduce-scatter", reduceScatterTasks, tiling, rankId, commAicoreNum,
+            dLoopsInRank, !IS_DETERMINISTIC, IS_DETERMINISTIC);
+
+        // 确定性模式下调度器只遍历本rank的数据块, all-gather自行展开到各rank
+        uint32_t allGatherCoreLoops = IS_DETERMINISTIC ? commCoreLoops * tiling.rankSize : commCoreLoops;
+        std::vector<CommTaskInfo> allGatherTasks;
+        for (uint32_t commLoopIdx = 0; commLoopIdx < allGatherCoreLoops; ++commLoopIdx) {
+            MatrixCoord blockCoord;
+            if constexpr (IS_DETERMINISTIC) {
+                uint32_t dataIdx = commScheduler.RankDiv(commLoopIdx);
+                blockCoord = MatrixCoord{dataIdx, commScheduler.RankMod(commLoopIdx + dataIdx)};
+            } else {
+                blockCoord = commScheduler.GetBlockIdx(commLoopIdx);
+            }
+            MatrixCoord blockOffset = commScheduler.template GetBlockOffset<CopyMode::Gather, CopyDirect::Get>(
+                blockCoord, layoutComm);
+            MatrixCoord blockShape = ClipToGemmBlock(matmulBlockScheduler, blockShapeMN,
+                commScheduler.template GetActualBlockShape<CopyMode::Gather, CopyDirect::Get>(blockCoord, layoutComm),
+                commOffset + blockOffset);
+            allGatherTasks.push_back(CommTaskInfo{commLoopIdx % commAicoreNum, blockCoord, blockShape, false});
+        }
+        bijective &= ReportCommPhase("all-gather", allGatherTasks, tiling, rankId, commAicoreNum, dLoopsInRank,
+            true, false);
+    }
+
+    bool tilesOnce = std::all_of(tileHits.begin(), tileHits.end(), [](uint32_t hit) { return hit == 1; });
+    std::printf("matmul tiles: %u over %u chunks, each computed once: %s\n", coreLoops, commLoops,
+        tilesOnce ? "yes" : "NO");
+    return bijective && tilesOnce;
+}
+
+// 与MatmulReduceScatter kernel的AIC/AIV循环一一对应, 各rank的块按ChunkPartition轮流分配到chunk
+template <bool IS_DETERMINISTIC>
+bool ExploreMatmulReduceScatter(const CocTilingParams &tiling, uint32_t rankId)
+{
+    uint32_t coreNum = tiling.blockNum;
+    uint32_t rankSize = tiling.rankSize;
+    MatrixCoord blockShapeMN{tiling.m0, tiling.n0};
+    Catcoc::detail::RankPartition rankPartition(tiling.m, rankSize);
+    GemmCoord problemShapeInRank{rankPartition.GetMaxExtent(), tiling.n, tiling.k};
+    BlockScheduler matmulBlockScheduler(problemShapeInRank, blockShapeMN,
+        Catcoc::DGemm::Block::GemmSwizzle{tiling.swizzleOffset, tiling.swizzleDirection});
+    uint32_t loopsInRank = matmulBlockScheduler.GetCoreLoops();
+    // 通信epilogue的remapper与kernel一致, 在最大分片的网格上按本rank的行数裁剪
+    BlockScheduler reMapper(GemmCoord{rankPartition.GetExtent(rankId), tiling.n, tiling.k}, blockShapeMN,
+        matmulBlockScheduler.loopsMN, Catcoc::DGemm::Block::GemmSwizzle{tiling.swizzleOffset, tiling.swizzleDirection});
+    Catcoc::detail::KSlices kSlices(CeilDiv(tiling.k, tiling.k0), tiling.splitK);
+    Catcoc::detail::ChunkPartition chunkPartition = Catcoc::detail::MakeSplitKChunkPartition(rankSize, coreNum,
+        tiling.commInterval, tiling.firstCommInterval, loopsInRank, kSlices.splitK);
+    uint32_t commLoops = chunkPartition.GetChunkCount();
+    std::vector<uint32_t> tileHits(static_cast<size_t>(loopsInRank) * rankSize, 0);
+
+    MatrixCoord commBlockShape{tiling.commBlockM, tiling.n0};
+    CommScheduler<IS_DETERMINISTIC> commScheduler(rankId, rankSize,
+        MatrixCoord{tiling.commDataSplit, tiling.commNpuSplit}, coreNum);
+    bool bijective = true;
+
+    for (uint32_t commIdx = 0; commIdx < commLoops; ++commIdx) {
+        uint32_t actualBlockPerComm = chunkPartition.GetTotalCount(commIdx);
+        uint32_t segmentInRank = chunkPartition.GetMaxCount(commIdx);
+        std::printf("chunk %u: %u matmul blocks, segment %u blocks per rank, %u K slices\n", commIdx,
+            actualBlockPerComm, segmentInRank, kSlices.splitK);
+
+        // 任务顺序与通信任务的读取顺序一致: 原子累加模式逐个分片累加, 分片在外层; 确定性模式一次读取一个块的所有分片,
+        // 分片在内层. 各段从首块开始读取, 目标rank逐块轮换. 只统计分片0的覆盖次数
+        uint32_t taskCount = actualBlockPerComm * kSlices.splitK;
+        CoreLoad matmulLoad(coreNum);
+        std::vector<std::vector<GemmCoord>> coreTiles(coreNum);
+        for (uint32_t taskIdx = 0; taskIdx < taskCount; ++taskIdx) {
+            uint32_t sliceIdx = IS_DETERMINISTIC ? taskIdx % kSlices.splitK : taskIdx / actualBlockPerComm;
+            uint32_t blockIdxInComm = IS_DETERMINISTIC ? taskIdx / kSlices.splitK : taskIdx % actualBlockPerComm;
+            uint32_t targetRankIdx;
+            uint32_t blockIdxInRank;
+            chunkPartition.LocateInterleaved(blockIdxInComm, commIdx, targetRankIdx, blockIdxInRank);
+            uint32_t loopIdxInRank = chunkPartition.GetOffset(targetRankIdx, commIdx) + blockIdxInRank;
+            GemmCoord blockCoord = matmulBlockScheduler.GetBlockCoord(loopIdxInRank);
+            GemmCoord actualBlockShape = matmulBlockScheduler.GetActualBlockShape(blockCoord);
+            uint32_t offsetM = blockCoord.m() * tiling.m0;
+            uint32_t targetExtent = rankPartition.GetExtent(targetRankIdx);
+            // 行数较少的rank在网格末尾的块不需要计算
+            uint32_t rows = (offsetM >= targetExtent) ? 0 : std::min(actualBlockShape.m(), targetExtent - offsetM);
+            uint32_t kOffset;
+            uint32_t kSize;
+            kSlices.GetSliceK(sliceIdx, tiling.k0, tiling.k, kOffset, kSize);
+            uint32_t coreIdx = taskIdx % coreNum;
+            matmulLoad.Add(coreIdx, static_cast<uint64_t>(rows) * actualBlockShape.n() * kSize);
+            coreTiles[coreIdx].push_back(GemmCoord{blockCoord.m(), blockCoord.n(), targetRankIdx});
+            if (kOffset == 0) {
+                tileHits[static_cast<size_t>(targetRankIdx) * loopsInRank + loopIdxInRank] += 1;
+            }
+        }
+        PrintLoad("matmul", matmulLoad, taskCount, 0);
+        if (printTasks) {
+            PrintMatmulTasks(coreTiles);
+        }
+
+        MatrixCoord commShape = MatrixCoord{segmentInRank * rankSize, 1} * blockShapeMN;
+        MatrixCoord dataLoopsMx = CeilDiv(commShape, commBlockShape);
+        uint32_t dLoopsInRank = CeilDiv(dataLoopsMx.row() * dataLoopsMx.column(), rankSize);
+        commScheduler.Update(commShape, commBlockShape, dLoopsInRank);
+        auto layoutComm = Catcoc::layout::AffineRankN<3>::Packed(
+            Catlass::MakeCoord<int>(1, dLoopsInRank, commBlockShape.row()));
+        MatrixCoord actualCommShapeInRank = commShape / Catlass::MakeCoord<uint32_t>(rankSize, 1);
+        uint32_t blockCountInRank = chunkPartition.GetCount(rankId, commIdx);
+        MatrixCoord commOffsetInRank = MatrixCoord{chunkPartition.GetOffset(rankId, commIdx), 0} * blockShapeMN;
+        uint32_t commAicoreNum = commScheduler.GetRealCore();
+        uint32_t commCoreLoops = commScheduler.GetCoreLoop();
+
+        // 原子累加模式按K分片逐个累加, 本rank只有分片0已由AIC写入D; 确定性模式在一个任务中累加所有rank的所有分片
+        uint32_t sliceLoops = IS_DETERMINISTIC ? 1 : kSlices.splitK;
+        for (uint32_t sliceIdx = 0; sliceIdx < sliceLoops; ++sliceIdx) {
+            std::vector<CommTaskInfo> reduceScatterTasks;
+            for (uint32_t commLoopIdx = 0; commLoopIdx < commCoreLoops; ++commLoopIdx) {
+                MatrixCoord blockCoord = commScheduler.GetBlockIdx(commLoopIdx);
+                MatrixCoord blockOffset = commScheduler.template GetBlockOffset<CopyMode::Scatter, CopyDirect::Get>(
+                    blockCoord, layoutComm);
+                MatrixCoord blockOffsetInRank = blockOffset % actualCommShapeInRank;
+                MatrixCoord blockShape = ClipToGemmBlock(reMapper, blockShapeMN,
+                    commScheduler.template GetActualBlockShape<CopyMode::Scatter, CopyDirect::Get>(blockCoord,
+                    layoutComm), commOffsetInRank + blockOffsetInRank);
+                bool skipped = (blockOffsetInRank.row() / blockShapeMN.row() >= blockCountInRank) ||
+                    (!IS_DETERMINISTIC && blockCoord.column() == rankId && sliceIdx == 0);
+                reduceScatterTasks.push_back(
+                    CommTaskInfo{commLoopIdx % commAicoreNum, blockCoord, blockShape, skipped});
+            }
+            std::string phase = (sliceLoops > 1) ? "reduce-scatter slice " + std::to_string(sliceIdx) :
+                "reduce-scatter";
+            bijective &= ReportCommPhase(phase.c_str(), reduceScatterTasks, tiling, rankId, commAicoreNum,
+                dLoopsInRank, !IS_DETERMINISTIC, IS_DETERMINISTIC);
+        }
+    }
+
+    bool tilesOnce = std::all_of(tileHits.begin(), tileHits.end(), [](uint32_t hit) { return hit == 1; });
+    std::printf("matmul tiles: %u per rank over %u chunks, each computed once: %s\n", loopsInRank, commLoops,
+        tilesOnce ? "yes" : "NO");
+    return bijective && tilesOnce;
+}
+
+int main(int argc, char **argv)
+{
+    Options options;
+    if (options.Parse(argc, argv) != 0) {
+        std::fprintf(stderr, "usage: %s op rank_size m n k [name=value ...]\n"
+            "  op: MatmulAllReduce, MatmulReduceScatter\n"
+            "  name: m0 n0 k0 commInterval firstCommInterval tailSplitK splitK commBlockM commNpuSplit commDataSplit\n"
+            "        deterministic blockNum rankId swizzleOffset swizzleDirection\n",
+            argv[0]);
+        return -1;
+    }
+    // PRINT_TASKS=1时打印每个阶段各核的任务列表和每轮各peer的搬运字节数
+    printTasks = std::getenv("PRINT_TASKS") != nullptr && std::atoi(std::getenv("PRINT_TASKS")) != 0;
+
+    const CocTilingParams &tiling = options.tiling;
+    std::printf("%s m %u n %u k %u, rank %u of %u, %u cores\n", options.opName.c_str(),
+        tiling.m, tiling.n, tiling.k, options.rankId, tiling.rankSize, tiling.blockNum);
+    std::printf("m0 %u n0 %u commInterval %u commBlockM %u commNpuSplit %u commDataSplit %u deterministic %u\n",
+        tiling.m0, tiling.n0, tiling.commInterval, tiling.commBlockM, tiling.commNpuSplit, tiling.commDataSplit,
+        tiling.deterministic);
+    std::printf("swizzleOffset %u swizzleDirection %u firstCommInterval %u tailSplitK %u splitK %u\n",
+        tiling.swizzleOffset, tiling.swizzleDirection, tiling.firstCommInterval, tiling.tailSplitK, tiling.splitK);
+
+    bool bijective;
+    if (options.opName == "MatmulAllReduce") {
+        bijective = tiling.deterministic ? ExploreMatmulAllReduce<true>(tiling, options.rankId) :
+            ExploreMatmulAllReduce<false>(tiling, options.rankId);
+    } else {
+        bijective = tiling.deterministic ? ExploreMatmulReduceScatter<true>(tiling, options.rankId) :
+            ExploreMatmulReduceScatter<false>(tiling, options.rankId);
+    }
+    if (!bijective) {
+        std::printf("[ERROR] The schedule does not cover every block exactly once\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2025 Huawei Technologies Co., Ltd.
+ * This file is a part of the CANN Open Software.
+ * Licensed under CANN Open Software License Agreement Version 1.0 (the "License").
+ * Please refer to the License for details. You may not use this file except in compliance with the License.
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE.
+ * See LICENSE in the root of the software repository for the full text of the License.
+ */
+
+#ifndef SHARED_LIB_CATCOC_KERNEL_H
+#define SHARED_LIB_CATCOC_KERNEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    CATCOC_SUCCESS = 0,
+    CATCOC_ERROR_INVALID_PARAM,
+    CATCOC_ERROR_NOT_INITIALIZED,
+    CATCOC_ERROR_UNSUPPORTED,
+    CATCOC_ERROR_LOAD_KERNEL,
+    CATCOC_ERROR_OUT_OF_MEMORY,
+    CATCOC_ERROR_RUNTIME
+} CatcocStatus;
+
+typedef enum {
+    CATCOC_OP_MATMUL_ALLREDUCE = 0,
+    CATCOC_OP_ALLGATHER_MATMUL = 1,
+    CATCOC_OP_MATMUL_REDUCE_SCATTER = 2,
+    CATCOC_OP_QUANT_MATMUL_REDUCE_SCATTER = 3
+} CatcocOpType;
+
+/* 取值与aclDataType一致 */
+typedef enum {
+    CATCOC_DTYPE_FP16 = 1,
+    CATCOC_DTYPE_INT8 = 2,
+    CATCOC_DTYPE_BF16 = 27
+} CatcocDataType;
+
+typedef struct {
+    CatcocOpType op;
+    /* 输入A/B的类型, QuantMatmulReduceScatter只支持INT8, 其余算子支持FP16和BF16 */
+    CatcocDataType dataType;
+    /* MatmulAllReduce/MatmulReduceScatter为整体的M, AllGatherMatmul为每个rank上A的M */
+    uint32_t m;
+    uint32_t n;
+    uint32_t k;
+    uint32_t transA;
+    uint32_t transB;
+    /* 1: 按rank顺序确定性累加, 仅对规约类算子生效 */
+    uint32_t deterministic;
+} CatcocPlanDesc;
+
+/* QuantMatmulReduceScatter的额外输入, 输出D为half */
+typedef struct {
+    void *scale;          /* per channel scale, n个float */
+    void *perTokenScale;  /* per token scale, 整体m个float */
+    void *bias;           /* n个int32 */
+    void *accum;          /* 本rank的int32累加结果, CatcocPlanGetAccumSize字节 */
+} CatcocQuantArgs;
+
+typedef struct CatcocPlan *CatcocPlanHandle;
+
+/* 多个plan共用的workspace, 用于在同一stream上顺序执行的plan, 大小为其中最大的plan所需 */
+typedef struct CatcocWorkspace *CatcocWorkspaceHandle;
+
+/*
+ * 在shmem初始化之后调用一次, 集合调用, 各rank参数需一致.
+ * workspaceCapacity为对称内存池容量, 0表示使用默认容量; tilingFile为dynamic_tiling调优得到的best_result.csv, 可为NULL
+ */
+CatcocStatus CatcocInit(int32_t deviceId, size_t workspaceCapacity, const char *tilingFile);
+
+/* 集合调用, 需在所有plan销毁且launch完成之后, shmem_finalize之前调用 */
+CatcocStatus CatcocFinalize(void);
+
+/*
+ * 确定tiling, 从对称内存池中取workspace, 并在首次使用某个算子和数据类型时加载对应的kernel库.
+ * 各rank需以相同顺序创建和销毁plan, 保证workspace在各rank上的偏移一致
+ */
+CatcocStatus CatcocPlanCreate(const CatcocPlanDesc *desc, CatcocPlanHandle *plan);
+
+/* 创建一个空的共用workspace, 由之后绑定到它的plan按需扩大 */
+CatcocStatus CatcocWorkspaceCreate(CatcocWorkspaceHandle *workspace);
+
+/* 需在绑定到它的plan全部销毁且launch完成之后调用 */
+CatcocStatus CatcocWorkspaceDestroy(CatcocWorkspaceHandle workspace);
+
+/*
+ * 与CatcocPlanCreate相同, 但plan不单独持有workspace, 而是使用workspace, 需要时将其扩大到该plan所需的大小.
+ * 扩大时workspace在对称内存池中的位置可能改变, 调用方需保证此时没有使用该workspace的launch未完成.
+ * 绑定到同一workspace的plan只能在同一stream上顺序执行, 各rank需以相同顺序创建, 扩大的顺序因此一致
+ */
+CatcocStatus CatcocPlanCreateWithWorkspace(const CatcocPlanDesc *desc, CatcocWorkspaceHandle workspace,
+    CatcocPlanHandle *plan);
+
+CatcocStatus CatcocPlanDestroy(CatcocPlanHandle plan);
+
+/* 只做kernel launch, 可多线程调用; 同一plan的workspace在两次launch之间复用, 不能在多个stream上并发执行 */
+CatcocStatus CatcocPlanRun(CatcocPlanHandle plan, void *stream, void *a, void *b, void *d);
+
+CatcocStatus CatcocPlanRunQuant(CatcocPlanHandle plan, void *stream, void *a, void *b, void *d,
+    const CatcocQuantArgs *quantArgs);
+
+/* QuantMatmulReduceScatter的accum字节数, 其余算子返回0 */
+size_t CatcocPlanGetAccumSize(CatcocPlanHandle plan);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SHARED_LIB_CATCOC_KERNEL_H
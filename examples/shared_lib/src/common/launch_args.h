@@ -0,0 +1,31 @@
+#ifndef SHARED_LIB_LAUNCH_ARGS_H
+#define SHARED_LIB_LAUNCH_ARGS_H
+
+#include <cstdint>
+
+#include "info.h"
+
+// libcatcoc.so与各kernel库之间的调用约定. 每个(算子, 数据类型)编译为一个kernel库, 导出同名的C符号,
+// 由libcatcoc.so在第一次创建该算子的plan时dlopen
+struct CatcocLaunchArgs {
+    void *stream;
+    uint64_t fftsAddr;
+    uint8_t *a;
+    uint8_t *b;
+    uint8_t *d;
+    // 仅QuantMatmulReduceScatter使用
+    uint8_t *scale;
+    uint8_t *perTokenScale;
+    uint8_t *bias;
+    uint8_t *accum;
+    uint8_t *symmetricPtr;
+    CocTilingParams tiling;
+    uint32_t transA;
+    uint32_t transB;
+};
+
+using CatcocLaunchFunc = void (*)(const CatcocLaunchArgs *);
+
+constexpr const char *CATCOC_LAUNCH_SYMBOL = "CatcocLaunch";
+
+#endif // SHARED_LIB_LAUNCH_ARGS_H
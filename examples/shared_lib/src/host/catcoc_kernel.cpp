@@ -0,0 +1,389 @@
+#include <dlfcn.h>
+
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include <acl/acl.h>
+#include <runtime/rt_ffts.h>
+
+// shmem_host
+#include "host/shmem_host_heap.h"
+#include "host/shmem_host_team.h"
+
+#include "utils/utils.h"
+
+#include "catcoc_kernel.h"
+#include "launch_args.h"
+#include "tiling_check.h"
+#include "tiling_table.h"
+
+#include "catcoc/detail/rank_partition.hpp"
+#include "catcoc/symmetric_pool.hpp"
+
+struct CatcocWorkspace {
+    explicit CatcocWorkspace(Catcoc::SymmetricPool &pool) : sequential(pool) {}
+
+    Catcoc::SequentialWorkspace sequential;
+};
+
+struct CatcocPlan {
+    CatcocOpType op;
+    CocTilingParams tiling;
+    uint32_t transA;
+    uint32_t transB;
+    uint64_t fftsAddr;
+    CatcocLaunchFunc launch;
+    // 单独持有的workspace, 使用共用workspace时无效
+    Catcoc::SymmetricWorkspace workspace;
+    size_t accumSize;
+    CatcocWorkspace *shared;
+    size_t workspaceSize;
+};
+
+namespace {
+
+constexpr uint32_t OP_NUM = 4;
+// 与tiling文件中Op列的名字一致
+const char *const OP_NAMES[OP_NUM] = {
+    "MatmulAllReduce", "AllGatherMatmul", "MatmulReduceScatter", "QuantMatmulReduceScatter"
+};
+// 各算子按哪种通信检查tiling, 量化matmul reduce scatter与matmul reduce scatter的通信相同
+const CocCommType OP_COMM_TYPES[OP_NUM] = {
+    MATMUL_ALLREDUCE, ALLGATHER_MATMUL, MATMUL_REDUCE_SCATTER, MATMUL_REDUCE_SCATTER
+};
+const char *const OP_LIB_NAMES[OP_NUM] = {
+    "matmul_allreduce", "allgather_matmul", "matmul_reduce_scatter", "quant_matmul_reduce_scatter"
+};
+// 未命中调优表时的commInterval, 与examples中各算子的静态配置一致
+const uint32_t DEFAULT_COMM_INTERVAL[OP_NUM] = {3, 1, 10, 10};
+
+struct Context {
+    std::mutex mutex;
+    bool initialized{false};
+    uint32_t blockNum{0};
+    uint32_t rankSize{1};
+    uint32_t rankId{0};
+    uint64_t fftsAddr{0};
+    Catcoc::SymmetricPool pool;
+    CocTilingTable tilingTable;
+    // (算子, 数据类型) -> 已加载的kernel库
+    std::map<std::pair<uint32_t, uint32_t>, void *> libHandles;
+    std::map<std::pair<uint32_t, uint32_t>, CatcocLaunchFunc> launchFuncs;
+};
+
+Context &GetContext()
+{
+    static Context context;
+    return context;
+}
+
+bool IsSupported(CatcocOpType op, CatcocDataType dataType)
+{
+    if (op == CATCOC_OP_QUANT_MATMUL_REDUCE_SCATTER) {
+        return dataType == CATCOC_DTYPE_INT8;
+    }
+    return static_cast<uint32_t>(op) < OP_NUM && (dataType == CATCOC_DTYPE_FP16 || dataType == CATCOC_DTYPE_BF16);
+}
+
+const char *GetDataTypeName(CatcocDataType dataType)
+{
+    switch (dataType) {
+        case CATCOC_DTYPE_FP16:
+            return "fp16";
+        case CATCOC_DTYPE_BF16:
+            return "bf16";
+        default:
+            return "int8";
+    }
+}
+
+// kernel库与libcatcoc.so放在同一目录
+std::string GetLibraryDir()
+{
+    Dl_info info;
+    if (dladdr(reinterpret_cast<void *>(&CatcocInit), &info) == 0 || info.dli_fname == nullptr) {
+        return "";
+    }
+    std::string path = info.dli_fname;
+    size_t pos = path.find_last_of('/');
+    return (pos == std::string::npos) ? "" : path.substr(0, pos + 1);
+}
+
+// 首次用到某个(算子, 数据类型)时才加载对应的kernel库, 调用时需持有context.mutex
+CatcocLaunchFunc LoadKernel(Context &context, CatcocOpType op, CatcocDataType dataType)
+{
+    auto key = std::make_pair(static_cast<uint32_t>(op), static_cast<uint32_t>(dataType));
+    if (auto it = context.launchFuncs.find(key); it != context.launchFuncs.end()) {
+        return it->second;
+    }
+    std::string libName = GetLibraryDir() + "libcatcoc_" + OP_LIB_NAMES[op] + "_" + GetDataTypeName(dataType) + ".so";
+    void *handle = dlopen(libName.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (handle == nullptr) {
+        ERROR_LOG("Load kernel library failed: %s", dlerror());
+        return nullptr;
+    }
+    auto launch = reinterpret_cast<CatcocLaunchFunc>(dlsym(handle, CATCOC_LAUNCH_SYMBOL));
+    if (launch == nullptr) {
+        ERROR_LOG("Find %s in %s failed", CATCOC_LAUNCH_SYMBOL, libName.c_str());
+        dlclose(handle);
+        return nullptr;
+    }
+    context.libHandles[key] = handle;
+    context.launchFuncs[key] = launch;
+    return launch;
+}
+
+// 量化算子在int32的累加结果上做reduce scatter
+uint32_t GetWorkspaceElementBytes(CatcocOpType op)
+{
+    return (op == CATCOC_OP_QUANT_MATMUL_REDUCE_SCATTER) ? sizeof(int32_t) : INPUT_DTYPE;
+}
+
+size_t GetWorkspaceSize(const CocTilingParams &tiling, CatcocOpType op)
+{
+    return GetWorkspaceSize(tiling, OP_COMM_TYPES[op], tiling.rankSize, GetWorkspaceElementBytes(op));
+}
+
+// 在dynamic_tiling的约束之外, 量化kernel只编译了默认基本块和默认swizzle, chunk固定为commInterval,
+// 且只支持默认的调度参数: dequant不能作用在部分和上, 也没有逐块就绪标志和直接写入远端的实现
+bool IsValidTiling(const Context &context, const CocTilingParams &tiling, CatcocOpType op)
+{
+    if (op == CATCOC_OP_QUANT_MATMUL_REDUCE_SCATTER &&
+        (tiling.m0 != M0 || tiling.n0 != N0 || tiling.k0 != K0 ||
+        tiling.swizzleOffset != SWIZZLE_OFFSET || tiling.swizzleDirection != SWIZZLE_DIRECTION ||
+        tiling.firstCommInterval != 0 || tiling.splitK != 0 || tiling.tileFlags != 0 || tiling.pushStore != 0)) {
+        return false;
+    }
+    // put模式的all-gather写入各rank的输出, 而调用方传入的输出不在对称内存中
+    if (tiling.pushAllGather != 0) {
+        return false;
+    }
+    return IsValidTiling(tiling, OP_COMM_TYPES[op], context.pool.GetCapacity(), GetWorkspaceElementBytes(op));
+}
+
+CocTilingParams GetDefaultTiling(const Context &context, const CatcocPlanDesc &desc)
+{
+    CocTilingParams tiling;
+    tiling.m = desc.m;
+    tiling.n = desc.n;
+    tiling.k = desc.k;
+    tiling.m0 = M0;
+    tiling.n0 = N0;
+    tiling.k0 = K0;
+    tiling.commTileM = 64;
+    tiling.commBlockM = 64;
+    tiling.commInterval = DEFAULT_COMM_INTERVAL[desc.op];
+    tiling.commNpuSplit = 1;
+    tiling.commDataSplit = context.blockNum;
+    tiling.rankSize = context.rankSize;
+    // allgather matmul没有规约
+    tiling.deterministic = (desc.op == CATCOC_OP_ALLGATHER_MATMUL) ? 0 : (desc.deterministic ? 1 : 0);
+    tiling.blockNum = context.blockNum;
+    return tiling;
+}
+
+// 共用workspace扩大时会移动, 每次launch时重新取
+uint8_t *GetWorkspacePtr(const CatcocPlan *plan)
+{
+    return (plan->shared == nullptr) ? plan->workspace.ptr : plan->shared->sequential.View(plan->workspaceSize).ptr;
+}
+
+CatcocStatus CreatePlan(const CatcocPlanDesc *desc, CatcocWorkspace *shared, CatcocPlanHandle *plan)
+{
+    if (desc == nullptr || plan == nullptr || desc->m == 0 || desc->n == 0 || desc->k == 0) {
+        return CATCOC_ERROR_INVALID_PARAM;
+    }
+    if (!IsSupported(desc->op, desc->dataType)) {
+        return CATCOC_ERROR_UNSUPPORTED;
+    }
+    Context &context = GetContext();
+    std::lock_guard<std::mutex> lock(context.mutex);
+    if (!context.initialized) {
+        return CATCOC_ERROR_NOT_INITIALIZED;
+    }
+
+    CocTilingParams tiling = GetDefaultTiling(context, *desc);
+    CocTilingParams tuned;
+    if (context.tilingTable.Lookup(OP_NAMES[desc->op], tiling, desc->transA, desc->transB, tuned)) {
+        CocTilingParams candidate = tiling;
+        MergeTunedTiling(candidate, tuned);
+        // 调用方的输出不在对称内存中, 调优表中put模式的all-gather退回各rank读取
+        candidate.pushAllGather = 0;
+        // 调优结果来自同一分桶中的其他M, 对本shape不满足约束时保留默认tiling
+        if (IsValidTiling(context, candidate, desc->op)) {
+            tiling = candidate;
+        }
+    }
+    if (!IsValidTiling(context, tiling, desc->op)) {
+        ERROR_LOG("No valid tiling for %s, m = %u, n = %u, k = %u", OP_NAMES[desc->op], desc->m, desc->n, desc->k);
+        return CATCOC_ERROR_UNSUPPORTED;
+    }
+
+    // 量化kernel没有编译期通信切分的版本
+    if (desc->op != CATCOC_OP_QUANT_MATMUL_REDUCE_SCATTER) {
+        tiling.commStatic = GetStaticComm(tiling);
+    }
+
+    CatcocLaunchFunc launch = LoadKernel(context, desc->op, desc->dataType);
+    if (launch == nullptr) {
+        return CATCOC_ERROR_LOAD_KERNEL;
+    }
+    size_t workspaceSize = GetWorkspaceSize(tiling, desc->op);
+    Catcoc::SymmetricWorkspace workspace = (shared == nullptr) ? context.pool.Acquire(workspaceSize) :
+        shared->sequential.View(workspaceSize);
+    if (!workspace.IsValid()) {
+        ERROR_LOG("Acquire symmetric workspace failed, size = %zu", workspaceSize);
+        return CATCOC_ERROR_OUT_OF_MEMORY;
+    }
+
+    size_t accumSize = 0;
+    if (desc->op == CATCOC_OP_QUANT_MATMUL_REDUCE_SCATTER) {
+        Catcoc::detail::RankPartition rankPartition(desc->m, context.rankSize);
+        accumSize = static_cast<size_t>(rankPartition.GetExtent(context.rankId)) * desc->n * sizeof(int32_t);
+    }
+    *plan = new CatcocPlan{desc->op, tiling, desc->transA, desc->transB, context.fftsAddr, launch,
+        (shared == nullptr) ? workspace : Catcoc::SymmetricWorkspace{}, accumSize, shared, workspaceSize};
+    return CATCOC_SUCCESS;
+}
+
+} // namespace
+
+CatcocStatus CatcocInit(int32_t deviceId, size_t workspaceCapacity, const char *tilingFile)
+{
+    Context &context = GetContext();
+    std::lock_guard<std::mutex> lock(context.mutex);
+    if (context.initialized) {
+        return CATCOC_SUCCESS;
+    }
+    context.blockNum = GetLaunchCoreNum(deviceId);
+    if (context.blockNum == 0) {
+        return CATCOC_ERROR_RUNTIME;
+    }
+    context.rankSize = shmem_n_pes();
+    context.rankId = shmem_my_pe();
+    uint32_t fftsLen{0};
+    if (rtGetC2cCtrlAddr(&context.fftsAddr, &fftsLen) != RT_ERROR_NONE) {
+        ERROR_LOG("Get FFTS address failed");
+        return CATCOC_ERROR_RUNTIME;
+    }
+    if (tilingFile != nullptr && !context.tilingTable.Load(tilingFile)) {
+        return CATCOC_ERROR_INVALID_PARAM;
+    }
+    size_t capacity = (workspaceCapacity == 0) ? static_cast<size_t>(LCAL_BUFF_BYTES - FLAG_BUFF_BYTES) :
+        workspaceCapacity;
+    if (!context.pool.Init(capacity)) {
+        ERROR_LOG("Init symmetric pool failed, capacity = %zu", capacity);
+        return CATCOC_ERROR_OUT_OF_MEMORY;
+    }
+    context.initialized = true;
+    return CATCOC_SUCCESS;
+}
+
+CatcocStatus CatcocFinalize(void)
+{
+    Context &context = GetContext();
+    std::lock_guard<std::mutex> lock(context.mutex);
+    if (!context.initialized) {
+        return CATCOC_ERROR_NOT_INITIALIZED;
+    }
+    context.pool.Finalize();
+    for (auto &lib : context.libHandles) {
+        dlclose(lib.second);
+    }
+    context.libHandles.clear();
+    context.launchFuncs.clear();
+    context.initialized = false;
+    return CATCOC_SUCCESS;
+}
+
+CatcocStatus CatcocPlanCreate(const CatcocPlanDesc *desc, CatcocPlanHandle *plan)
+{
+    return CreatePlan(desc, nullptr, plan);
+}
+
+CatcocStatus CatcocWorkspaceCreate(CatcocWorkspaceHandle *workspace)
+{
+    if (workspace == nullptr) {
+        return CATCOC_ERROR_INVALID_PARAM;
+    }
+    Context &context = GetContext();
+    std::lock_guard<std::mutex> lock(context.mutex);
+    if (!context.initialized) {
+        return CATCOC_ERROR_NOT_INITIALIZED;
+    }
+    *workspace = new CatcocWorkspace(context.pool);
+    return CATCOC_SUCCESS;
+}
+
+CatcocStatus CatcocWorkspaceDestroy(CatcocWorkspaceHandle workspace)
+{
+    if (workspace == nullptr) {
+        return CATCOC_ERROR_INVALID_PARAM;
+    }
+    Context &context = GetContext();
+    {
+        std::lock_guard<std::mutex> lock(context.mutex);
+        workspace->sequential.Release();
+    }
+    delete workspace;
+    return CATCOC_SUCCESS;
+}
+
+CatcocStatus CatcocPlanCreateWithWorkspace(const CatcocPlanDesc *desc, CatcocWorkspaceHandle workspace,
+    CatcocPlanHandle *plan)
+{
+    if (workspace == nullptr) {
+        return CATCOC_ERROR_INVALID_PARAM;
+    }
+    return CreatePlan(desc, workspace, plan);
+}
+
+CatcocStatus CatcocPlanDestroy(CatcocPlanHandle plan)
+{
+    if (plan == nullptr) {
+        return CATCOC_ERROR_INVALID_PARAM;
+    }
+    Context &context = GetContext();
+    {
+        std::lock_guard<std::mutex> lock(context.mutex);
+        context.pool.Release(plan->workspace);
+    }
+    delete plan;
+    return CATCOC_SUCCESS;
+}
+
+CatcocStatus CatcocPlanRun(CatcocPlanHandle plan, void *stream, void *a, void *b, void *d)
+{
+    if (plan == nullptr || plan->op == CATCOC_OP_QUANT_MATMUL_REDUCE_SCATTER) {
+        return CATCOC_ERROR_INVALID_PARAM;
+    }
+    CatcocLaunchArgs args{stream, plan->fftsAddr,
+        static_cast<uint8_t *>(a), static_cast<uint8_t *>(b), static_cast<uint8_t *>(d),
+        nullptr, nullptr, nullptr, nullptr,
+        GetWorkspacePtr(plan), plan->tiling, plan->transA, plan->transB};
+    plan->launch(&args);
+    return CATCOC_SUCCESS;
+}
+
+CatcocStatus CatcocPlanRunQuant(CatcocPlanHandle plan, void *stream, void *a, void *b, void *d,
+    const CatcocQuantArgs *quantArgs)
+{
+    if (plan == nullptr || plan->op != CATCOC_OP_QUANT_MATMUL_REDUCE_SCATTER || quantArgs == nullptr) {
+        return CATCOC_ERROR_INVALID_PARAM;
+    }
+    CatcocLaunchArgs args{stream, plan->fftsAddr,
+        static_cast<uint8_t *>(a), static_cast<uint8_t *>(b), static_cast<uint8_t *>(d),
+        static_cast<uint8_t *>(quantArgs->scale), static_cast<uint8_t *>(quantArgs->perTokenScale),
+        static_cast<uint8_t *>(quantArgs->bias), static_cast<uint8_t *>(quantArgs->accum),
+        GetWorkspacePtr(plan), plan->tiling, plan->transA, plan->transB};
+    plan->launch(&args);
+    return CATCOC_SUCCESS;
+}
+
+size_t CatcocPlanGetAccumSize(CatcocPlanHandle plan)
+{
+    return (plan == nullptr) ? 0 : plan->accumSize;
+}
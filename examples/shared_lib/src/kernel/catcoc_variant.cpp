@@ -0,0 +1,71 @@
+// 编译时由CATCOC_VARIANT_OP和CATCOC_VARIANT_DTYPE选择算子和数据类型, 取值与catcoc_kernel.h中的枚举一致,
+// 每个组合生成一个只包含该算子的kernel库
+#include "launch_args.h"
+
+#if CATCOC_VARIANT_OP == 0
+#include "impl/kernel/matmul_allreduce.h"
+#elif CATCOC_VARIANT_OP == 1
+#include "impl/kernel/allgather_matmul.h"
+#elif CATCOC_VARIANT_OP == 2
+#include "impl/kernel/matmul_reduce_scatter.h"
+#elif CATCOC_VARIANT_OP == 3
+#include "kernel/quant_matmul_reduce_scatter.h"
+#else
+#error "Unknown CATCOC_VARIANT_OP"
+#endif
+
+using namespace AscendC;
+
+#if CATCOC_VARIANT_DTYPE == 1
+using Element = half;
+#elif CATCOC_VARIANT_DTYPE == 27
+using Element = bfloat16_t;
+#elif CATCOC_VARIANT_DTYPE == 2
+using Element = int8_t;
+#else
+#error "Unknown CATCOC_VARIANT_DTYPE"
+#endif
+
+using LayoutC = Catlass::layout::RowMajor;
+using LayoutD = Catlass::layout::RowMajor;
+
+template <class LayoutA, class LayoutB>
+void Launch(const CatcocLaunchArgs &args)
+{
+    CocTilingParams cocTiling = args.tiling;
+#if CATCOC_VARIANT_OP == 0
+    MatmulAllReduce<Element, LayoutA, Element, LayoutB, Element, LayoutC, Element, LayoutD>
+        <<<cocTiling.blockNum, nullptr, args.stream>>>(args.fftsAddr, args.a, args.b, args.d, args.symmetricPtr,
+        cocTiling);
+#elif CATCOC_VARIANT_OP == 1
+    AllGatherMatmul<Element, LayoutA, Element, LayoutB, Element, LayoutC, Element, LayoutD>
+        <<<cocTiling.blockNum, nullptr, args.stream>>>(args.fftsAddr, args.a, args.b, args.d, args.symmetricPtr,
+        cocTiling);
+#elif CATCOC_VARIANT_OP == 2
+    MatmulReduceScatter<Element, LayoutA, Element, LayoutB, Element, LayoutC, Element, LayoutD>
+        <<<cocTiling.blockNum, nullptr, args.stream>>>(args.fftsAddr, args.a, args.b, args.d, args.symmetricPtr,
+        cocTiling);
+#else
+    QuantMatmulReduceScatter<LayoutA, LayoutB>
+        <<<cocTiling.blockNum, nullptr, args.stream>>>(args.fftsAddr, args.a, args.b, args.scale,
+        args.perTokenScale, args.bias, args.accum, args.d, args.symmetricPtr, cocTiling);
+#endif
+}
+
+extern "C" void CatcocLaunch(const CatcocLaunchArgs *args)
+{
+    using LayoutA0 = Catlass::layout::RowMajor;
+    using LayoutB0 = Catlass::layout::RowMajor;
+    using LayoutA1 = Catlass::layout::ColumnMajor;
+    using LayoutB1 = Catlass::layout::ColumnMajor;
+
+    if (!args->transA && !args->transB) {
+        Launch<LayoutA0, LayoutB0>(*args);
+    } else if (!args->transA && args->transB) {
+        Launch<LayoutA0, LayoutB1>(*args);
+    } else if (args->transA && !args->transB) {
+        Launch<LayoutA1, LayoutB0>(*args);
+    } else {
+        Launch<LayoutA1, LayoutB1>(*args);
+    }
+}
@@ -0,0 +1,229 @@
+#ifndef QUANT_MATMUL_REDUCE_SCATTER_KERNEL_H
+#define QUANT_MATMUL_REDUCE_SCATTER_KERNEL_H
+
+#include "info.h"
+
+// from catlass
+#include "catlass/catlass.hpp"
+#include "catlass/arch/arch.hpp"
+#include "catlass/epilogue/block/block_epilogue.hpp"
+#include "catlass/epilogue/block/block_epilogue_per_token_dequant.hpp"
+#include "catlass/epilogue/tile/tile_broadcast_mul.hpp"
+#include "catlass/epilogue/tile/tile_broadcast_one_blk.hpp"
+#include "catlass/epilogue/tile/tile_copy.hpp"
+#include "catlass/epilogue/tile/tile_swizzle.hpp"
+#include "catlass/gemm/block/block_mmad.hpp"
+#include "catlass/gemm/block/block_swizzle.hpp"
+#include "catlass/gemm/dispatch_policy.hpp"
+#include "catlass/gemm/gemm_type.hpp"
+#include "catlass/layout/layout.hpp"
+
+#include "catcoc/catcoc.hpp"
+#include "catcoc/comm_epilogue/comm_dispatch_policy.hpp"
+#include "catcoc/comm_epilogue/block/comm_block_epilogue.hpp"
+#include "catcoc/comm_epilogue/block/comm_block_swizzle.hpp"
+#include "catcoc/comm_epilogue/tile/tile_remote_copy.hpp"
+#include "catcoc/detail/remote_copy_type.hpp"
+#include "catcoc/detail/rank_partition.hpp"
+#include "catcoc/dgemm/kernel/quant_matmul_reduce_scatter.hpp"
+
+using namespace AscendC;
+using namespace Catcoc;
+
+// int8 x int8的矩阵乘在int32上做reduce scatter, 再按per channel和per token的scale反量化为half,
+// tiling由CocTilingParams在运行时给出, 与dynamic_tiling中的MatmulReduceScatter一致
+template <
+    class ArchTag,
+    class LayoutA, class LayoutB,
+    bool IS_DETERMINISTIC
+>
+CATLASS_DEVICE
+void QuantMatmulReduceScatterImpl(
+    Catlass::GemmCoord const &problemShape,
+    GM_ADDR gmA, LayoutA const &layoutA,
+    GM_ADDR gmB, LayoutB const &layoutB,
+    GM_ADDR gmScale, GM_ADDR gmPerTokenScale, GM_ADDR gmBias,
+    GM_ADDR gmAccum, GM_ADDR gmD,
+    uint32_t rank, uint32_t rankSize, uint32_t commInterval, uint32_t workspaceStages, uint32_t ubStages,
+    Catlass::MatrixCoord const &commCoreSplit,
+    Catlass::MatrixCoord const &commBlockShape,
+    Catlass::MatrixCoord const &commTileShape,
+    GM_ADDR symmetricPtr
+)
+{
+    using LayoutC = Catlass::layout::RowMajor;
+    using LayoutD = Catlass::layout::RowMajor;
+
+    constexpr bool enableUnitFlag = true;
+    using MmadDispatchPolicy = Catlass::Gemm::MmadAtlasA2PingpongBias<enableUnitFlag>;
+    using L1TileShape = Catlass::GemmShape<M0, N0, K0>;
+    using L0TileShape = Catlass::GemmShape<M0, N0, 64>;
+
+    using AType = Catlass::Gemm::GemmType<int8_t, LayoutA>;
+    using BType = Catlass::Gemm::GemmType<int8_t, LayoutB>;
+    using CType = Catlass::Gemm::GemmType<int32_t, LayoutC>;
+    using BiasType = Catlass::Gemm::GemmType<int32_t, Catlass::layout::VectorLayout>;
+
+    using BlockMmad = Catlass::Gemm::Block::BlockMmad<MmadDispatchPolicy,
+        L1TileShape, L0TileShape, AType, BType, CType, BiasType>;
+    using BlockScheduler = typename Catlass::Gemm::Block::GemmIdentityBlockSwizzle<7, 1>;
+
+    using CopyDirect = Catcoc::detail::CopyDirect;
+    using TileRemoteCopy = CommEpilogue::Tile::TileRemoteCopy<ArchTag, CType, CType, CopyDirect::Get>;
+    using TileScheduler = Catlass::Epilogue::Tile::EpilogueIdentityTileSwizzle;
+
+    constexpr bool isDynamic = true;
+    using ReduceScatterDispatch = CommEpilogue::EpilogueAtlasA2CommToLocalMem<UB_STAGES,
+        Catcoc::detail::CopyMode::Scatter, isDynamic>;
+    using BlockEpilogueReduceScatterAtomic = CommEpilogue::Block::CommBlockEpilogue<
+        ReduceScatterDispatch,
+        CType, CType,
+        void,
+        void,
+        void, TileRemoteCopy, TileScheduler,
+        BlockScheduler
+    >;
+    using ReduceScatterDeterministicDispatch = CommEpilogue::EpilogueAtlasA2CommReduceDeterministic<UB_STAGES,
+        true, isDynamic>;
+    using BlockEpilogueReduceScatterDeterministic = CommEpilogue::Block::CommBlockEpilogue<
+        ReduceScatterDeterministicDispatch,
+        CType, CType,
+        void,
+        void,
+        void, TileScheduler,
+        BlockScheduler
+    >;
+    using BlockEpilogueReduceScatter = std::conditional_t<IS_DETERMINISTIC,
+        BlockEpilogueReduceScatterDeterministic, BlockEpilogueReduceScatterAtomic>;
+
+    using CommBlockScheduler = CommEpilogue::Block::BlockCommSwizzle<0, IS_DETERMINISTIC>;
+
+    using namespace Catlass::Epilogue;
+    using DequantScaleType = Catlass::Gemm::GemmType<float, Catlass::layout::VectorLayout>;
+    using DequantPerTokenScaleType = Catlass::Gemm::GemmType<float, Catlass::layout::VectorLayout>;
+    using DequantDType = Catlass::Gemm::GemmType<half, LayoutD>;
+    using DequantDispatchPolicy = EpilogueAtlasA2PerTokenDequant<2>;
+
+    using EpilogueTileShape = Catlass::MatrixShape<64, 128>;
+    using ComputeType = Catlass::Gemm::GemmType<float, Catlass::layout::RowMajor>;
+    using TileRowBroadcastMul = Tile::TileRowBroadcastMul<ArchTag, ComputeType, EpilogueTileShape>;
+    using TileBroadcastOneBlk = Tile::TileBroadcastOneBlk<ArchTag, ComputeType, 64>;
+    using TileOneBlkColumnBroadcastMul = Tile::TileOneBlkColumnBroadcastMul<ArchTag, ComputeType, EpilogueTileShape>;
+    using TileCopy = Tile::TileCopy<ArchTag, CType, DequantScaleType, DequantPerTokenScaleType, DequantDType>;
+    using EpilogueTileSwizzle = Tile::EpilogueIdentityTileSwizzle;
+    using BlockEpilogueDequant = Block::BlockEpilogue<
+        DequantDispatchPolicy, CType, DequantScaleType,
+        DequantPerTokenScaleType, DequantDType, TileRowBroadcastMul,
+        TileBroadcastOneBlk, TileOneBlkColumnBroadcastMul, TileCopy,
+        EpilogueTileSwizzle>;
+
+    using QuantMatmulReduceScatterKernel = DGemm::Kernel::QuantMatmulReduceScatter<
+        BlockMmad,
+        BlockEpilogueReduceScatter,
+        BlockEpilogueDequant,
+        BlockScheduler,
+        CommBlockScheduler,
+        WORKSPACE_STAGES
+    >;
+
+    uint32_t m = problemShape.m();
+    uint32_t n = problemShape.n();
+    uint32_t k = problemShape.k();
+
+    // Remap over the tile grid of the largest share, the shape is clipped to the rows owned by this rank
+    Catcoc::detail::RankPartition rankPartition(m, rankSize);
+    uint32_t mInRank = rankPartition.GetExtent(rank);
+    Catlass::GemmCoord problemShapeInRank{mInRank, n, k};
+    Catlass::MatrixCoord tileMN{M0, N0};
+    BlockScheduler matmulBlockScheduler(problemShapeInRank, tileMN,
+        CeilDiv(Catlass::MatrixCoord{rankPartition.GetMaxExtent(), n}, tileMN));
+
+    LayoutC layoutSymmetric{M0 * commInterval * AscendC::GetBlockNum() * workspaceStages, N0, N0};
+    LayoutC layoutAccum{mInRank, n, n};
+    LayoutD layoutD{mInRank, n, n};
+
+    typename BlockEpilogueReduceScatter::Params reduceScatterParams{
+        reinterpret_cast<__gm__ int32_t *>(symmetricPtr),
+        layoutSymmetric,
+        matmulBlockScheduler,
+        commCoreSplit,
+        commBlockShape,
+        commTileShape,
+        ubStages
+    };
+
+    typename BlockEpilogueDequant::Params dequantParams{
+        reinterpret_cast<__gm__ float *>(gmScale), Catlass::layout::VectorLayout(n),
+        reinterpret_cast<__gm__ float *>(gmPerTokenScale) + rankPartition.GetOffset(rank),
+        Catlass::layout::VectorLayout(mInRank),
+        reinterpret_cast<__gm__ half *>(gmD), layoutD
+    };
+
+    typename QuantMatmulReduceScatterKernel::Params params{
+        problemShape,
+        rank, rankSize,
+        gmA, layoutA,
+        gmB, layoutB,
+        gmBias, Catlass::layout::VectorLayout(n),
+        symmetricPtr,
+        reduceScatterParams,
+        dequantParams,
+        gmAccum, layoutAccum,
+        gmD, layoutD,
+        commInterval,
+        workspaceStages
+    };
+
+    QuantMatmulReduceScatterKernel quantMatmulReduceScatter;
+    quantMatmulReduceScatter(params);
+}
+
+template <class LayoutA, class LayoutB>
+CATLASS_GLOBAL
+void QuantMatmulReduceScatter(
+    uint64_t fftsAddr, GM_ADDR gmA, GM_ADDR gmB, GM_ADDR gmScale, GM_ADDR gmPerTokenScale, GM_ADDR gmBias,
+    GM_ADDR gmAccum, GM_ADDR gmD, GM_ADDR symmetricPtr, CocTilingParams cocTiling
+)
+{
+    AscendC::SetSyncBaseAddr(fftsAddr);
+
+    using ArchTag = Catlass::Arch::AtlasA2;
+    Catlass::Arch::Resource<ArchTag> resource;
+
+    uint32_t m = cocTiling.m;
+    uint32_t n = cocTiling.n;
+    uint32_t k = cocTiling.k;
+    uint32_t n0 = cocTiling.n0;
+    uint32_t commInterval = cocTiling.commInterval;
+    uint32_t workspaceStages = cocTiling.workspaceStages;
+    uint32_t ubStages = cocTiling.ubStages;
+
+    Catlass::GemmCoord problemShape{m, n, k};
+    Catlass::MatrixCoord commCoreSplit{cocTiling.commDataSplit, cocTiling.commNpuSplit};
+    Catlass::MatrixCoord commBlockShape{cocTiling.commBlockM, n0};
+    Catlass::MatrixCoord commTileShape{cocTiling.commTileM / 2, n0};
+
+    uint32_t rank = shmem_my_pe();
+    uint32_t rankSize = shmem_n_pes();
+
+    LayoutA layoutA{m, k};
+    LayoutB layoutB{k, n};
+
+    if (cocTiling.deterministic) {
+        QuantMatmulReduceScatterImpl<ArchTag, LayoutA, LayoutB, true>(
+            problemShape, gmA, layoutA, gmB, layoutB,
+            gmScale, gmPerTokenScale, gmBias, gmAccum, gmD,
+            rank, rankSize, commInterval, workspaceStages, ubStages,
+            commCoreSplit, commBlockShape, commTileShape, symmetricPtr
+        );
+    } else {
+        QuantMatmulReduceScatterImpl<ArchTag, LayoutA, LayoutB, false>(
+            problemShape, gmA, layoutA, gmB, layoutB,
+            gmScale, gmPerTokenScale, gmBias, gmAccum, gmD,
+            rank, rankSize, commInterval, workspaceStages, ubStages,
+            commCoreSplit, commBlockShape, commTileShape, symmetricPtr
+        );
+    }
+}
+
+#endif // QUANT_MATMUL_REDUCE_SCATTER_KERNEL_H
@@ -1,4 +1,5 @@
 #include <climits>
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
 #include <sys/file.h>
@@ -126,3 +127,23 @@ inline bool WriteFile(const std::string &filePath, const void *buffer, size_t si
     close(fd);
     return true;
 }
+
+/// Number of AI cores to launch on deviceId. Defaults to all cores of the device; the CORE_NUM
+/// environment variable can lower it to leave cores to other work running on the same device.
+/// Returns 0 when the device cannot be queried, callers must not launch then.
+inline uint32_t GetLaunchCoreNum(int32_t deviceId)
+{
+    int64_t coreNum = 0;
+    if (aclrtGetDeviceInfo(deviceId, ACL_DEV_ATTR_AICORE_CORE_NUM, &coreNum) != ACL_SUCCESS || coreNum <= 0) {
+        ERROR_LOG("Failed to query the AI core number of device %d.", deviceId);
+        return 0;
+    }
+    const char *limit = std::getenv("CORE_NUM");
+    if (limit != nullptr) {
+        int64_t limitNum = std::atoll(limit);
+        if (limitNum > 0 && limitNum < coreNum) {
+            coreNum = limitNum;
+        }
+    }
+    return static_cast<uint32_t>(coreNum);
+}
@@ -11,7 +11,10 @@
 #ifndef CATCOC_CATLASS_HPP
 #define CATCOC_CATLASS_HPP
 
+// Host code shares the scheduler headers built on this one, only the device compile needs AscendC
+#if defined(__CCE__)
 #include <kernel_operator.h>
+#endif
 
 #include "catlass/catlass.hpp"
 #include "catlass/coord.hpp"
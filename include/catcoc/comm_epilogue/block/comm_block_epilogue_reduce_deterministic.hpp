@@ -0,0 +1,361 @@
+/*
+ * Copyright (c) 2025 Huawei Technologies Co., Ltd.
+ * This file is a part of the CANN Open Software.
+ * Licensed under CANN Open Software License Agreement Version 1.0 (the "License").
+ * Please refer to the License for details. You may not use this file except in compliance with the License.
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY, OR FITNESS FOR A PARTICULAR PURPOSE.
+ * See LICENSE in the root of the software repository for the full text of the License.
+ */
+
+#ifndef CATCOC_COMM_EPILOGUE_BLOCK_EPILOGUE_REDUCE_DETERMINISTIC_HPP
+#define CATCOC_COMM_EPILOGUE_BLOCK_EPILOGUE_REDUCE_DETERMINISTIC_HPP
+
+#include <type_traits>
+
+#include "catcoc/catcoc.hpp"
+#include "catcoc/comm_epilogue/comm_dispatch_policy.hpp"
+#include "catcoc/detail/pipeline_stages.hpp"
+#include "catcoc/detail/remote_copy_type.hpp"
+
+// from catlass
+#include "catlass/arch/resource.hpp"
+#include "catlass/epilogue/tile/copy_gm_to_ub.hpp"
+#include "catlass/epilogue/tile/copy_ub_to_gm.hpp"
+#include "catlass/gemm_coord.hpp"
+#include "catlass/matrix_coord.hpp"
+#include "catlass/layout/layout.hpp"
+
+// from shmem
+#include "shmem_api.h"
+
+namespace Catcoc::CommEpilogue::Block {
+
+using Catlass::MatrixCoord;
+using Catlass::GemmCoord;
+
+template <
+    uint32_t UB_STAGES_,
+    bool RemapOutput_,
+    bool IsDynamic_,
+    class SrcType_,
+    class DstType_,
+    class CoreSplit_,
+    class BlockShape_,
+    class TileShape_,
+    class EpilogueTileSwizzle_,
+    class GemmReMapper_
+>
+class CommBlockEpilogue <
+    EpilogueAtlasA2CommReduceDeterministic<UB_STAGES_, RemapOutput_, IsDynamic_>,
+    SrcType_,
+    DstType_,
+    CoreSplit_,
+    BlockShape_,
+    TileShape_,
+    EpilogueTileSwizzle_,
+    GemmReMapper_
+> {
+public:
+    // Type aliases
+    using DispatchPolicy = EpilogueAtlasA2CommReduceDeterministic<UB_STAGES_, RemapOutput_, IsDynamic_>;
+    static constexpr uint32_t UB_STAGES = UB_STAGES_;
+    static_assert(UB_STAGES >= 1 && UB_STAGES <= detail::MAX_UB_STAGES, "Each UB stage needs its own event ID.");
+    static constexpr bool RemapOutput = RemapOutput_;
+    static constexpr bool IsDynamic = IsDynamic_;
+    using ArchTag = typename DispatchPolicy::ArchTag;
+    using ElementSrc = typename SrcType_::Element;
+    using LayoutSrc = typename SrcType_::Layout;
+    using ElementDst = typename DstType_::Element;
+    using LayoutDst = typename DstType_::Layout;
+    // Integer partials are summed exactly, floating point partials are widened to fp32
+    using ElementCompute = std::conditional_t<std::is_same_v<ElementSrc, int32_t>, int32_t, float>;
+
+    using CoreSplit = CoreSplit_;
+    using BlockShape = BlockShape_;
+    using TileShape = TileShape_;
+    using EpilogueTileSwizzle = EpilogueTileSwizzle_;
+    using GemmReMapper = GemmReMapper_;
+    // Every rank reads its own slice from the workspace of all ranks
+    static constexpr detail::CopyMode RemoteCopyMode = detail::CopyMode::Scatter;
+    static constexpr detail::CopyDirect RemoteCopyDirect = detail::CopyDirect::Get;
+
+    using CopyGmToUbSrc = Catlass::Epilogue::Tile::CopyGm2Ub<ArchTag, SrcType_>;
+    using CopyUbToGmDst = Catlass::Epilogue::Tile::CopyUb2Gm<ArchTag, DstType_>;
+
+    static_assert(std::is_same_v<ElementCompute, int32_t> == std::is_same_v<ElementDst, int32_t>,
+        "Deterministic reduce does not support converting between integer and floating point.");
+
+    // Epilogue params definition
+    template <bool IsDynamicParams_>
+    struct ParamsBase {};
+
+    template <>
+    struct ParamsBase<false> {
+        __gm__ ElementSrc *shmemPtr{nullptr};
+        LayoutSrc shmemLayout;
+        GemmReMapper gemmReMapper;
+
+        CATLASS_HOST_DEVICE
+        ParamsBase() {}
+
+        CATLASS_HOST_DEVICE
+        ParamsBase(__gm__ ElementSrc *shmemPtr_, LayoutSrc const &shmemLayout_, GemmReMapper const gemmReMapper_)
+            : shmemPtr(shmemPtr_), shmemLayout(shmemLayout_), gemmReMapper(gemmReMapper_) {}
+
+        CATLASS_DEVICE
+        static MatrixCoord CoreSplit() { return CoreSplit::ToCoord(); }
+        CATLASS_DEVICE
+        static MatrixCoord BlockShape() { return BlockShape::ToCoord(); }
+        CATLASS_DEVICE
+        static MatrixCoord TileShape() { return TileShape::ToCoord(); }
+        CATLASS_DEVICE
+        static uint32_t UbStages() { return UB_STAGES; }
+    };
+
+    template <>
+    struct ParamsBase<true> {
+        __gm__ ElementSrc *shmemPtr{nullptr};
+        LayoutSrc shmemLayout;
+        GemmReMapper gemmReMapper;
+        MatrixCoord coreSplit;
+        MatrixCoord blockShape;
+        MatrixCoord tileShape;
+        // UB buffers used at runtime, at most UB_STAGES
+        uint32_t ubStages{UB_STAGES};
+
+        CATLASS_HOST_DEVICE
+        ParamsBase() {}
+
+        CATLASS_HOST_DEVICE
+        ParamsBase(__gm__ ElementSrc *shmemPtr_, LayoutSrc const &shmemLayout_, GemmReMapper const gemmReMapper_,
+            MatrixCoord coreSplit_, MatrixCoord blockShape_, MatrixCoord tileShape_, uint32_t ubStages_ = UB_STAGES)
+            : shmemPtr(shmemPtr_), shmemLayout(shmemLayout_), gemmReMapper(gemmReMapper_),
+              coreSplit(coreSplit_), blockShape(blockShape_), tileShape(tileShape_), ubStages(ubStages_) {}
+
+        CATLASS_DEVICE
+        MatrixCoord CoreSplit() const { return coreSplit; }
+        CATLASS_DEVICE
+        MatrixCoord BlockShape() const { return blockShape; }
+        CATLASS_DEVICE
+        MatrixCoord TileShape() const { return tileShape; }
+        CATLASS_DEVICE
+        uint32_t UbStages() const { return detail::ClampStages(ubStages, UB_STAGES); }
+    };
+
+    using Params = ParamsBase<IsDynamic>;
+
+    CATLASS_DEVICE
+    CommBlockEpilogue(Catlass::Arch::Resource<ArchTag> &resource, Params const &params) : params(params)
+    {
+        ubStages = params.UbStages();
+        size_t ubOffset = 0;
+        uint32_t tileElems = params.TileShape().row() * params.TileShape().column();
+
+        for (uint32_t i = 0; i < ubStages; ++i) {
+            ubInList[i] = resource.ubBuf.template GetBufferByByte<ElementSrc>(ubOffset);
+            ubOffset += tileElems * sizeof(ElementSrc);
+        }
+        ubAcc = resource.ubBuf.template GetBufferByByte<ElementCompute>(ubOffset);
+        ubOffset += tileElems * sizeof(ElementCompute);
+        if constexpr (!std::is_same_v<ElementSrc, ElementCompute>) {
+            ubCast = resource.ubBuf.template GetBufferByByte<ElementCompute>(ubOffset);
+            ubOffset += tileElems * sizeof(ElementCompute);
+        }
+        if constexpr (!std::is_same_v<ElementDst, ElementCompute>) {
+            ubOut = resource.ubBuf.template GetBufferByByte<ElementDst>(ubOffset);
+            ubOffset += tileElems * sizeof(ElementDst);
+        }
+    }
+
+    CATLASS_DEVICE
+    void AllocEventID()
+    {
+        for (uint32_t i = 0; i < ubStages; ++i) {
+            inEventIdList[i] = i;
+            AscendC::SetFlag<AscendC::HardEvent::V_MTE2>(inEventIdList[i]);
+        }
+        AscendC::SetFlag<AscendC::HardEvent::MTE3_V>(outEventId);
+    }
+
+    CATLASS_DEVICE
+    void ReleaseEventID()
+    {
+        for (uint32_t i = 0; i < ubStages; ++i) {
+            AscendC::WaitFlag<AscendC::HardEvent::V_MTE2>(inEventIdList[i]);
+        }
+        AscendC::WaitFlag<AscendC::HardEvent::MTE3_V>(outEventId);
+        ubListId = 0;
+    }
+
+    CATLASS_DEVICE
+    ~CommBlockEpilogue()
+    {
+    }
+
+    /// Reduce one communication block: the partial owned by this rank is read from the workspace of
+    /// rank 0, 1, ..., rankSize - 1 in that order, summed in ElementCompute and written with a single
+    /// plain store, so the result does not depend on which peer finishes first. A split-K producer leaves
+    /// sliceCount partials per rank, sliceStrideRows rows of the workspace apart, they are added in rank
+    /// then slice order in the same pass. A non-zero rankStrideRows means the peers pushed their partials
+    /// into the local workspace, the one of rank r being r * rankStrideRows rows after inputBlockOffset.
+    CATLASS_DEVICE
+    void operator() (
+        MatrixCoord const &gemmBlockShape,
+        MatrixCoord const &outputBlockOffset,
+        MatrixCoord const &inputBlockOffset,
+        MatrixCoord const &commBlockShape,
+        AscendC::GlobalTensor<ElementDst> const &gmD,
+        LayoutDst const &layoutD,
+        uint32_t const &globalLoopIdx,
+        uint32_t const &rankSize,
+        uint32_t sliceCount = 1,
+        uint32_t sliceStrideRows = 0,
+        uint32_t rankStrideRows = 0)
+    {
+        // Remap the idx & actual shape of the gemm block
+        GemmCoord remapOutputBlockCoordMNK = params.gemmReMapper.GetBlockCoord(globalLoopIdx);
+        GemmCoord actualGemmBlockShapeMNK = params.gemmReMapper.GetActualBlockShape(remapOutputBlockCoordMNK);
+        MatrixCoord actualGemmBlockShape = actualGemmBlockShapeMNK.GetCoordMN();
+
+        // Calculate the offset within the block
+        MatrixCoord blockInnerOffset = outputBlockOffset % gemmBlockShape;
+        MatrixCoord outputBaseOffset = outputBlockOffset;
+        if constexpr (RemapOutput) {
+            outputBaseOffset = remapOutputBlockCoordMNK.GetCoordMN() * gemmBlockShape + blockInnerOffset;
+        }
+
+        // Get actual communication block shape
+        MatrixCoord actualCommBlockShape;
+        if (blockInnerOffset.row() < actualGemmBlockShape.row()) {
+            actualCommBlockShape = MatrixCoord::Min(actualGemmBlockShape - blockInnerOffset, commBlockShape);
+        } else {
+            return;
+        }
+
+        auto tileShape = params.TileShape();
+        EpilogueTileSwizzle epilogueTileSwizzle(actualCommBlockShape, tileShape);
+        uint32_t tileLoops = epilogueTileSwizzle.GetLoops();
+
+        for (uint32_t innerLoopIdx = 0; innerLoopIdx < tileLoops; innerLoopIdx++) {
+            auto tileCoord = epilogueTileSwizzle.GetTileCoord(innerLoopIdx);
+            auto actualTileShape = epilogueTileSwizzle.GetActualTileShape(tileCoord);
+            auto tileOffsetInBlock = tileCoord * tileShape;
+
+            auto inTileOffset = inputBlockOffset + tileOffsetInBlock;
+            auto outTileOffset = outputBaseOffset + tileOffsetInBlock;
+
+            // The whole UB row is reduced, only the actual columns are stored
+            uint32_t computeCount = actualTileShape.row() * tileShape.column();
+            auto layoutUb = LayoutSrc{actualTileShape.row(), actualTileShape.column(), tileShape.column()};
+            auto layoutUbOut = LayoutDst{actualTileShape.row(), actualTileShape.column(), tileShape.column()};
+            auto layoutSubblockS = params.shmemLayout.GetTileLayout(actualTileShape);
+            int64_t inTileOffsetLinear = params.shmemLayout.GetOffset(inTileOffset);
+            int64_t sliceStride = params.shmemLayout.GetOffset(MatrixCoord{sliceStrideRows, 0});
+            int64_t rankStride = params.shmemLayout.GetOffset(MatrixCoord{rankStrideRows, 0});
+
+            // The accumulator and the output buffer are reused only after the previous store is done
+            AscendC::WaitFlag<AscendC::HardEvent::MTE3_V>(outEventId);
+            AscendC::Duplicate(ubAcc, static_cast<ElementCompute>(0), computeCount);
+
+            // The loads run ubStages - 1 partials ahead of the adds, so the partial of the next rank or slice
+            // is in flight while the current one is accumulated. The adds keep the rank then slice order.
+            TileLoad load{inTileOffsetLinear, sliceStride, rankStride, layoutUb, layoutSubblockS, sliceCount,
+                rankStrideRows != 0, 0, 0, ubListId};
+            uint32_t loadCount = rankSize * sliceCount;
+            uint32_t prefetchCount = ubStages - 1;
+            for (uint32_t loadIdx = 0; loadIdx < prefetchCount && loadIdx < loadCount; ++loadIdx) {
+                LoadNextPartial(load);
+            }
+            for (uint32_t loadIdx = 0; loadIdx < loadCount; ++loadIdx) {
+                if (loadIdx + prefetchCount < loadCount) {
+                    LoadNextPartial(load);
+                }
+                AscendC::WaitFlag<AscendC::HardEvent::MTE2_V>(inEventIdList[ubListId]);
+
+                AscendC::PipeBarrier<PIPE_V>();
+                if constexpr (std::is_same_v<ElementSrc, ElementCompute>) {
+                    AscendC::Add(ubAcc, ubAcc, ubInList[ubListId], computeCount);
+                } else {
+                    AscendC::Cast(ubCast, ubInList[ubListId], AscendC::RoundMode::CAST_NONE, computeCount);
+                    AscendC::PipeBarrier<PIPE_V>();
+                    AscendC::Add(ubAcc, ubAcc, ubCast, computeCount);
+                }
+
+                AscendC::SetFlag<AscendC::HardEvent::V_MTE2>(inEventIdList[ubListId]);
+                ubListId = (ubListId + 1 < ubStages) ? (ubListId + 1) : 0;
+            }
+
+            AscendC::PipeBarrier<PIPE_V>();
+            AscendC::LocalTensor<ElementDst> ubStore;
+            if constexpr (std::is_same_v<ElementDst, ElementCompute>) {
+                ubStore = ubAcc;
+            } else {
+                AscendC::Cast(ubOut, ubAcc, AscendC::RoundMode::CAST_RINT, computeCount);
+                ubStore = ubOut;
+            }
+
+            AscendC::SetFlag<AscendC::HardEvent::V_MTE3>(outEventId);
+            AscendC::WaitFlag<AscendC::HardEvent::V_MTE3>(outEventId);
+            auto gmSubblockD = gmD[layoutD.GetOffset(outTileOffset)];
+            auto layoutSubblockD = layoutD.GetTileLayout(actualTileShape);
+            copyUbToGmDst(gmSubblockD, ubStore, layoutSubblockD, layoutUbOut);
+            AscendC::SetFlag<AscendC::HardEvent::MTE3_V>(outEventId);
+        }
+    }
+
+private:
+    /// Position of the next partial to load for the current tile
+    struct TileLoad {
+        int64_t tileOffset;
+        int64_t sliceStride;
+        int64_t rankStride;
+        LayoutSrc layoutUb;
+        LayoutSrc layoutSrc;
+        uint32_t sliceCount;
+        bool pushed;
+        uint32_t rankIdx;
+        uint32_t sliceIdx;
+        uint32_t listId;
+    };
+
+    /// Starts the copy of the next partial into the next UB stage, once the add reading that stage is done
+    CATLASS_DEVICE
+    void LoadNextPartial(TileLoad &load)
+    {
+        AscendC::GlobalTensor<ElementSrc> gmS;
+        if (load.pushed) {
+            gmS.SetGlobalBuffer(reinterpret_cast<__gm__ ElementSrc *>(params.shmemPtr));
+        } else {
+            gmS.SetGlobalBuffer(reinterpret_cast<__gm__ ElementSrc *>(
+                shmem_ptr(params.shmemPtr, static_cast<int>(load.rankIdx))));
+        }
+        int64_t offset = load.tileOffset + load.rankIdx * load.rankStride + load.sliceIdx * load.sliceStride;
+
+        AscendC::WaitFlag<AscendC::HardEvent::V_MTE2>(inEventIdList[load.listId]);
+        copyGmToUbSrc(ubInList[load.listId], gmS[offset], load.layoutUb, load.layoutSrc);
+        AscendC::SetFlag<AscendC::HardEvent::MTE2_V>(inEventIdList[load.listId]);
+
+        load.listId = (load.listId + 1 < ubStages) ? (load.listId + 1) : 0;
+        if (++load.sliceIdx == load.sliceCount) {
+            load.sliceIdx = 0;
+            ++load.rankIdx;
+        }
+    }
+
+    Params params;
+    AscendC::LocalTensor<ElementSrc> ubInList[UB_STAGES];
+    AscendC::LocalTensor<ElementCompute> ubAcc;
+    AscendC::LocalTensor<ElementCompute> ubCast;
+    AscendC::LocalTensor<ElementDst> ubOut;
+    uint32_t inEventIdList[UB_STAGES];
+    uint32_t outEventId{0};
+    uint32_t ubStages{UB_STAGES};
+    uint32_t ubListId{0};
+    CopyGmToUbSrc copyGmToUbSrc;
+    CopyUbToGmDst copyUbToGmDst;
+};
+
+} // namespace Catcoc::CommEpilogue::Block
+
+#endif  // CATCOC_COMM_EPILOGUE_BLOCK_EPILOGUE_REDUCE_DETERMINISTIC_HPP
@@ -13,6 +13,7 @@
 
 #include "catcoc/catcoc.hpp"
 #include "catcoc/comm_epilogue/comm_dispatch_policy.hpp"
+#include "catcoc/detail/pipeline_stages.hpp"
 #include "catcoc/detail/remote_copy_type.hpp"
 
 // from catlass
@@ -54,6 +55,7 @@ public:
     // Type aliases
     using DispatchPolicy = EpilogueAtlasA2CommToLocalMem<UB_STAGES_, CopyMode_, IsDynamic_>;
     static constexpr uint32_t UB_STAGES = UB_STAGES_;
+    static_assert(UB_STAGES >= 1 && UB_STAGES <= detail::MAX_UB_STAGES, "Each UB stage needs its own event ID.");
     static constexpr bool IsDynamic = IsDynamic_;
     using ArchTag = typename DispatchPolicy::ArchTag;
     using ElementSrc = typename SrcType_::Element;
@@ -93,6 +95,8 @@ public:
         static MatrixCoord BlockShape() { return BlockShape::ToCoord(); }
         CATLASS_DEVICE
         static MatrixCoord TileShape() { return TileShape::ToCoord(); }
+        CATLASS_DEVICE
+        static uint32_t UbStages() { return UB_STAGES; }
     };
 
     template <>
@@ -102,16 +106,18 @@ public:
         GemmReMapper gemmReMapper;
         MatrixCoord coreSplit;
         MatrixCoord blockShape;
-        MatrixCoord tileShape; 
+        MatrixCoord tileShape;
+        // UB buffers used at runtime, at most UB_STAGES
+        uint32_t ubStages{UB_STAGES};
 
         CATLASS_HOST_DEVICE
         ParamsBase() {}
 
         CATLASS_HOST_DEVICE
         ParamsBase(__gm__ ElementDst *shmemPtr_, LayoutDst const &shmemLayout_, GemmReMapper const gemmReMapper_,
-            MatrixCoord coreSplit_, MatrixCoord blockShape_, MatrixCoord tileShape_)
+            MatrixCoord coreSplit_, MatrixCoord blockShape_, MatrixCoord tileShape_, uint32_t ubStages_ = UB_STAGES)
             : shmemPtr(shmemPtr_), shmemLayout(shmemLayout_), gemmReMapper(gemmReMapper_),
-              coreSplit(coreSplit_), blockShape(blockShape_), tileShape(tileShape_) {}
+              coreSplit(coreSplit_), blockShape(blockShape_), tileShape(tileShape_), ubStages(ubStages_) {}
 
         CATLASS_DEVICE
         MatrixCoord CoreSplit() const { return coreSplit; }
@@ -119,6 +125,8 @@ public:
         MatrixCoord BlockShape() const { return blockShape; }
         CATLASS_DEVICE
         MatrixCoord TileShape() const { return tileShape; }
+        CATLASS_DEVICE
+        uint32_t UbStages() const { return detail::ClampStages(ubStages, UB_STAGES); }
     };
 
     using Params = ParamsBase<IsDynamic>;
@@ -126,9 +134,10 @@ public:
     CATLASS_DEVICE
     CommBlockEpilogue(Catlass::Arch::Resource<ArchTag> &resource, Params const &params) : params(params)
     {
+        ubStages = params.UbStages();
         size_t ubOffset = 0;
 
-        for (uint32_t i = 0; i < UB_STAGES; ++i) {
+        for (uint32_t i = 0; i < ubStages; ++i) {
             ubSList[i] = resource.ubBuf.template GetBufferByByte<ElementDst>(ubOffset);
             ubOffset += params.TileShape().row() * params.TileShape().column() * sizeof(ElementDst);
         }
@@ -138,7 +147,7 @@ public:
     void AllocEventID()
     {
         uint32_t copyEventId = 0;
-        for (uint32_t i = 0; i < UB_STAGES; ++i) {
+        for (uint32_t i = 0; i < ubStages; ++i) {
             copyEventIdList[i] = copyEventId++;
             AscendC::SetFlag<AscendC::HardEvent::MTE3_MTE2>(copyEventIdList[i]);
         }
@@ -147,7 +156,7 @@ public:
     CATLASS_DEVICE
     void ReleaseEventID()
     {
-        for (uint32_t i = 0; i < UB_STAGES; ++i) {
+        for (uint32_t i = 0; i < ubStages; ++i) {
             AscendC::WaitFlag<AscendC::HardEvent::MTE3_MTE2>(copyEventIdList[i]);
         }
         ubListId = 0;
@@ -219,7 +228,7 @@ public:
                 rankIdx
             );
             AscendC::SetFlag<AscendC::HardEvent::MTE3_MTE2>(copyEventIdList[ubListId]);
-            ubListId = (ubListId + 1 < UB_STAGES) ? (ubListId + 1) : 0;
+            ubListId = (ubListId + 1 < ubStages) ? (ubListId + 1) : 0;
         }
     }
 
@@ -227,6 +236,7 @@ private:
     Params params;
     AscendC::LocalTensor<ElementDst> ubSList[UB_STAGES];
     uint32_t copyEventIdList[UB_STAGES];
+    uint32_t ubStages{UB_STAGES};
     uint32_t ubListId{0};
     TileRemoteCopy tileRemoteCopy;
 };
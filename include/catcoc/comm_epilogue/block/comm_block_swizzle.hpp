@@ -12,6 +12,7 @@
 #define CATCOC_COMM_EPILOGUE_BLOCK_SWIZZLE_HPP
 
 #include "catcoc/catcoc.hpp"
+#include "catcoc/detail/fast_divisor.hpp"
 #include "catcoc/detail/remote_copy_type.hpp"
 
 // from catlass
@@ -22,9 +23,14 @@ namespace Catcoc::CommEpilogue::Block {
 
 using Catlass::MatrixCoord;
 
-template <uint32_t SWIZZLE_DIRECTION_ = 0, bool IS_DETERMINISTIC_ = false>
+template <uint32_t SWIZZLE_DIRECTION_ = 0, bool IS_DETERMINISTIC_ = false, uint32_t RANK_SIZE_ = 0>
 struct BlockCommSwizzle {
     static constexpr uint32_t SWIZZLE_DIRECTION = SWIZZLE_DIRECTION_;
+    // Rank count fixed at compile time, 0 reads it at runtime. The task index math divides by it for
+    // every comm block, a constant turns those divisions into shifts and masks
+    static constexpr uint32_t RANK_SIZE = RANK_SIZE_;
+    // In deterministic mode a task is a data block of the current rank, and the rank dimension is
+    // reduced in a fixed order inside the epilogue instead of being spread over tasks
     static constexpr uint32_t IS_DETERMINISTIC = IS_DETERMINISTIC_;
 
     static_assert((IS_DETERMINISTIC && SWIZZLE_DIRECTION == 0) || !IS_DETERMINISTIC, 
@@ -40,21 +46,28 @@ struct BlockCommSwizzle {
     MatrixCoord coreSplit;
     MatrixCoord blockShape;
 
-    CATLASS_DEVICE
+    detail::RankDivisor<RANK_SIZE> rankDivisor;
+    detail::FastDivisor swizzleDivisor;
+    detail::FastDivisor tileBlockDivisor;
+    detail::FastDivisor coreLoopDivisor;
+
+    CATLASS_HOST_DEVICE
     BlockCommSwizzle() {}
 
-    template <detail::CopyMode CopyMode_, detail::CopyDirect CopyDirect_>
-    CATLASS_DEVICE
+    /// Scheduler of a launch on launchCoreNum blocks. Host code builds it the same way to inspect or
+    /// precompute the schedule the kernel will walk. The core split is a tuning choice checked on the host,
+    /// it must fit in the launch, otherwise the tasks of the missing cores would never run.
+    CATLASS_HOST_DEVICE
     BlockCommSwizzle(uint32_t curRankIdx_, uint32_t rankSize_, MatrixCoord const &coreSplit_,
-        MatrixCoord const &problemSize_, MatrixCoord const &blockShape_)
-        : curRankIdx(curRankIdx_), rankSize(rankSize_), coreSplit(coreSplit_),
-          problemSize(problemSize_), blockShape(blockShape_)
+        uint32_t launchCoreNum)
+        : rankSize(rankSize_), curRankIdx(curRankIdx_), coreSplit(coreSplit_)
     {
         // deterministic calculation does not allow npu split
         if constexpr (IS_DETERMINISTIC) {
             coreSplit = MatrixCoord{coreSplit.row() * coreSplit.column(), 1};
         }
-        
+        assert(coreSplit.row() * coreSplit.column() <= launchCoreNum);
+
         if constexpr (SWIZZLE_DIRECTION == 0) {
             swizzleOffset = coreSplit.row();
         } else {
@@ -62,71 +75,81 @@ struct BlockCommSwizzle {
         }
         rankLoops = rankSize;
         nStride = rankSize / coreSplit.column();
-        MatrixCoord dataLoopsMx = CeilDiv(problemSize, blockShape);
-        if constexpr (CopyMode_ == detail::CopyMode::P2P) {
-            dataLoopsInRank = dataLoopsMx.row() * dataLoopsMx.column();
-        } else {
-            dataLoopsInRank = CeilDiv(dataLoopsMx.row() * dataLoopsMx.column(), rankSize);
-        }
+        // Data loops are set by Update once the shape of the comm stage is known
+        dataLoopsInRank = 0;
+        InitDivisors();
     }
 
+#if defined(__CCE__)
+    template <detail::CopyMode CopyMode_, detail::CopyDirect CopyDirect_>
     CATLASS_DEVICE
     BlockCommSwizzle(uint32_t curRankIdx_, uint32_t rankSize_, MatrixCoord const &coreSplit_,
-        MatrixCoord const &problemSize_, MatrixCoord const &blockShape_, uint32_t dataLoopsInRank_)
-        : curRankIdx(curRankIdx_), rankSize(rankSize_), coreSplit(coreSplit_),
-          problemSize(problemSize_), blockShape(blockShape_), dataLoopsInRank(dataLoopsInRank_)
+        MatrixCoord const &problemSize_, MatrixCoord const &blockShape_)
+        : BlockCommSwizzle(curRankIdx_, rankSize_, coreSplit_, AscendC::GetBlockNum())
     {
-        // deterministic calculation does not allow npu split
-        if constexpr (IS_DETERMINISTIC) {
-            coreSplit = MatrixCoord{coreSplit.row() * coreSplit.column(), 1};
-        }
+        Update<CopyMode_, CopyDirect_>(problemSize_, blockShape_);
+    }
 
-        if constexpr (SWIZZLE_DIRECTION == 0) {
-            swizzleOffset = coreSplit.row();
-        } else {
-            swizzleOffset = coreSplit.column();
-        }
-        rankLoops = rankSize;
-        nStride = rankSize / coreSplit.column();
+    CATLASS_DEVICE
+    BlockCommSwizzle(uint32_t curRankIdx_, uint32_t rankSize_, MatrixCoord const &coreSplit_,
+        MatrixCoord const &problemSize_, MatrixCoord const &blockShape_, uint32_t dataLoopsInRank_)
+        : BlockCommSwizzle(curRankIdx_, rankSize_, coreSplit_, AscendC::GetBlockNum())
+    {
+        Update(problemSize_, blockShape_, dataLoopsInRank_);
     }
 
     CATLASS_DEVICE
     BlockCommSwizzle(uint32_t curRankIdx_, uint32_t rankSize_, MatrixCoord const &coreSplit_)
-        : curRankIdx(curRankIdx_), rankSize(rankSize_), coreSplit(coreSplit_)
-    {
-        // deterministic calculation does not allow npu split
-        if constexpr (IS_DETERMINISTIC) {
-            coreSplit = MatrixCoord{coreSplit.row() * coreSplit.column(), 1};
-        }
+        : BlockCommSwizzle(curRankIdx_, rankSize_, coreSplit_, AscendC::GetBlockNum()) {}
+#endif
 
+    /// Divisors of the task index math, rebuilt whenever the loop counts change
+    CATLASS_HOST_DEVICE
+    void InitDivisors()
+    {
+        rankDivisor = detail::RankDivisor<RANK_SIZE>(rankLoops);
+        swizzleDivisor = detail::FastDivisor(swizzleOffset);
+        coreLoopDivisor = detail::FastDivisor(GetCoreLoop());
         if constexpr (SWIZZLE_DIRECTION == 0) {
-            swizzleOffset = coreSplit.row();
+            tileBlockDivisor = detail::FastDivisor(swizzleOffset * rankLoops);
         } else {
-            swizzleOffset = coreSplit.column();
+            tileBlockDivisor = detail::FastDivisor(swizzleOffset * dataLoopsInRank);
         }
-        rankLoops = rankSize;
-        nStride = rankSize / coreSplit.column();
     }
 
-    CATLASS_DEVICE
+    CATLASS_HOST_DEVICE
+    uint32_t RankDiv(uint32_t value) const
+    {
+        return rankDivisor.Div(value);
+    }
+
+    CATLASS_HOST_DEVICE
+    uint32_t RankMod(uint32_t value) const
+    {
+        return rankDivisor.Mod(value);
+    }
+
+    CATLASS_HOST_DEVICE
     uint32_t GetCoreLoop() const
     {
         if constexpr (IS_DETERMINISTIC) {
-            return RoundUp<uint32_t>(dataLoopsInRank, coreSplit.row()) * rankLoops;
+            // One task per data block, the epilogue walks over the ranks in a fixed order
+            return dataLoopsInRank;
         } else {
             return dataLoopsInRank * rankLoops;
         }
     }
 
-    CATLASS_DEVICE
+    CATLASS_HOST_DEVICE
     void Update(MatrixCoord const &problemSize_, MatrixCoord const &blockShape_, uint32_t dataLoopsInRank_) {
         problemSize = problemSize_;
         blockShape = blockShape_;
         dataLoopsInRank = dataLoopsInRank_;
+        InitDivisors();
     }
 
     template <detail::CopyMode CopyMode_, detail::CopyDirect CopyDirect_>
-    CATLASS_DEVICE
+    CATLASS_HOST_DEVICE
     void Update(MatrixCoord const &problemSize_, MatrixCoord const &blockShape_) {
         problemSize = problemSize_;
         blockShape = blockShape_;
@@ -136,49 +159,60 @@ struct BlockCommSwizzle {
         } else {
             dataLoopsInRank = CeilDiv(dataLoopsMx.row() * dataLoopsMx.column(), rankSize);
         }
+        InitDivisors();
     }
 
-    CATLASS_DEVICE
+    CATLASS_HOST_DEVICE
     uint32_t GetRealCore() const
     {
         return coreSplit.row() * coreSplit.column();
     }
 
-    CATLASS_DEVICE
+    CATLASS_HOST_DEVICE
     MatrixCoord GetBlockIdx(uint32_t taskIdx) const {
-        uint32_t innerIdx = taskIdx % GetCoreLoop();
-        if constexpr (SWIZZLE_DIRECTION == 0) { // Zn
-            uint32_t tileBlockLoop = CeilDiv(dataLoopsInRank, swizzleOffset);
-            uint32_t tileBlockIdx = innerIdx / (swizzleOffset * rankLoops);
-            uint32_t inTileBlockIdx = innerIdx % (swizzleOffset * rankLoops);
-
-            uint32_t nRow = swizzleOffset;
-            if constexpr (!IS_DETERMINISTIC) {
-                if (tileBlockIdx == tileBlockLoop - 1) {
-                    nRow = dataLoopsInRank - swizzleOffset * tileBlockIdx;
-                }
+        uint32_t innerIdx = coreLoopDivisor.Mod(taskIdx);
+        if constexpr (IS_DETERMINISTIC) {
+            return MatrixCoord{innerIdx, curRankIdx};
+        } else if constexpr (SWIZZLE_DIRECTION == 0) { // Zn
+            uint32_t tileBlockLoop = swizzleDivisor.Div(dataLoopsInRank + swizzleOffset - 1);
+            uint32_t tileBlockIdx = tileBlockDivisor.Div(innerIdx);
+            uint32_t inTileBlockIdx = tileBlockDivisor.Mod(innerIdx);
+
+            // Only the last tile block may be narrower than swizzleOffset
+            uint32_t dataIdx;
+            uint32_t rankIdx;
+            if (tileBlockIdx == tileBlockLoop - 1 && dataLoopsInRank != swizzleOffset * tileBlockLoop) {
+                uint32_t nRow = dataLoopsInRank - swizzleOffset * tileBlockIdx;
+                dataIdx = tileBlockIdx * swizzleOffset + inTileBlockIdx % nRow;
+                rankIdx = inTileBlockIdx / nRow;
+            } else {
+                dataIdx = tileBlockIdx * swizzleOffset + swizzleDivisor.Mod(inTileBlockIdx);
+                rankIdx = swizzleDivisor.Div(inTileBlockIdx);
             }
-            uint32_t dataIdx = tileBlockIdx * swizzleOffset + inTileBlockIdx % nRow;
-            uint32_t rankIdx = inTileBlockIdx / nRow;
-            
-            rankIdx = (rankIdx * nStride) % rankLoops + (rankIdx * nStride) / rankLoops;
-            rankIdx = (rankIdx + dataIdx) % rankLoops;
+
+            rankIdx = RankMod(rankIdx * nStride) + RankDiv(rankIdx * nStride);
+            rankIdx = RankMod(rankIdx + dataIdx);
 
             return MatrixCoord{dataIdx, rankIdx};
         } else if (SWIZZLE_DIRECTION == 1) { // Nz
-            uint32_t tileBlockLoop = CeilDiv(rankLoops, swizzleOffset);
-            uint32_t tileBlockIdx = innerIdx / (swizzleOffset * dataLoopsInRank);
-            uint32_t inTileBlockIdx = innerIdx % (swizzleOffset * dataLoopsInRank);
-
-            uint32_t nCol = swizzleOffset;
-            if (tileBlockIdx == tileBlockLoop - 1) {
-                nCol = rankLoops - swizzleOffset * tileBlockIdx;
+            uint32_t tileBlockLoop = swizzleDivisor.Div(rankLoops + swizzleOffset - 1);
+            uint32_t tileBlockIdx = tileBlockDivisor.Div(innerIdx);
+            uint32_t inTileBlockIdx = tileBlockDivisor.Mod(innerIdx);
+
+            // Only the last tile block may be narrower than swizzleOffset
+            uint32_t dataIdx;
+            uint32_t rankIdx;
+            if (tileBlockIdx == tileBlockLoop - 1 && rankLoops != swizzleOffset * tileBlockLoop) {
+                uint32_t nCol = rankLoops - swizzleOffset * tileBlockIdx;
+                dataIdx = inTileBlockIdx / nCol;
+                rankIdx = tileBlockIdx * swizzleOffset + inTileBlockIdx % nCol;
+            } else {
+                dataIdx = swizzleDivisor.Div(inTileBlockIdx);
+                rankIdx = tileBlockIdx * swizzleOffset + swizzleDivisor.Mod(inTileBlockIdx);
             }
-            uint32_t dataIdx = inTileBlockIdx / nCol;
-            uint32_t rankIdx = tileBlockIdx * swizzleOffset + inTileBlockIdx % nCol;
-            
-            rankIdx = (rankIdx * nStride) % rankLoops + (rankIdx * nStride) / rankLoops;
-            rankIdx = (rankIdx + dataIdx) % rankLoops;
+
+            rankIdx = RankMod(rankIdx * nStride) + RankDiv(rankIdx * nStride);
+            rankIdx = RankMod(rankIdx + dataIdx);
 
             return MatrixCoord{dataIdx, rankIdx};
         }
@@ -186,7 +220,7 @@ struct BlockCommSwizzle {
     }
 
     template <detail::CopyMode CopyMode_, detail::CopyDirect CopyDirect_>
-    CATLASS_DEVICE
+    CATLASS_HOST_DEVICE
     MatrixCoord GetBlockOffset(MatrixCoord blockIdx, layout::AffineRankN<3> layoutC) const {
         uint32_t dataIdx = blockIdx.row();
         uint32_t rankIdx;
@@ -201,7 +235,7 @@ struct BlockCommSwizzle {
     }
 
     template <detail::CopyMode CopyMode_, detail::CopyDirect CopyDirect_>
-    CATLASS_DEVICE
+    CATLASS_HOST_DEVICE
     MatrixCoord GetActualBlockShape(MatrixCoord blockIdx, layout::AffineRankN<3> layoutC) const
     {
         if (blockIdx.row() >= dataLoopsInRank) {
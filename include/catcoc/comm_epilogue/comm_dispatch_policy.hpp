@@ -24,6 +24,7 @@ struct EpilogueAtlasA2CommToShareMem {
     using ArchTag = Catlass::Arch::AtlasA2;
     static constexpr uint32_t UB_STAGES = UB_STAGES_;
     static constexpr bool IsDynamic = IsDynamic_;
+    static constexpr bool IsDeterministic = false;
 };
 
 
@@ -33,6 +34,20 @@ struct EpilogueAtlasA2CommToLocalMem {
     using ArchTag = Catlass::Arch::AtlasA2;
     static constexpr uint32_t UB_STAGES = UB_STAGES_;
     static constexpr bool IsDynamic = IsDynamic_;
+    static constexpr bool IsDeterministic = false;
+};
+
+// For AtlasA2, a deterministic reduce epilogue of the form D(local mem) = sum_r C_r(shared mem),
+// the partials of all ranks are accumulated in UB in a fixed rank order and stored once.
+// RemapOutput_ selects whether the output offset is remapped through the gemm scheduler (D is the
+// user output) or used as is (D is the local symmetric workspace).
+template <uint32_t UB_STAGES_, bool RemapOutput_ = true, bool IsDynamic_=false>
+struct EpilogueAtlasA2CommReduceDeterministic {
+    using ArchTag = Catlass::Arch::AtlasA2;
+    static constexpr uint32_t UB_STAGES = UB_STAGES_;
+    static constexpr bool RemapOutput = RemapOutput_;
+    static constexpr bool IsDynamic = IsDynamic_;
+    static constexpr bool IsDeterministic = true;
 };
 
 ///////////////////////////
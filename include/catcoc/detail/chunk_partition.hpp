@@ -0,0 +1,206 @@
+#ifndef CATCOC_DETAIL_CHUNK_PARTITION_HPP
+#define CATCOC_DETAIL_CHUNK_PARTITION_HPP
+
+#include "catlass/catlass.hpp"
+
+namespace Catcoc::detail {
+
+/// Chunk sizes of a comm pipeline that ramps up. The first chunk holds firstBlockPerComm blocks and each
+/// following chunk twice the previous one while that stays below blockPerComm, every chunk after the ramp
+/// holds blockPerComm and the last one whatever is left. The first comm phase can then start after a few
+/// blocks instead of a full chunk, while the steady chunks keep the barrier count of a uniform split.
+/// A firstBlockPerComm of 0 or not below blockPerComm gives uniform chunks.
+struct ChunkRamp {
+    uint32_t blockPerComm{1};
+    uint32_t firstBlockPerComm{1};
+    /// Chunks before the first one of blockPerComm blocks, and the blocks they hold
+    uint32_t rampCount{0};
+    uint32_t rampBlocks{0};
+
+    CATLASS_HOST_DEVICE
+    ChunkRamp() {}
+
+    CATLASS_HOST_DEVICE
+    ChunkRamp(uint32_t blockPerComm_, uint32_t firstBlockPerComm_ = 0)
+        : blockPerComm(blockPerComm_),
+          firstBlockPerComm((firstBlockPerComm_ == 0 || firstBlockPerComm_ > blockPerComm_) ?
+              blockPerComm_ : firstBlockPerComm_)
+    {
+        for (uint32_t size = firstBlockPerComm; size < blockPerComm; size *= 2) {
+            rampBlocks += size;
+            ++rampCount;
+        }
+    }
+
+    /// Blocks in the chunks before chunkIdx, not clipped to the blocks of the launch
+    CATLASS_HOST_DEVICE
+    uint32_t GetBegin(uint32_t chunkIdx) const
+    {
+        if (chunkIdx <= rampCount) {
+            return firstBlockPerComm * ((1U << chunkIdx) - 1);
+        }
+        return rampBlocks + (chunkIdx - rampCount) * blockPerComm;
+    }
+
+    /// Nominal size of chunkIdx, blockPerComm once the ramp is over
+    CATLASS_HOST_DEVICE
+    uint32_t GetSize(uint32_t chunkIdx) const
+    {
+        return (chunkIdx < rampCount) ? (firstBlockPerComm << chunkIdx) : blockPerComm;
+    }
+
+    CATLASS_HOST_DEVICE
+    uint32_t GetChunkCount(uint32_t totalBlocks) const
+    {
+        if (totalBlocks > rampBlocks) {
+            return rampCount + (totalBlocks - rampBlocks + blockPerComm - 1) / blockPerComm;
+        }
+        uint32_t chunkIdx = 0;
+        while (GetBegin(chunkIdx) < totalBlocks) {
+            ++chunkIdx;
+        }
+        return chunkIdx;
+    }
+
+    /// Blocks of chunkIdx when totalBlocks are split, only the last chunk may fall short of GetSize
+    CATLASS_HOST_DEVICE
+    uint32_t GetActualSize(uint32_t chunkIdx, uint32_t totalBlocks) const
+    {
+        uint32_t begin = GetBegin(chunkIdx);
+        uint32_t size = GetSize(chunkIdx);
+        return (begin + size <= totalBlocks) ? size : totalBlocks - begin;
+    }
+};
+
+/// Maps the blocks of one communication chunk to the ranks they are computed for.
+/// The `blockPerComm` slots of every chunk are dealt to ranks round robin, continuing where the previous
+/// chunk stopped, so each rank gets floor or ceil(blockPerComm / rankSize) blocks per chunk even when
+/// blockPerComm is not a multiple of rankSize, and no rank falls more than one block behind another.
+/// Inside a chunk the blocks of rank r are stored in segment r, every segment being GetMaxCount() blocks.
+/// With a ChunkRamp the slot count of a chunk follows the ramp, the largest chunk still has blockPerComm.
+struct ChunkPartition {
+    uint32_t rankSize{1};
+    uint32_t blockPerComm{1};
+    uint32_t loopsInRank{0};
+    ChunkRamp ramp;
+
+    CATLASS_HOST_DEVICE
+    ChunkPartition() {}
+
+    CATLASS_HOST_DEVICE
+    ChunkPartition(uint32_t rankSize_, uint32_t blockPerComm_, uint32_t loopsInRank_,
+        uint32_t firstBlockPerComm_ = 0)
+        : rankSize(rankSize_), blockPerComm(blockPerComm_), loopsInRank(loopsInRank_),
+          ramp(blockPerComm_, firstBlockPerComm_) {}
+
+    CATLASS_HOST_DEVICE
+    uint32_t GetChunkCount() const
+    {
+        return ramp.GetChunkCount(loopsInRank * rankSize);
+    }
+
+    /// Largest per-rank block count of any chunk, sizes the workspace segment of a rank
+    CATLASS_HOST_DEVICE
+    uint32_t GetSlotsInRank() const
+    {
+        return (blockPerComm + rankSize - 1) / rankSize;
+    }
+
+    /// Number of blocks of rankIdx dealt before chunkIdx, i.e. its first loop index in chunkIdx
+    CATLASS_HOST_DEVICE
+    uint32_t GetOffset(uint32_t rankIdx, uint32_t chunkIdx) const
+    {
+        uint32_t dealt = ramp.GetBegin(chunkIdx);
+        if (dealt <= rankIdx) {
+            return 0;
+        }
+        uint32_t done = (dealt - rankIdx + rankSize - 1) / rankSize;
+        return (done < loopsInRank) ? done : loopsInRank;
+    }
+
+    CATLASS_HOST_DEVICE
+    uint32_t GetCount(uint32_t rankIdx, uint32_t chunkIdx) const
+    {
+        return GetOffset(rankIdx, chunkIdx + 1) - GetOffset(rankIdx, chunkIdx);
+    }
+
+    /// Segment size of chunkIdx, equal to GetSlotsInRank() except for the ramp chunks and possibly the last one
+    CATLASS_HOST_DEVICE
+    uint32_t GetMaxCount(uint32_t chunkIdx) const
+    {
+        uint32_t maxCount = 0;
+        for (uint32_t rankIdx = 0; rankIdx < rankSize; ++rankIdx) {
+            uint32_t count = GetCount(rankIdx, chunkIdx);
+            maxCount = (count > maxCount) ? count : maxCount;
+        }
+        return maxCount;
+    }
+
+    /// Number of blocks actually computed in chunkIdx
+    CATLASS_HOST_DEVICE
+    uint32_t GetTotalCount(uint32_t chunkIdx) const
+    {
+        uint32_t total = 0;
+        for (uint32_t rankIdx = 0; rankIdx < rankSize; ++rankIdx) {
+            total += GetCount(rankIdx, chunkIdx);
+        }
+        return total;
+    }
+
+    /// Locates the blockIdx-th computed block of chunkIdx, ranks are visited in order
+    CATLASS_HOST_DEVICE
+    void Locate(uint32_t blockIdx, uint32_t chunkIdx, uint32_t &rankIdx, uint32_t &idxInRank) const
+    {
+        idxInRank = blockIdx;
+        for (rankIdx = 0; rankIdx < rankSize - 1; ++rankIdx) {
+            uint32_t count = GetCount(rankIdx, chunkIdx);
+            if (idxInRank < count) {
+                return;
+            }
+            idxInRank -= count;
+        }
+    }
+
+    /// Locates the blockIdx-th computed block of chunkIdx, the ranks take turns block by block. Comm tasks
+    /// walk a segment from its first block on, so the blocks of every segment come out in the order they
+    /// are read instead of one segment after another. The ranks holding one more block come last.
+    CATLASS_HOST_DEVICE
+    void LocateInterleaved(uint32_t blockIdx, uint32_t chunkIdx, uint32_t &rankIdx, uint32_t &idxInRank) const
+    {
+        uint32_t minCount = GetCount(0, chunkIdx);
+        for (rankIdx = 1; rankIdx < rankSize; ++rankIdx) {
+            uint32_t count = GetCount(rankIdx, chunkIdx);
+            minCount = (count < minCount) ? count : minCount;
+        }
+        if (blockIdx < minCount * rankSize) {
+            idxInRank = blockIdx / rankSize;
+            rankIdx = blockIdx % rankSize;
+            return;
+        }
+        idxInRank = minCount;
+        uint32_t rest = blockIdx - minCount * rankSize;
+        for (rankIdx = 0; rankIdx < rankSize - 1; ++rankIdx) {
+            if (GetCount(rankIdx, chunkIdx) > minCount) {
+                if (rest == 0) {
+                    return;
+                }
+                --rest;
+            }
+        }
+    }
+};
+
+/// ChunkPartition of a reduce-scatter whose blocks are cut into splitK K slices. A chunk deals 1 / splitK of
+/// the blocks of an unsplit one, so every core still computes about commInterval slices per chunk.
+CATLASS_HOST_DEVICE
+inline ChunkPartition MakeSplitKChunkPartition(uint32_t rankSize, uint32_t coreNum, uint32_t commInterval,
+    uint32_t firstCommInterval, uint32_t loopsInRank, uint32_t splitK)
+{
+    uint32_t blockPerComm = coreNum * commInterval / splitK;
+    return ChunkPartition(rankSize, (blockPerComm > 0) ? blockPerComm : 1, loopsInRank,
+        coreNum * firstCommInterval / splitK);
+}
+
+} // namespace Catcoc::detail
+
+#endif // CATCOC_DETAIL_CHUNK_PARTITION_HPP
@@ -0,0 +1,122 @@
+#ifndef CATCOC_DETAIL_FAST_DIVISOR_HPP
+#define CATCOC_DETAIL_FAST_DIVISOR_HPP
+
+#if !defined(__CCE__)
+#include <cassert>
+#endif
+
+#include "catlass/catlass.hpp"
+
+namespace Catcoc::detail {
+
+/// Runtime divisor of the scheduler index math. Division runs on the AI core scalar unit and stalls the
+/// queues it feeds, so a power of two divisor, the usual case for rank counts and tile counts, is turned
+/// into a shift and a mask once and every Div/Mod after that avoids the divide.
+struct FastDivisor {
+    uint32_t divisor{1};
+    uint32_t shift{0};
+    bool isPowerOfTwo{true};
+
+    CATLASS_HOST_DEVICE
+    FastDivisor() {}
+
+    CATLASS_HOST_DEVICE
+    explicit FastDivisor(uint32_t divisor_)
+        : divisor(divisor_), shift(0), isPowerOfTwo(divisor_ != 0 && (divisor_ & (divisor_ - 1)) == 0)
+    {
+        while (isPowerOfTwo && (1U << shift) < divisor) {
+            ++shift;
+        }
+    }
+
+    CATLASS_HOST_DEVICE
+    uint32_t Div(uint32_t value) const
+    {
+        return isPowerOfTwo ? (value >> shift) : (value / divisor);
+    }
+
+    CATLASS_HOST_DEVICE
+    uint32_t Mod(uint32_t value) const
+    {
+        return isPowerOfTwo ? (value & (divisor - 1)) : (value % divisor);
+    }
+};
+
+/// Rank count known at compile time when RANK_SIZE is not 0, the division and modulo by it then fold to
+/// shifts and masks for 2/4/8 ranks. RANK_SIZE == 0 keeps the count a runtime FastDivisor.
+/// A specialization only holds for launches on exactly RANK_SIZE ranks, hosts check it with Matches
+/// before launching and the constructor asserts it on the device.
+template <uint32_t RANK_SIZE>
+struct RankDivisor {
+    CATLASS_HOST_DEVICE
+    RankDivisor() {}
+
+    CATLASS_HOST_DEVICE
+    explicit RankDivisor(uint32_t rankSize)
+    {
+        assert(Matches(rankSize));
+    }
+
+    CATLASS_HOST_DEVICE
+    static constexpr bool Matches(uint32_t rankSize)
+    {
+        return rankSize == RANK_SIZE;
+    }
+
+    CATLASS_HOST_DEVICE
+    static constexpr uint32_t Get()
+    {
+        return RANK_SIZE;
+    }
+
+    CATLASS_HOST_DEVICE
+    static constexpr uint32_t Div(uint32_t value)
+    {
+        return value / RANK_SIZE;
+    }
+
+    CATLASS_HOST_DEVICE
+    static constexpr uint32_t Mod(uint32_t value)
+    {
+        return value % RANK_SIZE;
+    }
+};
+
+template <>
+struct RankDivisor<0> {
+    FastDivisor rankSize;
+
+    CATLASS_HOST_DEVICE
+    RankDivisor() {}
+
+    CATLASS_HOST_DEVICE
+    explicit RankDivisor(uint32_t rankSize_) : rankSize(rankSize_) {}
+
+    CATLASS_HOST_DEVICE
+    static constexpr bool Matches(uint32_t)
+    {
+        return true;
+    }
+
+    CATLASS_HOST_DEVICE
+    uint32_t Get() const
+    {
+        return rankSize.divisor;
+    }
+
+    CATLASS_HOST_DEVICE
+    uint32_t Div(uint32_t value) const
+    {
+        return rankSize.Div(value);
+    }
+
+    CATLASS_HOST_DEVICE
+    uint32_t Mod(uint32_t value) const
+    {
+        return rankSize.Mod(value);
+    }
+};
+
+} // namespace Catcoc::detail
+
+#endif // CATCOC_DETAIL_FAST_DIVISOR_HPP
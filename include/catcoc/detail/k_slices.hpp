@@ -0,0 +1,37 @@
+#ifndef CATCOC_DETAIL_K_SLICES_HPP
+#define CATCOC_DETAIL_K_SLICES_HPP
+
+#include "catlass/catlass.hpp"
+
+namespace Catcoc::detail {
+
+/// K of one matmul block cut into splitK slices. The kLoops tiles of the L1 K tile are spread evenly,
+/// so two slices differ by one tile at most and only the last one may end on a partial tile.
+struct KSlices {
+    uint32_t kLoops{1};
+    uint32_t splitK{1};
+
+    CATLASS_HOST_DEVICE
+    KSlices() {}
+
+    /// maxSplitK of 0 or 1 keeps the block whole, more slices than K tiles are not made
+    CATLASS_HOST_DEVICE
+    KSlices(uint32_t kLoops_, uint32_t maxSplitK) : kLoops(kLoops_)
+    {
+        splitK = (kLoops < maxSplitK) ? kLoops : maxSplitK;
+        splitK = (splitK > 1) ? splitK : 1;
+    }
+
+    /// K range of sliceIdx in elements, k is the K of the problem and kTile the L1 K tile
+    CATLASS_HOST_DEVICE
+    void GetSliceK(uint32_t sliceIdx, uint32_t kTile, uint32_t k, uint32_t &kOffset, uint32_t &kSize) const
+    {
+        kOffset = kLoops * sliceIdx / splitK * kTile;
+        uint32_t kEnd = kLoops * (sliceIdx + 1) / splitK * kTile;
+        kSize = ((kEnd < k) ? kEnd : k) - kOffset;
+    }
+};
+
+} // namespace Catcoc::detail
+
+#endif // CATCOC_DETAIL_K_SLICES_HPP
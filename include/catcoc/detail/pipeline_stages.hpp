@@ -0,0 +1,41 @@
+#ifndef CATCOC_DETAIL_PIPELINE_STAGES_HPP
+#define CATCOC_DETAIL_PIPELINE_STAGES_HPP
+
+#include "catlass/catlass.hpp"
+
+namespace Catcoc::detail {
+
+/// Each workspace stage takes one cross-core flag ID in each direction between AIC and AIV. IDs 0..7 are
+/// free, the IDs above are taken by the catlass inter-block barriers.
+constexpr uint32_t MAX_WORKSPACE_STAGES = 8;
+
+/// Each UB stage takes one event ID per hard event type, which provides 8 of them.
+constexpr uint32_t MAX_UB_STAGES = 8;
+
+/// UB capacity of one AIV on AtlasA2
+constexpr uint32_t UB_BYTES = 192 * 1024;
+
+/// Runtime depth of a pipeline compiled for at most maxStages stages, 0 selects the compiled depth
+CATLASS_HOST_DEVICE constexpr
+uint32_t ClampStages(uint32_t stages, uint32_t maxStages)
+{
+    return (stages == 0 || stages > maxStages) ? maxStages : stages;
+}
+
+CATLASS_HOST_DEVICE constexpr
+bool IsValidWorkspaceStages(uint32_t stages)
+{
+    return stages >= 1 && stages <= MAX_WORKSPACE_STAGES;
+}
+
+/// A UB pipeline of `stages` buffers of stageBytes each, next to fixedBytes of single buffered scratch
+CATLASS_HOST_DEVICE constexpr
+bool IsValidUbStages(uint32_t stages, uint32_t stageBytes, uint32_t fixedBytes = 0)
+{
+    return stages >= 1 && stages <= MAX_UB_STAGES &&
+        static_cast<uint64_t>(stages) * stageBytes + fixedBytes <= UB_BYTES;
+}
+
+} // namespace Catcoc::detail
+
+#endif // CATCOC_DETAIL_PIPELINE_STAGES_HPP
@@ -0,0 +1,47 @@
+#ifndef CATCOC_DETAIL_RANK_PARTITION_HPP
+#define CATCOC_DETAIL_RANK_PARTITION_HPP
+
+#include "catlass/catlass.hpp"
+
+namespace Catcoc::detail {
+
+/// Splits `total` rows over `rankSize` ranks without padding: the first `total % rankSize` ranks own
+/// ceil(total / rankSize) rows and the others own floor(total / rankSize) rows, stored back to back.
+struct RankPartition {
+    uint32_t total{0};
+    uint32_t rankSize{1};
+    uint32_t base{0};
+    uint32_t remain{0};
+
+    CATLASS_HOST_DEVICE
+    RankPartition() {}
+
+    CATLASS_HOST_DEVICE
+    RankPartition(uint32_t total_, uint32_t rankSize_)
+        : total(total_), rankSize(rankSize_), base(total_ / rankSize_), remain(total_ % rankSize_) {}
+
+    /// Number of rows owned by rankIdx
+    CATLASS_HOST_DEVICE
+    uint32_t GetExtent(uint32_t rankIdx) const
+    {
+        return base + ((rankIdx < remain) ? 1 : 0);
+    }
+
+    /// First row owned by rankIdx
+    CATLASS_HOST_DEVICE
+    uint32_t GetOffset(uint32_t rankIdx) const
+    {
+        return rankIdx * base + ((rankIdx < remain) ? rankIdx : remain);
+    }
+
+    /// Largest extent over all ranks, every rank walks a tile grid of this height
+    CATLASS_HOST_DEVICE
+    uint32_t GetMaxExtent() const
+    {
+        return base + ((remain > 0) ? 1 : 0);
+    }
+};
+
+} // namespace Catcoc::detail
+
+#endif // CATCOC_DETAIL_RANK_PARTITION_HPP
@@ -0,0 +1,71 @@
+#ifndef CATCOC_DETAIL_TAIL_SPLIT_HPP
+#define CATCOC_DETAIL_TAIL_SPLIT_HPP
+
+#include "catlass/catlass.hpp"
+
+#include "catcoc/detail/k_slices.hpp"
+
+namespace Catcoc::detail {
+
+/// Stream-K style split of the last comm chunk. When its tileCount blocks leave AI cores idle, every block
+/// is cut into splitK slices along K so that up to coreNum cores share the chunk, and the AIVs sum the
+/// slices before the chunk is communicated. Task t computes slice t / tileCount of block t % tileCount and
+/// stores it in slot t of the stage, slice 0 of every block thus lands where the unsplit block would.
+/// maxSplitK of 0 or 1 disables the split, so does a chunk that already keeps half of the cores busy.
+struct TailSplit {
+    uint32_t tileCount{0};
+    uint32_t kLoops{1};
+    uint32_t splitK{1};
+
+    CATLASS_HOST_DEVICE
+    TailSplit() {}
+
+    CATLASS_HOST_DEVICE
+    TailSplit(uint32_t tileCount_, uint32_t coreNum, uint32_t kLoops_, uint32_t maxSplitK)
+        : tileCount(tileCount_), kLoops(kLoops_)
+    {
+        if (tileCount == 0) {
+            return;
+        }
+        uint32_t idleSplit = coreNum / tileCount;
+        splitK = (maxSplitK < idleSplit) ? maxSplitK : idleSplit;
+        splitK = (kLoops < splitK) ? kLoops : splitK;
+        splitK = (splitK > 1) ? splitK : 1;
+    }
+
+    CATLASS_HOST_DEVICE
+    bool IsSplit() const
+    {
+        return splitK > 1;
+    }
+
+    /// Slots of the stage the split chunk fills, at most coreNum
+    CATLASS_HOST_DEVICE
+    uint32_t GetTaskCount() const
+    {
+        return tileCount * splitK;
+    }
+
+    CATLASS_HOST_DEVICE
+    uint32_t GetTileIdx(uint32_t taskIdx) const
+    {
+        return taskIdx % tileCount;
+    }
+
+    CATLASS_HOST_DEVICE
+    uint32_t GetSliceIdx(uint32_t taskIdx) const
+    {
+        return taskIdx / tileCount;
+    }
+
+    /// K range of sliceIdx in elements, see KSlices
+    CATLASS_HOST_DEVICE
+    void GetSliceK(uint32_t sliceIdx, uint32_t kTile, uint32_t k, uint32_t &kOffset, uint32_t &kSize) const
+    {
+        KSlices(kLoops, splitK).GetSliceK(sliceIdx, kTile, k, kOffset, kSize);
+    }
+};
+
+} // namespace Catcoc::detail
+
+#endif // CATCOC_DETAIL_TAIL_SPLIT_HPP
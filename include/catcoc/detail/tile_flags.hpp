@@ -0,0 +1,53 @@
+#ifndef CATCOC_DETAIL_TILE_FLAGS_HPP
+#define CATCOC_DETAIL_TILE_FLAGS_HPP
+
+#include <cstddef>
+
+#include "catlass/catlass.hpp"
+
+namespace Catcoc::detail {
+
+/// Ready flags of the tiles a comm kernel stages, one per slot of every stage, placed after the staged
+/// tiles of the workspace. A flag owns a whole cache line, so the AIC flushing it never writes back a
+/// neighbour that a peer is polling.
+struct TileFlagsLayout {
+    static constexpr uint32_t FLAG_BYTES = 64;
+
+    /// Workspace bytes taken by the staged tiles
+    size_t stagedBytes{0};
+    uint32_t slotsPerStage{0};
+    /// Stages the launch actually uses, at most workspaceStages
+    uint32_t stages{0};
+
+    CATLASS_HOST_DEVICE
+    TileFlagsLayout() {}
+
+    CATLASS_HOST_DEVICE
+    TileFlagsLayout(size_t stagedBytes_, uint32_t slotsPerStage_, uint32_t stages_)
+        : stagedBytes(stagedBytes_), slotsPerStage(slotsPerStage_), stages(stages_) {}
+
+    CATLASS_HOST_DEVICE
+    uint32_t GetFlagCount() const
+    {
+        return slotsPerStage * stages;
+    }
+
+    /// Byte offset of the flag of slotIdx in stageId from the workspace base
+    CATLASS_HOST_DEVICE
+    size_t GetOffset(uint32_t stageId, uint32_t slotIdx) const
+    {
+        size_t base = (stagedBytes + FLAG_BYTES - 1) / FLAG_BYTES * FLAG_BYTES;
+        return base + (static_cast<size_t>(stageId) * slotsPerStage + slotIdx) * FLAG_BYTES;
+    }
+
+    /// Workspace bytes of the staged tiles followed by the flags
+    CATLASS_HOST_DEVICE
+    size_t GetWorkspaceSize() const
+    {
+        return (GetFlagCount() == 0) ? stagedBytes : GetOffset(stages, 0);
+    }
+};
+
+} // namespace Catcoc::detail
+
+#endif // CATCOC_DETAIL_TILE_FLAGS_HPP
@@ -0,0 +1,173 @@
+#ifndef CATCOC_DGEMM_BLOCK_SPLITK_REDUCE_HPP
+#define CATCOC_DGEMM_BLOCK_SPLITK_REDUCE_HPP
+
+#include <type_traits>
+
+#include "catcoc/catcoc.hpp"
+
+// from catlass
+#include "catlass/arch/resource.hpp"
+
+namespace Catcoc::DGemm::Block {
+
+/// Sums the K slices of a split-K matmul, the counterpart of Catlass::Gemm::Kernel::ReduceAdd for slices
+/// stored in the matmul output type. Slice s of elementCount elements starts at s * elementCount and the
+/// sum overwrites slice 0. Floating point slices are summed in fp32, in slice order, so the result does
+/// not depend on the core count. Every AIV of the launch takes a share of the elements. The slices are
+/// loaded into two UB buffers in turn, one slice ahead of the adds, the catlass ReduceAdd only covers fp32
+/// slices.
+template <
+    class ArchTag_,
+    class ElementC_,
+    uint32_t COMPUTE_LENGTH_ = 4096
+>
+class BlockSplitkReduce {
+public:
+    using ArchTag = ArchTag_;
+    using ElementC = ElementC_;
+    static constexpr uint32_t COMPUTE_LENGTH = COMPUTE_LENGTH_;
+    using ElementCompute = std::conditional_t<std::is_same_v<ElementC, int32_t>, int32_t, float>;
+
+    static constexpr uint32_t IN_STAGES = 2;
+
+    static_assert(COMPUTE_LENGTH * ((IN_STAGES + 1) * sizeof(ElementC) + 2 * sizeof(ElementCompute)) <=
+        ArchTag::UB_SIZE, "Exceeding the UB space!");
+
+    CATLASS_DEVICE
+    BlockSplitkReduce(Catlass::Arch::Resource<ArchTag> &resource)
+    {
+        size_t ubOffset = 0;
+        for (uint32_t i = 0; i < IN_STAGES; ++i) {
+            ubInList[i] = resource.ubBuf.template GetBufferByByte<ElementC>(ubOffset);
+            ubOffset += COMPUTE_LENGTH * sizeof(ElementC);
+        }
+        ubAcc = resource.ubBuf.template GetBufferByByte<ElementCompute>(ubOffset);
+        ubOffset += COMPUTE_LENGTH * sizeof(ElementCompute);
+        if constexpr (!std::is_same_v<ElementC, ElementCompute>) {
+            ubCast = resource.ubBuf.template GetBufferByByte<ElementCompute>(ubOffset);
+            ubOffset += COMPUTE_LENGTH * sizeof(ElementCompute);
+            ubOut = resource.ubBuf.template GetBufferByByte<ElementC>(ubOffset);
+            ubOffset += COMPUTE_LENGTH * sizeof(ElementC);
+        }
+    }
+
+    /// Shares the UB with the comm epilogues, none of them may hold buffers or event IDs across the call
+    CATLASS_DEVICE
+    void operator()(AscendC::GlobalTensor<ElementC> const &gmSlices, uint64_t elementCount, uint32_t splitK)
+    {
+        uint32_t aivNum = AscendC::GetBlockNum() * AscendC::GetSubBlockNum();
+        uint32_t aivIdx = AscendC::GetBlockIdx();
+        uint64_t loops = (elementCount + COMPUTE_LENGTH - 1) / COMPUTE_LENGTH;
+
+        for (uint32_t i = 0; i < IN_STAGES; ++i) {
+            AscendC::SetFlag<AscendC::HardEvent::V_MTE2>(i);
+        }
+        AscendC::SetFlag<AscendC::HardEvent::MTE3_V>(EVENT_ID0);
+        // The load of the next slice, or of the first slice of the next share, is issued before the add of the
+        // current one waits for its data
+        SliceLoad load{gmSlices, elementCount, loops, splitK, aivNum, aivIdx, 0, 0};
+        uint32_t listId = 0;
+        if (load.loopIdx < loops) {
+            LoadNextSlice(load);
+        }
+        for (uint64_t loopIdx = aivIdx; loopIdx < loops; loopIdx += aivNum) {
+            uint64_t offset = loopIdx * COMPUTE_LENGTH;
+            uint32_t count = (loopIdx == loops - 1) ? static_cast<uint32_t>(elementCount - offset) : COMPUTE_LENGTH;
+
+            // The accumulator and the output buffer are reused only after the previous store is done
+            AscendC::WaitFlag<AscendC::HardEvent::MTE3_V>(EVENT_ID0);
+            AscendC::Duplicate(ubAcc, static_cast<ElementCompute>(0), count);
+            for (uint32_t sliceIdx = 0; sliceIdx < splitK; ++sliceIdx) {
+                if (load.loopIdx < loops) {
+                    LoadNextSlice(load);
+                }
+                AscendC::WaitFlag<AscendC::HardEvent::MTE2_V>(listId);
+
+                AscendC::PipeBarrier<PIPE_V>();
+                if constexpr (std::is_same_v<ElementC, ElementCompute>) {
+                    AscendC::Add(ubAcc, ubAcc, ubInList[listId], count);
+                } else {
+                    AscendC::Cast(ubCast, ubInList[listId], AscendC::RoundMode::CAST_NONE, count);
+                    AscendC::PipeBarrier<PIPE_V>();
+                    AscendC::Add(ubAcc, ubAcc, ubCast, count);
+                }
+                AscendC::SetFlag<AscendC::HardEvent::V_MTE2>(listId);
+                listId = (listId + 1 < IN_STAGES) ? (listId + 1) : 0;
+            }
+
+            AscendC::PipeBarrier<PIPE_V>();
+            AscendC::LocalTensor<ElementC> ubStore;
+            if constexpr (std::is_same_v<ElementC, ElementCompute>) {
+                ubStore = ubAcc;
+            } else {
+                AscendC::Cast(ubOut, ubAcc, AscendC::RoundMode::CAST_RINT, count);
+                ubStore = ubOut;
+            }
+            AscendC::SetFlag<AscendC::HardEvent::V_MTE3>(EVENT_ID0);
+            AscendC::WaitFlag<AscendC::HardEvent::V_MTE3>(EVENT_ID0);
+            CopyUbToGm(gmSlices[offset], ubStore, count);
+            AscendC::SetFlag<AscendC::HardEvent::MTE3_V>(EVENT_ID0);
+        }
+        for (uint32_t i = 0; i < IN_STAGES; ++i) {
+            AscendC::WaitFlag<AscendC::HardEvent::V_MTE2>(i);
+        }
+        AscendC::WaitFlag<AscendC::HardEvent::MTE3_V>(EVENT_ID0);
+    }
+
+private:
+    /// Position of the next slice to load, shares of COMPUTE_LENGTH elements are walked aivNum apart
+    struct SliceLoad {
+        AscendC::GlobalTensor<ElementC> gmSlices;
+        uint64_t elementCount;
+        uint64_t loops;
+        uint32_t splitK;
+        uint32_t aivNum;
+        uint64_t loopIdx;
+        uint32_t sliceIdx;
+        uint32_t listId;
+    };
+
+    /// Starts the copy of the next slice into the next UB buffer, once the add reading that buffer is done
+    CATLASS_DEVICE
+    void LoadNextSlice(SliceLoad &load)
+    {
+        uint64_t offset = load.loopIdx * COMPUTE_LENGTH;
+        uint32_t count = (load.loopIdx == load.loops - 1) ? static_cast<uint32_t>(load.elementCount - offset) :
+            COMPUTE_LENGTH;
+        AscendC::WaitFlag<AscendC::HardEvent::V_MTE2>(load.listId);
+        CopyGmToUb(ubInList[load.listId], load.gmSlices[load.sliceIdx * load.elementCount + offset], count);
+        AscendC::SetFlag<AscendC::HardEvent::MTE2_V>(load.listId);
+
+        load.listId = (load.listId + 1 < IN_STAGES) ? (load.listId + 1) : 0;
+        if (++load.sliceIdx == load.splitK) {
+            load.sliceIdx = 0;
+            load.loopIdx += load.aivNum;
+        }
+    }
+
+    CATLASS_DEVICE
+    void CopyGmToUb(AscendC::LocalTensor<ElementC> const &dst, AscendC::GlobalTensor<ElementC> const &src,
+        uint32_t count)
+    {
+        AscendC::DataCopyExtParams dataCopyParams(1, count * sizeof(ElementC), 0, 0, 0);
+        AscendC::DataCopyPadExtParams<ElementC> padParams(false, 0, 0, 0);
+        AscendC::DataCopyPad(dst, src, dataCopyParams, padParams);
+    }
+
+    CATLASS_DEVICE
+    void CopyUbToGm(AscendC::GlobalTensor<ElementC> const &dst, AscendC::LocalTensor<ElementC> const &src,
+        uint32_t count)
+    {
+        AscendC::DataCopyExtParams dataCopyParams(1, count * sizeof(ElementC), 0, 0, 0);
+        AscendC::DataCopyPad(dst, src, dataCopyParams);
+    }
+
+    AscendC::LocalTensor<ElementC> ubInList[IN_STAGES];
+    AscendC::LocalTensor<ElementCompute> ubAcc;
+    AscendC::LocalTensor<ElementCompute> ubCast;
+    AscendC::LocalTensor<ElementC> ubOut;
+};
+
+} // namespace Catcoc::DGemm::Block
+
+#endif // CATCOC_DGEMM_BLOCK_SPLITK_REDUCE_HPP
@@ -19,17 +19,22 @@
 #include "catlass/matrix_coord.hpp"
 #include "catlass/gemm/block/block_swizzle.hpp"
 
+#include "catcoc/catcoc.hpp"
+#include "catcoc/detail/fast_divisor.hpp"
+#include "catcoc/detail/rank_partition.hpp"
+
 namespace Catcoc::DGemm::Block {
 
 using Catlass::MatrixCoord;
 using Catlass::GemmCoord;
 
-/// Threadblock swizzling function for GEMMs
-template <uint32_t SwizzleOffset = 1, uint32_t SwizzleDirection = 0, uint32_t BufferNum = 1>
+/// Threadblock swizzling function for GEMMs, RANK_SIZE_ fixes the rank count at compile time when not 0
+template <uint32_t SwizzleOffset = 1, uint32_t SwizzleDirection = 0, uint32_t BufferNum = 1, uint32_t RANK_SIZE_ = 0>
 struct GemmIdentityBlockSwizzleAllGather :
     public Catlass::Gemm::Block::GemmIdentityBlockSwizzle<SwizzleOffset, SwizzleDirection> {
 
     using Base = Catlass::Gemm::Block::GemmIdentityBlockSwizzle<SwizzleOffset, SwizzleDirection>;
+    static constexpr uint32_t RANK_SIZE = RANK_SIZE_;
     ///
     /// Data members
     ///
@@ -39,6 +44,14 @@ struct GemmIdentityBlockSwizzleAllGather :
     MatrixCoord loopsMN;
     uint32_t rankSize;
     uint32_t mLoopsPerComm;
+    detail::RankPartition rankPartition;
+
+    // Divisors of the per task index math, the grid is fixed once constructed
+    uint32_t commCount;
+    detail::RankDivisor<RANK_SIZE> rankDivisor;
+    detail::FastDivisor commTaskDivisor;
+    detail::FastDivisor mLoopsPerRankDivisor;
+    detail::FastDivisor rankMLoopsDivisor;
 
     ///
     /// Methods
@@ -57,13 +70,38 @@ struct GemmIdentityBlockSwizzleAllGather :
           tileMN(tileMN_)
     {
         loopsMN = Base::loopsMN * MatrixCoord{rankSize, 1};
+        rankPartition = detail::RankPartition(problemShape.m(), rankSize);
+        InitDivisors();
     }
 
+    /// Ragged variant, problemShape_ is the gathered problem and rank r owns rankPartition_.GetExtent(r) rows.
+    /// Every rank walks the tile grid of the largest share, tiles past a rank's own rows get an empty shape.
+    CATLASS_DEVICE
+    GemmIdentityBlockSwizzleAllGather(detail::RankPartition const &rankPartition_, uint32_t pValue_,
+        GemmCoord const &problemShape_, MatrixCoord const &tileMN_)
+        : Base(GemmCoord{rankPartition_.GetMaxExtent(), problemShape_.n(), problemShape_.k()},
+            tileMN_),
+          rankSize(rankPartition_.rankSize), mLoopsPerComm(pValue_ * rankPartition_.rankSize),
+          rankPartition(rankPartition_), problemShape(problemShape_), tileMN(tileMN_)
+    {
+        loopsMN = Base::loopsMN * MatrixCoord{rankSize, 1};
+        InitDivisors();
+    }
+
+    CATLASS_DEVICE
+    void InitDivisors()
+    {
+        commCount = CeilDiv(loopsMN.row(), mLoopsPerComm);
+        rankDivisor = detail::RankDivisor<RANK_SIZE>(rankSize);
+        commTaskDivisor = detail::FastDivisor(mLoopsPerComm * Base::loopsMN.column());
+        mLoopsPerRankDivisor = detail::FastDivisor(mLoopsPerComm / rankSize);
+        rankMLoopsDivisor = detail::FastDivisor(Base::loopsMN.row());
+    }
 
     CATLASS_DEVICE
     uint32_t GetBatchIdx(uint32_t taskIdx) const 
     {
-        return Base::GetBatchIdx(taskIdx / rankSize);
+        return Base::GetBatchIdx(rankDivisor.Div(taskIdx));
     }
 
     CATLASS_DEVICE
@@ -87,13 +125,11 @@ struct GemmIdentityBlockSwizzleAllGather :
     CATLASS_DEVICE
     GemmCoord GetBlockCoord(uint32_t taskIdx) 
     {
-        uint32_t commCount = CeilDiv(loopsMN.row(), mLoopsPerComm);
-        uint32_t commIdx = taskIdx / (mLoopsPerComm * Base::loopsMN.column());
-        uint32_t inCommIdx = taskIdx % (mLoopsPerComm * Base::loopsMN.column());
+        uint32_t commIdx = commTaskDivisor.Div(taskIdx);
+        uint32_t inCommIdx = commTaskDivisor.Mod(taskIdx);
 
-        auto actualMLoops = 
-            (commIdx == commCount - 1) ? loopsMN.row() - commIdx * mLoopsPerComm : mLoopsPerComm;
-        auto actualMLoopsPerRank = actualMLoops / rankSize;
+        bool isLastComm = (commIdx == commCount - 1);
+        auto actualMLoops = isLastComm ? loopsMN.row() - commIdx * mLoopsPerComm : mLoopsPerComm;
 
         // 局部swizzle
         auto tmpMNLoops = Base::loopsMN;
@@ -101,18 +137,42 @@ struct GemmIdentityBlockSwizzleAllGather :
         auto coord = Base::GetBlockCoord(inCommIdx);
         Base::loopsMN = tmpMNLoops;
 
-        uint32_t rankIdx = coord.m() / actualMLoopsPerRank;
-        uint32_t m = rankIdx * Base::loopsMN.row() + commIdx * (mLoopsPerComm / rankSize) + coord.m() % actualMLoopsPerRank;
-        
+        // Only the last comm may hold fewer rows per rank than pValue
+        uint32_t rankIdx;
+        uint32_t mInRank;
+        if (isLastComm && actualMLoops != mLoopsPerComm) {
+            uint32_t actualMLoopsPerRank = rankDivisor.Div(actualMLoops);
+            rankIdx = coord.m() / actualMLoopsPerRank;
+            mInRank = coord.m() % actualMLoopsPerRank;
+        } else {
+            rankIdx = mLoopsPerRankDivisor.Div(coord.m());
+            mInRank = mLoopsPerRankDivisor.Mod(coord.m());
+        }
+        uint32_t m = rankIdx * Base::loopsMN.row() + commIdx * mLoopsPerRankDivisor.divisor + mInRank;
+
         return GemmCoord{m, coord.n(), coord.k()};
     }
 
     CATLASS_DEVICE
     GemmCoord GetActualBlockShape(GemmCoord blockTileOffset) 
     {
-        uint32_t mIdxInRank = blockTileOffset.m() % Base::loopsMN.row();
+        uint32_t rankIdx = rankMLoopsDivisor.Div(blockTileOffset.m());
+        uint32_t mIdxInRank = rankMLoopsDivisor.Mod(blockTileOffset.m());
         GemmCoord blockTileOffsetInRank(mIdxInRank, blockTileOffset.n(), blockTileOffset.k());
-        return Base::GetActualBlockShape(blockTileOffsetInRank);
+        GemmCoord actualBlockShape = Base::GetActualBlockShape(blockTileOffsetInRank);
+
+        // Clip to the rows owned by rankIdx, which may be one row less than the grid height
+        uint32_t mOffsetInRank = mIdxInRank * tileMN.row();
+        uint32_t extent = rankPartition.GetExtent(rankIdx);
+        uint32_t mActual = (mOffsetInRank < extent) ? Min(actualBlockShape.m(), extent - mOffsetInRank) : 0;
+        return GemmCoord{mActual, actualBlockShape.n(), actualBlockShape.k()};
+    }
+
+    /// First row of the gathered problem owned by rankIdx
+    CATLASS_DEVICE
+    uint32_t GetRankOffset(uint32_t rankIdx) const
+    {
+        return rankPartition.GetOffset(rankIdx);
     }
 };
 
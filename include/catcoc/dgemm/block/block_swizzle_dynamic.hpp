@@ -0,0 +1,151 @@
+#ifndef CATCOC_DGEMM_BLOCK_SWIZZLE_DYNAMIC_HPP
+#define CATCOC_DGEMM_BLOCK_SWIZZLE_DYNAMIC_HPP
+
+#include <type_traits>
+
+#include "catlass/catlass.hpp"
+#include "catlass/detail/alignment.hpp"
+#include "catlass/gemm_coord.hpp"
+#include "catlass/matrix_coord.hpp"
+
+#include "catcoc/catcoc.hpp"
+#include "catcoc/detail/fast_divisor.hpp"
+
+namespace Catcoc::DGemm::Block {
+
+using Catlass::MatrixCoord;
+using Catlass::GemmCoord;
+
+/// Tile order of GemmDynamicBlockSwizzle, the defaults give the order of GemmIdentityBlockSwizzle<7, 1>
+struct GemmSwizzle {
+    /// Tiles walked along the swizzled dimension before the walk moves on
+    uint32_t offset{7};
+    /// 0 walks offset rows of tiles across n (Zn), 1 walks offset columns of tiles across m (Nz)
+    uint32_t direction{1};
+};
+
+/// GemmIdentityBlockSwizzle with the swizzle offset and direction chosen at runtime. A kernel that uses it as
+/// the matmul scheduler must hand the same GemmSwizzle to the GemmReMapper of its comm epilogues, the
+/// epilogue finds the output of a tile by walking the tile order again.
+struct GemmDynamicBlockSwizzle {
+    /// Data members
+
+    GemmCoord problemShape;
+    MatrixCoord tileMN;
+    MatrixCoord loopsMN;
+    GemmSwizzle swizzle;
+
+    // Divisors of the per task index math, the grid is fixed once constructed
+    uint32_t tileBlockLoop{0};
+    detail::FastDivisor coreLoopsDivisor;
+    detail::FastDivisor tileBlockDivisor;
+    detail::FastDivisor offsetDivisor;
+    detail::FastDivisor tailDivisor;
+
+    /// Methods
+
+    CATLASS_HOST_DEVICE
+    GemmDynamicBlockSwizzle() {}
+
+    CATLASS_HOST_DEVICE
+    GemmDynamicBlockSwizzle(GemmCoord const &problemShape_, MatrixCoord const &tileMN_,
+        GemmSwizzle const &swizzle_ = GemmSwizzle{})
+        : problemShape(problemShape_), tileMN(tileMN_), swizzle(swizzle_)
+    {
+        loopsMN = CeilDiv(MatrixCoord(problemShape.GetCoordMN()), tileMN);
+        InitDivisors();
+    }
+
+    CATLASS_HOST_DEVICE
+    GemmDynamicBlockSwizzle(GemmCoord const &problemShape_, MatrixCoord const &tileMN_,
+        MatrixCoord const &loopsMN_, GemmSwizzle const &swizzle_ = GemmSwizzle{})
+        : problemShape(problemShape_), tileMN(tileMN_), loopsMN(loopsMN_), swizzle(swizzle_)
+    {
+        InitDivisors();
+    }
+
+    CATLASS_HOST_DEVICE
+    void InitDivisors()
+    {
+        uint32_t swizzleLoops = (swizzle.direction == 0) ? loopsMN.row() : loopsMN.column();
+        uint32_t crossLoops = (swizzle.direction == 0) ? loopsMN.column() : loopsMN.row();
+        tileBlockLoop = CeilDiv(swizzleLoops, swizzle.offset);
+        coreLoopsDivisor = detail::FastDivisor(GetCoreLoops());
+        tileBlockDivisor = detail::FastDivisor(swizzle.offset * crossLoops);
+        offsetDivisor = detail::FastDivisor(swizzle.offset);
+        // The last block of the swizzled dimension may hold fewer than offset tiles
+        tailDivisor = detail::FastDivisor(swizzleLoops - swizzle.offset * (tileBlockLoop - 1));
+    }
+
+    CATLASS_HOST_DEVICE
+    uint32_t GetCoreLoops() const
+    {
+        return loopsMN.row() * loopsMN.column();
+    }
+
+    CATLASS_HOST_DEVICE
+    uint32_t GetBatchIdx(uint32_t taskIdx) const
+    {
+        return coreLoopsDivisor.Div(taskIdx);
+    }
+
+    CATLASS_HOST_DEVICE
+    GemmCoord GetBlockCoord(uint32_t taskIdx) const
+    {
+        uint32_t innerIdx = coreLoopsDivisor.Mod(taskIdx);
+        uint32_t tileBlockIdx = tileBlockDivisor.Div(innerIdx);
+        uint32_t inTileBlockIdx = tileBlockDivisor.Mod(innerIdx);
+
+        detail::FastDivisor const &spanDivisor = (tileBlockIdx == tileBlockLoop - 1) ? tailDivisor : offsetDivisor;
+        uint32_t swizzleIdx = tileBlockIdx * swizzle.offset + spanDivisor.Mod(inTileBlockIdx);
+        uint32_t crossIdx = spanDivisor.Div(inTileBlockIdx);
+        if (swizzle.direction == 0) { // Zn
+            if (tileBlockIdx % 2 == 1) {
+                crossIdx = loopsMN.column() - crossIdx - 1;
+            }
+            return GemmCoord{swizzleIdx, crossIdx, 0};
+        } else { // Nz
+            if (tileBlockIdx % 2 == 1) {
+                crossIdx = loopsMN.row() - crossIdx - 1;
+            }
+            return GemmCoord{crossIdx, swizzleIdx, 0};
+        }
+    }
+
+    CATLASS_HOST_DEVICE
+    GemmCoord GetActualBlockShape(GemmCoord blockCoord) const
+    {
+        uint32_t mActual = (blockCoord.m() == (loopsMN.row() - 1)) ?
+            (problemShape.m() - blockCoord.m() * tileMN.row()) : tileMN.row();
+        uint32_t nActual = (blockCoord.n() == (loopsMN.column() - 1)) ?
+            (problemShape.n() - blockCoord.n() * tileMN.column()) : tileMN.column();
+        uint32_t kActual = problemShape.k();
+        return GemmCoord{mActual, nActual, kActual};
+    }
+};
+
+}  // namespace Catcoc::DGemm::Block
+
+namespace Catcoc::detail {
+
+template <class BlockScheduler>
+struct IsDynamicSwizzle : std::false_type {};
+
+template <>
+struct IsDynamicSwizzle<DGemm::Block::GemmDynamicBlockSwizzle> : std::true_type {};
+
+/// Swizzles GemmDynamicBlockSwizzle can walk, compile time schedulers accept any since they ignore it
+template <class BlockScheduler>
+CATLASS_HOST_DEVICE
+bool IsValidSwizzle(DGemm::Block::GemmSwizzle const &swizzle)
+{
+    if constexpr (IsDynamicSwizzle<BlockScheduler>::value) {
+        return swizzle.offset != 0 && swizzle.direction <= 1;
+    } else {
+        return true;
+    }
+}
+
+} // namespace Catcoc::detail
+
+#endif // CATCOC_DGEMM_BLOCK_SWIZZLE_DYNAMIC_HPP
@@ -0,0 +1,104 @@
+#ifndef CATCOC_DGEMM_BLOCK_TILE_FLAGS_HPP
+#define CATCOC_DGEMM_BLOCK_TILE_FLAGS_HPP
+
+#include "catcoc/catcoc.hpp"
+#include "catcoc/detail/tile_flags.hpp"
+
+// from shmem
+#include "shmem_api.h"
+
+namespace Catcoc::DGemm::Block {
+
+/// Tile granular AIC -> AIV readiness through the symmetric workspace. The AIC publishes a slot as soon as
+/// the fixpipe store of its tile has landed in GM, and the AIVs of every rank poll the slots a comm task
+/// reads, so the first tiles of a chunk are sent while the slowest core is still computing its last one.
+/// A flag holds 1 + the index of the chunk that last stored its slot. The values only grow during a launch,
+/// so flags are cleared once per launch instead of once per chunk.
+class BlockTileFlags {
+public:
+    CATLASS_DEVICE
+    BlockTileFlags(GM_ADDR ptrWorkspace_, detail::TileFlagsLayout const &layout_)
+        : ptrWorkspace(ptrWorkspace_), layout(layout_) {}
+
+    /// AIC, after the block mmad that stored slotIdx of stageId for chunk commIdx
+    CATLASS_DEVICE
+    void Publish(uint32_t stageId, uint32_t slotIdx, uint32_t commIdx)
+    {
+        Store(ptrWorkspace, stageId, slotIdx, commIdx);
+    }
+
+    /// AIC, Publish for a tile the fixpipe stored into the workspace of rankIdx, the flag goes along with it
+    CATLASS_DEVICE
+    void Publish(uint32_t rankIdx, uint32_t stageId, uint32_t slotIdx, uint32_t commIdx)
+    {
+        Store(reinterpret_cast<GM_ADDR>(shmem_ptr(ptrWorkspace, static_cast<int>(rankIdx))), stageId, slotIdx,
+            commIdx);
+    }
+
+    /// AIV, spins until rankIdx has published every slot under rows [rowOffset, rowOffset + rows) of
+    /// stageId for chunk commIdx, tileRows being the rows of one slot
+    CATLASS_DEVICE
+    void Wait(uint32_t rankIdx, uint32_t stageId, uint32_t rowOffset, uint32_t rows, uint32_t tileRows,
+        uint32_t commIdx)
+    {
+        if (rows == 0) {
+            return;
+        }
+        GM_ADDR ptrRank = reinterpret_cast<GM_ADDR>(shmem_ptr(ptrWorkspace, static_cast<int>(rankIdx)));
+        int32_t expected = static_cast<int32_t>(commIdx + 1);
+        uint32_t slotEnd = (rowOffset + rows + tileRows - 1) / tileRows;
+        for (uint32_t slotIdx = rowOffset / tileRows; slotIdx < slotEnd; ++slotIdx) {
+            AscendC::GlobalTensor<int32_t> gmFlag = GetFlag(ptrRank, stageId, slotIdx);
+            do {
+                Flush(gmFlag);
+            } while (gmFlag.GetValue(0) < expected);
+        }
+    }
+
+    /// AIV, every AIV of the launch clears a share of the local flags. The launch must then synchronize all
+    /// ranks before any AIC publishes or any AIV polls, a stale flag of the previous launch would pass.
+    CATLASS_DEVICE
+    void Clear()
+    {
+        uint32_t aivNum = AscendC::GetBlockNum() * AscendC::GetSubBlockNum();
+        for (uint32_t flagIdx = AscendC::GetBlockIdx(); flagIdx < layout.GetFlagCount(); flagIdx += aivNum) {
+            AscendC::GlobalTensor<int32_t> gmFlag = GetFlag(ptrWorkspace, 0, flagIdx);
+            gmFlag.SetValue(0, 0);
+            Flush(gmFlag);
+        }
+    }
+
+private:
+    CATLASS_DEVICE
+    void Store(GM_ADDR ptrBase, uint32_t stageId, uint32_t slotIdx, uint32_t commIdx)
+    {
+        // The flag must not overtake the tile, the scalar store waits for the fixpipe to drain
+        AscendC::SetFlag<AscendC::HardEvent::FIX_S>(EVENT_ID0);
+        AscendC::WaitFlag<AscendC::HardEvent::FIX_S>(EVENT_ID0);
+        AscendC::GlobalTensor<int32_t> gmFlag = GetFlag(ptrBase, stageId, slotIdx);
+        gmFlag.SetValue(0, static_cast<int32_t>(commIdx + 1));
+        Flush(gmFlag);
+    }
+
+    CATLASS_DEVICE
+    AscendC::GlobalTensor<int32_t> GetFlag(GM_ADDR ptrBase, uint32_t stageId, uint32_t slotIdx) const
+    {
+        AscendC::GlobalTensor<int32_t> gmFlag;
+        gmFlag.SetGlobalBuffer(reinterpret_cast<__gm__ int32_t *>(ptrBase + layout.GetOffset(stageId, slotIdx)));
+        return gmFlag;
+    }
+
+    CATLASS_DEVICE
+    static void Flush(AscendC::GlobalTensor<int32_t> const &gmFlag)
+    {
+        AscendC::DataCacheCleanAndInvalid<int32_t, AscendC::CacheLine::SINGLE_CACHE_LINE,
+            AscendC::DcciDst::CACHELINE_OUT>(gmFlag);
+    }
+
+    GM_ADDR ptrWorkspace;
+    detail::TileFlagsLayout layout;
+};
+
+} // namespace Catcoc::DGemm::Block
+
+#endif // CATCOC_DGEMM_BLOCK_TILE_FLAGS_HPP
@@ -0,0 +1,282 @@
+#ifndef CATCOC_DGEMM_COMM_SCHEDULE_HPP
+#define CATCOC_DGEMM_COMM_SCHEDULE_HPP
+
+#include <cstddef>
+
+#include "catcoc/catcoc.hpp"
+#include "catcoc/detail/chunk_partition.hpp"
+#include "catcoc/detail/remote_copy_type.hpp"
+#include "catcoc/dgemm/workspace_size.hpp"
+
+// from catlass
+#include "catlass/catlass.hpp"
+#include "catlass/matrix_coord.hpp"
+
+namespace Catcoc::DGemm {
+
+using Catlass::MatrixCoord;
+
+/// One comm block of a core, what the comm loop otherwise derives from the task index through the comm
+/// scheduler on every iteration
+struct CommTask {
+    /// Row of the block in the staged chunk, GetBlockOffset of the comm scheduler
+    uint32_t offsetRow;
+    /// Rank the block is exchanged with
+    uint32_t peerRankIdx;
+    /// GetActualBlockShape of the comm scheduler
+    uint32_t rows;
+    uint32_t columns;
+};
+
+/// Tasks of coreIdx when loops tasks are dealt round robin over coreNum cores
+CATLASS_HOST_DEVICE
+inline uint32_t GetRoundRobinCount(uint32_t loops, uint32_t coreIdx, uint32_t coreNum)
+{
+    return (coreIdx < loops) ? (loops - coreIdx + coreNum - 1) / coreNum : 0;
+}
+
+/// Word layout of a comm schedule precomputed on the host. Two header words (coreNum, maxTaskCount) are
+/// followed by sectionNum sections, a section holds the task count of every core and then maxTaskCount
+/// task slots per core, so the tasks of a core are contiguous.
+struct CommScheduleLayout {
+    static constexpr uint32_t HEADER_WORDS = 2;
+    static constexpr uint32_t TASK_WORDS = sizeof(CommTask) / sizeof(uint32_t);
+
+    uint32_t sectionNum{0};
+    uint32_t coreNum{0};
+    uint32_t maxTaskCount{0};
+
+    CATLASS_HOST_DEVICE
+    CommScheduleLayout() {}
+
+    CATLASS_HOST_DEVICE
+    CommScheduleLayout(uint32_t sectionNum_, uint32_t coreNum_, uint32_t maxTaskCount_)
+        : sectionNum(sectionNum_), coreNum(coreNum_), maxTaskCount(maxTaskCount_) {}
+
+    CATLASS_HOST_DEVICE
+    size_t GetSectionWords() const
+    {
+        return coreNum + static_cast<size_t>(coreNum) * maxTaskCount * TASK_WORDS;
+    }
+
+    CATLASS_HOST_DEVICE
+    size_t GetTaskCountIndex(uint32_t sectionIdx, uint32_t coreIdx) const
+    {
+        return HEADER_WORDS + sectionIdx * GetSectionWords() + coreIdx;
+    }
+
+    CATLASS_HOST_DEVICE
+    size_t GetTaskIndex(uint32_t sectionIdx, uint32_t coreIdx, uint32_t taskIdx) const
+    {
+        return HEADER_WORDS + sectionIdx * GetSectionWords() + coreNum +
+            (static_cast<size_t>(coreIdx) * maxTaskCount + taskIdx) * TASK_WORDS;
+    }
+
+    CATLASS_HOST_DEVICE
+    size_t GetWords() const
+    {
+        return HEADER_WORDS + sectionNum * GetSectionWords();
+    }
+
+    CATLASS_HOST_DEVICE
+    size_t GetSize() const
+    {
+        return GetWords() * sizeof(uint32_t);
+    }
+};
+
+/// Comm schedule of MatmulAllReduce. Chunks of the same size share a reduce-scatter and an all-gather
+/// section: one pair for each ramp chunk, one for the full chunks and one for the last chunk cover the
+/// whole launch. CommScheduler and the copy modes must be the ones the kernel is built with, the schedule
+/// is valid for the rank and the launch core count it was built for.
+template <
+    class CommScheduler,
+    detail::CopyMode REDUCE_SCATTER_MODE, detail::CopyDirect REDUCE_SCATTER_DIRECT,
+    detail::CopyMode ALL_GATHER_MODE, detail::CopyDirect ALL_GATHER_DIRECT
+>
+struct MatmulAllReduceCommSchedule {
+    static constexpr bool IS_DETERMINISTIC = CommScheduler::IS_DETERMINISTIC;
+
+    /// Every chunk size has a reduce-scatter section followed by an all-gather section
+    static constexpr uint32_t PHASE_NUM = 2;
+
+    /// Sections of a launch whose ChunkRamp has rampCount ramp chunks
+    CATLASS_HOST_DEVICE
+    static uint32_t GetSectionNum(uint32_t rampCount)
+    {
+        return (rampCount + 2) * PHASE_NUM;
+    }
+
+    /// Section of a comm phase in chunk commIdx of commLoops, ramp chunks come first, then the full chunks
+    /// and the last chunk
+    CATLASS_HOST_DEVICE
+    static uint32_t GetSection(bool isAllGather, uint32_t commIdx, uint32_t commLoops, uint32_t rampCount)
+    {
+        uint32_t sizeIdx = (commIdx == commLoops - 1) ? rampCount + 1 : ((commIdx < rampCount) ? commIdx : rampCount);
+        return sizeIdx * PHASE_NUM + (isAllGather ? 1 : 0);
+    }
+
+    WorkspaceDesc desc;
+    uint32_t rankIdx{0};
+    MatrixCoord commCoreSplit;
+    MatrixCoord commBlockShape;
+
+    CATLASS_HOST_DEVICE
+    MatmulAllReduceCommSchedule(WorkspaceDesc const &desc_, uint32_t rankIdx_, MatrixCoord const &commCoreSplit_,
+        MatrixCoord const &commBlockShape_)
+        : desc(desc_), rankIdx(rankIdx_), commCoreSplit(commCoreSplit_), commBlockShape(commBlockShape_) {}
+
+    CATLASS_HOST_DEVICE
+    detail::ChunkRamp GetRamp() const
+    {
+        return detail::ChunkRamp(desc.coreNum * desc.commInterval, desc.coreNum * desc.firstCommInterval);
+    }
+
+    CATLASS_HOST_DEVICE
+    CommScheduleLayout GetLayout() const
+    {
+        uint32_t sectionNum = GetSectionNum(GetRamp().rampCount);
+        uint32_t maxTaskCount = 0;
+        for (uint32_t sectionIdx = 0; sectionIdx < sectionNum; ++sectionIdx) {
+            uint32_t taskCount = BuildSection(sectionIdx, CommScheduleLayout{}, nullptr);
+            maxTaskCount = (taskCount > maxTaskCount) ? taskCount : maxTaskCount;
+        }
+        return CommScheduleLayout{sectionNum, desc.coreNum, maxTaskCount};
+    }
+
+    /// Writes GetLayout().GetWords() words
+    CATLASS_HOST_DEVICE
+    void Build(uint32_t *words) const
+    {
+        CommScheduleLayout layout = GetLayout();
+        words[0] = layout.coreNum;
+        words[1] = layout.maxTaskCount;
+        for (uint32_t sectionIdx = 0; sectionIdx < layout.sectionNum; ++sectionIdx) {
+            BuildSection(sectionIdx, layout, words);
+        }
+    }
+
+private:
+    /// Walks the comm loop of one section as the kernel does, returns the largest task count of a core
+    CATLASS_HOST_DEVICE
+    uint32_t BuildSection(uint32_t sectionIdx, CommScheduleLayout const &layout, uint32_t *words) const
+    {
+        uint32_t tileM = desc.l1TileShape.m();
+        uint32_t tileN = desc.l1TileShape.n();
+        uint32_t coreLoops = ((desc.problemShape.m() + tileM - 1) / tileM) *
+            ((desc.problemShape.n() + tileN - 1) / tileN);
+        detail::ChunkRamp ramp = GetRamp();
+        uint32_t commLoops = ramp.GetChunkCount(coreLoops);
+        uint32_t sizeIdx = sectionIdx / PHASE_NUM;
+        bool isAllGather = (sectionIdx % PHASE_NUM == 1);
+        // Sizes no chunk of this launch has get an empty section
+        uint32_t blockInComm = 0;
+        if (sizeIdx == ramp.rampCount + 1) {
+            blockInComm = ramp.GetActualSize(commLoops - 1, coreLoops);
+        } else if (sizeIdx < ramp.rampCount) {
+            blockInComm = (sizeIdx + 1 < commLoops) ? ramp.GetSize(sizeIdx) : 0;
+        } else if (ramp.rampCount + 1 < commLoops) {
+            blockInComm = ramp.blockPerComm;
+        }
+        if (blockInComm == 0) {
+            for (uint32_t coreIdx = 0; words != nullptr && coreIdx < layout.coreNum; ++coreIdx) {
+                words[layout.GetTaskCountIndex(sectionIdx, coreIdx)] = 0;
+            }
+            return 0;
+        }
+
+        MatrixCoord commShape{blockInComm * tileM, tileN};
+        MatrixCoord dataLoopsMx = CeilDiv(commShape, commBlockShape);
+        uint32_t dLoopsInRank = CeilDiv(dataLoopsMx.row() * dataLoopsMx.column(), desc.rankSize);
+        CommScheduler commScheduler(rankIdx, desc.rankSize, commCoreSplit, desc.coreNum);
+        commScheduler.Update(commShape, commBlockShape, dLoopsInRank);
+        auto layoutComm = layout::AffineRankN<3>::Packed(
+            Catlass::MakeCoord<int>(1, dLoopsInRank, commBlockShape.row()));
+
+        uint32_t commAicoreNum = commScheduler.GetRealCore();
+        uint32_t phaseLoops = commScheduler.GetCoreLoop();
+        if (isAllGather && IS_DETERMINISTIC) {
+            // The deterministic scheduler only walks the local slice, the all-gather spreads the ranks itself
+            phaseLoops *= desc.rankSize;
+        }
+        uint32_t maxTaskCount = GetRoundRobinCount(phaseLoops, 0, commAicoreNum);
+        if (words == nullptr) {
+            return maxTaskCount;
+        }
+
+        for (uint32_t coreIdx = 0; coreIdx < layout.coreNum; ++coreIdx) {
+            uint32_t taskCount = 0;
+            for (uint32_t loopIdx = coreIdx; coreIdx < commAicoreNum && loopIdx < phaseLoops;
+                loopIdx += commAicoreNum) {
+                MatrixCoord blockCoord;
+                if (isAllGather && IS_DETERMINISTIC) {
+                    uint32_t dataIdx = commScheduler.RankDiv(loopIdx);
+                    blockCoord = MatrixCoord{dataIdx, commScheduler.RankMod(loopIdx + dataIdx)};
+                } else {
+                    blockCoord = commScheduler.GetBlockIdx(loopIdx);
+                }
+                // The local block needs no reduce, the kernel skips it as well
+                if (!isAllGather && !IS_DETERMINISTIC && blockCoord.column() == rankIdx) {
+                    continue;
+                }
+                MatrixCoord blockOffset;
+                MatrixCoord actualBlockShape;
+                if (isAllGather) {
+                    blockOffset = commScheduler.template GetBlockOffset<ALL_GATHER_MODE, ALL_GATHER_DIRECT>(
+                        blockCoord, layoutComm);
+                    actualBlockShape = commScheduler.template GetActualBlockShape<ALL_GATHER_MODE,
+                        ALL_GATHER_DIRECT>(blockCoord, layoutComm);
+                } else {
+                    blockOffset = commScheduler.template GetBlockOffset<REDUCE_SCATTER_MODE,
+                        REDUCE_SCATTER_DIRECT>(blockCoord, layoutComm);
+                    actualBlockShape = commScheduler.template GetActualBlockShape<REDUCE_SCATTER_MODE,
+                        REDUCE_SCATTER_DIRECT>(blockCoord, layoutComm);
+                }
+                uint32_t *task = words + layout.GetTaskIndex(sectionIdx, coreIdx, taskCount);
+                task[0] = blockOffset.row();
+                task[1] = commScheduler.RankMod(blockCoord.column());
+                task[2] = actualBlockShape.row();
+                task[3] = actualBlockShape.column();
+                ++taskCount;
+            }
+            words[layout.GetTaskCountIndex(sectionIdx, coreIdx)] = taskCount;
+        }
+        return maxTaskCount;
+    }
+};
+
+#if defined(__CCE__)
+/// Device side reader of a schedule written by the host, every word is one scalar load from GM
+struct CommScheduleView {
+    AscendC::GlobalTensor<uint32_t> gmWords;
+    CommScheduleLayout layout;
+
+    CATLASS_DEVICE
+    CommScheduleView() {}
+
+    CATLASS_DEVICE
+    CommScheduleView(GM_ADDR ptrSchedule, uint32_t sectionNum)
+    {
+        gmWords.SetGlobalBuffer(reinterpret_cast<__gm__ uint32_t *>(ptrSchedule));
+        layout = CommScheduleLayout{sectionNum, gmWords.GetValue(0), gmWords.GetValue(1)};
+    }
+
+    CATLASS_DEVICE
+    uint32_t GetTaskCount(uint32_t sectionIdx, uint32_t coreIdx)
+    {
+        return gmWords.GetValue(layout.GetTaskCountIndex(sectionIdx, coreIdx));
+    }
+
+    CATLASS_DEVICE
+    CommTask GetTask(uint32_t sectionIdx, uint32_t coreIdx, uint32_t taskIdx)
+    {
+        size_t index = layout.GetTaskIndex(sectionIdx, coreIdx, taskIdx);
+        return CommTask{gmWords.GetValue(index), gmWords.GetValue(index + 1),
+            gmWords.GetValue(index + 2), gmWords.GetValue(index + 3)};
+    }
+};
+#endif
+
+} // namespace Catcoc::DGemm
+
+#endif // CATCOC_DGEMM_COMM_SCHEDULE_HPP
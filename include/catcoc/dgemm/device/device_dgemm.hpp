@@ -0,0 +1,94 @@
+#ifndef CATCOC_DGEMM_DEVICE_DEVICE_DGEMM_HPP
+#define CATCOC_DGEMM_DEVICE_DEVICE_DGEMM_HPP
+
+#include <acl/acl.h>
+
+#include "catcoc/catcoc.hpp"
+#include "catcoc/dgemm/device/kernel_adapter.hpp"
+
+// from catlass
+#include "catlass/status.hpp"
+
+namespace Catcoc::DGemm::Device {
+
+using Catlass::Status;
+
+/// Host side handle of a comm kernel, in the style of Catlass::Gemm::Device::DeviceGemm. Initialize
+/// rejects arguments the kernel cannot run, e.g. more pipeline stages than it was compiled for or a UB
+/// pipeline that does not fit, which would otherwise hang the ranks in the middle of the collective.
+template <class DGemmKernel>
+class DeviceDGemm {
+public:
+    /// Argument structure: User API
+    using Arguments = typename DGemmKernel::Arguments;
+    /// Argument structure: Kernel API
+    using Params = typename DGemmKernel::Params;
+
+private:
+    Arguments args_;
+    uint8_t *workspace_{nullptr};
+    bool initialized_{false};
+
+public:
+    DeviceDGemm() {}
+    ~DeviceDGemm() {}
+
+    /// Access the Arguments the kernel is launched with
+    Arguments const &arguments() const
+    {
+        return args_;
+    }
+
+    /// Determines whether the comm kernel can execute the given problem.
+    static Status CanImplement(Arguments const &args)
+    {
+        if (DGemmKernel::CanImplement(args)) {
+            return Status::kSuccess;
+        } else {
+            return Status::kInvalid;
+        }
+    }
+
+    /// Gets the symmetric workspace size, every rank has to pass the same offset into the symmetric heap
+    static size_t GetWorkspaceSize(Arguments const &args)
+    {
+        return DGemmKernel::GetWorkspaceSize(args);
+    }
+
+    /// Initializes the comm kernel state from arguments, workspace is symmetric memory of at least
+    /// GetWorkspaceSize(args) bytes
+    Status Initialize(Arguments const &args, uint8_t *workspace = nullptr, aclrtStream stream = nullptr)
+    {
+        initialized_ = false;
+        if (CanImplement(args) != Status::kSuccess) {
+            return Status::kInvalid;
+        }
+        if (workspace == nullptr && GetWorkspaceSize(args) > 0) {
+            return Status::kInvalid;
+        }
+        args_ = args;
+        workspace_ = workspace;
+        initialized_ = true;
+        return Status::kSuccess;
+    }
+
+    /// Launches on args.coreNum blocks, the workspace was laid out for that count
+    inline Status Run(aclrtStream stream, uint64_t fftsAddr)
+    {
+        if (!initialized_) {
+            return Status::kInvalid;
+        }
+        KernelAdapter<DGemmKernel><<<args_.coreNum, nullptr, stream>>>(args_, workspace_, fftsAddr);
+        return Status::kSuccess;
+    }
+
+    /// Runs the kernel using initialized state
+    inline Status operator()(aclrtStream stream, uint64_t fftsAddr)
+    {
+        return Run(stream, fftsAddr);
+    }
+};
+
+} // namespace Catcoc::DGemm::Device
+
+#endif // CATCOC_DGEMM_DEVICE_DEVICE_DGEMM_HPP
@@ -0,0 +1,22 @@
+#ifndef CATCOC_DGEMM_DEVICE_KERNEL_ADAPTER_HPP
+#define CATCOC_DGEMM_DEVICE_KERNEL_ADAPTER_HPP
+
+#include "catcoc/catcoc.hpp"
+
+namespace Catcoc::DGemm::Device {
+
+/// Generic entry of the comm kernels. The epilogue Params hold catlass block swizzles that can only be
+/// built on the device, so the host passes the checked Arguments and the kernel lowers them here.
+template <class DGemmKernel>
+CATLASS_GLOBAL
+void KernelAdapter(typename DGemmKernel::Arguments args, GM_ADDR workspace, uint64_t fftsAddr)
+{
+    AscendC::SetSyncBaseAddr(fftsAddr);
+    typename DGemmKernel::Params params = DGemmKernel::ToUnderlyingArguments(args, workspace);
+    DGemmKernel op;
+    op(params);
+}
+
+} // namespace Catcoc::DGemm::Device
+
+#endif // CATCOC_DGEMM_DEVICE_KERNEL_ADAPTER_HPP
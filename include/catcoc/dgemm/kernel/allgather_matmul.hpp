@@ -2,6 +2,11 @@
 #define CATCOC_DGEMM_KERNEL_ALLGATHER_MATMUL_HPP
 
 #include "catcoc/catcoc.hpp"
+#include "catcoc/dgemm/workspace_size.hpp"
+#include "catcoc/dgemm/kernel/comm_arguments.hpp"
+#include "catcoc/detail/fast_divisor.hpp"
+#include "catcoc/detail/pipeline_stages.hpp"
+#include "catcoc/detail/rank_partition.hpp"
 
 // from catlass
 #include "catlass/arch/resource.hpp"
@@ -43,11 +48,13 @@ public:
     using CommScheduler = BlockEpilogueScheduler_;
 
     static constexpr uint32_t WORKSPACE_STAGES = WORKSPACE_STAGES_;
+    static_assert(WORKSPACE_STAGES >= 1 && WORKSPACE_STAGES <= detail::MAX_WORKSPACE_STAGES,
+        "Each workspace stage needs its own cross-core flag ID.");
     
     /// Parameters structure
     struct Params {
         // Data members
-        GemmCoord problemShape;
+        GemmCoord problemShape; // gathered problem, rank r owns RankPartition(m, rankSize).GetExtent(r) rows of A
         GemmCoord blockShape;
 
         uint32_t rankIdx;
@@ -64,6 +71,8 @@ public:
         LayoutD layoutD;
 
         uint32_t commInterval;
+        // Pipeline depth used at runtime, at most WORKSPACE_STAGES
+        uint32_t workspaceStages{WORKSPACE_STAGES};
 
         // Methods
         CATLASS_DEVICE
@@ -78,7 +87,8 @@ public:
             GM_ADDR ptrSymmetric_,
             AllGatherParams const &allGatherParams_,
             GM_ADDR ptrD_, LayoutD const &layoutD_,
-            uint32_t commInterval_
+            uint32_t commInterval_,
+            uint32_t workspaceStages_ = WORKSPACE_STAGES
         ) : problemShape(problemShape_),
             rankIdx(rank_), rankSize(rankSize_),
             ptrA(ptrA_), layoutA(layoutA_),
@@ -86,9 +96,92 @@ public:
             ptrSymmetric(ptrSymmetric_),
             allGatherParams(allGatherParams_),
             ptrD(ptrD_), layoutD(layoutD_),
-            commInterval(commInterval_) {}
+            commInterval(commInterval_), workspaceStages(workspaceStages_) {}
     };
 
+    /// Symmetric workspace bytes one rank needs for a launch on coreNum blocks, the gathered problem shape, the
+    /// layout of ptrSymmetric never goes past it
+    CATLASS_HOST_DEVICE
+    static size_t GetWorkspaceSize(GemmCoord const &problemShape, uint32_t rankSize, uint32_t coreNum,
+        uint32_t commInterval, uint32_t workspaceStages = WORKSPACE_STAGES)
+    {
+        WorkspaceDesc desc{problemShape, L1TileShape::ToCoord(), rankSize, coreNum, commInterval,
+            workspaceStages, static_cast<uint32_t>(sizeof(ElementA))};
+        return GetAllGatherMatmulWorkspaceSize(desc);
+    }
+
+    /// Host side arguments, checked and sized by Device::DeviceDGemm before the launch
+    struct Arguments {
+        /// Gathered problem, rank r owns RankPartition(m, rankSize).GetExtent(r) rows of A
+        GemmCoord problemShape;
+        uint32_t rankIdx;
+        uint32_t rankSize;
+        /// Launch block count, the workspace layout depends on it
+        uint32_t coreNum;
+        GM_ADDR ptrA;
+        GM_ADDR ptrB;
+        GM_ADDR ptrD;
+        uint32_t commInterval;
+        uint32_t workspaceStages{WORKSPACE_STAGES};
+        CommArguments comm;
+    };
+
+    static bool CanImplement(Arguments const &args)
+    {
+        if (args.problemShape.m() == 0 || args.problemShape.n() == 0 || args.problemShape.k() == 0) {
+            return false;
+        }
+        if (args.rankSize == 0 || args.rankIdx >= args.rankSize || args.coreNum == 0 || args.commInterval == 0) {
+            return false;
+        }
+        // Schedulers specialized on the rank count only hold for that count
+        if (!detail::RankDivisor<BlockScheduler::RANK_SIZE>::Matches(args.rankSize) ||
+            !detail::RankDivisor<CommScheduler::RANK_SIZE>::Matches(args.rankSize)) {
+            return false;
+        }
+        if (!detail::IsValidWorkspaceStages(args.workspaceStages) || args.workspaceStages > WORKSPACE_STAGES) {
+            return false;
+        }
+        if (args.ptrA == nullptr || args.ptrB == nullptr || args.ptrD == nullptr) {
+            return false;
+        }
+        return detail::CanImplementComm<AllGather>(args.comm, args.coreNum);
+    }
+
+    static size_t GetWorkspaceSize(Arguments const &args)
+    {
+        return GetWorkspaceSize(args.problemShape, args.rankSize, args.coreNum, args.commInterval,
+            args.workspaceStages);
+    }
+
+    CATLASS_DEVICE
+    static Params ToUnderlyingArguments(Arguments const &args, GM_ADDR workspace)
+    {
+        uint32_t n = args.problemShape.n();
+        uint32_t k = args.problemShape.k();
+        uint32_t workspaceStages = detail::ClampStages(args.workspaceStages, WORKSPACE_STAGES);
+        detail::RankPartition rankPartition(args.problemShape.m(), args.rankSize);
+        uint32_t mInRank = rankPartition.GetExtent(args.rankIdx);
+        Catlass::layout::RowMajor layoutSymmetric{
+            L1TileShape::M * args.commInterval * args.rankSize * workspaceStages, k, k
+        };
+        // Remap over the tile grid of the largest share, the shape is clipped to the rows owned by this rank
+        MatrixCoord commTileMN{L1TileShape::M, k};
+        typename AllGather::GemmReMapper allGatherReMapper(GemmCoord{mInRank, k, k}, commTileMN,
+            CeilDiv(MatrixCoord{rankPartition.GetMaxExtent(), k}, commTileMN));
+        return Params{
+            args.problemShape,
+            args.rankIdx, args.rankSize,
+            args.ptrA, LayoutA{mInRank, k},
+            args.ptrB, LayoutB{k, n},
+            workspace,
+            detail::MakeCommParams<AllGather>(workspace, layoutSymmetric, allGatherReMapper, args.comm),
+            args.ptrD, LayoutD{args.problemShape.m(), n},
+            args.commInterval,
+            workspaceStages
+        };
+    }
+
     // Methods
     CATLASS_DEVICE
     AllGatherMatmul()
@@ -107,8 +200,10 @@ public:
     CATLASS_DEVICE
     void operator()<AscendC::AIC>(Params &params)
     {
+        uint32_t workspaceStages = detail::ClampStages(params.workspaceStages, WORKSPACE_STAGES);
         GemmCoord blockShape = L1TileShape::ToCoord();
-        BlockScheduler matmulBlockScheduler(params.rankSize, params.commInterval, params.problemShape, blockShape.GetCoordMN());
+        detail::RankPartition rankPartition(params.problemShape.m(), params.rankSize);
+        BlockScheduler matmulBlockScheduler(rankPartition, params.commInterval, params.problemShape, blockShape.GetCoordMN());
 
         BlockMmad blockMmad(resource);
 
@@ -132,7 +227,7 @@ public:
         uint32_t commLoops = CeilDiv(coreLoops, blockPerComm);
 
         for (uint32_t commIdx = 0; commIdx < commLoops; ++commIdx) {
-            uint32_t stageId = commIdx % WORKSPACE_STAGES;
+            uint32_t stageId = commIdx % workspaceStages;
             auto actualBlocksPerComm = (commIdx == commLoops - 1) ? 
                 coreLoops - commIdx * blockPerComm : blockPerComm;
             auto mLoopsPerRank = actualBlocksPerComm / (params.rankSize * nLoops);
@@ -146,6 +241,9 @@ public:
                 // Compute block location
                 GemmCoord blockCoord = matmulBlockScheduler.GetBlockCoord(loopIdx);
                 GemmCoord actualBlockShape = matmulBlockScheduler.GetActualBlockShape(blockCoord);
+                if (actualBlockShape.m() == 0) {
+                    continue;
+                }
 
                 uint32_t rankIdx = blockCoord.m() / mLoops;
                 uint32_t mIdxInRank = blockCoord.m() % mLoops;
@@ -155,7 +253,7 @@ public:
                 auto layoutARow = layout::AffineRankN<3>(layoutARowLogicShape);
 
                 GemmCoord offsetCoord = blockCoord * blockShape;
-                MatrixCoord rankOffsetC = params.problemShape.GetCoordMN() * Catlass::MakeCoord<uint32_t>(rankIdx, 0);
+                MatrixCoord rankOffsetC{matmulBlockScheduler.GetRankOffset(rankIdx), 0};
                 MatrixCoord inRankOffsetC = MatrixCoord{mIdxInRank, blockCoord.n()} * blockShape.GetCoordMN();
 
                 auto blockOffsetA = MatrixCoord{(uint32_t)layoutARow(Catlass::MakeCoord<int>(stageId, rankIdx, inCommIdx)) * L1TileShape::M, offsetCoord.k()};
@@ -182,8 +280,10 @@ public:
     CATLASS_DEVICE
     void operator()<AscendC::AIV>(Params &params)
     {
+        uint32_t workspaceStages = detail::ClampStages(params.workspaceStages, WORKSPACE_STAGES);
         MatrixCoord blockShapeMN = MatrixCoord{L1TileShape::M, params.problemShape.k()};
-        BlockScheduler matmulBlockScheduler(params.rankSize, params.commInterval, params.problemShape, L1TileShape::ToCoordMN());
+        detail::RankPartition rankPartition(params.problemShape.m(), params.rankSize);
+        BlockScheduler matmulBlockScheduler(rankPartition, params.commInterval, params.problemShape, L1TileShape::ToCoordMN());
 
         AllGather allGather(resource, params.allGatherParams);
         
@@ -207,7 +307,7 @@ public:
         auto layoutCommBlockInRank = layout::AffineRankN<3>::Packed(layoutCommBlockLogicShapeInRank);
 
         for (uint32_t commIdx = 0; commIdx < commLoops; ++commIdx) {
-            uint32_t stageId = commIdx % WORKSPACE_STAGES;
+            uint32_t stageId = commIdx % workspaceStages;
             uint32_t actualBlockInComm = Min(blockPerComm, coreLoops - commIdx * blockPerComm);
             MatrixCoord actualCommShape = MatrixCoord{actualBlockInComm, 1} * blockShapeMN;
 
@@ -223,7 +323,7 @@ public:
             MatrixCoord stageOffset = MatrixCoord{stageId * blockPerComm, 0} * blockShapeMN;
 
             // wait aic
-            if (commIdx >= WORKSPACE_STAGES) {
+            if (commIdx >= workspaceStages) {
                 Catlass::Arch::CrossCoreWaitFlag(flagAicFinishStore[stageId]);
             }
 
@@ -249,7 +349,7 @@ public:
                     auto globalLoopIdx = inputLoopOffset.row();
  
                     allGather(blockShapeMN, offsetOut, offsetIn, actualCommSubBlockShape, 
-                        tensorA, params.layoutA, globalLoopIdx, remoteRankIdx % params.rankSize);
+                        tensorA, params.layoutA, globalLoopIdx, commScheduler.RankMod(remoteRankIdx));
                 }
             }
             allGather.ReleaseEventID();
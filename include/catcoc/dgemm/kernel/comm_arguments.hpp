@@ -0,0 +1,88 @@
+#ifndef CATCOC_DGEMM_KERNEL_COMM_ARGUMENTS_HPP
+#define CATCOC_DGEMM_KERNEL_COMM_ARGUMENTS_HPP
+
+#include <type_traits>
+#include <utility>
+
+#include "catcoc/catcoc.hpp"
+#include "catcoc/detail/pipeline_stages.hpp"
+#include "catcoc/dgemm/block/block_swizzle_dynamic.hpp"
+
+// from catlass
+#include "catlass/matrix_coord.hpp"
+
+namespace Catcoc::DGemm::Kernel {
+
+using Catlass::MatrixCoord;
+
+/// Comm tiling of an epilogue built with IsDynamic, compile time tiled epilogues ignore it
+struct CommArguments {
+    MatrixCoord coreSplit;
+    MatrixCoord blockShape;
+    MatrixCoord tileShape;
+    /// UB buffers used at runtime, 0 selects the compiled depth
+    uint32_t ubStages{0};
+};
+
+} // namespace Catcoc::DGemm::Kernel
+
+namespace Catcoc::detail {
+
+/// Checks the runtime comm tiling of Epilogue against the launch and the UB it runs in
+template <class Epilogue>
+bool CanImplementComm(DGemm::Kernel::CommArguments const &comm, uint32_t coreNum)
+{
+    if constexpr (Epilogue::IsDynamic) {
+        uint32_t commCoreNum = comm.coreSplit.row() * comm.coreSplit.column();
+        if (commCoreNum == 0 || commCoreNum > coreNum) {
+            return false;
+        }
+        if (comm.blockShape.row() == 0 || comm.blockShape.column() == 0 ||
+            comm.tileShape.row() == 0 || comm.tileShape.column() == 0) {
+            return false;
+        }
+        uint32_t ubStages = ClampStages(comm.ubStages, Epilogue::UB_STAGES);
+        uint32_t tileElems = comm.tileShape.row() * comm.tileShape.column();
+        uint32_t elementBytes = sizeof(typename Epilogue::ElementDst);
+        // The deterministic reduce adds an fp32 accumulator, a cast buffer and an output buffer
+        uint32_t fixedBytes = Epilogue::DispatchPolicy::IsDeterministic ?
+            tileElems * (sizeof(float) * 2 + elementBytes) : 0;
+        return IsValidUbStages(ubStages, tileElems * elementBytes, fixedBytes);
+    } else {
+        return true;
+    }
+}
+
+/// Epilogue Params over the symmetric workspace, the remapper has a device only constructor so this
+/// runs inside the kernel
+template <class Epilogue, class LayoutSymmetric>
+CATLASS_DEVICE
+typename Epilogue::Params MakeCommParams(GM_ADDR ptrSymmetric, LayoutSymmetric const &layoutSymmetric,
+    typename Epilogue::GemmReMapper const &gemmReMapper, DGemm::Kernel::CommArguments const &comm)
+{
+    using Params = typename Epilogue::Params;
+    using ShmemPtr = decltype(std::declval<Params>().shmemPtr);
+    if constexpr (Epilogue::IsDynamic) {
+        return Params{reinterpret_cast<ShmemPtr>(ptrSymmetric), layoutSymmetric, gemmReMapper,
+            comm.coreSplit, comm.blockShape, comm.tileShape, comm.ubStages};
+    } else {
+        return Params{reinterpret_cast<ShmemPtr>(ptrSymmetric), layoutSymmetric, gemmReMapper};
+    }
+}
+
+/// Matmul scheduler or comm remapper over the tile grid, swizzle only reaches a GemmDynamicBlockSwizzle,
+/// compile time schedulers keep their own order. Like the remapper constructors this runs inside the kernel.
+template <class BlockScheduler, class... Grid>
+CATLASS_DEVICE
+BlockScheduler MakeBlockScheduler(DGemm::Block::GemmSwizzle const &swizzle, Grid const &...grid)
+{
+    if constexpr (IsDynamicSwizzle<BlockScheduler>::value) {
+        return BlockScheduler(grid..., swizzle);
+    } else {
+        return BlockScheduler(grid...);
+    }
+}
+
+} // namespace Catcoc::detail
+
+#endif // CATCOC_DGEMM_KERNEL_COMM_ARGUMENTS_HPP
@@ -2,6 +2,15 @@
 #define CATCOC_DGEMM_KERNEL_MATMUL_ALLREDUCE_HPP
 
 #include "catcoc/catcoc.hpp"
+#include "catcoc/dgemm/block/block_splitk_reduce.hpp"
+#include "catcoc/dgemm/block/block_tile_flags.hpp"
+#include "catcoc/dgemm/comm_schedule.hpp"
+#include "catcoc/dgemm/workspace_size.hpp"
+#include "catcoc/dgemm/kernel/comm_arguments.hpp"
+#include "catcoc/detail/chunk_partition.hpp"
+#include "catcoc/detail/fast_divisor.hpp"
+#include "catcoc/detail/pipeline_stages.hpp"
+#include "catcoc/detail/tail_split.hpp"
 
 // from catlass
 #include "catlass/arch/resource.hpp"
@@ -45,8 +54,22 @@ public:
 
     using BlockScheduler = BlockScheduler_;
     using CommScheduler = BlockEpilogueScheduler_;
+    using SplitkReduce = Block::BlockSplitkReduce<ArchTag, ElementC>;
 
     static constexpr uint32_t WORKSPACE_STAGES = WORKSPACE_STAGES_;
+    static_assert(WORKSPACE_STAGES >= 1 && WORKSPACE_STAGES <= detail::MAX_WORKSPACE_STAGES,
+        "Each workspace stage needs its own cross-core flag ID.");
+    static constexpr bool IS_DETERMINISTIC = CommScheduler::IS_DETERMINISTIC;
+    static_assert(ReduceScatter::DispatchPolicy::IsDeterministic == IS_DETERMINISTIC,
+        "Deterministic comm scheduler must be paired with a deterministic reduce epilogue.");
+    // A put all-gather pushes every reduced slice of this rank into the D of all ranks as soon as the local
+    // AIVs have reduced it, instead of every rank pulling the slices of its peers after a global barrier
+    static constexpr bool PUSH_ALL_GATHER = (AllGather::RemoteCopyDirect == detail::CopyDirect::Put);
+
+    /// Comm tasks the host can precompute for Params::ptrCommSchedule
+    using CommSchedule = MatmulAllReduceCommSchedule<CommScheduler,
+        ReduceScatter::RemoteCopyMode, ReduceScatter::RemoteCopyDirect,
+        AllGather::RemoteCopyMode, AllGather::RemoteCopyDirect>;
 
     /// Parameters structure
     struct Params {
@@ -68,6 +91,18 @@ public:
         LayoutD layoutD;
 
         uint32_t commInterval;
+        // Pipeline depth used at runtime, at most WORKSPACE_STAGES
+        uint32_t workspaceStages{WORKSPACE_STAGES};
+        // Schedule built by CommSchedule for this launch, nullptr walks the comm scheduler on the device
+        GM_ADDR ptrCommSchedule{nullptr};
+        // Tile order of a GemmDynamicBlockSwizzle scheduler, the remappers of the epilogue params must use it too
+        Block::GemmSwizzle swizzle;
+        // commInterval of the first chunk, the chunks double up to commInterval, 0 keeps them uniform
+        uint32_t firstCommInterval{0};
+        // Largest K split of the last chunk onto idle cores, 0 or 1 computes it like the other chunks
+        uint32_t tailSplitK{0};
+        // Non-zero lets the comm tasks wait for the tiles they read instead of the whole chunk
+        uint32_t tileFlags{0};
 
         // Methods
         CATLASS_DEVICE
@@ -83,7 +118,13 @@ public:
             ReduceScatterParams const &reduceScatterParams_,
             AllGatherParams const &allGatherParams_,
             GM_ADDR ptrD_, LayoutD const &layoutD_,
-            uint32_t commInterval_
+            uint32_t commInterval_,
+            uint32_t workspaceStages_ = WORKSPACE_STAGES,
+            GM_ADDR ptrCommSchedule_ = nullptr,
+            Block::GemmSwizzle const &swizzle_ = Block::GemmSwizzle{},
+            uint32_t firstCommInterval_ = 0,
+            uint32_t tailSplitK_ = 0,
+            uint32_t tileFlags_ = 0
         ) : problemShape(problemShape_),
             rankIdx(rank_), rankSize(rankSize_),
             ptrA(ptrA_), layoutA(layoutA_),
@@ -92,9 +133,124 @@ public:
             reduceScatterParams(reduceScatterParams_),
             allGatherParams(allGatherParams_),
             ptrD(ptrD_), layoutD(layoutD_),
-            commInterval(commInterval_) {}
+            commInterval(commInterval_), workspaceStages(workspaceStages_), ptrCommSchedule(ptrCommSchedule_),
+            swizzle(swizzle_), firstCommInterval(firstCommInterval_), tailSplitK(tailSplitK_),
+            tileFlags(tileFlags_) {}
     };
 
+    CATLASS_HOST_DEVICE
+    static WorkspaceDesc GetWorkspaceDesc(GemmCoord const &problemShape, uint32_t rankSize, uint32_t coreNum,
+        uint32_t commInterval, uint32_t workspaceStages = WORKSPACE_STAGES, uint32_t firstCommInterval = 0,
+        uint32_t tailSplitK = 0, uint32_t tileFlags = 0)
+    {
+        WorkspaceDesc desc{problemShape, L1TileShape::ToCoord(), rankSize, coreNum, commInterval,
+            workspaceStages, static_cast<uint32_t>(sizeof(ElementC)), firstCommInterval, tailSplitK};
+        desc.tileFlags = tileFlags;
+        return desc;
+    }
+
+    /// Symmetric workspace bytes one rank needs for a launch on coreNum blocks, the
+    /// layout of ptrSymmetric never goes past it
+    CATLASS_HOST_DEVICE
+    static size_t GetWorkspaceSize(GemmCoord const &problemShape, uint32_t rankSize, uint32_t coreNum,
+        uint32_t commInterval, uint32_t workspaceStages = WORKSPACE_STAGES, uint32_t firstCommInterval = 0,
+        uint32_t tailSplitK = 0, uint32_t tileFlags = 0)
+    {
+        return GetMatmulAllReduceWorkspaceSize(GetWorkspaceDesc(problemShape, rankSize, coreNum, commInterval,
+            workspaceStages, firstCommInterval, tailSplitK, tileFlags));
+    }
+
+    /// Host side arguments, checked and sized by Device::DeviceDGemm before the launch
+    struct Arguments {
+        GemmCoord problemShape;
+        uint32_t rankIdx;
+        uint32_t rankSize;
+        /// Launch block count, the workspace layout depends on it
+        uint32_t coreNum;
+        GM_ADDR ptrA;
+        GM_ADDR ptrB;
+        /// Symmetric, at the same offset on every rank, when the all-gather puts into the peers
+        GM_ADDR ptrD;
+        uint32_t commInterval;
+        uint32_t workspaceStages{WORKSPACE_STAGES};
+        /// Shared by the reduce-scatter and the all-gather epilogue
+        CommArguments comm;
+        /// Optional device copy of a CommSchedule built for this rank and coreNum
+        GM_ADDR ptrCommSchedule{nullptr};
+        /// Tile order of the matmul, used when BlockScheduler is GemmDynamicBlockSwizzle
+        Block::GemmSwizzle swizzle;
+        /// commInterval of the first chunk, see detail::ChunkRamp
+        uint32_t firstCommInterval{0};
+        /// Largest K split of the last chunk, see detail::TailSplit
+        uint32_t tailSplitK{0};
+        /// Per tile ready flags after the stages, see Block::BlockTileFlags
+        uint32_t tileFlags{0};
+    };
+
+    static bool CanImplement(Arguments const &args)
+    {
+        if (args.problemShape.m() == 0 || args.problemShape.n() == 0 || args.problemShape.k() == 0) {
+            return false;
+        }
+        if (args.rankSize == 0 || args.rankIdx >= args.rankSize || args.coreNum == 0 || args.commInterval == 0) {
+            return false;
+        }
+        // A comm scheduler specialized on the rank count only holds for that count
+        if (!detail::RankDivisor<CommScheduler::RANK_SIZE>::Matches(args.rankSize)) {
+            return false;
+        }
+        if (!detail::IsValidWorkspaceStages(args.workspaceStages) || args.workspaceStages > WORKSPACE_STAGES) {
+            return false;
+        }
+        if (args.ptrA == nullptr || args.ptrB == nullptr || args.ptrD == nullptr) {
+            return false;
+        }
+        if (!detail::IsValidSwizzle<BlockScheduler>(args.swizzle)) {
+            return false;
+        }
+        return detail::CanImplementComm<ReduceScatter>(args.comm, args.coreNum) &&
+            detail::CanImplementComm<AllGather>(args.comm, args.coreNum);
+    }
+
+    static size_t GetWorkspaceSize(Arguments const &args)
+    {
+        return GetWorkspaceSize(args.problemShape, args.rankSize, args.coreNum, args.commInterval,
+            args.workspaceStages, args.firstCommInterval, args.tailSplitK, args.tileFlags);
+    }
+
+    CATLASS_DEVICE
+    static Params ToUnderlyingArguments(Arguments const &args, GM_ADDR workspace)
+    {
+        uint32_t m = args.problemShape.m();
+        uint32_t n = args.problemShape.n();
+        uint32_t k = args.problemShape.k();
+        uint32_t workspaceStages = detail::ClampStages(args.workspaceStages, WORKSPACE_STAGES);
+        Catlass::layout::RowMajor layoutSymmetric{
+            L1TileShape::M * args.commInterval * args.coreNum * workspaceStages, L1TileShape::N, L1TileShape::N
+        };
+        auto reduceScatterReMapper = detail::MakeBlockScheduler<typename ReduceScatter::GemmReMapper>(args.swizzle,
+            args.problemShape, L1TileShape::ToCoordMN());
+        auto allGatherReMapper = detail::MakeBlockScheduler<typename AllGather::GemmReMapper>(args.swizzle,
+            args.problemShape, L1TileShape::ToCoordMN());
+        return Params{
+            args.problemShape,
+            args.rankIdx, args.rankSize,
+            args.ptrA, LayoutA{m, k},
+            args.ptrB, LayoutB{k, n},
+            workspace,
+            detail::MakeCommParams<ReduceScatter>(workspace, layoutSymmetric, reduceScatterReMapper, args.comm),
+            detail::MakeCommParams<AllGather>(workspace, layoutSymmetric, allGatherReMapper, args.comm),
+            args.ptrD, LayoutD{m, n},
+            args.commInterval,
+            workspaceStages,
+            args.ptrCommSchedule,
+            args.swizzle,
+            args.firstCommInterval,
+            args.tailSplitK,
+            args.tileFlags
+        };
+    }
+
     // Methods
     CATLASS_DEVICE
     MatmulAllReduce()
@@ -113,8 +269,10 @@ public:
     CATLASS_DEVICE
     void operator()<AscendC::AIC>(Params &params)
     {
+        uint32_t workspaceStages = detail::ClampStages(params.workspaceStages, WORKSPACE_STAGES);
         GemmCoord blockShape = L1TileShape::ToCoord();
-        BlockScheduler matmulBlockScheduler(params.problemShape, blockShape.GetCoordMN());
+        auto matmulBlockScheduler = detail::MakeBlockScheduler<BlockScheduler>(params.swizzle,
+            params.problemShape, blockShape.GetCoordMN());
         uint32_t coreLoops = matmulBlockScheduler.GetCoreLoops();
 
         BlockMmad blockMmad(resource);
@@ -130,41 +288,61 @@ public:
         uint32_t aicoreNum = AscendC::GetBlockNum();
 
         uint32_t blockPerComm = aicoreNum * params.commInterval;
-        uint32_t commLoops = CeilDiv(coreLoops, blockPerComm);
+        detail::ChunkRamp chunkRamp(blockPerComm, aicoreNum * params.firstCommInterval);
+        uint32_t commLoops = chunkRamp.GetChunkCount(coreLoops);
+        detail::TailSplit tailSplit(chunkRamp.GetActualSize(commLoops - 1, coreLoops), aicoreNum,
+            CeilDiv(params.problemShape.k(), L1TileShape::K), params.tailSplitK);
 
         AscendC::GlobalTensor<ElementC> gmC;
         gmC.SetGlobalBuffer(reinterpret_cast<__gm__ ElementC *>(params.ptrSymmetric));
 
         auto layoutC = Catlass::layout::RowMajor{
-            WORKSPACE_STAGES * blockPerComm * L1TileShape::M, L1TileShape::N,
+            workspaceStages * blockPerComm * L1TileShape::M, L1TileShape::N,
             L1TileShape::N
         };
 
-        auto layoutCRowLogicShape = Catlass::MakeCoord<int>(WORKSPACE_STAGES, blockPerComm, L1TileShape::M);
+        Block::BlockTileFlags tileFlags(params.ptrSymmetric, GetMatmulAllReduceTileFlags(GetWorkspaceDesc(
+            params.problemShape, params.rankSize, aicoreNum, params.commInterval, workspaceStages,
+            params.firstCommInterval, params.tailSplitK)));
+        bool tileFlagsCleared = (params.tileFlags == 0);
+
+        auto layoutCRowLogicShape = Catlass::MakeCoord<int>(workspaceStages, blockPerComm, L1TileShape::M);
         auto layoutCRow = layout::AffineRankN<3>::Packed(layoutCRowLogicShape);
 
         for (uint32_t commIdx = 0; commIdx < commLoops; ++commIdx) {
-            uint32_t stageId = commIdx % WORKSPACE_STAGES;
+            uint32_t stageId = commIdx % workspaceStages;
 
-            if (commIdx >= WORKSPACE_STAGES) {
+            if (commIdx >= workspaceStages) {
+                WaitTileFlagsCleared(tileFlagsCleared);
                 Catlass::Arch::CrossCoreWaitFlag(flagAivFinishCompute[stageId]);
             }
 
-            uint32_t commBlockOffset = commIdx * blockPerComm;
-            for (
-                uint32_t blockIdxInComm = aicoreIndex, loopIdx = commBlockOffset + aicoreIndex;
-                blockIdxInComm < blockPerComm && loopIdx < coreLoops;
-                blockIdxInComm += aicoreNum, loopIdx = commBlockOffset + blockIdxInComm
-            ) {
+            // Every stage is blockPerComm blocks, a smaller ramp chunk fills the front of its stage
+            uint32_t commBlockOffset = chunkRamp.GetBegin(commIdx);
+            uint32_t actualBlockPerComm = chunkRamp.GetActualSize(commIdx, coreLoops);
+            // A task is one block, or one K slice of a block when the last chunk is split onto idle cores
+            bool splitTail = (commIdx == commLoops - 1) && tailSplit.IsSplit();
+            uint32_t taskCount = splitTail ? tailSplit.GetTaskCount() : actualBlockPerComm;
+            for (uint32_t taskIdx = aicoreIndex; taskIdx < taskCount; taskIdx += aicoreNum) {
+                uint32_t blockIdxInComm = splitTail ? tailSplit.GetTileIdx(taskIdx) : taskIdx;
+
                 // Compute block location
-                GemmCoord blockCoord = matmulBlockScheduler.GetBlockCoord(loopIdx);
+                GemmCoord blockCoord = matmulBlockScheduler.GetBlockCoord(commBlockOffset + blockIdxInComm);
                 GemmCoord actualBlockShape = matmulBlockScheduler.GetActualBlockShape(blockCoord);
 
                 GemmCoord offsetCoord = blockCoord * blockShape;
-                // Compute initial location in logical coordinates
+                if (splitTail) {
+                    uint32_t kOffset;
+                    uint32_t kSize;
+                    tailSplit.GetSliceK(tailSplit.GetSliceIdx(taskIdx), L1TileShape::K, params.problemShape.k(),
+                        kOffset, kSize);
+                    offsetCoord = GemmCoord{offsetCoord.m(), offsetCoord.n(), kOffset};
+                    actualBlockShape = GemmCoord{actualBlockShape.m(), actualBlockShape.n(), kSize};
+                }
+                // Compute initial location in logical coordinates, the slices of a split block follow it
                 auto blockOffsetA = offsetCoord.GetCoordMK();
                 auto blockOffsetB = offsetCoord.GetCoordKN();
-                auto blockOffsetC = MatrixCoord{layoutCRow(Catlass::MakeCoord<int>(stageId, blockIdxInComm, 0)), 0};
+                auto blockOffsetC = MatrixCoord{layoutCRow(Catlass::MakeCoord<int>(stageId, taskIdx, 0)), 0};
 
                 int64_t offsetA = params.layoutA.GetOffset(blockOffsetA);
                 int64_t offsetB = params.layoutB.GetOffset(blockOffsetB);
@@ -177,10 +355,16 @@ public:
                     gmC[offsetC], layoutC,
                     actualBlockShape
                 );
+
+                if (params.tileFlags != 0) {
+                    WaitTileFlagsCleared(tileFlagsCleared);
+                    tileFlags.Publish(stageId, taskIdx, commIdx);
+                }
             }
 
             Catlass::Arch::CrossCoreSetFlag<0x2, PIPE_FIX>(flagAicFinishStore[stageId]);
         }
+        WaitTileFlagsCleared(tileFlagsCleared);
         AscendC::PipeBarrier<PIPE_ALL>();
     }
 
@@ -188,34 +372,52 @@ public:
     CATLASS_DEVICE
     void operator()<AscendC::AIV>(Params &params)
     {
+        uint32_t workspaceStages = detail::ClampStages(params.workspaceStages, WORKSPACE_STAGES);
         MatrixCoord blockShapeMN = L1TileShape::ToCoordMK();
-        BlockScheduler matmulBlockScheduler(params.problemShape, L1TileShape::ToCoordMN());
+        auto matmulBlockScheduler = detail::MakeBlockScheduler<BlockScheduler>(params.swizzle,
+            params.problemShape, L1TileShape::ToCoordMN());
         uint32_t coreLoops = matmulBlockScheduler.GetCoreLoops();
 
         ReduceScatter reduceScatter(resource, params.reduceScatterParams);
         AllGather allGather(resource, params.allGatherParams);
+        SplitkReduce splitkReduce(resource);
 
         uint32_t aicoreIndex = AscendC::GetBlockIdx() / AscendC::GetSubBlockNum();
         uint32_t aicoreNum = AscendC::GetBlockNum();
         uint32_t aivIndex = AscendC::GetSubBlockIdx();
 
         auto blockPerComm = aicoreNum * params.commInterval;
-        auto commLoops = CeilDiv(coreLoops, blockPerComm);
+        detail::ChunkRamp chunkRamp(blockPerComm, aicoreNum * params.firstCommInterval);
+        auto commLoops = chunkRamp.GetChunkCount(coreLoops);
+        detail::TailSplit tailSplit(chunkRamp.GetActualSize(commLoops - 1, coreLoops), aicoreNum,
+            CeilDiv(params.problemShape.k(), L1TileShape::K), params.tailSplitK);
 
         AscendC::GlobalTensor<ElementC> gmC;
         gmC.SetGlobalBuffer(reinterpret_cast<__gm__ ElementC *>(params.ptrSymmetric));
 
         auto layoutC = Catlass::layout::RowMajor(
-            WORKSPACE_STAGES * blockPerComm * L1TileShape::M, L1TileShape::N,
+            workspaceStages * blockPerComm * L1TileShape::M, L1TileShape::N,
             L1TileShape::N
         );
 
+        Block::BlockTileFlags tileFlags(params.ptrSymmetric, GetMatmulAllReduceTileFlags(GetWorkspaceDesc(
+            params.problemShape, params.rankSize, aicoreNum, params.commInterval, workspaceStages,
+            params.firstCommInterval, params.tailSplitK)));
+        if (params.tileFlags != 0) {
+            tileFlags.Clear();
+            AscendC::PipeBarrier<PIPE_ALL>();
+            // No rank may publish or poll a flag before the flags of every rank are cleared
+            shmemx_barrier_all_vec();
+            Catlass::Arch::CrossCoreSetFlag<0x2, PIPE_MTE3>(flagAivFinishCompute[0]);
+        }
+
         AscendC::GlobalTensor<ElementD> gmD;
         gmD.SetGlobalBuffer(reinterpret_cast<__gm__ ElementD *>(params.ptrD));
 
         MatrixCoord commBlockShape = params.reduceScatterParams.BlockShape();
         MatrixCoord commCoreSplit = params.reduceScatterParams.CoreSplit();
-        MatrixCoord commShape = MatrixCoord{blockPerComm, 1} * blockShapeMN;
+        uint32_t blockInComm = chunkRamp.GetActualSize(0, coreLoops);
+        MatrixCoord commShape = MatrixCoord{blockInComm, 1} * blockShapeMN;
         MatrixCoord dataLoopsMx = CeilDiv(commShape, commBlockShape);
         uint32_t dLoopsInRank = CeilDiv(dataLoopsMx.row() * dataLoopsMx.column(), params.rankSize);
         CommScheduler commScheduler(params.rankIdx, params.rankSize, commCoreSplit, 
@@ -223,12 +425,22 @@ public:
         
         auto layoutCommLogicShape = Catlass::MakeCoord<int>(1, dLoopsInRank, commBlockShape.row());
         auto layoutComm = layout::AffineRankN<3>::Packed(layoutCommLogicShape);
+
+        // A schedule built on the host for this launch replaces the per task scheduler math
+        CommScheduleView commSchedule;
+        bool useCommSchedule = false;
+        if (params.ptrCommSchedule != nullptr) {
+            commSchedule = CommScheduleView(params.ptrCommSchedule, CommSchedule::GetSectionNum(chunkRamp.rampCount));
+            useCommSchedule = (commSchedule.layout.coreNum == aicoreNum);
+        }
         
         for (uint32_t commIdx = 0; commIdx < commLoops; ++commIdx) {
-            uint32_t stageId = commIdx % WORKSPACE_STAGES;
+            uint32_t stageId = commIdx % workspaceStages;
             
-            if (commIdx == commLoops - 1) {
-                uint32_t actualBlockInComm = coreLoops - commIdx * blockPerComm;
+            // The ramp chunks and the last chunk change the shape the comm scheduler splits
+            uint32_t actualBlockInComm = chunkRamp.GetActualSize(commIdx, coreLoops);
+            if (actualBlockInComm != blockInComm) {
+                blockInComm = actualBlockInComm;
                 commShape = MatrixCoord{actualBlockInComm, 1} * blockShapeMN;
                 dataLoopsMx = CeilDiv(commShape, commBlockShape);
                 dLoopsInRank = CeilDiv(dataLoopsMx.row() * dataLoopsMx.column(), params.rankSize);
@@ -241,38 +453,93 @@ public:
             auto commCoreLoops = commScheduler.GetCoreLoop();
 
             MatrixCoord stageOffset = MatrixCoord{stageId * blockPerComm, 0} * blockShapeMN;
-            MatrixCoord commOffset = MatrixCoord{commIdx * blockPerComm, 0} * blockShapeMN;
-
-
-            // wait aic
-            Catlass::Arch::CrossCoreWaitFlag(flagAicFinishStore[stageId]);
+            MatrixCoord commOffset = MatrixCoord{chunkRamp.GetBegin(commIdx), 0} * blockShapeMN;
+
+
+            // With tile flags a comm task only waits for the tiles it reads. The split last chunk is summed
+            // before it is communicated and keeps waiting for the whole chunk.
+            bool splitTail = (commIdx == commLoops - 1) && tailSplit.IsSplit();
+            bool waitTiles = (params.tileFlags != 0) && !splitTail;
+            if (!waitTiles) {
+                // wait aic
+                Catlass::Arch::CrossCoreWaitFlag(flagAicFinishStore[stageId]);
+
+                if (splitTail) {
+                    // The slices come from every AIC, all of them must be stored before any AIV sums them
+                    Catlass::Arch::CrossCoreBarrier<0x0, PIPE_MTE3>();
+                    AscendC::PipeBarrier<PIPE_ALL>();
+                    int64_t stageBase = layoutC.GetOffset(stageOffset);
+                    splitkReduce(gmC[stageBase],
+                        static_cast<uint64_t>(tailSplit.tileCount) * L1TileShape::M * L1TileShape::N,
+                        tailSplit.splitK);
+                    AscendC::PipeBarrier<PIPE_ALL>();
+                }
 
-            // Local matmul is completed, waiting until tasks on all devices are complete.
-            shmemx_barrier_all_vec();
+                // Local matmul is completed, waiting until tasks on all devices are complete.
+                shmemx_barrier_all_vec();
+            }
 
-            AscendC::SetAtomicAdd<ElementD>();
+            if constexpr (!IS_DETERMINISTIC) {
+                AscendC::SetAtomicAdd<ElementD>();
+            }
             AscendC::PipeBarrier<PIPE_ALL>();
             reduceScatter.AllocEventID();
             if (aivIndex == 0 && aicoreIndex < commAicoreNum) {
-                for (uint32_t commLoopIdx = aicoreIndex; commLoopIdx < commCoreLoops; commLoopIdx += commAicoreNum) {
-                    MatrixCoord commBlockCoord = commScheduler.GetBlockIdx(commLoopIdx);
-                    MatrixCoord blockOffset = commScheduler.template GetBlockOffset<ReduceScatter::RemoteCopyMode,
-                        ReduceScatter::RemoteCopyDirect>(commBlockCoord, layoutComm);
-                    MatrixCoord actualCommBlockShape = commScheduler.template GetActualBlockShape<
-                        ReduceScatter::RemoteCopyMode, ReduceScatter::RemoteCopyDirect>(commBlockCoord, layoutComm);
-
-                    uint32_t remoteRankIdx = commBlockCoord.column();
-                    if (remoteRankIdx == params.rankIdx) {
+                uint32_t section = CommSchedule::GetSection(false, commIdx, commLoops, chunkRamp.rampCount);
+                uint32_t taskCount = useCommSchedule ? commSchedule.GetTaskCount(section, aicoreIndex) :
+                    GetRoundRobinCount(commCoreLoops, aicoreIndex, commAicoreNum);
+                for (uint32_t taskIdx = 0; taskIdx < taskCount; ++taskIdx) {
+                    MatrixCoord blockOffset;
+                    MatrixCoord actualCommBlockShape;
+                    uint32_t remoteRankIdx;
+                    if (useCommSchedule) {
+                        CommTask task = commSchedule.GetTask(section, aicoreIndex, taskIdx);
+                        blockOffset = MatrixCoord{task.offsetRow, 0};
+                        actualCommBlockShape = MatrixCoord{task.rows, task.columns};
+                        remoteRankIdx = task.peerRankIdx;
+                    } else {
+                        uint32_t commLoopIdx = aicoreIndex + taskIdx * commAicoreNum;
+                        MatrixCoord commBlockCoord = commScheduler.GetBlockIdx(commLoopIdx);
+                        blockOffset = commScheduler.template GetBlockOffset<ReduceScatter::RemoteCopyMode,
+                            ReduceScatter::RemoteCopyDirect>(commBlockCoord, layoutComm);
+                        actualCommBlockShape = commScheduler.template GetActualBlockShape<
+                            ReduceScatter::RemoteCopyMode, ReduceScatter::RemoteCopyDirect>(commBlockCoord, layoutComm);
+                        remoteRankIdx = commBlockCoord.column();
+                    }
+
+                    if (!IS_DETERMINISTIC && remoteRankIdx == params.rankIdx) {
                         continue;
                     }
 
+                    if (waitTiles) {
+                        // The deterministic reduce reads the tiles of every rank, the atomic one adds the
+                        // remote tiles onto the local ones
+                        if constexpr (IS_DETERMINISTIC) {
+                            for (uint32_t srcRankIdx = 0; srcRankIdx < params.rankSize; ++srcRankIdx) {
+                                tileFlags.Wait(srcRankIdx, stageId, blockOffset.row(), actualCommBlockShape.row(),
+                                    L1TileShape::M, commIdx);
+                            }
+                        } else {
+                            tileFlags.Wait(remoteRankIdx, stageId, blockOffset.row(), actualCommBlockShape.row(),
+                                L1TileShape::M, commIdx);
+                            tileFlags.Wait(params.rankIdx, stageId, blockOffset.row(), actualCommBlockShape.row(),
+                                L1TileShape::M, commIdx);
+                        }
+                    }
+
                     auto offsetIn = stageOffset + blockOffset;
                     auto offsetOut = offsetIn;
 
                     auto globalLoopIdx = (commOffset + blockOffset).row() / blockShapeMN.row();
 
-                    reduceScatter(blockShapeMN, offsetOut, offsetIn, actualCommBlockShape,
-                        gmC, layoutC, globalLoopIdx, remoteRankIdx % params.rankSize);
+                    if constexpr (IS_DETERMINISTIC) {
+                        // The reduced slice overwrites the local partial in place
+                        reduceScatter(blockShapeMN, offsetOut, offsetIn, actualCommBlockShape,
+                            gmC, layoutC, globalLoopIdx, params.rankSize);
+                    } else {
+                        reduceScatter(blockShapeMN, offsetOut, offsetIn, actualCommBlockShape,
+                            gmC, layoutC, globalLoopIdx, commScheduler.RankMod(remoteRankIdx));
+                    }
                 }
             }
             reduceScatter.ReleaseEventID();
@@ -280,20 +547,52 @@ public:
             AscendC::WaitFlag<AscendC::HardEvent::MTE3_S>(EVENT_ID0);
             AscendC::SetAtomicNone();
             AscendC::PipeBarrier<PIPE_ALL>();
+            if (waitTiles) {
+                // Every tile was published, the chunk wide flag is only taken to keep the counts balanced
+                Catlass::Arch::CrossCoreWaitFlag(flagAicFinishStore[stageId]);
+            }
 
-            // ReduceScatter is completed, waiting until tasks on all devices are complete.
-            shmemx_barrier_all_vec();
+            if constexpr (PUSH_ALL_GATHER) {
+                // The atomic adds onto a slice come from every local AIV, the slice is reduced once they are
+                // done. The peers still reducing their own slices are not waited for.
+                Catlass::Arch::CrossCoreBarrier<0x0, PIPE_MTE3>();
+                AscendC::PipeBarrier<PIPE_ALL>();
+            } else {
+                // ReduceScatter is completed, waiting until tasks on all devices are complete.
+                shmemx_barrier_all_vec();
+            }
 
+            // The deterministic scheduler only walks the local slice, so the all-gather spreads the ranks itself
+            uint32_t allGatherCoreLoops = IS_DETERMINISTIC ? commCoreLoops * params.rankSize : commCoreLoops;
             allGather.AllocEventID();
             if (aivIndex == 0 && aicoreIndex < commAicoreNum) {
-                for (uint32_t commLoopIdx = aicoreIndex; commLoopIdx < commCoreLoops; commLoopIdx += commAicoreNum) {
-                    MatrixCoord commBlockCoord = commScheduler.GetBlockIdx(commLoopIdx);
-                    MatrixCoord blockOffset = commScheduler.template GetBlockOffset<AllGather::RemoteCopyMode,
-                        AllGather::RemoteCopyDirect>(commBlockCoord, layoutComm);
-                    MatrixCoord actualCommBlockShape = commScheduler.template GetActualBlockShape<
-                        AllGather::RemoteCopyMode, AllGather::RemoteCopyDirect>(commBlockCoord, layoutComm);
-
-                    uint32_t remoteRankIdx = commBlockCoord.column();
+                uint32_t section = CommSchedule::GetSection(true, commIdx, commLoops, chunkRamp.rampCount);
+                uint32_t taskCount = useCommSchedule ? commSchedule.GetTaskCount(section, aicoreIndex) :
+                    GetRoundRobinCount(allGatherCoreLoops, aicoreIndex, commAicoreNum);
+                for (uint32_t taskIdx = 0; taskIdx < taskCount; ++taskIdx) {
+                    MatrixCoord blockOffset;
+                    MatrixCoord actualCommBlockShape;
+                    uint32_t remoteRankIdx;
+                    if (useCommSchedule) {
+                        CommTask task = commSchedule.GetTask(section, aicoreIndex, taskIdx);
+                        blockOffset = MatrixCoord{task.offsetRow, 0};
+                        actualCommBlockShape = MatrixCoord{task.rows, task.columns};
+                        remoteRankIdx = task.peerRankIdx;
+                    } else {
+                        uint32_t commLoopIdx = aicoreIndex + taskIdx * commAicoreNum;
+                        MatrixCoord commBlockCoord;
+                        if constexpr (IS_DETERMINISTIC) {
+                            uint32_t dataIdx = commScheduler.RankDiv(commLoopIdx);
+                            commBlockCoord = MatrixCoord{dataIdx, commScheduler.RankMod(commLoopIdx + dataIdx)};
+                        } else {
+                            commBlockCoord = commScheduler.GetBlockIdx(commLoopIdx);
+                        }
+                        blockOffset = commScheduler.template GetBlockOffset<AllGather::RemoteCopyMode,
+                            AllGather::RemoteCopyDirect>(commBlockCoord, layoutComm);
+                        actualCommBlockShape = commScheduler.template GetActualBlockShape<
+                            AllGather::RemoteCopyMode, AllGather::RemoteCopyDirect>(commBlockCoord, layoutComm);
+                        remoteRankIdx = commBlockCoord.column();
+                    }
 
                     auto offsetIn = stageOffset + blockOffset;
                     auto offsetOut = commOffset + blockOffset;
@@ -301,11 +600,12 @@ public:
                     auto globalLoopIdx = offsetOut.row() / blockShapeMN.row();
 
                     allGather(blockShapeMN, offsetOut, offsetIn, actualCommBlockShape,
-                        gmD, params.layoutD, globalLoopIdx, remoteRankIdx % params.rankSize);
+                        gmD, params.layoutD, globalLoopIdx, commScheduler.RankMod(remoteRankIdx));
                 }
             }
             allGather.ReleaseEventID();
-            // AllGather is completed, waiting until tasks on all devices are complete.
+            // AllGather is completed, waiting until tasks on all devices are complete. With a put all-gather
+            // this is also the point past which no peer reads the partials of the stage
             shmemx_barrier_all_vec();
 
             Catlass::Arch::CrossCoreSetFlag<0x2, PIPE_MTE3>(flagAivFinishCompute[stageId]);
@@ -313,6 +613,17 @@ public:
     }
 
 private:
+    /// With tile flags the AIVs release flagAivFinishCompute[0] once more, ahead of the stage releases, after
+    /// the flags of every rank are cleared. The AIC takes it before its first publish or stage wait.
+    CATLASS_DEVICE
+    void WaitTileFlagsCleared(bool &cleared)
+    {
+        if (!cleared) {
+            Catlass::Arch::CrossCoreWaitFlag(flagAivFinishCompute[0]);
+            cleared = true;
+        }
+    }
+
     // ID used for inter-core synchronization
     Catlass::Arch::CrossCoreFlag flagAicFinishStore[WORKSPACE_STAGES];
     Catlass::Arch::CrossCoreFlag flagAivFinishCompute[WORKSPACE_STAGES];
@@ -2,6 +2,14 @@
 #define CATCOC_DGEMM_KERNEL_MATMUL_REDUCE_SCATTER_HPP
 
 #include "catcoc/catcoc.hpp"
+#include "catcoc/dgemm/block/block_tile_flags.hpp"
+#include "catcoc/dgemm/workspace_size.hpp"
+#include "catcoc/dgemm/kernel/comm_arguments.hpp"
+#include "catcoc/detail/chunk_partition.hpp"
+#include "catcoc/detail/fast_divisor.hpp"
+#include "catcoc/detail/k_slices.hpp"
+#include "catcoc/detail/pipeline_stages.hpp"
+#include "catcoc/detail/rank_partition.hpp"
 
 // from catlass
 #include "catlass/arch/resource.hpp"
@@ -43,6 +51,11 @@ public:
     using CommScheduler = BlockEpilogueScheduler_;
 
     static constexpr uint32_t WORKSPACE_STAGES = WORKSPACE_STAGES_;
+    static_assert(WORKSPACE_STAGES >= 1 && WORKSPACE_STAGES <= detail::MAX_WORKSPACE_STAGES,
+        "Each workspace stage needs its own cross-core flag ID.");
+    static constexpr bool IS_DETERMINISTIC = CommScheduler::IS_DETERMINISTIC;
+    static_assert(ReduceScatter::DispatchPolicy::IsDeterministic == IS_DETERMINISTIC,
+        "Deterministic comm scheduler must be paired with a deterministic reduce epilogue.");
 
     /// Parameters structure
     struct Params {
@@ -63,6 +76,18 @@ public:
         LayoutD layoutD;
 
         uint32_t commInterval;
+        // Pipeline depth used at runtime, at most WORKSPACE_STAGES
+        uint32_t workspaceStages{WORKSPACE_STAGES};
+        // Tile order of a GemmDynamicBlockSwizzle scheduler, the remapper of the epilogue params must use it too
+        Block::GemmSwizzle swizzle;
+        // commInterval of the first chunk, the chunks double up to commInterval, 0 keeps them uniform
+        uint32_t firstCommInterval{0};
+        // K slices of every block, summed by the reduce-scatter, 0 or 1 keeps blocks whole
+        uint32_t splitK{0};
+        // Non-zero lets the comm tasks wait for the tiles they read instead of the whole chunk
+        uint32_t tileFlags{0};
+        // Non-zero makes the AIC store every partial into the workspace of the rank that reduces it
+        uint32_t pushStore{0};
 
         // Methods
         CATLASS_DEVICE
@@ -77,7 +102,13 @@ public:
             GM_ADDR ptrSymmetric_,
             ReduceScatterParams const &reduceScatterParams_,
             GM_ADDR ptrD_, LayoutD const &layoutD_,
-            uint32_t commInterval_
+            uint32_t commInterval_,
+            uint32_t workspaceStages_ = WORKSPACE_STAGES,
+            Block::GemmSwizzle const &swizzle_ = Block::GemmSwizzle{},
+            uint32_t firstCommInterval_ = 0,
+            uint32_t splitK_ = 0,
+            uint32_t tileFlags_ = 0,
+            uint32_t pushStore_ = 0
         ) : problemShape(problemShape_),
             rankIdx(rank_), rankSize(rankSize_),
             ptrA(ptrA_), layoutA(layoutA_),
@@ -85,9 +116,124 @@ public:
             ptrSymmetric(ptrSymmetric_),
             reduceScatterParams(reduceScatterParams_),
             ptrD(ptrD_), layoutD(layoutD_),
-            commInterval(commInterval_) {}
+            commInterval(commInterval_), workspaceStages(workspaceStages_), swizzle(swizzle_),
+            firstCommInterval(firstCommInterval_), splitK(splitK_), tileFlags(tileFlags_), pushStore(pushStore_) {}
     };
 
+    CATLASS_HOST_DEVICE
+    static WorkspaceDesc GetWorkspaceDesc(GemmCoord const &problemShape, uint32_t rankSize, uint32_t coreNum,
+        uint32_t commInterval, uint32_t workspaceStages = WORKSPACE_STAGES, uint32_t firstCommInterval = 0,
+        uint32_t splitK = 0, uint32_t tileFlags = 0)
+    {
+        WorkspaceDesc desc{problemShape, L1TileShape::ToCoord(), rankSize, coreNum, commInterval,
+            workspaceStages, static_cast<uint32_t>(sizeof(ElementC)), firstCommInterval};
+        desc.splitK = splitK;
+        desc.tileFlags = tileFlags;
+        return desc;
+    }
+
+    /// Symmetric workspace bytes one rank needs for a launch on coreNum blocks, the
+    /// layout of ptrSymmetric never goes past it
+    CATLASS_HOST_DEVICE
+    static size_t GetWorkspaceSize(GemmCoord const &problemShape, uint32_t rankSize, uint32_t coreNum,
+        uint32_t commInterval, uint32_t workspaceStages = WORKSPACE_STAGES, uint32_t firstCommInterval = 0,
+        uint32_t splitK = 0, uint32_t tileFlags = 0)
+    {
+        return GetMatmulReduceScatterWorkspaceSize(GetWorkspaceDesc(problemShape, rankSize, coreNum, commInterval,
+            workspaceStages, firstCommInterval, splitK, tileFlags));
+    }
+
+    /// Host side arguments, checked and sized by Device::DeviceDGemm before the launch
+    struct Arguments {
+        /// Whole problem, rank r receives RankPartition(m, rankSize).GetExtent(r) rows of D
+        GemmCoord problemShape;
+        uint32_t rankIdx;
+        uint32_t rankSize;
+        /// Launch block count, the workspace layout depends on it
+        uint32_t coreNum;
+        GM_ADDR ptrA;
+        GM_ADDR ptrB;
+        GM_ADDR ptrD;
+        uint32_t commInterval;
+        uint32_t workspaceStages{WORKSPACE_STAGES};
+        CommArguments comm;
+        /// Tile order of the matmul, used when BlockScheduler is GemmDynamicBlockSwizzle
+        Block::GemmSwizzle swizzle;
+        /// commInterval of the first chunk, see detail::ChunkRamp
+        uint32_t firstCommInterval{0};
+        /// K slices of every block, see detail::KSlices. Meant for a per-rank M too small to fill the cores
+        uint32_t splitK{0};
+        /// Per tile ready flags after the stages, see Block::BlockTileFlags
+        uint32_t tileFlags{0};
+        /// Partials are pushed from the fixpipe into the workspace of their target rank, which then reduces
+        /// them from local memory. The workspace size does not change
+        uint32_t pushStore{0};
+    };
+
+    static bool CanImplement(Arguments const &args)
+    {
+        if (args.problemShape.m() == 0 || args.problemShape.n() == 0 || args.problemShape.k() == 0) {
+            return false;
+        }
+        if (args.rankSize == 0 || args.rankIdx >= args.rankSize || args.coreNum == 0 || args.commInterval == 0) {
+            return false;
+        }
+        // A comm scheduler specialized on the rank count only holds for that count
+        if (!detail::RankDivisor<CommScheduler::RANK_SIZE>::Matches(args.rankSize)) {
+            return false;
+        }
+        if (!detail::IsValidWorkspaceStages(args.workspaceStages) || args.workspaceStages > WORKSPACE_STAGES) {
+            return false;
+        }
+        if (args.ptrA == nullptr || args.ptrB == nullptr || args.ptrD == nullptr) {
+            return false;
+        }
+        if (!detail::IsValidSwizzle<BlockScheduler>(args.swizzle)) {
+            return false;
+        }
+        return detail::CanImplementComm<ReduceScatter>(args.comm, args.coreNum);
+    }
+
+    static size_t GetWorkspaceSize(Arguments const &args)
+    {
+        return GetWorkspaceSize(args.problemShape, args.rankSize, args.coreNum, args.commInterval,
+            args.workspaceStages, args.firstCommInterval, args.splitK, args.tileFlags);
+    }
+
+    CATLASS_DEVICE
+    static Params ToUnderlyingArguments(Arguments const &args, GM_ADDR workspace)
+    {
+        uint32_t m = args.problemShape.m();
+        uint32_t n = args.problemShape.n();
+        uint32_t k = args.problemShape.k();
+        uint32_t workspaceStages = detail::ClampStages(args.workspaceStages, WORKSPACE_STAGES);
+        detail::RankPartition rankPartition(m, args.rankSize);
+        uint32_t mInRank = rankPartition.GetExtent(args.rankIdx);
+        Catlass::layout::RowMajor layoutSymmetric{
+            L1TileShape::M * args.commInterval * args.coreNum * workspaceStages, L1TileShape::N, L1TileShape::N
+        };
+        // Remap over the tile grid of the largest share, the shape is clipped to the rows owned by this rank
+        MatrixCoord tileMN = L1TileShape::ToCoordMN();
+        auto reduceScatterReMapper = detail::MakeBlockScheduler<typename ReduceScatter::GemmReMapper>(args.swizzle,
+            GemmCoord{mInRank, n, k}, tileMN, CeilDiv(MatrixCoord{rankPartition.GetMaxExtent(), n}, tileMN));
+        return Params{
+            args.problemShape,
+            args.rankIdx, args.rankSize,
+            args.ptrA, LayoutA{m, k},
+            args.ptrB, LayoutB{k, n},
+            workspace,
+            detail::MakeCommParams<ReduceScatter>(workspace, layoutSymmetric, reduceScatterReMapper, args.comm),
+            args.ptrD, LayoutD{mInRank, n},
+            args.commInterval,
+            workspaceStages,
+            args.swizzle,
+            args.firstCommInterval,
+            args.splitK,
+            args.tileFlags,
+            args.pushStore
+        };
+    }
+
     // Methods
     CATLASS_DEVICE
     MatmulReduceScatter()
@@ -106,16 +252,22 @@ public:
     CATLASS_DEVICE
     void operator()<AscendC::AIC>(Params &params)
     {
+        uint32_t workspaceStages = detail::ClampStages(params.workspaceStages, WORKSPACE_STAGES);
         uint32_t aicoreIndex = AscendC::GetBlockIdx();
         uint32_t aicoreNum = AscendC::GetBlockNum();
-        uint32_t blockPerComm = aicoreNum * params.commInterval;
-        uint32_t blockPerCommInRank = blockPerComm / params.rankSize;
 
         GemmCoord blockShape = L1TileShape::ToCoord();
-        GemmCoord problemShapeInRank = params.problemShape / Catlass::MakeCoord<uint32_t>(params.rankSize, 1, 1);
-        BlockScheduler matmulBlockScheduler(problemShapeInRank, blockShape.GetCoordMN());
-        uint32_t coreLoops = matmulBlockScheduler.GetCoreLoops() * params.rankSize;
-        uint32_t commLoops = CeilDiv(coreLoops, blockPerComm);
+        // Every rank walks the tile grid of the largest rank share, blocks past a rank's own rows are skipped
+        detail::RankPartition rankPartition(params.problemShape.m(), params.rankSize);
+        GemmCoord problemShapeInRank{rankPartition.GetMaxExtent(), params.problemShape.n(), params.problemShape.k()};
+        auto matmulBlockScheduler = detail::MakeBlockScheduler<BlockScheduler>(params.swizzle,
+            problemShapeInRank, blockShape.GetCoordMN());
+        detail::KSlices kSlices(CeilDiv(params.problemShape.k(), L1TileShape::K), params.splitK);
+        detail::ChunkPartition chunkPartition = detail::MakeSplitKChunkPartition(params.rankSize, aicoreNum,
+            params.commInterval, params.firstCommInterval, matmulBlockScheduler.GetCoreLoops(), kSlices.splitK);
+        uint32_t commLoops = chunkPartition.GetChunkCount();
+        // Each rank owns a segment of GetSlotsInRank() blocks in every workspace stage, once per K slice
+        uint32_t blockPerStage = chunkPartition.GetSlotsInRank() * params.rankSize * kSlices.splitK;
 
         BlockMmad blockMmad(resource);
 
@@ -130,53 +282,91 @@ public:
         gmD.SetGlobalBuffer(reinterpret_cast<__gm__ ElementC *>(params.ptrD));
 
         auto layoutC = Catlass::layout::RowMajor{
-            WORKSPACE_STAGES * blockPerComm * L1TileShape::M, L1TileShape::N,
+            workspaceStages * blockPerStage * L1TileShape::M, L1TileShape::N,
             L1TileShape::N
         };
 
-        auto layoutCRowLogicShape = Catlass::MakeCoord<int>(WORKSPACE_STAGES, blockPerComm, L1TileShape::M);
+        auto layoutCRowLogicShape = Catlass::MakeCoord<int>(workspaceStages, blockPerStage, L1TileShape::M);
         auto layoutCRow = layout::AffineRankN<3>::Packed(layoutCRowLogicShape);
 
+        Block::BlockTileFlags tileFlags(params.ptrSymmetric, GetMatmulReduceScatterTileFlags(GetWorkspaceDesc(
+            params.problemShape, params.rankSize, aicoreNum, params.commInterval, workspaceStages,
+            params.firstCommInterval, params.splitK)));
+        bool tileFlagsCleared = (params.tileFlags == 0);
+        bool pushStore = (params.pushStore != 0);
+
         for (uint32_t commIdx = 0; commIdx < commLoops; ++commIdx) {
-            uint32_t stageId = commIdx % WORKSPACE_STAGES;
+            uint32_t stageId = commIdx % workspaceStages;
 
-            if (commIdx >= WORKSPACE_STAGES) {
+            if (commIdx >= workspaceStages) {
+                WaitTileFlagsCleared(tileFlagsCleared);
                 Catlass::Arch::CrossCoreWaitFlag(flagAivFinishCompute[stageId]);
             }
 
-            uint32_t actualBlockPerComm = (commIdx == commLoops - 1) ?
-                (coreLoops - blockPerComm * commIdx) : blockPerComm;
-            uint32_t actualBlockPerCommInRank = actualBlockPerComm / params.rankSize;
-
-            uint32_t commBlockOffsetInRank = commIdx * blockPerCommInRank;
-            for (
-                uint32_t blockIdxInComm = aicoreIndex;
-                blockIdxInComm < actualBlockPerComm;
-                blockIdxInComm += aicoreNum
-            ) {
-                uint32_t loopIdxInRank = commBlockOffsetInRank + blockIdxInComm % actualBlockPerCommInRank;
-                uint32_t targetRankIdx = blockIdxInComm / actualBlockPerCommInRank;
+            uint32_t actualBlockPerComm = chunkPartition.GetTotalCount(commIdx);
+            uint32_t segmentInRank = chunkPartition.GetMaxCount(commIdx);
+            // The slices of a chunk are stored one after another, each laid out like an unsplit chunk
+            uint32_t taskCount = actualBlockPerComm * kSlices.splitK;
+
+            for (uint32_t taskIdx = aicoreIndex; taskIdx < taskCount; taskIdx += aicoreNum) {
+                // Tasks follow the order the comm tasks consume them in. The atomic reduce adds one slice of
+                // the chunk after another, the deterministic one reads all slices of a block at once
+                uint32_t sliceIdx = IS_DETERMINISTIC ? taskIdx % kSlices.splitK : taskIdx / actualBlockPerComm;
+                uint32_t blockIdxInComm = IS_DETERMINISTIC ? taskIdx / kSlices.splitK : taskIdx % actualBlockPerComm;
+                // Every segment is read from its first block on, the target ranks take turns block by block
+                uint32_t targetRankIdx;
+                uint32_t blockIdxInRank;
+                chunkPartition.LocateInterleaved(blockIdxInComm, commIdx, targetRankIdx, blockIdxInRank);
+                uint32_t loopIdxInRank = chunkPartition.GetOffset(targetRankIdx, commIdx) + blockIdxInRank;
+                // A pulled partial stays in the local stage, in the segment of its target rank. A pushed one
+                // lands in the stage of its target rank, in the segment of the rank that computed it
+                uint32_t storeRankIdx = pushStore ? targetRankIdx : params.rankIdx;
+                uint32_t segmentIdx = pushStore ? params.rankIdx : targetRankIdx;
+                uint32_t slotIdxInComm = (sliceIdx * params.rankSize + segmentIdx) * segmentInRank + blockIdxInRank;
                 // Compute block location
                 GemmCoord blockCoord = matmulBlockScheduler.GetBlockCoord(loopIdxInRank);
                 GemmCoord actualBlockShape = matmulBlockScheduler.GetActualBlockShape(blockCoord);
 
                 GemmCoord offsetCoord = blockCoord * blockShape;
+                uint32_t targetExtent = rankPartition.GetExtent(targetRankIdx);
+                if (offsetCoord.m() >= targetExtent) {
+                    // The comm tasks over the slot still wait for it
+                    if (params.tileFlags != 0) {
+                        WaitTileFlagsCleared(tileFlagsCleared);
+                        tileFlags.Publish(storeRankIdx, stageId, slotIdxInComm, commIdx);
+                    }
+                    continue;
+                }
+                uint32_t kOffset;
+                uint32_t kSize;
+                kSlices.GetSliceK(sliceIdx, L1TileShape::K, params.problemShape.k(), kOffset, kSize);
+                offsetCoord = GemmCoord{offsetCoord.m(), offsetCoord.n(), kOffset};
+                actualBlockShape = GemmCoord{
+                    Min(actualBlockShape.m(), targetExtent - offsetCoord.m()), actualBlockShape.n(), kSize
+                };
                 // Compute initial location in logical coordinates
-                auto rankOffsetA = problemShapeInRank.GetCoordMK() * Catlass::MakeCoord<uint32_t>(targetRankIdx, 0);
+                auto rankOffsetA = Catlass::MakeCoord<uint32_t>(rankPartition.GetOffset(targetRankIdx), 0);
                 auto blockOffsetA = offsetCoord.GetCoordMK() + rankOffsetA;
                 auto blockOffsetB = offsetCoord.GetCoordKN();
                 
                 MatrixCoord blockOffsetStore;
                 AscendC::GlobalTensor<ElementC> gmStore;
                 Catlass::layout::RowMajor layoutStore;
-                if (targetRankIdx == params.rankIdx) {
+                // In deterministic mode the local partial joins the rank-ordered reduction as well, the other
+                // K slices of a local block are added to D by the reduce-scatter
+                if (targetRankIdx == params.rankIdx && sliceIdx == 0 && !IS_DETERMINISTIC) {
                     blockOffsetStore = offsetCoord.GetCoordMN();
                     gmStore = gmD;
                     layoutStore = params.layoutD;
                 }
                 else {
-                    blockOffsetStore = MatrixCoord{layoutCRow(Catlass::MakeCoord<int>(stageId, blockIdxInComm, 0)), 0};
+                    blockOffsetStore = MatrixCoord{layoutCRow(Catlass::MakeCoord<int>(stageId, slotIdxInComm, 0)), 0};
                     gmStore = gmC;
+                    if (storeRankIdx != params.rankIdx) {
+                        // The fixpipe writes the partial through the symmetric address of the target rank
+                        gmStore.SetGlobalBuffer(reinterpret_cast<__gm__ ElementC *>(
+                            shmem_ptr(params.ptrSymmetric, static_cast<int>(storeRankIdx))));
+                    }
                     layoutStore = layoutC;
                 }
                 
@@ -191,10 +381,17 @@ public:
                     gmStore[offsetStore], layoutStore,
                     actualBlockShape
                 );
+
+                // A local tile stored to D is published under its slot as well
+                if (params.tileFlags != 0) {
+                    WaitTileFlagsCleared(tileFlagsCleared);
+                    tileFlags.Publish(storeRankIdx, stageId, slotIdxInComm, commIdx);
+                }
             }
 
             Catlass::Arch::CrossCoreSetFlag<0x2, PIPE_FIX>(flagAicFinishStore[stageId]);
         }
+        WaitTileFlagsCleared(tileFlagsCleared);
         AscendC::PipeBarrier<PIPE_ALL>();
     }
 
@@ -202,29 +399,46 @@ public:
     CATLASS_DEVICE
     void operator()<AscendC::AIV>(Params &params)
     {
+        uint32_t workspaceStages = detail::ClampStages(params.workspaceStages, WORKSPACE_STAGES);
         uint32_t aicoreIndex = AscendC::GetBlockIdx() / AscendC::GetSubBlockNum();
         uint32_t aicoreNum = AscendC::GetBlockNum();
         uint32_t aivIndex = AscendC::GetSubBlockIdx();
-        uint32_t blockPerComm = aicoreNum * params.commInterval;
-        uint32_t blockPerCommInRank = blockPerComm / params.rankSize;
 
         MatrixCoord blockShapeMN = L1TileShape::ToCoordMN();
-        GemmCoord problemShapeInRank = params.problemShape / Catlass::MakeCoord<uint32_t>(params.rankSize, 1, 1);
-        BlockScheduler matmulBlockScheduler(problemShapeInRank, blockShapeMN);
-        uint32_t coreLoops = matmulBlockScheduler.GetCoreLoops() * params.rankSize;
-        auto commLoops = CeilDiv(coreLoops, blockPerComm);
+        detail::RankPartition rankPartition(params.problemShape.m(), params.rankSize);
+        GemmCoord problemShapeInRank{rankPartition.GetMaxExtent(), params.problemShape.n(), params.problemShape.k()};
+        auto matmulBlockScheduler = detail::MakeBlockScheduler<BlockScheduler>(params.swizzle,
+            problemShapeInRank, blockShapeMN);
+        detail::KSlices kSlices(CeilDiv(params.problemShape.k(), L1TileShape::K), params.splitK);
+        detail::ChunkPartition chunkPartition = detail::MakeSplitKChunkPartition(params.rankSize, aicoreNum,
+            params.commInterval, params.firstCommInterval, matmulBlockScheduler.GetCoreLoops(), kSlices.splitK);
+        auto commLoops = chunkPartition.GetChunkCount();
+        uint32_t blockPerStage = chunkPartition.GetSlotsInRank() * params.rankSize * kSlices.splitK;
 
         ReduceScatter reduceScatter(resource, params.reduceScatterParams);
 
         AscendC::GlobalTensor<ElementC> gmC;
         gmC.SetGlobalBuffer(reinterpret_cast<__gm__ ElementC *>(params.ptrSymmetric));
 
+        Block::BlockTileFlags tileFlags(params.ptrSymmetric, GetMatmulReduceScatterTileFlags(GetWorkspaceDesc(
+            params.problemShape, params.rankSize, aicoreNum, params.commInterval, workspaceStages,
+            params.firstCommInterval, params.splitK)));
+        if (params.tileFlags != 0) {
+            tileFlags.Clear();
+            AscendC::PipeBarrier<PIPE_ALL>();
+            // No rank may publish or poll a flag before the flags of every rank are cleared
+            shmemx_barrier_all_vec();
+            Catlass::Arch::CrossCoreSetFlag<0x2, PIPE_MTE3>(flagAivFinishCompute[0]);
+        }
+
         AscendC::GlobalTensor<ElementD> gmD;
         gmD.SetGlobalBuffer(reinterpret_cast<__gm__ ElementD *>(params.ptrD));
 
         MatrixCoord commBlockShape = params.reduceScatterParams.BlockShape();
         MatrixCoord commCoreSplit = params.reduceScatterParams.CoreSplit();
-        MatrixCoord commShape = MatrixCoord{blockPerComm, 1} * blockShapeMN;
+        // The chunk is seen as rankSize segments of segmentInRank blocks, one per target rank
+        uint32_t segmentInRank = chunkPartition.GetMaxCount(0);
+        MatrixCoord commShape = MatrixCoord{segmentInRank * params.rankSize, 1} * blockShapeMN;
         MatrixCoord dataLoopsMx = CeilDiv(commShape, commBlockShape);
         uint32_t dLoopsInRank = CeilDiv(dataLoopsMx.row() * dataLoopsMx.column(), params.rankSize);
         CommScheduler commScheduler(params.rankIdx, params.rankSize, commCoreSplit, 
@@ -235,10 +449,10 @@ public:
         auto layoutComm = layout::AffineRankN<3>::Packed(layoutCommLogicShape);
 
         for (uint32_t commIdx = 0; commIdx < commLoops; ++commIdx) {
-            uint32_t stageId = commIdx % WORKSPACE_STAGES;
-            if (commIdx == commLoops - 1) {
-                uint32_t actualBlockInComm = coreLoops - commIdx * blockPerComm;
-                commShape = MatrixCoord{actualBlockInComm, 1} * blockShapeMN;
+            uint32_t stageId = commIdx % workspaceStages;
+            if (chunkPartition.GetMaxCount(commIdx) != segmentInRank) {
+                segmentInRank = chunkPartition.GetMaxCount(commIdx);
+                commShape = MatrixCoord{segmentInRank * params.rankSize, 1} * blockShapeMN;
                 dataLoopsMx = CeilDiv(commShape, commBlockShape);
                 dLoopsInRank = CeilDiv(dataLoopsMx.row() * dataLoopsMx.column(), params.rankSize);
                 commScheduler.Update(commShape, commBlockShape, dLoopsInRank);
@@ -249,39 +463,81 @@ public:
             auto commAicoreNum = commScheduler.GetRealCore();
             auto commCoreLoops = commScheduler.GetCoreLoop();
 
-            MatrixCoord stageOffset = MatrixCoord{stageId * blockPerComm, 0} * blockShapeMN;
-            MatrixCoord commOffsetInRank = MatrixCoord{commIdx * blockPerCommInRank, 0} * blockShapeMN;
-
-            // wait aic
-            Catlass::Arch::CrossCoreWaitFlag(flagAicFinishStore[stageId]);
-            //TODO: do block dequant-op
-            // Local matmul is completed, waiting until tasks on all devices are complete.
-            shmemx_barrier_all_vec();
+            MatrixCoord stageOffset = MatrixCoord{stageId * blockPerStage, 0} * blockShapeMN;
+            MatrixCoord commOffsetInRank =
+                MatrixCoord{chunkPartition.GetOffset(params.rankIdx, commIdx), 0} * blockShapeMN;
+            // Blocks of the local segment past this count were not computed in this chunk
+            uint32_t blockCountInRank = chunkPartition.GetCount(params.rankIdx, commIdx);
+
+            // With tile flags a comm task only waits for the tiles it reads
+            if (params.tileFlags == 0) {
+                // wait aic
+                Catlass::Arch::CrossCoreWaitFlag(flagAicFinishStore[stageId]);
+                //TODO: do block dequant-op
+                // Local matmul is completed, waiting until tasks on all devices are complete.
+                shmemx_barrier_all_vec();
+            }
 
-            AscendC::SetAtomicAdd<ElementD>();
+            if constexpr (!IS_DETERMINISTIC) {
+                AscendC::SetAtomicAdd<ElementD>();
+            }
             AscendC::PipeBarrier<PIPE_ALL>();
             reduceScatter.AllocEventID();
+            // The K slices of the chunk are segmentInRank * rankSize blocks apart in the stage. The atomic
+            // reduce adds them to D one by one, the deterministic one sums the slices of every rank itself
+            uint32_t sliceStrideRows = segmentInRank * params.rankSize * blockShapeMN.row();
+            uint32_t sliceLoops = IS_DETERMINISTIC ? 1 : kSlices.splitK;
             if (aivIndex == 0 && aicoreIndex < commAicoreNum) {
-                for (uint32_t commLoopIdx = aicoreIndex; commLoopIdx < commCoreLoops; commLoopIdx += commAicoreNum) {
-                    MatrixCoord commBlockCoord = commScheduler.GetBlockIdx(commLoopIdx);
-                    MatrixCoord blockOffset = commScheduler.template GetBlockOffset<ReduceScatter::RemoteCopyMode,
-                        ReduceScatter::RemoteCopyDirect>(commBlockCoord, layoutComm);
-                    MatrixCoord actualCommBlockShape = commScheduler.template GetActualBlockShape<
-                        ReduceScatter::RemoteCopyMode, ReduceScatter::RemoteCopyDirect>(commBlockCoord, layoutComm);
-                    MatrixCoord blockOffsetInRank = blockOffset % actualCommShapeInRank;
-
-                    uint32_t remoteRankIdx = commBlockCoord.column();
-                    if (remoteRankIdx == params.rankIdx) {
-                        continue;
+                for (uint32_t sliceIdx = 0; sliceIdx < sliceLoops; ++sliceIdx) {
+                    for (uint32_t commLoopIdx = aicoreIndex; commLoopIdx < commCoreLoops;
+                        commLoopIdx += commAicoreNum) {
+                        MatrixCoord commBlockCoord = commScheduler.GetBlockIdx(commLoopIdx);
+                        MatrixCoord blockOffset = commScheduler.template GetBlockOffset<ReduceScatter::RemoteCopyMode,
+                            ReduceScatter::RemoteCopyDirect>(commBlockCoord, layoutComm);
+                        MatrixCoord actualCommBlockShape = commScheduler.template GetActualBlockShape<
+                            ReduceScatter::RemoteCopyMode, ReduceScatter::RemoteCopyDirect>(commBlockCoord, layoutComm);
+                        MatrixCoord blockOffsetInRank = blockOffset % actualCommShapeInRank;
+                        if (blockOffsetInRank.row() / blockShapeMN.row() >= blockCountInRank) {
+                            continue;
+                        }
+
+                        uint32_t remoteRankIdx = commBlockCoord.column();
+                        // Slice 0 of a local block was stored to D by the AIC
+                        if (!IS_DETERMINISTIC && remoteRankIdx == params.rankIdx && sliceIdx == 0) {
+                            continue;
+                        }
+
+                        // Pushed partials are read from the local stage, which holds one segment per source rank
+                        uint32_t srcRankIdx = commScheduler.RankMod(remoteRankIdx);
+                        MatrixCoord srcOffset = blockOffset;
+                        uint32_t rankStrideRows = 0;
+                        if (params.pushStore != 0) {
+                            rankStrideRows = actualCommShapeInRank.row();
+                            srcOffset = IS_DETERMINISTIC ? blockOffsetInRank :
+                                MatrixCoord{remoteRankIdx * rankStrideRows, 0} + blockOffsetInRank;
+                            srcRankIdx = params.rankIdx;
+                        }
+
+                        if (params.tileFlags != 0) {
+                            WaitCommTiles(tileFlags, params, stageId, commIdx, actualCommBlockShape.row(),
+                                srcRankIdx, srcOffset.row(), blockOffset.row(), sliceIdx, sliceStrideRows,
+                                rankStrideRows);
+                        }
+
+                        auto offsetIn = stageOffset + srcOffset + MatrixCoord{sliceIdx * sliceStrideRows, 0};
+                        auto offsetOut = commOffsetInRank + blockOffsetInRank;
+
+                        auto globalLoopIdx = offsetOut.row() / blockShapeMN.row();
+
+                        if constexpr (IS_DETERMINISTIC) {
+                            reduceScatter(blockShapeMN, offsetOut, offsetIn, actualCommBlockShape,
+                                gmD, params.layoutD, globalLoopIdx, params.rankSize, kSlices.splitK, sliceStrideRows,
+                                rankStrideRows);
+                        } else {
+                            reduceScatter(blockShapeMN, offsetOut, offsetIn, actualCommBlockShape,
+                                gmD, params.layoutD, globalLoopIdx, srcRankIdx);
+                        }
                     }
-
-                    auto offsetIn = stageOffset + blockOffset;
-                    auto offsetOut = commOffsetInRank + blockOffsetInRank;
-
-                    auto globalLoopIdx = offsetOut.row() / blockShapeMN.row();
-
-                    reduceScatter(blockShapeMN, offsetOut, offsetIn, actualCommBlockShape,
-                        gmD, params.layoutD, globalLoopIdx, remoteRankIdx % params.rankSize);
                 }
             }
             reduceScatter.ReleaseEventID();
@@ -289,6 +545,10 @@ public:
             AscendC::WaitFlag<AscendC::HardEvent::MTE3_S>(EVENT_ID0);
             AscendC::SetAtomicNone();
             AscendC::PipeBarrier<PIPE_ALL>();
+            if (params.tileFlags != 0) {
+                // Every tile was published, the chunk wide flag is only taken to keep the counts balanced
+                Catlass::Arch::CrossCoreWaitFlag(flagAicFinishStore[stageId]);
+            }
 
             // ReduceScatter is completed, waiting until tasks on all devices are complete.
             shmemx_barrier_all_vec();
@@ -298,6 +558,43 @@ public:
     }
 
 private:
+    /// With tile flags the AIVs release flagAivFinishCompute[0] once more, ahead of the stage releases, after
+    /// the flags of every rank are cleared. The AIC takes it before its first publish or stage wait.
+    CATLASS_DEVICE
+    void WaitTileFlagsCleared(bool &cleared)
+    {
+        if (!cleared) {
+            Catlass::Arch::CrossCoreWaitFlag(flagAivFinishCompute[0]);
+            cleared = true;
+        }
+    }
+
+    /// Waits for the tiles under the rows of a comm task, read at srcRowOffset of the stage of srcRankIdx.
+    /// The deterministic reduce reads every K slice of every rank, which are rankStrideRows apart in the
+    /// local stage when they were pushed. The atomic one adds K slice sliceIdx onto D, where the AIC stored
+    /// slice 0 of the local tile, whose slot is at localRowOffset of the local stage.
+    CATLASS_DEVICE
+    void WaitCommTiles(Block::BlockTileFlags &tileFlags, Params const &params, uint32_t stageId, uint32_t commIdx,
+        uint32_t rows, uint32_t srcRankIdx, uint32_t srcRowOffset, uint32_t localRowOffset, uint32_t sliceIdx,
+        uint32_t sliceStrideRows, uint32_t rankStrideRows)
+    {
+        if constexpr (IS_DETERMINISTIC) {
+            uint32_t splitK = detail::KSlices(CeilDiv(params.problemShape.k(), L1TileShape::K), params.splitK).splitK;
+            for (uint32_t rankIdx = 0; rankIdx < params.rankSize; ++rankIdx) {
+                uint32_t flagRankIdx = (rankStrideRows != 0) ? params.rankIdx : rankIdx;
+                for (uint32_t srcSliceIdx = 0; srcSliceIdx < splitK; ++srcSliceIdx) {
+                    tileFlags.Wait(flagRankIdx, stageId,
+                        srcRowOffset + rankIdx * rankStrideRows + srcSliceIdx * sliceStrideRows, rows,
+                        L1TileShape::M, commIdx);
+                }
+            }
+        } else {
+            tileFlags.Wait(srcRankIdx, stageId, srcRowOffset + sliceIdx * sliceStrideRows, rows,
+                L1TileShape::M, commIdx);
+            tileFlags.Wait(params.rankIdx, stageId, localRowOffset, rows, L1TileShape::M, commIdx);
+        }
+    }
+
     // ID used for inter-core synchronization
     Catlass::Arch::CrossCoreFlag flagAicFinishStore[WORKSPACE_STAGES];
     Catlass::Arch::CrossCoreFlag flagAivFinishCompute[WORKSPACE_STAGES];
@@ -4,6 +4,10 @@
 
 // Include dependent headers
 #include "catcoc/catcoc.hpp"                     // Core header file for the catcoc library, may contain communication primitives, etc.
+#include "catcoc/dgemm/workspace_size.hpp"      // Exact size of the symmetric workspace
+#include "catcoc/detail/chunk_partition.hpp"    // Round-robin split of each communication chunk over ranks
+#include "catcoc/detail/pipeline_stages.hpp"    // Limits of the runtime workspace pipeline depth
+#include "catcoc/detail/rank_partition.hpp"     // Ragged split of the M dimension over ranks
 #include "catlass/arch/resource.hpp"             // Definitions for hardware resource management in the catlass library
 #include "catlass/arch/cross_core_sync.hpp"      // Tools for inter-core synchronization in the catlass library, such as Flag
 #include "catlass/gemm_coord.hpp"                // Structures for representing GEMM (General Matrix Multiplication) related coordinates in the catlass library
@@ -50,6 +54,12 @@ public:
     using BlockScheduler = BlockScheduler_;
     using CommScheduler = BlockEpilogueScheduler_;
     static constexpr uint32_t WORKSPACE_STAGES = WORKSPACE_STAGES_; // Number of pipeline stages
+    static_assert(WORKSPACE_STAGES >= 1 && WORKSPACE_STAGES <= detail::MAX_WORKSPACE_STAGES,
+        "Each workspace stage needs its own cross-core flag ID.");
+    // Deterministic mode: every rank sums the int32 partials of all ranks in rank order without atomics
+    static constexpr bool IS_DETERMINISTIC = CommScheduler::IS_DETERMINISTIC;
+    static_assert(ReduceScatter::DispatchPolicy::IsDeterministic == IS_DETERMINISTIC,
+        "Deterministic comm scheduler must be paired with a deterministic reduce epilogue.");
 
     //
     // Params struct: used to pass all the necessary parameters for the operator from the host side
@@ -67,6 +77,7 @@ public:
         GM_ADDR ptrC_accum; LayoutC layoutC_accum; // Address and layout of the C accumulator result
         GM_ADDR ptrD_out; LayoutD layoutD_out;     // Address and layout of the final output D
         uint32_t commInterval;                     // Communication interval, controls the ratio of computation to communication
+        uint32_t workspaceStages{WORKSPACE_STAGES}; // Pipeline depth used at runtime, at most WORKSPACE_STAGES
 
         CATLASS_DEVICE Params() {} // Default constructor
         CATLASS_DEVICE Params(     // Parameterized constructor, for host-side initialization
@@ -79,7 +90,8 @@ public:
             ReduceScatterParams const &reduceScatterParams_, DequantParams const &dequantParams_,
             GM_ADDR ptrC_accum_, LayoutC const &layoutC_accum_, 
             GM_ADDR ptrD_out_, LayoutD const &layoutD_out_, 
-            uint32_t commInterval_
+            uint32_t commInterval_,
+            uint32_t workspaceStages_ = WORKSPACE_STAGES
         ) : problemShape(problemShape_), 
             rankIdx(rank_), rankSize(rankSize_),
             ptrA(ptrA_), layoutA(layoutA_), 
@@ -90,9 +102,20 @@ public:
             dequantParams(dequantParams_),
             ptrC_accum(ptrC_accum_), layoutC_accum(layoutC_accum_), 
             ptrD_out(ptrD_out_), layoutD_out(layoutD_out_),
-            commInterval(commInterval_) {}
+            commInterval(commInterval_), workspaceStages(workspaceStages_) {}
     };
 
+    /// Symmetric workspace bytes one rank needs for a launch on coreNum blocks, the
+    /// layout of ptrSymmetric never goes past it
+    CATLASS_HOST_DEVICE
+    static size_t GetWorkspaceSize(GemmCoord const &problemShape, uint32_t rankSize, uint32_t coreNum,
+        uint32_t commInterval, uint32_t workspaceStages = WORKSPACE_STAGES)
+    {
+        WorkspaceDesc desc{problemShape, L1TileShape::ToCoord(), rankSize, coreNum, commInterval,
+            workspaceStages, static_cast<uint32_t>(sizeof(ElementC))};
+        return GetMatmulReduceScatterWorkspaceSize(desc);
+    }
+
     //
     // Kernel constructor: initializes Flags for inter-core synchronization
     //
@@ -114,22 +137,26 @@ public:
     // Kernel implementation for AIC (AI Core): mainly responsible for high-density matrix multiplication computation
     //
     template <> CATLASS_DEVICE void operator()<AscendC::AIC>(Params &params) {
+        uint32_t workspaceStages = detail::ClampStages(params.workspaceStages, WORKSPACE_STAGES);
         // Get the ID of the current AI Core and the total number of AI Cores
         uint32_t aicoreIndex = AscendC::GetBlockIdx();
         uint32_t aicoreNum = AscendC::GetBlockNum();
         // Calculate size parameters related to computation and communication
         uint32_t blockPerComm = aicoreNum * params.commInterval;
-        uint32_t blockPerCommInRank = blockPerComm / params.rankSize;
 
         // Get the shape of the basic computation unit (Block)
         GemmCoord blockShape = L1TileShape::ToCoord();
-        // Calculate the problem shape handled by the current Rank (M dimension is partitioned)
-        GemmCoord problemShapeInRank = params.problemShape / Catlass::MakeCoord<uint32_t>(params.rankSize, 1, 1);
+        // Calculate the problem shape handled by each Rank (M dimension is partitioned, the first M % rankSize
+        // ranks own one extra row, every rank walks the tile grid of the largest share)
+        detail::RankPartition rankPartition(params.problemShape.m(), params.rankSize);
+        GemmCoord problemShapeInRank{rankPartition.GetMaxExtent(), params.problemShape.n(), params.problemShape.k()};
         // Initialize the computation task scheduler
         BlockScheduler matmulBlockScheduler(problemShapeInRank, blockShape.GetCoordMN());
-        // Calculate the total number of loops
-        uint32_t coreLoops = matmulBlockScheduler.GetCoreLoops() * params.rankSize;
-        uint32_t commLoops = CeilDiv(coreLoops, blockPerComm);
+        // Deal the blocks of every communication chunk to the target Ranks, blockPerComm need not divide evenly
+        detail::ChunkPartition chunkPartition(params.rankSize, blockPerComm, matmulBlockScheduler.GetCoreLoops());
+        uint32_t commLoops = chunkPartition.GetChunkCount();
+        // Each Rank owns a segment of GetSlotsInRank() blocks in every workspace stage
+        uint32_t blockPerStage = chunkPartition.GetSlotsInRank() * params.rankSize;
 
         // Create a matrix multiplication computation object
         BlockMmad blockMmad(resource);
@@ -151,36 +178,47 @@ public:
         gmC_accum.SetGlobalBuffer(reinterpret_cast<__gm__ ElementC *>(params.ptrC_accum));
 
         // Define the layout of the workspace for storing cross-card computation results
-        auto layoutC = Catlass::layout::RowMajor{ WORKSPACE_STAGES * blockPerComm * L1TileShape::M, L1TileShape::N, L1TileShape::N };
-        auto layoutCRowLogicShape = Catlass::MakeCoord<int>(WORKSPACE_STAGES, blockPerComm, L1TileShape::M);
+        auto layoutC = Catlass::layout::RowMajor{ workspaceStages * blockPerStage * L1TileShape::M, L1TileShape::N, L1TileShape::N };
+        auto layoutCRowLogicShape = Catlass::MakeCoord<int>(workspaceStages, blockPerStage, L1TileShape::M);
         auto layoutCRow = layout::AffineRankN<3>::Packed(layoutCRowLogicShape);
 
         // --- Main loop: execute computation in a pipelined manner ---
         for (uint32_t commIdx = 0; commIdx < commLoops; ++commIdx) {
-            uint32_t stageId = commIdx % WORKSPACE_STAGES; // Calculate the current pipeline stage being used
+            uint32_t stageId = commIdx % workspaceStages; // Calculate the current pipeline stage being used
             // If not in the initial stage, wait for AIV to finish processing data from the previous buffer of the same stage
-            if (commIdx >= WORKSPACE_STAGES) { 
+            if (commIdx >= workspaceStages) { 
                 Catlass::Arch::CrossCoreWaitFlag(flagAivFinishCompute[stageId]); 
             }
 
             // Calculate the actual number of blocks to be processed in the current communication cycle
-            uint32_t actualBlockPerComm = (commIdx == commLoops - 1) ? (coreLoops - blockPerComm * commIdx) : blockPerComm;
-            uint32_t actualBlockPerCommInRank = actualBlockPerComm / params.rankSize;
-            uint32_t commBlockOffsetInRank = commIdx * blockPerCommInRank;
+            uint32_t actualBlockPerComm = chunkPartition.GetTotalCount(commIdx);
+            // Size of the per-Rank segment of this chunk in the workspace
+            uint32_t segmentInRank = chunkPartition.GetMaxCount(commIdx);
 
             // Each AI Core processes different computation blocks in a strided manner
             for (uint32_t blockIdxInComm = aicoreIndex; blockIdxInComm < actualBlockPerComm; blockIdxInComm += aicoreNum) {
-                // Calculate the logical ID of the current block in the entire problem and its target Rank
-                uint32_t loopIdxInRank = commBlockOffsetInRank + blockIdxInComm % actualBlockPerCommInRank;
-                uint32_t targetRankIdx = blockIdxInComm / actualBlockPerCommInRank;
+                // Calculate the target Rank of the current block and its logical ID in that Rank's problem
+                uint32_t targetRankIdx;
+                uint32_t blockIdxInRank;
+                chunkPartition.Locate(blockIdxInComm, commIdx, targetRankIdx, blockIdxInRank);
+                uint32_t loopIdxInRank = chunkPartition.GetOffset(targetRankIdx, commIdx) + blockIdxInRank;
+                uint32_t slotIdxInComm = targetRankIdx * segmentInRank + blockIdxInRank;
                 
                 // Get the coordinates and actual shape of the current block from the scheduler
                 GemmCoord blockCoord = matmulBlockScheduler.GetBlockCoord(loopIdxInRank);
                 GemmCoord actualBlockShape = matmulBlockScheduler.GetActualBlockShape(blockCoord);
                 GemmCoord offsetCoord = blockCoord * blockShape;
+                // Skip blocks past the rows owned by the target Rank and clip the last one to its share
+                uint32_t targetExtent = rankPartition.GetExtent(targetRankIdx);
+                if (offsetCoord.m() >= targetExtent) {
+                    continue;
+                }
+                actualBlockShape = GemmCoord{
+                    Min(actualBlockShape.m(), targetExtent - offsetCoord.m()), actualBlockShape.n(), actualBlockShape.k()
+                };
                 
                 // Calculate the offset addresses for matrices A and B
-                auto rankOffsetA = problemShapeInRank.GetCoordMK() * Catlass::MakeCoord<uint32_t>(targetRankIdx, 0);
+                auto rankOffsetA = Catlass::MakeCoord<uint32_t>(rankPartition.GetOffset(targetRankIdx), 0);
                 auto blockOffsetA = offsetCoord.GetCoordMK() + rankOffsetA;
                 auto blockOffsetB = offsetCoord.GetCoordKN();
                 
@@ -188,14 +226,15 @@ public:
                 MatrixCoord blockOffsetStore;
                 AscendC::GlobalTensor<ElementC> gmStore;
                 Catlass::layout::RowMajor layoutStore;
-                if (targetRankIdx == params.rankIdx) {
+                if (targetRankIdx == params.rankIdx && !IS_DETERMINISTIC) {
                     // If computing for the current Rank, store the result directly into the final accumulator gmC_accum
+                    // (in deterministic mode it goes to the workspace and joins the rank-ordered reduction)
                     blockOffsetStore = offsetCoord.GetCoordMN();
                     gmStore = gmC_accum;
                     layoutStore = params.layoutC_accum;
                 } else {
                     // If computing for another Rank, store the result in the workspace of the symmetric memory gmC_workspace
-                    blockOffsetStore = MatrixCoord{layoutCRow(Catlass::MakeCoord<int>(stageId, blockIdxInComm, 0)), 0};
+                    blockOffsetStore = MatrixCoord{layoutCRow(Catlass::MakeCoord<int>(stageId, slotIdxInComm, 0)), 0};
                     gmStore = gmC_workspace;
                     layoutStore = layoutC;
                 }
@@ -226,18 +265,20 @@ public:
     // Kernel implementation for AIV (AI Vector): mainly responsible for communication, bias addition, dequantization, and other post-processing operations
     //
     template <> CATLASS_DEVICE void operator()<AscendC::AIV>(Params &params) {
+        uint32_t workspaceStages = detail::ClampStages(params.workspaceStages, WORKSPACE_STAGES);
         // ... Initialization code similar to that in AIC is omitted ...
         uint32_t aicoreIndex = AscendC::GetBlockIdx() / AscendC::GetSubBlockNum();
         uint32_t aicoreNum = AscendC::GetBlockNum();
         uint32_t aivIndex = AscendC::GetSubBlockIdx();
         uint32_t blockPerComm = aicoreNum * params.commInterval;
-        uint32_t blockPerCommInRank = blockPerComm / params.rankSize;
 
         MatrixCoord blockShapeMN = L1TileShape::ToCoordMN();
-        GemmCoord problemShapeInRank = params.problemShape / Catlass::MakeCoord<uint32_t>(params.rankSize, 1, 1);
+        detail::RankPartition rankPartition(params.problemShape.m(), params.rankSize);
+        GemmCoord problemShapeInRank{rankPartition.GetMaxExtent(), params.problemShape.n(), params.problemShape.k()};
         BlockScheduler matmulBlockScheduler(problemShapeInRank, blockShapeMN);
-        uint32_t coreLoops = matmulBlockScheduler.GetCoreLoops() * params.rankSize;
-        auto commLoops = CeilDiv(coreLoops, blockPerComm);
+        detail::ChunkPartition chunkPartition(params.rankSize, blockPerComm, matmulBlockScheduler.GetCoreLoops());
+        auto commLoops = chunkPartition.GetChunkCount();
+        uint32_t blockPerStage = chunkPartition.GetSlotsInRank() * params.rankSize;
 
         // Initialize the Reduce-Scatter communication object
         ReduceScatter reduceScatter(resource, params.reduceScatterParams);
@@ -249,7 +290,9 @@ public:
 
         MatrixCoord commBlockShape = params.reduceScatterParams.BlockShape();
         MatrixCoord commCoreSplit = params.reduceScatterParams.CoreSplit();
-        MatrixCoord commShape = MatrixCoord{blockPerComm, 1} * blockShapeMN;
+        // The chunk is seen as rankSize segments of segmentInRank blocks, one per target Rank
+        uint32_t segmentInRank = chunkPartition.GetMaxCount(0);
+        MatrixCoord commShape = MatrixCoord{segmentInRank * params.rankSize, 1} * blockShapeMN;
         MatrixCoord dataLoopsMx = CeilDiv(commShape, commBlockShape);
         uint32_t dLoopsInRank = CeilDiv(dataLoopsMx.row() * dataLoopsMx.column(), params.rankSize);
         CommScheduler commScheduler(params.rankIdx, params.rankSize, commCoreSplit, commShape, commBlockShape, dLoopsInRank);
@@ -260,11 +303,11 @@ public:
 
         // --- Main loop: corresponds to the AIC pipeline ---
         for (uint32_t commIdx = 0; commIdx < commLoops; ++commIdx) {
-            uint32_t stageId = commIdx % WORKSPACE_STAGES;
-            // ... Code for handling the boundary case of the last loop is omitted ...
-            if (commIdx == commLoops - 1) {
-                uint32_t actualBlockInComm = coreLoops - commIdx * blockPerComm;
-                commShape = MatrixCoord{actualBlockInComm, 1} * blockShapeMN;
+            uint32_t stageId = commIdx % workspaceStages;
+            // The last chunk may have shorter segments
+            if (chunkPartition.GetMaxCount(commIdx) != segmentInRank) {
+                segmentInRank = chunkPartition.GetMaxCount(commIdx);
+                commShape = MatrixCoord{segmentInRank * params.rankSize, 1} * blockShapeMN;
                 dataLoopsMx = CeilDiv(commShape, commBlockShape);
                 dLoopsInRank = CeilDiv(dataLoopsMx.row() * dataLoopsMx.column(), params.rankSize);
                 commScheduler.Update(commShape, commBlockShape, dLoopsInRank);
@@ -275,14 +318,19 @@ public:
             auto commAicoreNum = commScheduler.GetRealCore();
             auto commCoreLoops = commScheduler.GetCoreLoop();
 
-            MatrixCoord stageOffset = MatrixCoord{stageId * blockPerComm, 0} * blockShapeMN;
-            MatrixCoord commOffsetInRank = MatrixCoord{commIdx * blockPerCommInRank, 0} * blockShapeMN;
+            MatrixCoord stageOffset = MatrixCoord{stageId * blockPerStage, 0} * blockShapeMN;
+            MatrixCoord commOffsetInRank =
+                MatrixCoord{chunkPartition.GetOffset(params.rankIdx, commIdx), 0} * blockShapeMN;
+            // Blocks of the local segment past this count were not computed in this chunk
+            uint32_t blockCountInRank = chunkPartition.GetCount(params.rankIdx, commIdx);
 
             // Wait for AIC to complete computation
             Catlass::Arch::CrossCoreWaitFlag(flagAicFinishStore[stageId]);
             // --- Reduce-Scatter Communication Operation ---
             shmemx_barrier_all_vec(); // All Ranks synchronize here
-            AscendC::SetAtomicAdd<ElementC>(); // Set the hardware atomic add function
+            if constexpr (!IS_DETERMINISTIC) {
+                AscendC::SetAtomicAdd<ElementC>(); // Set the hardware atomic add function
+            }
             AscendC::PipeBarrier<PIPE_ALL>();
 
             // ... It will sum the results in gmC_accum from all Ranks and write the sliced results back to each Rank's own gmC_accum ...
@@ -295,17 +343,25 @@ public:
                     MatrixCoord actualCommBlockShape = commScheduler.template GetActualBlockShape<ReduceScatter::RemoteCopyMode, 
                                                 ReduceScatter::RemoteCopyDirect>(commBlockCoord, layoutComm);
                     MatrixCoord blockOffsetInRank = blockOffset % actualCommShapeInRank;
+                    if (blockOffsetInRank.row() / blockShapeMN.row() >= blockCountInRank) { continue; }
 
                     uint32_t remoteRankIdx = commBlockCoord.column();
-                    if (remoteRankIdx == params.rankIdx) { continue; }
+                    if (!IS_DETERMINISTIC && remoteRankIdx == params.rankIdx) { continue; }
 
                     auto offsetIn = stageOffset + blockOffset;
                     auto offsetOut = commOffsetInRank + blockOffsetInRank;
                     auto globalLoopIdx = offsetOut.row() / blockShapeMN.row();
 
-                    reduceScatter(blockShapeMN, offsetOut, offsetIn, actualCommBlockShape, 
-                                 gmC_accum, params.layoutC_accum, globalLoopIdx, 
-                                 remoteRankIdx % params.rankSize);
+                    if constexpr (IS_DETERMINISTIC) {
+                        // The last argument is the number of ranks to accumulate over
+                        reduceScatter(blockShapeMN, offsetOut, offsetIn, actualCommBlockShape,
+                                     gmC_accum, params.layoutC_accum, globalLoopIdx,
+                                     params.rankSize);
+                    } else {
+                        reduceScatter(blockShapeMN, offsetOut, offsetIn, actualCommBlockShape, 
+                                     gmC_accum, params.layoutC_accum, globalLoopIdx, 
+                                     commScheduler.RankMod(remoteRankIdx));
+                    }
                 }       
             }
             reduceScatter.ReleaseEventID();
@@ -321,7 +377,7 @@ public:
         
         // --- Dequantization Operation ---
         // After all computation and communication are complete, dequantize the final int32 result to get a bfloat16 output
-        uint32_t M_per_rank = params.problemShape.m() / params.rankSize;
+        uint32_t M_per_rank = rankPartition.GetExtent(params.rankIdx);
         uint32_t N = params.problemShape.n();
         GemmCoord problemShapeEpilogue{M_per_rank, N, 1};
         uint32_t coreNum = AscendC::GetBlockNum();
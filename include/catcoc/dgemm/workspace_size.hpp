@@ -0,0 +1,140 @@
+#ifndef CATCOC_DGEMM_WORKSPACE_SIZE_HPP
+#define CATCOC_DGEMM_WORKSPACE_SIZE_HPP
+
+#include <cstddef>
+
+#include "catcoc/detail/chunk_partition.hpp"
+#include "catcoc/detail/k_slices.hpp"
+#include "catcoc/detail/rank_partition.hpp"
+#include "catcoc/detail/tail_split.hpp"
+#include "catcoc/detail/tile_flags.hpp"
+
+// from catlass
+#include "catlass/catlass.hpp"
+#include "catlass/gemm_coord.hpp"
+#include "catlass/matrix_coord.hpp"
+
+namespace Catcoc::detail {
+
+/// Blocks used by a ring of `stages` buffers of blockPerStage blocks each, when commLoops chunks are
+/// pushed through it and the last chunk holds lastBlocks blocks
+CATLASS_HOST_DEVICE
+inline size_t StagedBlocks(uint32_t stages, uint32_t commLoops, uint32_t blockPerStage, uint32_t lastBlocks)
+{
+    if (commLoops == 0) {
+        return 0;
+    }
+    if (commLoops > stages) {
+        return static_cast<size_t>(stages) * blockPerStage;
+    }
+    return static_cast<size_t>(commLoops - 1) * blockPerStage + lastBlocks;
+}
+
+} // namespace Catcoc::detail
+
+namespace Catcoc::DGemm {
+
+/// Everything that decides how much symmetric memory one launch of a comm kernel touches on each rank.
+/// The host sizes shmem_malloc with it, the tiling search filters with it and the kernels lay out their
+/// stages with the same quantities, so a workspace of exactly this size is enough.
+struct WorkspaceDesc {
+    /// Problem shape as passed to the kernel Params
+    Catlass::GemmCoord problemShape;
+    /// L1 tile of the matmul, its M and N (K for all-gather) give the shape of one workspace block
+    Catlass::GemmCoord l1TileShape;
+    uint32_t rankSize{1};
+    /// Launch block count, i.e. AscendC::GetBlockNum() inside the kernel
+    uint32_t coreNum{1};
+    uint32_t commInterval{1};
+    uint32_t workspaceStages{2};
+    /// Size of the element staged in the workspace
+    uint32_t elementBytes{2};
+    /// commInterval of the first chunk, the chunks double up to commInterval, see Catcoc::detail::ChunkRamp.
+    /// 0 keeps every chunk at commInterval, AllGatherMatmul always does.
+    uint32_t firstCommInterval{0};
+    /// Largest K split of the last MatmulAllReduce chunk, see Catcoc::detail::TailSplit, 0 disables it
+    uint32_t tailSplitK{0};
+    /// K slices of every MatmulReduceScatter block, see Catcoc::detail::KSlices, 0 or 1 keeps blocks whole
+    uint32_t splitK{0};
+    /// Non-zero appends a ready flag per stage slot, see Catcoc::detail::TileFlagsLayout. MatmulAllReduce and
+    /// MatmulReduceScatter only.
+    uint32_t tileFlags{0};
+};
+
+/// MatmulAllReduce stages blockPerComm = coreNum * commInterval tiles of M x N per stage, the smaller ramp
+/// chunks use the front of their stage and the K slices of a split last chunk at most coreNum tiles of it
+CATLASS_HOST_DEVICE
+inline Catcoc::detail::TileFlagsLayout GetMatmulAllReduceTileFlags(WorkspaceDesc const &desc)
+{
+    uint32_t tileM = desc.l1TileShape.m();
+    uint32_t tileN = desc.l1TileShape.n();
+    uint32_t coreLoops = ((desc.problemShape.m() + tileM - 1) / tileM) * ((desc.problemShape.n() + tileN - 1) / tileN);
+    uint32_t blockPerComm = desc.coreNum * desc.commInterval;
+    Catcoc::detail::ChunkRamp ramp(blockPerComm, desc.coreNum * desc.firstCommInterval);
+    uint32_t commLoops = ramp.GetChunkCount(coreLoops);
+    uint32_t lastBlocks = (commLoops == 0) ? 0 : ramp.GetActualSize(commLoops - 1, coreLoops);
+    Catcoc::detail::TailSplit tailSplit(lastBlocks, desc.coreNum,
+        (desc.problemShape.k() + desc.l1TileShape.k() - 1) / desc.l1TileShape.k(), desc.tailSplitK);
+    lastBlocks = (tailSplit.GetTaskCount() > lastBlocks) ? tailSplit.GetTaskCount() : lastBlocks;
+    size_t blocks = Catcoc::detail::StagedBlocks(desc.workspaceStages, commLoops, blockPerComm, lastBlocks);
+    uint32_t stages = (commLoops < desc.workspaceStages) ? commLoops : desc.workspaceStages;
+    return Catcoc::detail::TileFlagsLayout(blocks * tileM * tileN * desc.elementBytes, blockPerComm, stages);
+}
+
+CATLASS_HOST_DEVICE
+inline size_t GetMatmulAllReduceWorkspaceSize(WorkspaceDesc const &desc)
+{
+    Catcoc::detail::TileFlagsLayout tileFlags = GetMatmulAllReduceTileFlags(desc);
+    return (desc.tileFlags != 0) ? tileFlags.GetWorkspaceSize() : tileFlags.stagedBytes;
+}
+
+/// MatmulReduceScatter and QuantMatmulReduceScatter deal every chunk to the ranks round robin, each rank
+/// owning a segment of the same size in a stage, see Catcoc::detail::ChunkPartition. With split-K a stage
+/// holds splitK copies of those segments, one per K slice.
+CATLASS_HOST_DEVICE
+inline Catcoc::detail::TileFlagsLayout GetMatmulReduceScatterTileFlags(WorkspaceDesc const &desc)
+{
+    uint32_t tileM = desc.l1TileShape.m();
+    uint32_t tileN = desc.l1TileShape.n();
+    uint32_t tileK = desc.l1TileShape.k();
+    Catcoc::detail::RankPartition rankPartition(desc.problemShape.m(), desc.rankSize);
+    uint32_t loopsInRank = ((rankPartition.GetMaxExtent() + tileM - 1) / tileM) *
+        ((desc.problemShape.n() + tileN - 1) / tileN);
+    Catcoc::detail::KSlices kSlices((desc.problemShape.k() + tileK - 1) / tileK, desc.splitK);
+    Catcoc::detail::ChunkPartition chunkPartition = Catcoc::detail::MakeSplitKChunkPartition(desc.rankSize,
+        desc.coreNum, desc.commInterval, desc.firstCommInterval, loopsInRank, kSlices.splitK);
+    uint32_t commLoops = chunkPartition.GetChunkCount();
+    uint32_t blockPerStage = chunkPartition.GetSlotsInRank() * desc.rankSize * kSlices.splitK;
+    uint32_t lastBlocks = (commLoops == 0) ? 0 :
+        chunkPartition.GetMaxCount(commLoops - 1) * desc.rankSize * kSlices.splitK;
+    size_t blocks = Catcoc::detail::StagedBlocks(desc.workspaceStages, commLoops, blockPerStage, lastBlocks);
+    uint32_t stages = (commLoops < desc.workspaceStages) ? commLoops : desc.workspaceStages;
+    return Catcoc::detail::TileFlagsLayout(blocks * tileM * tileN * desc.elementBytes, blockPerStage, stages);
+}
+
+CATLASS_HOST_DEVICE
+inline size_t GetMatmulReduceScatterWorkspaceSize(WorkspaceDesc const &desc)
+{
+    Catcoc::detail::TileFlagsLayout tileFlags = GetMatmulReduceScatterTileFlags(desc);
+    return (desc.tileFlags != 0) ? tileFlags.GetWorkspaceSize() : tileFlags.stagedBytes;
+}
+
+/// AllGatherMatmul stages commInterval row blocks of M x K from every rank per stage, problemShape is the
+/// gathered shape
+CATLASS_HOST_DEVICE
+inline size_t GetAllGatherMatmulWorkspaceSize(WorkspaceDesc const &desc)
+{
+    uint32_t tileM = desc.l1TileShape.m();
+    Catcoc::detail::RankPartition rankPartition(desc.problemShape.m(), desc.rankSize);
+    uint32_t mLoopsInRank = (rankPartition.GetMaxExtent() + tileM - 1) / tileM;
+    uint32_t commLoops = (mLoopsInRank + desc.commInterval - 1) / desc.commInterval;
+    uint32_t stages = (commLoops < desc.workspaceStages) ? commLoops : desc.workspaceStages;
+    // A stage is strided by commInterval blocks per rank unless the whole rank fits in one chunk
+    uint32_t blocksInRank = (mLoopsInRank < desc.commInterval) ? mLoopsInRank : desc.commInterval;
+    size_t blocks = static_cast<size_t>(stages) * desc.rankSize * blocksInRank;
+    return blocks * tileM * desc.problemShape.k() * desc.elementBytes;
+}
+
+} // namespace Catcoc::DGemm
+
+#endif // CATCOC_DGEMM_WORKSPACE_SIZE_HPP
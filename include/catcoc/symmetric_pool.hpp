@@ -0,0 +1,321 @@
+#ifndef CATCOC_SYMMETRIC_POOL_HPP
+#define CATCOC_SYMMETRIC_POOL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <mutex>
+
+#include "host/shmem_host_heap.h"
+
+#if defined(CATCOC_CHECK_SYMMETRIC_POOL)
+#include <chrono>
+#include <thread>
+
+#include <acl/acl.h>
+
+#include "host/shmem_host_rma.h"
+#include "host/shmem_host_team.h"
+#endif
+
+namespace Catcoc {
+
+/// A workspace handed out by SymmetricPool, offset is relative to the pool base and identical on every rank
+struct SymmetricWorkspace {
+    uint8_t *ptr{nullptr};
+    size_t offset{0};
+    size_t size{0};
+
+    bool IsValid() const
+    {
+        return ptr != nullptr;
+    }
+};
+
+/// Host side pool over one symmetric region, reserved at init with a single collective shmem_malloc so that no
+/// op has to call shmem_malloc/shmem_free, which stall every rank, inside the serving loop.
+///
+/// Ops that may run concurrently, e.g. on different streams, must hold different workspaces. Ops known to run
+/// one after another, e.g. on the same stream, should share one: acquire it for the largest of them and pass it
+/// to each launch. Acquire and Release are local calls, the pool is a first fit allocator whose state only
+/// depends on the sequence of calls, so as long as every rank issues the same sequence each workspace lands at
+/// the same offset on every rank, which the kernels rely on to address the peer copies. SequentialWorkspace does
+/// the sharing for ops on one stream.
+///
+/// The calls are serialized by an internal lock, which keeps the pool consistent when several host threads use it,
+/// but does not order them: threads that acquire concurrently get offsets that differ between ranks. Build with
+/// CATCOC_CHECK_SYMMETRIC_POOL to compare every Acquire against the other ranks, which makes Acquire collective.
+class SymmetricPool {
+public:
+    /// Workspaces start and end on this boundary, so the stages laid out in them stay aligned for the MTE
+    static constexpr size_t DEFAULT_ALIGNMENT = 512;
+
+    SymmetricPool() = default;
+    SymmetricPool(SymmetricPool const &) = delete;
+    SymmetricPool &operator=(SymmetricPool const &) = delete;
+
+    /// Collective, reserves capacity bytes on every rank
+    bool Init(size_t capacity, size_t alignment = DEFAULT_ALIGNMENT)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (base != nullptr || alignment == 0) {
+            return false;
+        }
+        this->alignment = alignment;
+        this->capacity = AlignUp(capacity);
+        base = static_cast<uint8_t *>(shmem_malloc(this->capacity));
+        if (base == nullptr) {
+            this->capacity = 0;
+            return false;
+        }
+        freeBlocks.clear();
+        usedBlocks.clear();
+        freeBlocks[0] = this->capacity;
+#if defined(CATCOC_CHECK_SYMMETRIC_POOL)
+        checkSlot = static_cast<uint64_t *>(shmem_malloc(sizeof(checkMirror)));
+        checkEpoch = 0;
+        if (checkSlot == nullptr) {
+            shmem_free(base);
+            base = nullptr;
+            this->capacity = 0;
+            return false;
+        }
+#endif
+        return true;
+    }
+
+    /// Collective, every workspace is invalid afterwards. Not done in a destructor since it has to happen before
+    /// shmem_finalize on every rank.
+    void Finalize()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (base == nullptr) {
+            return;
+        }
+#if defined(CATCOC_CHECK_SYMMETRIC_POOL)
+        shmem_free(checkSlot);
+        checkSlot = nullptr;
+#endif
+        shmem_free(base);
+        base = nullptr;
+        capacity = 0;
+        freeBlocks.clear();
+        usedBlocks.clear();
+    }
+
+    /// Returns an invalid workspace when no free range is large enough, or in checked builds when the offset
+    /// differs from the one the other ranks got
+    SymmetricWorkspace Acquire(size_t bytes)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        SymmetricWorkspace workspace = AcquireLocked(bytes);
+#if defined(CATCOC_CHECK_SYMMETRIC_POOL)
+        // A failed Acquire takes part as well, the other ranks are waiting for it
+        if (!IsOffsetSymmetric(workspace.IsValid() ? workspace.offset : SIZE_MAX)) {
+            ReleaseLocked(workspace);
+            return SymmetricWorkspace{};
+        }
+#endif
+        return workspace;
+    }
+
+    /// The caller must make sure no launch still using the workspace is in flight. Only the workspace returned by
+    /// Acquire releases its range, views of it with a different size are ignored. A Release that differs between
+    /// ranks shows up in checked builds at the next Acquire.
+    void Release(SymmetricWorkspace &workspace)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ReleaseLocked(workspace);
+    }
+
+    uint8_t *GetBase() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return base;
+    }
+
+    size_t GetCapacity() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return capacity;
+    }
+
+    /// Whether workspace was handed out by this pool and is still held. Its offset is then the same on every rank
+    /// that issued the same sequence of calls, so the peers can address it
+    bool Owns(SymmetricWorkspace const &workspace) const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return OwnsLocked(workspace);
+    }
+
+    /// Largest workspace Acquire can currently return
+    size_t GetMaxAvailable() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        size_t maxSize = 0;
+        for (auto const &block : freeBlocks) {
+            maxSize = (block.second > maxSize) ? block.second : maxSize;
+        }
+        return maxSize;
+    }
+
+private:
+    size_t AlignUp(size_t bytes) const
+    {
+        return (bytes + alignment - 1) / alignment * alignment;
+    }
+
+    SymmetricWorkspace AcquireLocked(size_t bytes)
+    {
+        size_t size = AlignUp((bytes == 0) ? 1 : bytes);
+        for (auto it = freeBlocks.begin(); it != freeBlocks.end(); ++it) {
+            if (it->second < size) {
+                continue;
+            }
+            size_t offset = it->first;
+            size_t remain = it->second - size;
+            freeBlocks.erase(it);
+            if (remain > 0) {
+                freeBlocks[offset + size] = remain;
+            }
+            usedBlocks[offset] = size;
+            return SymmetricWorkspace{base + offset, offset, size};
+        }
+        return SymmetricWorkspace{};
+    }
+
+    bool OwnsLocked(SymmetricWorkspace const &workspace) const
+    {
+        auto used = usedBlocks.find(workspace.offset);
+        return workspace.IsValid() && used != usedBlocks.end() && workspace.ptr == base + workspace.offset &&
+            workspace.size == used->second;
+    }
+
+    void ReleaseLocked(SymmetricWorkspace &workspace)
+    {
+        if (!OwnsLocked(workspace)) {
+            return;
+        }
+        auto used = usedBlocks.find(workspace.offset);
+        size_t offset = used->first;
+        size_t size = used->second;
+        usedBlocks.erase(used);
+        // Merge with the free neighbours so that large workspaces can be acquired again
+        auto next = freeBlocks.lower_bound(offset);
+        if (next != freeBlocks.end() && offset + size == next->first) {
+            size += next->second;
+            next = freeBlocks.erase(next);
+        }
+        if (next != freeBlocks.begin()) {
+            auto prev = std::prev(next);
+            if (prev->first + prev->second == offset) {
+                prev->second += size;
+                workspace = SymmetricWorkspace{};
+                return;
+            }
+        }
+        freeBlocks[offset] = size;
+        workspace = SymmetricWorkspace{};
+    }
+
+#if defined(CATCOC_CHECK_SYMMETRIC_POOL)
+    /// Publishes offset in the check slot and compares it with the one every other rank published for the same
+    /// Acquire. The slot holds {epoch, offset of odd epochs, offset of even epochs}, a rank that is one Acquire
+    /// ahead writes the other entry, so the one being compared stays readable until every rank has moved past it.
+    bool IsOffsetSymmetric(size_t offset)
+    {
+        using namespace std::chrono;
+        constexpr auto CHECK_TIMEOUT = seconds(60);
+        uint64_t epoch = ++checkEpoch;
+        uint32_t entry = 1 + epoch % 2;
+        checkMirror[0] = epoch;
+        checkMirror[entry] = offset;
+        if (aclrtMemcpy(checkSlot, sizeof(checkMirror), checkMirror, sizeof(checkMirror),
+            ACL_MEMCPY_HOST_TO_DEVICE) != ACL_SUCCESS) {
+            return false;
+        }
+        bool symmetric = true;
+        for (int pe = 0; pe < shmem_n_pes(); ++pe) {
+            uint64_t peer[CHECK_WORDS] = {0};
+            auto deadline = steady_clock::now() + CHECK_TIMEOUT;
+            while (peer[0] < epoch) {
+                if (steady_clock::now() > deadline || aclrtMemcpy(peer, sizeof(peer), shmem_ptr(checkSlot, pe),
+                    sizeof(peer), ACL_MEMCPY_DEVICE_TO_HOST) != ACL_SUCCESS) {
+                    return false;
+                }
+                std::this_thread::yield();
+            }
+            symmetric = symmetric && (peer[entry] == offset);
+        }
+        return symmetric;
+    }
+
+    static constexpr uint32_t CHECK_WORDS = 3;
+    uint64_t *checkSlot{nullptr};
+    uint64_t checkEpoch{0};
+    uint64_t checkMirror[CHECK_WORDS] = {0};
+#endif
+
+    uint8_t *base{nullptr};
+    size_t capacity{0};
+    size_t alignment{DEFAULT_ALIGNMENT};
+    /// offset -> size, ordered so that the first fit and the merging are deterministic
+    std::map<size_t, size_t> freeBlocks;
+    std::map<size_t, size_t> usedBlocks;
+    mutable std::mutex mutex;
+};
+
+/// One workspace shared by ops that run one after another, e.g. every op launched on one stream. View returns the
+/// first bytes of it and grows it when an op needs more, so the ops hold the range of the largest of them instead
+/// of one range each. Every rank must request the same sizes in the same order, and the views must not be passed
+/// to SymmetricPool::Release.
+class SequentialWorkspace {
+public:
+    explicit SequentialWorkspace(SymmetricPool &pool) : pool(pool) {}
+    SequentialWorkspace(SequentialWorkspace const &) = delete;
+    SequentialWorkspace &operator=(SequentialWorkspace const &) = delete;
+
+    /// Whether View(bytes) has to grow the workspace, the caller must then make sure no launch using a previous
+    /// view is in flight, e.g. by synchronizing the stream
+    bool NeedsGrow(size_t bytes) const
+    {
+        return !workspace.IsValid() || bytes > workspace.size;
+    }
+
+    /// Returns an invalid workspace when the pool cannot hold bytes. The workspace then keeps its previous size,
+    /// but may have moved, so views are to be taken again before each launch rather than kept
+    SymmetricWorkspace View(size_t bytes)
+    {
+        if (NeedsGrow(bytes)) {
+            size_t size = workspace.size;
+            pool.Release(workspace);
+            workspace = pool.Acquire(bytes);
+            if (!workspace.IsValid()) {
+                // The released range is free again, so this only fails when nothing was held before
+                workspace = (size == 0) ? SymmetricWorkspace{} : pool.Acquire(size);
+                return SymmetricWorkspace{};
+            }
+        }
+        return SymmetricWorkspace{workspace.ptr, workspace.offset, bytes};
+    }
+
+    /// Not done in a destructor since it has to happen before SymmetricPool::Finalize
+    void Release()
+    {
+        pool.Release(workspace);
+    }
+
+    size_t GetSize() const
+    {
+        return workspace.size;
+    }
+
+private:
+    SymmetricPool &pool;
+    SymmetricWorkspace workspace;
+};
+
+} // namespace Catcoc
+
+#endif // CATCOC_SYMMETRIC_POOL_HPP